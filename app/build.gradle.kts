@@ -17,7 +17,7 @@ android {
         testInstrumentationRunner = "androidx.test.runner.AndroidJUnitRunner"
         externalNativeBuild {
             cmake {
-                cppFlags += "-std=c++17"
+                cppFlags += "-std=c++20"
             }
         }
     }
@@ -41,6 +41,10 @@ android {
     buildFeatures {
         prefab = true
     }
+    androidResources {
+        // The asset bundle is memory mapped straight out of the APK, which needs it stored uncompressed
+        noCompress += "pak"
+    }
     externalNativeBuild {
         cmake {
             path = file("src/main/cpp/CMakeLists.txt")
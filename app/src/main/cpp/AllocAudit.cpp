@@ -0,0 +1,87 @@
+#include "AllocAudit.h"
+
+#ifdef PALIBRIX_ALLOC_AUDIT
+
+#include "AndroidOut.h"
+#include <atomic>
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+// Per thread so an allocation on the UI thread is never blamed on a frame and vice versa
+static thread_local uint64_t t_allocations = 0;
+static thread_local uint64_t t_exemptions = 0;
+static std::atomic<uint32_t> g_scopesCompleted{0};
+
+static void* countedAlloc(size_t size) {
+    ++t_allocations;
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+static void* countedAlignedAlloc(size_t size, std::align_val_t align) {
+    ++t_allocations;
+    void* p = nullptr;
+    if (posix_memalign(&p, std::max(sizeof(void*), static_cast<size_t>(align)), size ? size : 1) != 0) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new(size_t size) { return countedAlloc(size); }
+void* operator new[](size_t size) { return countedAlloc(size); }
+void* operator new(size_t size, std::align_val_t align) { return countedAlignedAlloc(size, align); }
+void* operator new[](size_t size, std::align_val_t align) { return countedAlignedAlloc(size, align); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    ++t_allocations;
+    return malloc(size ? size : 1);
+}
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    ++t_allocations;
+    return malloc(size ? size : 1);
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { free(p); }
+
+namespace AllocAudit {
+
+uint64_t threadAllocationCount() {
+    return t_allocations;
+}
+
+void exemptOpenScopes() {
+    ++t_exemptions;
+}
+
+Scope::Scope(const char* what) : what_(what), start_(t_allocations), exemptions_(t_exemptions) {}
+
+Scope::~Scope() {
+    uint64_t allocations = t_allocations - start_;
+    bool warmedUp = g_scopesCompleted.fetch_add(1, std::memory_order_relaxed) >= kWarmupScopes;
+    if (warmedUp && allocations != 0 && t_exemptions == exemptions_) {
+        aout << "AllocAudit: " << what_ << " made " << allocations
+             << " heap allocation(s) after warm-up" << std::endl;
+        abort();
+    }
+}
+
+Untracked::Untracked() : start_(t_allocations) {}
+
+Untracked::~Untracked() {
+    t_allocations = start_;
+}
+
+} // namespace AllocAudit
+
+#endif
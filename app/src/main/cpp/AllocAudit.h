@@ -0,0 +1,66 @@
+#ifndef PALIBRIX_ALLOCAUDIT_H
+#define PALIBRIX_ALLOCAUDIT_H
+
+#include <cstdint>
+
+/*!
+ * Steady-state allocation auditing, enabled by configuring with -DPALIBRIX_ALLOC_AUDIT=ON.
+ *
+ * In that build the global operator new/delete are replaced with counting versions, and every
+ * ALLOC_AUDIT_SCOPE (one per simulation tick, input and rendered frame) checks that the code
+ * inside it did not allocate. The first kWarmupScopes scopes are allowed to allocate so lazy
+ * setup can finish; after that any allocation is logged and aborts the process. Setup that can
+ * come back later, like recreating GPU objects after a context loss, exempts the scopes it
+ * runs in with ALLOC_AUDIT_EXEMPT, and ALLOC_AUDIT_UNTRACKED leaves out allocations that stand in
+ * for the driver's own, like the host GL recorder's bookkeeping.
+ *
+ * In normal builds the macro expands to nothing.
+ */
+#ifdef PALIBRIX_ALLOC_AUDIT
+
+namespace AllocAudit {
+
+constexpr uint32_t kWarmupScopes = 600;
+
+// Heap allocations made by the calling thread so far
+uint64_t threadAllocationCount();
+
+// Lets the scopes open on the calling thread allocate
+void exemptOpenScopes();
+
+class Scope {
+public:
+    explicit Scope(const char* what);
+    ~Scope();
+
+private:
+    const char* what_;
+    uint64_t start_;
+    uint64_t exemptions_;
+};
+
+// Allocations made while one is alive are not counted
+class Untracked {
+public:
+    Untracked();
+    ~Untracked();
+
+private:
+    uint64_t start_;
+};
+
+} // namespace AllocAudit
+
+#define ALLOC_AUDIT_SCOPE(what) AllocAudit::Scope allocAuditScope_(what)
+#define ALLOC_AUDIT_EXEMPT() AllocAudit::exemptOpenScopes()
+#define ALLOC_AUDIT_UNTRACKED() AllocAudit::Untracked allocAuditUntracked_
+
+#else
+
+#define ALLOC_AUDIT_SCOPE(what)
+#define ALLOC_AUDIT_EXEMPT()
+#define ALLOC_AUDIT_UNTRACKED()
+
+#endif
+
+#endif //PALIBRIX_ALLOCAUDIT_H
@@ -0,0 +1,149 @@
+#include "AssetBundle.h"
+#include "ByteStream.h"
+#include "AndroidOut.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+AssetBundle::AssetBundle()
+        : fd_(-1), fileOffset_(0), mapping_(nullptr), mappingSize_(0), base_(nullptr), size_(0) {}
+
+AssetBundle::~AssetBundle() {
+    close();
+}
+
+bool AssetBundle::openFile(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        aout << "Could not open asset bundle " << path << std::endl;
+        return false;
+    }
+    struct stat info;
+    bool opened = fstat(fd, &info) == 0 && openDescriptor(fd, 0, info.st_size);
+    ::close(fd);
+    return opened;
+}
+
+bool AssetBundle::openDescriptor(int fd, off_t offset, off_t length) {
+    close();
+    if (length < static_cast<off_t>(kAssetHeaderSize)) {
+        return false;
+    }
+
+    // mmap wants a page aligned offset; APK assets start anywhere
+    off_t pageSize = sysconf(_SC_PAGESIZE);
+    off_t mapOffset = offset - offset % pageSize;
+    size_t lead = static_cast<size_t>(offset - mapOffset);
+    size_t mappingSize = lead + static_cast<size_t>(length);
+    void* mapped = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, mapOffset);
+    if (mapped == MAP_FAILED) {
+        aout << "Could not map asset bundle" << std::endl;
+        return false;
+    }
+    fd_ = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    fileOffset_ = offset;
+    mapping_ = static_cast<uint8_t*>(mapped);
+    mappingSize_ = mappingSize;
+    base_ = mapping_ + lead;
+    size_ = static_cast<size_t>(length);
+
+    if (!parseIndex()) {
+        aout << "Not a valid asset bundle" << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+#ifdef __ANDROID__
+bool AssetBundle::openAsset(AAssetManager* assets, const char* name) {
+    AAsset* asset = AAssetManager_open(assets, name, AASSET_MODE_UNKNOWN);
+    if (!asset) {
+        aout << "No asset " << name << std::endl;
+        return false;
+    }
+    off64_t start = 0;
+    off64_t length = 0;
+    int fd = AAsset_openFileDescriptor64(asset, &start, &length);
+    AAsset_close(asset);
+    if (fd < 0) {
+        // Compressed inside the APK; the bundle has to be listed in noCompress
+        aout << "Asset " << name << " is compressed, cannot map it" << std::endl;
+        return false;
+    }
+    bool opened = openDescriptor(fd, start, length);
+    ::close(fd);
+    return opened;
+}
+#endif
+
+void AssetBundle::close() {
+    if (mapping_) {
+        munmap(mapping_, mappingSize_);
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+    fd_ = -1;
+    fileOffset_ = 0;
+    mapping_ = nullptr;
+    mappingSize_ = 0;
+    base_ = nullptr;
+    size_ = 0;
+    entries_.clear();
+}
+
+const AssetEntry* AssetBundle::find(const char* name) const {
+    auto it = std::lower_bound(entries_.begin(), entries_.end(), name,
+                               [](const AssetEntry& entry, const char* key) {
+                                   return strncmp(entry.name, key, kAssetNameSize) < 0;
+                               });
+    if (it == entries_.end() || strncmp(it->name, name, kAssetNameSize) != 0) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+void AssetBundle::prefetch(const AssetEntry& entry) const {
+    // madvise needs a page aligned start
+    uintptr_t start = reinterpret_cast<uintptr_t>(data(entry));
+    uintptr_t pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    uintptr_t alignedStart = start - start % pageSize;
+    madvise(reinterpret_cast<void*>(alignedStart), static_cast<size_t>(start - alignedStart + entry.size),
+            MADV_WILLNEED);
+}
+
+bool AssetBundle::parseIndex() {
+    ByteReader header(base_, kAssetHeaderSize);
+    uint32_t magic = header.getU32();
+    uint16_t version = header.getU16();
+    uint16_t count = header.getU16();
+    uint64_t totalSize = header.getU64();
+    if (magic != kAssetBundleMagic || version != kAssetBundleVersion || totalSize != size_
+        || kAssetHeaderSize + count * kAssetIndexEntrySize > size_) {
+        return false;
+    }
+
+    ByteReader in(base_ + kAssetHeaderSize, count * kAssetIndexEntrySize);
+    entries_.resize(count);
+    for (AssetEntry& entry : entries_) {
+        memcpy(entry.name, in.getBytes(kAssetNameSize), kAssetNameSize);
+        entry.name[kAssetNameSize - 1] = '\0';
+        entry.format = static_cast<AssetFormat>(in.getU16());
+        in.getU16(); // Reserved
+        entry.param = in.getU32();
+        entry.offset = in.getU64();
+        entry.size = in.getU64();
+        if (entry.offset % kAssetAlignment != 0 || entry.offset > size_ || entry.size > size_ - entry.offset) {
+            return false;
+        }
+    }
+    return in.ok() && std::is_sorted(entries_.begin(), entries_.end(),
+                                     [](const AssetEntry& a, const AssetEntry& b) {
+                                         return strncmp(a.name, b.name, kAssetNameSize) < 0;
+                                     });
+}
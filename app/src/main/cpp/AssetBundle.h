@@ -0,0 +1,95 @@
+#ifndef PALIBRIX_ASSETBUNDLE_H
+#define PALIBRIX_ASSETBUNDLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+#ifdef __ANDROID__
+#include <android/asset_manager.h>
+#endif
+
+// Packed asset archive, written by tools/asset_packer:
+//   header (16 bytes): magic "PLPK", u16 version, u16 entry count, u64 total size
+//   index: one 64-byte entry per asset, sorted by name
+//   payloads, each starting on a kAssetAlignment boundary
+// All integers little endian.
+constexpr uint32_t kAssetBundleMagic = 0x4b504c50; // "PLPK"
+constexpr uint16_t kAssetBundleVersion = 1;
+constexpr size_t kAssetHeaderSize = 16;
+constexpr size_t kAssetIndexEntrySize = 64;
+constexpr size_t kAssetNameSize = 40; // NUL padded
+constexpr size_t kAssetAlignment = 16; // Enough for vector loads straight from the mapping
+
+enum class AssetFormat : uint16_t {
+    Raw = 0,        // Bytes as packed
+    PcmF32Mono = 1, // Native-endian float samples, param = sample rate
+    Compressed = 2, // Encoded audio (MP3, Opus, ...) for the platform decoder
+};
+
+struct AssetEntry {
+    char name[kAssetNameSize];
+    AssetFormat format;
+    uint32_t param;
+    uint64_t offset; // From the start of the bundle
+    uint64_t size;
+};
+
+/*!
+ * Read-only view of a packed asset bundle. The whole file is memory mapped once; entry payloads
+ * are used in place, so loading an asset costs page faults rather than reads and copies.
+ *
+ * On device the bundle is an uncompressed APK asset (noCompress in build.gradle.kts), mapped
+ * through the descriptor AAsset_openFileDescriptor64 hands out; on host it is a plain file.
+ * Payload pointers stay valid until the bundle is destroyed.
+ */
+class AssetBundle {
+public:
+    AssetBundle();
+    ~AssetBundle();
+
+    AssetBundle(const AssetBundle&) = delete;
+    AssetBundle& operator=(const AssetBundle&) = delete;
+
+    bool openFile(const std::string& path);
+
+    // Maps length bytes at offset of fd; keeps its own duplicate of the descriptor
+    bool openDescriptor(int fd, off_t offset, off_t length);
+
+#ifdef __ANDROID__
+    bool openAsset(AAssetManager* assets, const char* name);
+#endif
+
+    void close();
+
+    bool isOpen() const { return base_ != nullptr; }
+    const std::vector<AssetEntry>& getEntries() const { return entries_; }
+
+    const AssetEntry* find(const char* name) const;
+    const uint8_t* data(const AssetEntry& entry) const { return base_ + entry.offset; }
+
+    // Asks the kernel to read the entry's pages ahead, for assets needed right away
+    void prefetch(const AssetEntry& entry) const;
+
+    /*!
+     * The descriptor and the entry's offset in it, for APIs that decode from a file
+     * (AMediaExtractor). Valid while the bundle is open.
+     */
+    int getDescriptor() const { return fd_; }
+    off_t getDescriptorOffset(const AssetEntry& entry) const { return fileOffset_ + entry.offset; }
+
+private:
+    bool parseIndex();
+
+    int fd_;
+    off_t fileOffset_;      // Of the bundle within fd_
+    uint8_t* mapping_;      // Page aligned start of the mapping
+    size_t mappingSize_;
+    const uint8_t* base_;   // Start of the bundle inside the mapping
+    size_t size_;
+    std::vector<AssetEntry> entries_;
+};
+
+#endif //PALIBRIX_ASSETBUNDLE_H
@@ -0,0 +1,298 @@
+#include "AudioEngine.h"
+#include "AssetBundle.h"
+#include "AndroidOut.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef __ANDROID__
+#include <media/NdkMediaCodec.h>
+#include <media/NdkMediaExtractor.h>
+#endif
+
+static const char* const kEffectAssets[] = {
+        "sfx/lock", "sfx/line_clear", "sfx/rotate", "sfx/hold", "sfx/click", "sfx/game_over",
+};
+static_assert(sizeof(kEffectAssets) / sizeof(kEffectAssets[0]) == static_cast<size_t>(SoundEffect::Count),
+              "every effect needs an asset name");
+
+AudioEngine::AudioEngine()
+        : sampleRate_(48000), effectSamples_(), effectFrames_(), voices_(), queueHead_(0), queueTail_(0) {
+    for (auto& loaded : effectLoaded_) {
+        loaded.store(false);
+    }
+}
+
+AudioEngine::~AudioEngine() {}
+
+bool AudioEngine::loadPcm(SoundEffect effect, const int16_t* samples, size_t frames, int channels,
+                          int sampleRate) {
+    int id = static_cast<int>(effect);
+    if (effectLoaded_[id].load(std::memory_order_acquire)) return false;
+    if (channels <= 0 || sampleRate <= 0 || frames == 0) return false;
+
+    // Downmix to mono, then linearly resample to the engine rate. This only happens at load
+    // time so the mixer never has to convert anything.
+    std::vector<float> mono(frames);
+    for (size_t i = 0; i < frames; ++i) {
+        float sum = 0.0f;
+        for (int c = 0; c < channels; ++c) {
+            sum += samples[i * channels + c];
+        }
+        mono[i] = sum / (channels * 32768.0f);
+    }
+
+    std::vector<float>& out = effectCache_[id];
+    if (sampleRate == sampleRate_) {
+        out = std::move(mono);
+    } else {
+        double step = (double)sampleRate / sampleRate_;
+        size_t outFrames = (size_t)(frames / step);
+        out.resize(outFrames);
+        for (size_t i = 0; i < outFrames; ++i) {
+            double src = i * step;
+            size_t i0 = (size_t)src;
+            size_t i1 = std::min(i0 + 1, frames - 1);
+            float t = (float)(src - i0);
+            out[i] = mono[i0] + (mono[i1] - mono[i0]) * t;
+        }
+    }
+
+    publish(effect, out.data(), out.size());
+    return true;
+}
+
+bool AudioEngine::loadMapped(SoundEffect effect, const float* samples, size_t frames, int sampleRate) {
+    int id = static_cast<int>(effect);
+    if (effectLoaded_[id].load(std::memory_order_acquire)) return false;
+    if (sampleRate <= 0 || frames == 0) return false;
+
+    if (sampleRate == sampleRate_ && reinterpret_cast<uintptr_t>(samples) % alignof(float) == 0) {
+        publish(effect, samples, frames); // Zero copy: the mixer reads the mapping
+        return true;
+    }
+
+    std::vector<float>& out = effectCache_[id];
+    double step = (double)sampleRate / sampleRate_;
+    size_t outFrames = (size_t)(frames / step);
+    out.resize(outFrames);
+    for (size_t i = 0; i < outFrames; ++i) {
+        double src = i * step;
+        size_t i0 = (size_t)src;
+        size_t i1 = std::min(i0 + 1, frames - 1);
+        float t = (float)(src - i0);
+        float s0;
+        float s1;
+        memcpy(&s0, samples + i0, sizeof(float)); // The source may be unaligned
+        memcpy(&s1, samples + i1, sizeof(float));
+        out[i] = s0 + (s1 - s0) * t;
+    }
+    publish(effect, out.data(), out.size());
+    return true;
+}
+
+int AudioEngine::loadBundle(const AssetBundle& bundle) {
+    int loaded = 0;
+    for (int id = 0; id < static_cast<int>(SoundEffect::Count); ++id) {
+        auto effect = static_cast<SoundEffect>(id);
+        const AssetEntry* entry = bundle.find(kEffectAssets[id]);
+        if (!entry) {
+            continue;
+        }
+        bool ok = false;
+        if (entry->format == AssetFormat::PcmF32Mono) {
+            bundle.prefetch(*entry);
+            ok = loadMapped(effect, reinterpret_cast<const float*>(bundle.data(*entry)),
+                            entry->size / sizeof(float), static_cast<int>(entry->param));
+        }
+#ifdef __ANDROID__
+        else if (entry->format == AssetFormat::Compressed) {
+            ok = loadCompressed(effect, bundle.getDescriptor(), bundle.getDescriptorOffset(*entry),
+                                static_cast<off_t>(entry->size));
+        }
+#endif
+        if (!ok) {
+            aout << "Audio: could not load " << kEffectAssets[id] << std::endl;
+        }
+        loaded += ok;
+    }
+    return loaded;
+}
+
+void AudioEngine::publish(SoundEffect effect, const float* samples, size_t frames) {
+    int id = static_cast<int>(effect);
+    effectSamples_[id] = samples;
+    effectFrames_[id] = static_cast<int32_t>(frames);
+    effectLoaded_[id].store(true, std::memory_order_release);
+}
+
+#ifdef __ANDROID__
+bool AudioEngine::loadCompressed(SoundEffect effect, int fd, off_t offset, off_t length) {
+    AMediaExtractor* extractor = AMediaExtractor_new();
+    if (AMediaExtractor_setDataSourceFd(extractor, fd, offset, length) != AMEDIA_OK) {
+        aout << "Audio: failed to open effect " << static_cast<int>(effect) << std::endl;
+        AMediaExtractor_delete(extractor);
+        return false;
+    }
+
+    // Pick the first audio track
+    AMediaFormat* format = nullptr;
+    const char* mime = nullptr;
+    for (size_t i = 0; i < AMediaExtractor_getTrackCount(extractor); ++i) {
+        AMediaFormat* trackFormat = AMediaExtractor_getTrackFormat(extractor, i);
+        const char* trackMime = nullptr;
+        if (AMediaFormat_getString(trackFormat, AMEDIAFORMAT_KEY_MIME, &trackMime)
+            && strncmp(trackMime, "audio/", 6) == 0) {
+            AMediaExtractor_selectTrack(extractor, i);
+            format = trackFormat;
+            mime = trackMime;
+            break;
+        }
+        AMediaFormat_delete(trackFormat);
+    }
+    if (!format) {
+        aout << "Audio: no audio track in effect " << static_cast<int>(effect) << std::endl;
+        AMediaExtractor_delete(extractor);
+        return false;
+    }
+
+    int32_t sampleRate = 0;
+    int32_t channels = 0;
+    AMediaFormat_getInt32(format, AMEDIAFORMAT_KEY_SAMPLE_RATE, &sampleRate);
+    AMediaFormat_getInt32(format, AMEDIAFORMAT_KEY_CHANNEL_COUNT, &channels);
+
+    AMediaCodec* codec = AMediaCodec_createDecoderByType(mime);
+    if (!codec || AMediaCodec_configure(codec, format, nullptr, nullptr, 0) != AMEDIA_OK
+        || AMediaCodec_start(codec) != AMEDIA_OK) {
+        aout << "Audio: no decoder for " << mime << std::endl;
+        if (codec) AMediaCodec_delete(codec);
+        AMediaFormat_delete(format);
+        AMediaExtractor_delete(extractor);
+        return false;
+    }
+
+    std::vector<int16_t> pcm;
+    bool inputDone = false;
+    bool outputDone = false;
+    while (!outputDone) {
+        if (!inputDone) {
+            ssize_t inIndex = AMediaCodec_dequeueInputBuffer(codec, 10000);
+            if (inIndex >= 0) {
+                size_t capacity = 0;
+                uint8_t* buffer = AMediaCodec_getInputBuffer(codec, inIndex, &capacity);
+                ssize_t size = AMediaExtractor_readSampleData(extractor, buffer, capacity);
+                if (size < 0) {
+                    AMediaCodec_queueInputBuffer(codec, inIndex, 0, 0, 0,
+                                                 AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM);
+                    inputDone = true;
+                } else {
+                    AMediaCodec_queueInputBuffer(codec, inIndex, 0, size,
+                                                 AMediaExtractor_getSampleTime(extractor), 0);
+                    AMediaExtractor_advance(extractor);
+                }
+            }
+        }
+
+        AMediaCodecBufferInfo info;
+        ssize_t outIndex = AMediaCodec_dequeueOutputBuffer(codec, &info, 10000);
+        if (outIndex >= 0) {
+            size_t capacity = 0;
+            uint8_t* buffer = AMediaCodec_getOutputBuffer(codec, outIndex, &capacity);
+            auto* samples = reinterpret_cast<const int16_t*>(buffer + info.offset);
+            pcm.insert(pcm.end(), samples, samples + info.size / sizeof(int16_t));
+            AMediaCodec_releaseOutputBuffer(codec, outIndex, false);
+            outputDone = (info.flags & AMEDIACODEC_BUFFER_FLAG_END_OF_STREAM) != 0;
+        } else if (outIndex == AMEDIACODEC_INFO_OUTPUT_FORMAT_CHANGED) {
+            AMediaFormat* outFormat = AMediaCodec_getOutputFormat(codec);
+            AMediaFormat_getInt32(outFormat, AMEDIAFORMAT_KEY_SAMPLE_RATE, &sampleRate);
+            AMediaFormat_getInt32(outFormat, AMEDIAFORMAT_KEY_CHANNEL_COUNT, &channels);
+            AMediaFormat_delete(outFormat);
+        }
+    }
+
+    AMediaCodec_stop(codec);
+    AMediaCodec_delete(codec);
+    AMediaFormat_delete(format);
+    AMediaExtractor_delete(extractor);
+
+    if (channels <= 0) return false;
+    return loadPcm(effect, pcm.data(), pcm.size() / channels, channels, sampleRate);
+}
+#endif
+
+void AudioEngine::play(SoundEffect effect, float gain) {
+    if (!effectLoaded_[static_cast<int>(effect)].load(std::memory_order_acquire)) return;
+
+    uint32_t tail = queueTail_.load(std::memory_order_relaxed);
+    if (tail - queueHead_.load(std::memory_order_acquire) >= kQueueSize) {
+        return; // Queue full, the audio thread is stalled; drop rather than block
+    }
+    queue_[tail % kQueueSize] = {effect, gain};
+    queueTail_.store(tail + 1, std::memory_order_release);
+}
+
+void AudioEngine::onGameEvent(const GameEvent& event) {
+    switch (event.type) {
+        case GameEventType::PieceLocked:
+            play(SoundEffect::Lock);
+            break;
+        case GameEventType::LineClear:
+            play(SoundEffect::LineClear);
+            break;
+        default:
+            break;
+    }
+}
+
+void AudioEngine::startVoice(const PlayCommand& command) {
+    int id = static_cast<int>(command.effect);
+
+    // Use a free voice, or steal the one closest to finishing
+    Voice* target = &voices_[0];
+    for (Voice& voice : voices_) {
+        if (!voice.samples) {
+            target = &voice;
+            break;
+        }
+        if (voice.length - voice.position < target->length - target->position) {
+            target = &voice;
+        }
+    }
+
+    target->samples = effectSamples_[id];
+    target->length = effectFrames_[id];
+    target->position = 0;
+    target->gain = command.gain;
+}
+
+void AudioEngine::render(float* out, int32_t frames) {
+    // Start voices requested since the last callback
+    uint32_t head = queueHead_.load(std::memory_order_relaxed);
+    uint32_t tail = queueTail_.load(std::memory_order_acquire);
+    for (; head != tail; ++head) {
+        startVoice(queue_[head % kQueueSize]);
+    }
+    queueHead_.store(head, std::memory_order_release);
+
+    memset(out, 0, frames * kChannels * sizeof(float));
+
+    for (Voice& voice : voices_) {
+        if (!voice.samples) continue;
+
+        int32_t count = std::min(frames, voice.length - voice.position);
+        const float* src = voice.samples + voice.position;
+        for (int32_t i = 0; i < count; ++i) {
+            float s = src[i] * voice.gain;
+            out[i * 2] += s;
+            out[i * 2 + 1] += s;
+        }
+
+        voice.position += count;
+        if (voice.position >= voice.length) {
+            voice.samples = nullptr;
+        }
+    }
+
+    for (int32_t i = 0; i < frames * kChannels; ++i) {
+        out[i] = std::min(1.0f, std::max(-1.0f, out[i]));
+    }
+}
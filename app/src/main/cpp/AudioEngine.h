@@ -0,0 +1,117 @@
+#ifndef PALIBRIX_AUDIOENGINE_H
+#define PALIBRIX_AUDIOENGINE_H
+
+#include <atomic>
+#include <cstdint>
+#include <sys/types.h>
+#include <vector>
+
+#include "Game.h"
+
+enum class SoundEffect {
+    Lock, LineClear, Rotate, Hold, Click, GameOver, Count
+};
+
+class AssetBundle;
+
+/*!
+ * Native sound effect mixer.
+ *
+ * Effects are mono float PCM at the engine sample rate: played straight from a mapped asset
+ * bundle when it was packed at that rate, otherwise decoded or resampled once into a cache. Game code
+ * triggers voices with play(), which only pushes onto a lock-free queue; the audio callback
+ * drains that queue and mixes all active voices in render(). An AudioSink drives render() from
+ * a real-time callback (AAudio on device) or offline (WAV file on host).
+ */
+class AudioEngine {
+public:
+    static constexpr int kMaxVoices = 16;
+    static constexpr int kChannels = 2; // render() output is interleaved stereo
+
+    AudioEngine();
+    ~AudioEngine();
+
+    /*!
+     * Sets the output rate. Must be called before any effect is loaded.
+     */
+    void setSampleRate(int sampleRate) { sampleRate_ = sampleRate; }
+    int getSampleRate() const { return sampleRate_; }
+
+    /*!
+     * Stores interleaved 16-bit PCM as an effect, downmixed to mono and resampled to the
+     * engine rate. Each effect can only be loaded once.
+     */
+    bool loadPcm(SoundEffect effect, const int16_t* samples, size_t frames, int channels, int sampleRate);
+
+    /*!
+     * Uses mono float PCM as an effect. At the engine rate the samples are referenced in place
+     * and must stay valid as long as the engine; otherwise they are resampled into the cache.
+     */
+    bool loadMapped(SoundEffect effect, const float* samples, size_t frames, int sampleRate);
+
+    /*!
+     * Loads every effect the bundle has ("sfx/lock", "sfx/line_clear", ...): PCM entries with
+     * loadMapped(), compressed ones through the platform decoder (device only). The bundle must
+     * outlive the engine. Returns the number of effects loaded.
+     */
+    int loadBundle(const AssetBundle& bundle);
+
+#ifdef __ANDROID__
+    /*!
+     * Decodes a compressed effect (e.g. an MP3 from res/raw) with AMediaCodec and caches it.
+     * The descriptor is only used during the call.
+     */
+    bool loadCompressed(SoundEffect effect, int fd, off_t offset, off_t length);
+#endif
+
+    /*!
+     * Starts a voice for the effect. Safe to call from one game thread while render() runs.
+     */
+    void play(SoundEffect effect, float gain = 1.0f);
+
+    /*!
+     * Triggers the sound for a game event, if it has one.
+     */
+    void onGameEvent(const GameEvent& event);
+
+    /*!
+     * Mixes the next frames into out (interleaved stereo float). Called from the audio thread.
+     */
+    void render(float* out, int32_t frames);
+
+private:
+    struct Voice {
+        const float* samples;
+        int32_t length;
+        int32_t position;
+        float gain;
+    };
+
+    struct PlayCommand {
+        SoundEffect effect;
+        float gain;
+    };
+
+    void startVoice(const PlayCommand& command);
+
+    int sampleRate_;
+
+    void publish(SoundEffect effect, const float* samples, size_t frames);
+
+    // Effect samples point into effectCache_ or into a mapped bundle
+    const float* effectSamples_[static_cast<int>(SoundEffect::Count)];
+    int32_t effectFrames_[static_cast<int>(SoundEffect::Count)];
+    std::vector<float> effectCache_[static_cast<int>(SoundEffect::Count)];
+    std::atomic<bool> effectLoaded_[static_cast<int>(SoundEffect::Count)];
+
+    // Voices are only touched by the audio thread
+    Voice voices_[kMaxVoices];
+
+    // Single producer / single consumer queue of play requests
+    static constexpr uint32_t kQueueSize = 32;
+    PlayCommand queue_[kQueueSize];
+    std::atomic<uint32_t> queueHead_; // Written by the audio thread
+    std::atomic<uint32_t> queueTail_; // Written by the game thread
+};
+
+#endif //PALIBRIX_AUDIOENGINE_H
@@ -0,0 +1,181 @@
+#include "AudioSink.h"
+#include "AndroidOut.h"
+#include <vector>
+
+#ifdef __ANDROID__
+AAudioSink::AAudioSink() : engine_(nullptr), stream_(nullptr), stopping_(false) {}
+
+AAudioSink::~AAudioSink() {
+    stop();
+}
+
+bool AAudioSink::start(AudioEngine& engine) {
+    std::lock_guard<std::mutex> guard(lock_);
+    engine_ = &engine;
+    stopping_ = false;
+    if (!stream_ && !openStream()) {
+        return false;
+    }
+    return AAudioStream_requestStart(stream_) == AAUDIO_OK;
+}
+
+void AAudioSink::stop() {
+    std::thread restart;
+    AAudioStream* stream = nullptr;
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        stopping_ = true;
+        restart = std::move(restartThread_);
+    }
+    // A restart that already reopened the stream is closed below; one that had not gives up
+    if (restart.joinable()) {
+        restart.join();
+    }
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        stream = stream_;
+        stream_ = nullptr;
+    }
+    // Closing waits for the stream's callbacks, which may be waiting for lock_
+    closeStream(stream);
+}
+
+bool AAudioSink::openStream() {
+    AAudioStreamBuilder* builder = nullptr;
+    if (AAudio_createStreamBuilder(&builder) != AAUDIO_OK) {
+        return false;
+    }
+
+    AAudioStreamBuilder_setDirection(builder, AAUDIO_DIRECTION_OUTPUT);
+    AAudioStreamBuilder_setPerformanceMode(builder, AAUDIO_PERFORMANCE_MODE_LOW_LATENCY);
+    AAudioStreamBuilder_setSharingMode(builder, AAUDIO_SHARING_MODE_EXCLUSIVE);
+    AAudioStreamBuilder_setUsage(builder, AAUDIO_USAGE_GAME);
+    AAudioStreamBuilder_setFormat(builder, AAUDIO_FORMAT_PCM_FLOAT);
+    AAudioStreamBuilder_setChannelCount(builder, AudioEngine::kChannels);
+    // Keep the engine rate once effects are cached so they never need resampling again
+    AAudioStreamBuilder_setSampleRate(builder, engine_->getSampleRate());
+    AAudioStreamBuilder_setDataCallback(builder, dataCallback, this);
+    AAudioStreamBuilder_setErrorCallback(builder, errorCallback, this);
+
+    aaudio_result_t result = AAudioStreamBuilder_openStream(builder, &stream_);
+    AAudioStreamBuilder_delete(builder);
+    if (result != AAUDIO_OK) {
+        aout << "AAudio: openStream failed: " << AAudio_convertResultToText(result) << std::endl;
+        stream_ = nullptr;
+        return false;
+    }
+
+    // Double buffering on the burst size is the lowest latency that stays glitch free
+    AAudioStream_setBufferSizeInFrames(stream_, AAudioStream_getFramesPerBurst(stream_) * 2);
+    engine_->setSampleRate(AAudioStream_getSampleRate(stream_));
+
+    aout << "AAudio: stream open, rate " << AAudioStream_getSampleRate(stream_)
+         << " burst " << AAudioStream_getFramesPerBurst(stream_) << std::endl;
+    return true;
+}
+
+void AAudioSink::closeStream(AAudioStream* stream) {
+    if (stream) {
+        AAudioStream_requestStop(stream);
+        AAudioStream_close(stream);
+    }
+}
+
+aaudio_data_callback_result_t AAudioSink::dataCallback(
+        AAudioStream*, void* userData, void* audioData, int32_t numFrames) {
+    auto* sink = static_cast<AAudioSink*>(userData);
+    sink->engine_->render(static_cast<float*>(audioData), numFrames);
+    return AAUDIO_CALLBACK_RESULT_CONTINUE;
+}
+
+void AAudioSink::errorCallback(AAudioStream*, void* userData, aaudio_result_t error) {
+    if (error != AAUDIO_ERROR_DISCONNECTED) return;
+
+    // The stream can't be closed from its own callback, so reopen it from a helper thread. stop()
+    // joins the newest one, which joins the one before it first.
+    auto* sink = static_cast<AAudioSink*>(userData);
+    std::lock_guard<std::mutex> guard(sink->lock_);
+    if (sink->stopping_) return;
+    std::thread previous = std::move(sink->restartThread_);
+    sink->restartThread_ = std::thread([sink, previous = std::move(previous)]() mutable {
+        if (previous.joinable()) {
+            previous.join();
+        }
+        AAudioStream* stream = nullptr;
+        {
+            std::lock_guard<std::mutex> guard(sink->lock_);
+            if (sink->stopping_) return;
+            stream = sink->stream_;
+            sink->stream_ = nullptr;
+        }
+        closeStream(stream);
+        std::lock_guard<std::mutex> guard(sink->lock_);
+        if (!sink->stopping_ && !sink->stream_ && sink->openStream()) {
+            AAudioStream_requestStart(sink->stream_);
+        }
+    });
+}
+#endif
+
+WavFileSink::WavFileSink(std::string path, int sampleRate)
+        : path_(std::move(path)), sampleRate_(sampleRate), engine_(nullptr), file_(nullptr),
+          framesWritten_(0) {}
+
+static void writeWavHeader(FILE* file, int sampleRate, uint32_t frames) {
+    const uint16_t channels = AudioEngine::kChannels;
+    const uint16_t bitsPerSample = 16;
+    const uint32_t byteRate = sampleRate * channels * bitsPerSample / 8;
+    const uint16_t blockAlign = channels * bitsPerSample / 8;
+    const uint32_t dataSize = frames * blockAlign;
+    const uint32_t riffSize = 36 + dataSize;
+    const uint32_t fmtSize = 16;
+    const uint16_t pcmFormat = 1;
+    const uint32_t rate = sampleRate;
+
+    fwrite("RIFF", 1, 4, file);
+    fwrite(&riffSize, 4, 1, file);
+    fwrite("WAVEfmt ", 1, 8, file);
+    fwrite(&fmtSize, 4, 1, file);
+    fwrite(&pcmFormat, 2, 1, file);
+    fwrite(&channels, 2, 1, file);
+    fwrite(&rate, 4, 1, file);
+    fwrite(&byteRate, 4, 1, file);
+    fwrite(&blockAlign, 2, 1, file);
+    fwrite(&bitsPerSample, 2, 1, file);
+    fwrite("data", 1, 4, file);
+    fwrite(&dataSize, 4, 1, file);
+}
+
+bool WavFileSink::start(AudioEngine& engine) {
+    engine_ = &engine;
+    engine_->setSampleRate(sampleRate_);
+    file_ = fopen(path_.c_str(), "wb");
+    if (!file_) {
+        return false;
+    }
+    framesWritten_ = 0;
+    writeWavHeader(file_, sampleRate_, 0); // Patched with the real size in stop()
+    return true;
+}
+
+bool WavFileSink::renderFrames(int frames) {
+    if (!file_) return false;
+
+    std::vector<float> mix(frames * AudioEngine::kChannels);
+    std::vector<int16_t> pcm(mix.size());
+    engine_->render(mix.data(), frames);
+    for (size_t i = 0; i < mix.size(); ++i) {
+        pcm[i] = (int16_t)(mix[i] * 32767.0f);
+    }
+    fwrite(pcm.data(), sizeof(int16_t), pcm.size(), file_);
+    framesWritten_ += frames;
+    return true;
+}
+
+void WavFileSink::stop() {
+    if (!file_) return;
+    fseek(file_, 0, SEEK_SET);
+    writeWavHeader(file_, sampleRate_, framesWritten_);
+    fclose(file_);
+    file_ = nullptr;
+}
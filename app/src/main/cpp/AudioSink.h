@@ -0,0 +1,84 @@
+#ifndef PALIBRIX_AUDIOSINK_H
+#define PALIBRIX_AUDIOSINK_H
+
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "AudioEngine.h"
+
+#ifdef __ANDROID__
+#include <aaudio/AAudio.h>
+#endif
+
+/*!
+ * Pulls mixed audio out of an AudioEngine.
+ */
+class AudioSink {
+public:
+    virtual ~AudioSink() = default;
+
+    /*!
+     * Starts pulling audio. Sets the engine sample rate, so call it before loading effects.
+     */
+    virtual bool start(AudioEngine& engine) = 0;
+    virtual void stop() = 0;
+};
+
+#ifdef __ANDROID__
+/*!
+ * Low latency AAudio output stream that mixes in its real-time data callback.
+ */
+class AAudioSink : public AudioSink {
+public:
+    AAudioSink();
+    ~AAudioSink() override;
+
+    bool start(AudioEngine& engine) override;
+    void stop() override;
+
+private:
+    bool openStream();
+    static void closeStream(AAudioStream* stream);
+
+    static aaudio_data_callback_result_t dataCallback(
+            AAudioStream* stream, void* userData, void* audioData, int32_t numFrames);
+    static void errorCallback(AAudioStream* stream, void* userData, aaudio_result_t error);
+
+    AudioEngine* engine_;
+    AAudioStream* stream_;
+
+    // Reopens the stream off the callback thread after the device was disconnected. Each restart
+    // thread joins the one before it, and none starts or reopens once stopping_ is set.
+    std::mutex lock_;
+    bool stopping_;
+    std::thread restartThread_;
+};
+#endif
+
+/*!
+ * Offline sink that renders the engine into a 16-bit stereo WAV file, for checking the mixer
+ * without an audio device.
+ */
+class WavFileSink : public AudioSink {
+public:
+    explicit WavFileSink(std::string path, int sampleRate = 48000);
+
+    bool start(AudioEngine& engine) override;
+    void stop() override;
+
+    /*!
+     * Renders the given number of frames and appends them to the file.
+     */
+    bool renderFrames(int frames);
+
+private:
+    std::string path_;
+    int sampleRate_;
+    AudioEngine* engine_;
+    FILE* file_;
+    uint32_t framesWritten_;
+};
+
+#endif //PALIBRIX_AUDIOSINK_H
@@ -0,0 +1,48 @@
+#include "Benchmarks.h"
+#include "BoardFeatures.h"
+#include "FlightRecorder.h"
+#include "PerfectClear.h"
+#include "TaskScheduler.h"
+#include "AndroidOut.h"
+
+#include <chrono>
+
+// Pose probes against a mid-game board: Game::fits walking the board, then the placement cache
+static void benchmarkPlacementProbes(int probes) {
+    Game game(0x9e3779b97f4a7c15ull);
+    for (int i = 0; i < 24; ++i) {
+        game.move(i % 7 - 3);
+        game.hardDrop();
+    }
+
+    // Poses around the stack, as a search or a fast slide would probe them
+    constexpr int kPoses = 4096;
+    static Tetromino poses[kPoses];
+    for (uint32_t i = 0; i < kPoses; ++i) {
+        uint32_t hash = i * 2654435761u;
+        poses[i] = {static_cast<TetrominoType>(hash % 7), static_cast<int>(hash >> 3 & 3),
+                    static_cast<int>((hash >> 5) % 12) - 2, static_cast<int>(hash >> 9 & 15) + 6};
+    }
+    auto time = [&](auto&& check, int& fitting) {
+        fitting = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < probes; ++i) {
+            fitting += check(poses[i % kPoses]) ? 1 : 0;
+        }
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / probes;
+    };
+    int walked = 0;
+    int cached = 0;
+    double walkNs = time([&](const Tetromino& piece) { return Game::fits(game.getBoard(), piece); }, walked);
+    double cacheNs = time([&](const Tetromino& piece) { return game.canPlace(piece); }, cached);
+    aout << "Placement probes: " << walkNs << " ns walking the board, " << cacheNs << " ns cached"
+         << (walked == cached ? "" : " (MISMATCH)") << std::endl;
+}
+
+void runBenchmarks() {
+    benchmarkBoardFeatures(20000);
+    PerfectClearFinder::benchmark();
+    TaskScheduler::benchmark();
+    benchmarkPlacementProbes(1 << 22);
+    FlightRecorder::benchmark();
+}
@@ -0,0 +1,10 @@
+#ifndef PALIBRIX_BENCHMARKS_H
+#define PALIBRIX_BENCHMARKS_H
+
+/*!
+ * Runs the native micro-benchmarks and logs their results. Called at startup in builds
+ * configured with -DPALIBRIX_BENCHMARKS=ON.
+ */
+void runBenchmarks();
+
+#endif //PALIBRIX_BENCHMARKS_H
@@ -0,0 +1,340 @@
+#include "BoardFeatures.h"
+#include "AndroidOut.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+// The kernel's instruction set follows the compile flags; PALIBRIX_NO_SIMD forces the plain C++
+// kernel, so that host tests can check it too
+#if defined(PALIBRIX_NO_SIMD)
+#elif defined(__ARM_NEON)
+#define PALIBRIX_FEATURES_NEON 1
+#include <arm_neon.h>
+#elif defined(__AVX2__)
+#define PALIBRIX_FEATURES_AVX2 1
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#define PALIBRIX_FEATURES_SSE2 1
+#include <emmintrin.h>
+#endif
+
+void packBoardRows(const Game::Board& board, uint16_t rows[BOARD_HEIGHT]) {
+    for (int y = 0; y < BOARD_HEIGHT; ++y) {
+        uint16_t bits = 0;
+        for (int x = 0; x < BOARD_WIDTH; ++x) {
+            if (board[y][x] != TetrominoType::EMPTY) {
+                bits |= static_cast<uint16_t>(1u << x);
+            }
+        }
+        rows[y] = bits;
+    }
+}
+
+int BoardBatch::add(const Game::Board& board) {
+    uint16_t boardRows[BOARD_HEIGHT];
+    packBoardRows(board, boardRows);
+    return add(boardRows);
+}
+
+int BoardBatch::add(const uint16_t boardRows[BOARD_HEIGHT]) {
+    int index = count++;
+    for (int y = 0; y < BOARD_HEIGHT; ++y) {
+        rows[y][index] = boardRows[y];
+    }
+    return index;
+}
+
+// Vector traits: the kernel below is written once against these and instantiated for the
+// instruction set the build targets. All values are small non-negative 16-bit integers.
+
+#if defined(PALIBRIX_FEATURES_NEON)
+struct NeonU16 {
+    using T = uint16x8_t;
+    static constexpr int kLanes = 8;
+    static constexpr const char* kName = "NEON";
+
+    static T load(const uint16_t* p) { return vld1q_u16(p); }
+    static void store(uint16_t* p, T v) { vst1q_u16(p, v); }
+    static T set1(uint16_t v) { return vdupq_n_u16(v); }
+    static T bitAnd(T a, T b) { return vandq_u16(a, b); }
+    static T bitOr(T a, T b) { return vorrq_u16(a, b); }
+    static T bitXor(T a, T b) { return veorq_u16(a, b); }
+    static T andNot(T a, T b) { return vbicq_u16(b, a); } // ~a & b
+    static T shl(T v, int n) { return vshlq_u16(v, vdupq_n_s16(static_cast<int16_t>(n))); }
+    static T shr(T v, int n) { return vshlq_u16(v, vdupq_n_s16(static_cast<int16_t>(-n))); }
+    static T add(T a, T b) { return vaddq_u16(a, b); }
+    static T sub(T a, T b) { return vsubq_u16(a, b); }
+    static T min(T a, T b) { return vminq_u16(a, b); }
+    static T max(T a, T b) { return vmaxq_u16(a, b); }
+    static T popcount(T v) { return vpaddlq_u8(vcntq_u8(vreinterpretq_u8_u16(v))); }
+};
+using BestU16 = NeonU16;
+#elif defined(PALIBRIX_FEATURES_AVX2)
+struct Avx2U16 {
+    using T = __m256i;
+    static constexpr int kLanes = 16;
+    static constexpr const char* kName = "AVX2";
+
+    static T load(const uint16_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    static void store(uint16_t* p, T v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+    static T set1(uint16_t v) { return _mm256_set1_epi16(static_cast<short>(v)); }
+    static T bitAnd(T a, T b) { return _mm256_and_si256(a, b); }
+    static T bitOr(T a, T b) { return _mm256_or_si256(a, b); }
+    static T bitXor(T a, T b) { return _mm256_xor_si256(a, b); }
+    static T andNot(T a, T b) { return _mm256_andnot_si256(a, b); }
+    static T shl(T v, int n) { return _mm256_slli_epi16(v, n); }
+    static T shr(T v, int n) { return _mm256_srli_epi16(v, n); }
+    static T add(T a, T b) { return _mm256_add_epi16(a, b); }
+    static T sub(T a, T b) { return _mm256_sub_epi16(a, b); }
+    static T min(T a, T b) { return _mm256_min_epu16(a, b); }
+    static T max(T a, T b) { return _mm256_max_epu16(a, b); }
+    static T popcount(T v);
+};
+using BestU16 = Avx2U16;
+#elif defined(PALIBRIX_FEATURES_SSE2)
+struct Sse2U16 {
+    using T = __m128i;
+    static constexpr int kLanes = 8;
+    static constexpr const char* kName = "SSE2";
+
+    static T load(const uint16_t* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    static void store(uint16_t* p, T v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v); }
+    static T set1(uint16_t v) { return _mm_set1_epi16(static_cast<short>(v)); }
+    static T bitAnd(T a, T b) { return _mm_and_si128(a, b); }
+    static T bitOr(T a, T b) { return _mm_or_si128(a, b); }
+    static T bitXor(T a, T b) { return _mm_xor_si128(a, b); }
+    static T andNot(T a, T b) { return _mm_andnot_si128(a, b); }
+    static T shl(T v, int n) { return _mm_slli_epi16(v, n); }
+    static T shr(T v, int n) { return _mm_srli_epi16(v, n); }
+    static T add(T a, T b) { return _mm_add_epi16(a, b); }
+    static T sub(T a, T b) { return _mm_sub_epi16(a, b); }
+    // SSE2 only has signed 16-bit min/max, which is fine for values this small
+    static T min(T a, T b) { return _mm_min_epi16(a, b); }
+    static T max(T a, T b) { return _mm_max_epi16(a, b); }
+    static T popcount(T v);
+};
+using BestU16 = Sse2U16;
+#endif
+
+struct ScalarU16 {
+    using T = uint16_t;
+    static constexpr int kLanes = 1;
+    static constexpr const char* kName = "scalar";
+
+    static T load(const uint16_t* p) { return *p; }
+    static void store(uint16_t* p, T v) { *p = v; }
+    static T set1(uint16_t v) { return v; }
+    static T bitAnd(T a, T b) { return a & b; }
+    static T bitOr(T a, T b) { return a | b; }
+    static T bitXor(T a, T b) { return a ^ b; }
+    static T andNot(T a, T b) { return static_cast<T>(~a & b); }
+    static T shl(T v, int n) { return static_cast<T>(v << n); }
+    static T shr(T v, int n) { return static_cast<T>(v >> n); }
+    static T add(T a, T b) { return static_cast<T>(a + b); }
+    static T sub(T a, T b) { return static_cast<T>(a - b); }
+    static T min(T a, T b) { return a < b ? a : b; }
+    static T max(T a, T b) { return a > b ? a : b; }
+    static T popcount(T v) { return static_cast<T>(__builtin_popcount(v)); }
+};
+#if !defined(PALIBRIX_FEATURES_NEON) && !defined(PALIBRIX_FEATURES_AVX2) && !defined(PALIBRIX_FEATURES_SSE2)
+using BestU16 = ScalarU16;
+#endif
+
+// Bit-sliced popcount for instruction sets without a per-lane one
+template <typename V>
+static inline typename V::T popcountSwar(typename V::T v) {
+    v = V::sub(v, V::bitAnd(V::shr(v, 1), V::set1(0x5555)));
+    v = V::add(V::bitAnd(v, V::set1(0x3333)), V::bitAnd(V::shr(v, 2), V::set1(0x3333)));
+    v = V::bitAnd(V::add(v, V::shr(v, 4)), V::set1(0x0f0f));
+    return V::bitAnd(V::add(v, V::shr(v, 8)), V::set1(0x001f));
+}
+
+#if defined(PALIBRIX_FEATURES_AVX2)
+Avx2U16::T Avx2U16::popcount(T v) { return popcountSwar<Avx2U16>(v); }
+#elif defined(PALIBRIX_FEATURES_SSE2)
+Sse2U16::T Sse2U16::popcount(T v) { return popcountSwar<Sse2U16>(v); }
+#endif
+
+template <typename V>
+static void featureKernel(const BoardBatch& batch, BoardFeatureBatch& out) {
+    using T = typename V::T;
+    const T zero = V::set1(0);
+    const T one = V::set1(1);
+    const T walls = V::set1(static_cast<uint16_t>(1u | (1u << (BOARD_WIDTH + 1))));
+    const T transitionMask = V::set1(static_cast<uint16_t>((1u << (BOARD_WIDTH + 1)) - 1));
+    const T fullHeight = V::set1(BOARD_HEIGHT);
+
+    for (int base = 0; base < kBoardBatchSize; base += V::kLanes) {
+        T above = zero; // Columns that have a filled cell at or above the current row
+        T holes = zero;
+        T transitions = zero;
+        T heights[BOARD_WIDTH];
+        for (T& height : heights) {
+            height = zero;
+        }
+
+        // Top to bottom: every row at or below a column's first filled cell adds to its height
+        for (int y = 0; y < BOARD_HEIGHT; ++y) {
+            T row = V::load(&batch.rows[y][base]);
+            above = V::bitOr(above, row);
+            holes = V::add(holes, V::popcount(V::andNot(row, above)));
+
+            T walled = V::bitOr(V::shl(row, 1), walls);
+            T changes = V::bitAnd(V::bitXor(walled, V::shr(walled, 1)), transitionMask);
+            transitions = V::add(transitions, V::popcount(changes));
+
+            for (int x = 0; x < BOARD_WIDTH; ++x) {
+                heights[x] = V::add(heights[x], V::bitAnd(V::shr(above, x), one));
+            }
+        }
+
+        T aggregate = zero;
+        T maxHeight = zero;
+        T bumpiness = zero;
+        T wellSum = zero;
+        T maxWell = zero;
+        for (int x = 0; x < BOARD_WIDTH; ++x) {
+            const T h = heights[x];
+            V::store(&out.heights[x][base], h);
+            aggregate = V::add(aggregate, h);
+            maxHeight = V::max(maxHeight, h);
+            if (x + 1 < BOARD_WIDTH) {
+                bumpiness = V::add(bumpiness, V::sub(V::max(h, heights[x + 1]), V::min(h, heights[x + 1])));
+            }
+
+            T left = x > 0 ? heights[x - 1] : fullHeight;
+            T right = x + 1 < BOARD_WIDTH ? heights[x + 1] : fullHeight;
+            T rim = V::min(left, right);
+            T depth = V::sub(V::max(rim, h), h);
+            wellSum = V::add(wellSum, depth);
+            maxWell = V::max(maxWell, depth);
+        }
+
+        V::store(&out.aggregateHeight[base], aggregate);
+        V::store(&out.maxHeight[base], maxHeight);
+        V::store(&out.holes[base], holes);
+        V::store(&out.wellSum[base], wellSum);
+        V::store(&out.maxWell[base], maxWell);
+        V::store(&out.rowTransitions[base], transitions);
+        V::store(&out.bumpiness[base], bumpiness);
+    }
+}
+
+void computeBoardFeatures(const BoardBatch& batch, BoardFeatureBatch& out) {
+    featureKernel<BestU16>(batch, out);
+}
+
+const char* boardFeatureKernelName() {
+    return BestU16::kName;
+}
+
+void computeBoardFeaturesScalar(const BoardBatch& batch, BoardFeatureBatch& out) {
+    for (int i = 0; i < kBoardBatchSize; ++i) {
+        auto filled = [&](int x, int y) {
+            if (x < 0 || x >= BOARD_WIDTH) {
+                return true;
+            }
+            return ((batch.rows[y][i] >> x) & 1) != 0;
+        };
+
+        int heights[BOARD_WIDTH];
+        int holes = 0;
+        for (int x = 0; x < BOARD_WIDTH; ++x) {
+            int top = BOARD_HEIGHT;
+            for (int y = 0; y < BOARD_HEIGHT; ++y) {
+                if (filled(x, y)) {
+                    top = std::min(top, y);
+                } else if (top < y) {
+                    holes++;
+                }
+            }
+            heights[x] = BOARD_HEIGHT - top;
+        }
+
+        int transitions = 0;
+        for (int y = 0; y < BOARD_HEIGHT; ++y) {
+            for (int x = 0; x <= BOARD_WIDTH; ++x) {
+                if (filled(x - 1, y) != filled(x, y)) {
+                    transitions++;
+                }
+            }
+        }
+
+        int aggregate = 0;
+        int maxHeight = 0;
+        int bumpiness = 0;
+        int wellSum = 0;
+        int maxWell = 0;
+        for (int x = 0; x < BOARD_WIDTH; ++x) {
+            aggregate += heights[x];
+            maxHeight = std::max(maxHeight, heights[x]);
+            if (x + 1 < BOARD_WIDTH) {
+                bumpiness += std::abs(heights[x] - heights[x + 1]);
+            }
+            int left = x > 0 ? heights[x - 1] : BOARD_HEIGHT;
+            int right = x + 1 < BOARD_WIDTH ? heights[x + 1] : BOARD_HEIGHT;
+            int depth = std::max(0, std::min(left, right) - heights[x]);
+            wellSum += depth;
+            maxWell = std::max(maxWell, depth);
+            out.heights[x][i] = static_cast<uint16_t>(heights[x]);
+        }
+
+        out.aggregateHeight[i] = static_cast<uint16_t>(aggregate);
+        out.maxHeight[i] = static_cast<uint16_t>(maxHeight);
+        out.holes[i] = static_cast<uint16_t>(holes);
+        out.wellSum[i] = static_cast<uint16_t>(wellSum);
+        out.maxWell[i] = static_cast<uint16_t>(maxWell);
+        out.rowTransitions[i] = static_cast<uint16_t>(transitions);
+        out.bumpiness[i] = static_cast<uint16_t>(bumpiness);
+    }
+}
+
+double benchmarkBoardFeatures(int batches) {
+    // Ragged stacks with a few holes, roughly what a search sees mid-game
+    BoardBatch batch;
+    uint32_t state = 0x9e3779b9u;
+    auto random = [&state]() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    };
+    while (!batch.full()) {
+        uint16_t rows[BOARD_HEIGHT] = {};
+        for (int x = 0; x < BOARD_WIDTH; ++x) {
+            int height = static_cast<int>(random() % 14);
+            for (int y = BOARD_HEIGHT - height; y < BOARD_HEIGHT; ++y) {
+                if (random() % 8 != 0) {
+                    rows[y] |= static_cast<uint16_t>(1u << x);
+                }
+            }
+        }
+        batch.add(rows);
+    }
+
+    BoardFeatureBatch reference;
+    BoardFeatureBatch features;
+    computeBoardFeaturesScalar(batch, reference);
+    computeBoardFeatures(batch, features);
+    if (memcmp(&reference, &features, sizeof(features)) != 0) {
+        aout << "Board feature kernel " << boardFeatureKernelName() << " disagrees with the reference" << std::endl;
+        return 0.0;
+    }
+
+    uint32_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < batches; ++i) {
+        // Perturb one row so the compiler cannot hoist the kernel out of the loop
+        batch.rows[BOARD_HEIGHT - 1][i % kBoardBatchSize] ^= 1;
+        computeBoardFeatures(batch, features);
+        checksum += features.holes[i % kBoardBatchSize];
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double boardsPerSecond = seconds > 0.0 ? batches * static_cast<double>(kBoardBatchSize) / seconds : 0.0;
+
+    aout << "Board features (" << boardFeatureKernelName() << "): " << static_cast<long long>(boardsPerSecond)
+         << " boards/s, checksum " << checksum << std::endl;
+    return boardsPerSecond;
+}
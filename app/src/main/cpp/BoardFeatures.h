@@ -0,0 +1,65 @@
+#ifndef PALIBRIX_BOARDFEATURES_H
+#define PALIBRIX_BOARDFEATURES_H
+
+#include <cstdint>
+
+#include "Game.h"
+
+constexpr int kBoardBatchSize = 64;
+constexpr uint16_t kBoardRowMask = (1u << BOARD_WIDTH) - 1;
+
+/*!
+ * Packs a board into one bitmask per row (bit x set = column x filled, row 0 at the top).
+ */
+void packBoardRows(const Game::Board& board, uint16_t rows[BOARD_HEIGHT]);
+
+/*!
+ * Boards in structure-of-arrays form: rows[y][i] is row y of board i, so one vector load picks
+ * up the same row of 8 (NEON, SSE) or 16 (AVX2) boards. Lanes at or past count hold stale data
+ * and produce meaningless features.
+ */
+struct BoardBatch {
+    uint16_t rows[BOARD_HEIGHT][kBoardBatchSize];
+    int count = 0;
+
+    void clear() { count = 0; }
+    bool full() const { return count == kBoardBatchSize; }
+
+    int add(const Game::Board& board);
+    int add(const uint16_t boardRows[BOARD_HEIGHT]);
+};
+
+/*!
+ * Per-board features of a BoardBatch, in the same lane order.
+ */
+struct BoardFeatureBatch {
+    uint16_t heights[BOARD_WIDTH][kBoardBatchSize];
+    uint16_t aggregateHeight[kBoardBatchSize];
+    uint16_t maxHeight[kBoardBatchSize];
+    uint16_t holes[kBoardBatchSize];          // Empty cells with a filled cell above them
+    uint16_t wellSum[kBoardBatchSize];        // Sum of column depths below both neighbours (walls count as full)
+    uint16_t maxWell[kBoardBatchSize];
+    uint16_t rowTransitions[kBoardBatchSize]; // Filled/empty changes along each row, walls count as filled
+    uint16_t bumpiness[kBoardBatchSize];      // Sum of height differences between adjacent columns
+};
+
+/*!
+ * Computes features for the whole batch with the widest kernel this build supports: NEON on
+ * ARM, AVX2 or SSE2 on x86 (by compile flags), plain C++ otherwise or with PALIBRIX_NO_SIMD.
+ */
+void computeBoardFeatures(const BoardBatch& batch, BoardFeatureBatch& out);
+
+/*!
+ * Cell-by-cell reference implementation, for checking the vector kernels.
+ */
+void computeBoardFeaturesScalar(const BoardBatch& batch, BoardFeatureBatch& out);
+
+const char* boardFeatureKernelName();
+
+/*!
+ * Times computeBoardFeatures over random boards, checks it against the reference and logs
+ * the throughput. Returns boards per second, or 0 if the kernel disagrees with the reference.
+ */
+double benchmarkBoardFeatures(int batches);
+
+#endif //PALIBRIX_BOARDFEATURES_H
@@ -0,0 +1,147 @@
+#ifndef PALIBRIX_BYTESTREAM_H
+#define PALIBRIX_BYTESTREAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/*!
+ * Little-endian writer over a caller-owned buffer. Writes past the end are dropped and clear
+ * ok(), so callers check once after a batch of puts instead of after each one.
+ */
+class ByteWriter {
+public:
+    ByteWriter(uint8_t* data, size_t capacity) : data_(data), capacity_(capacity), size_(0), ok_(true) {}
+
+    void putU8(uint8_t value) {
+        if (size_ < capacity_) {
+            data_[size_++] = value;
+        } else {
+            ok_ = false;
+        }
+    }
+
+    void putU16(uint16_t value) {
+        putU8(static_cast<uint8_t>(value));
+        putU8(static_cast<uint8_t>(value >> 8));
+    }
+
+    void putU32(uint32_t value) {
+        putU16(static_cast<uint16_t>(value));
+        putU16(static_cast<uint16_t>(value >> 16));
+    }
+
+    void putU64(uint64_t value) {
+        putU32(static_cast<uint32_t>(value));
+        putU32(static_cast<uint32_t>(value >> 32));
+    }
+
+    void putDouble(double value) {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        putU64(bits);
+    }
+
+    // LEB128: 7 bits per byte, high bit set on all but the last
+    void putVarint(uint64_t value) {
+        while (value >= 0x80) {
+            putU8(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        putU8(static_cast<uint8_t>(value));
+    }
+
+    void putBytes(const void* bytes, size_t count) {
+        if (count > capacity_ - size_) {
+            ok_ = false;
+            return;
+        }
+        memcpy(data_ + size_, bytes, count);
+        size_ += count;
+    }
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool ok() const { return ok_; }
+
+private:
+    uint8_t* data_;
+    size_t capacity_;
+    size_t size_;
+    bool ok_;
+};
+
+/*!
+ * Reader counterpart of ByteWriter. Reads past the end return zero and clear ok().
+ */
+class ByteReader {
+public:
+    ByteReader(const uint8_t* data, size_t size) : data_(data), size_(size), pos_(0), ok_(true) {}
+
+    uint8_t getU8() {
+        if (pos_ < size_) {
+            return data_[pos_++];
+        }
+        ok_ = false;
+        return 0;
+    }
+
+    uint16_t getU16() {
+        uint16_t lo = getU8();
+        return static_cast<uint16_t>(lo | (getU8() << 8));
+    }
+
+    uint32_t getU32() {
+        uint32_t lo = getU16();
+        return lo | (static_cast<uint32_t>(getU16()) << 16);
+    }
+
+    uint64_t getU64() {
+        uint64_t lo = getU32();
+        return lo | (static_cast<uint64_t>(getU32()) << 32);
+    }
+
+    double getDouble() {
+        uint64_t bits = getU64();
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    uint64_t getVarint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t byte = getU8();
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        ok_ = false;
+        return 0;
+    }
+
+    // Returns a pointer to the next count bytes in place, or nullptr if they run past the end
+    const uint8_t* getBytes(size_t count) {
+        if (count > size_ - pos_) {
+            ok_ = false;
+            pos_ = size_;
+            return nullptr;
+        }
+        const uint8_t* bytes = data_ + pos_;
+        pos_ += count;
+        return bytes;
+    }
+
+    size_t position() const { return pos_; }
+    size_t remaining() const { return size_ - pos_; }
+    bool ok() const { return ok_; }
+
+private:
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_;
+    bool ok_;
+};
+
+#endif //PALIBRIX_BYTESTREAM_H
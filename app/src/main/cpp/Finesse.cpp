@@ -0,0 +1,244 @@
+#include "Finesse.h"
+#include "TetrominoData.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr int kTypeCount = 7;
+
+constexpr int absolute(int value) {
+    return value < 0 ? -value : value;
+}
+
+// Cells a piece leaves behind when dropped on an empty floor, as a bitmask over 4 rows of
+// BOARD_WIDTH bits (row 0 = floor). 0 if the position is off the board.
+constexpr uint64_t landedCells(int type, int rotation, int x) {
+    const auto& shape = tetrominoShapes[type][rotation];
+    int bottom = 0;
+    for (const Mino& mino : shape) {
+        bottom = mino.y > bottom ? mino.y : bottom;
+    }
+    uint64_t cells = 0;
+    for (const Mino& mino : shape) {
+        int column = x + mino.x;
+        if (column < 0 || column >= BOARD_WIDTH) {
+            return 0;
+        }
+        cells |= uint64_t(1) << ((bottom - mino.y) * BOARD_WIDTH + column);
+    }
+    return cells;
+}
+
+struct FinesseTable {
+    FinesseEntry entries[kTypeCount][4][kFinesseColumns] = {};
+
+    constexpr FinesseTable() {
+        constexpr uint8_t rotateCw[4] = {0, 1, 2, 0};
+        constexpr uint8_t rotateCcw[4] = {0, 0, 0, 1};
+
+        for (int type = 0; type < kTypeCount; ++type) {
+            uint64_t cells[4][kFinesseColumns] = {};
+            for (int rotation = 0; rotation < 4; ++rotation) {
+                for (int column = 0; column < kFinesseColumns; ++column) {
+                    cells[rotation][column] = landedCells(type, rotation, column - 3);
+                }
+            }
+
+            for (int rotation = 0; rotation < 4; ++rotation) {
+                for (int column = 0; column < kFinesseColumns; ++column) {
+                    FinesseEntry best = {0, 0, 0, 0xff};
+                    if (cells[rotation][column] != 0) {
+                        // Cheapest of every position that leaves the same cells
+                        for (int other = 0; other < 4; ++other) {
+                            if (cells[other][SPAWN_X + 3] == 0) {
+                                continue; // Cannot rotate in place at spawn
+                            }
+                            for (int otherColumn = 0; otherColumn < kFinesseColumns; ++otherColumn) {
+                                if (cells[other][otherColumn] != cells[rotation][column]) {
+                                    continue;
+                                }
+                                int shift = otherColumn - 3 - SPAWN_X;
+                                int inputs = rotateCw[other] + rotateCcw[other] + absolute(shift);
+                                if (inputs < best.inputs) {
+                                    best = {rotateCw[other], rotateCcw[other], static_cast<int8_t>(shift),
+                                            static_cast<uint8_t>(inputs)};
+                                }
+                            }
+                        }
+                    }
+                    entries[type][rotation][column] = best;
+                }
+            }
+        }
+    }
+};
+
+constexpr FinesseTable kFinesseTable;
+
+static_assert(kFinesseTable.entries[static_cast<int>(TetrominoType::T)][0][SPAWN_X + 3].inputs == 0,
+              "A T dropped straight from spawn needs no inputs");
+static_assert(kFinesseTable.entries[static_cast<int>(TetrominoType::O)][2][SPAWN_X + 3].inputs == 0,
+              "Rotating an O never helps");
+
+// Cells of a piece as sorted board indices, for comparing placements
+void pieceCells(const Tetromino& piece, int out[4]) {
+    const auto& shape = tetrominoShapes[static_cast<int>(piece.type)][piece.rotation];
+    for (int i = 0; i < 4; ++i) {
+        out[i] = (piece.y + shape[i].y) * BOARD_WIDTH + piece.x + shape[i].x;
+    }
+    std::sort(out, out + 4);
+}
+
+} // namespace
+
+const FinesseEntry& finesseEntry(TetrominoType type, int rotation, int x) {
+    return kFinesseTable.entries[static_cast<int>(type)][rotation & 3][x + 3];
+}
+
+int finesseSearch(const Game::Board& board, const Tetromino& target) {
+    constexpr int kStates = 4 * kFinesseColumns * BOARD_HEIGHT;
+    auto index = [](int rotation, int x, int y) {
+        return (rotation * BOARD_HEIGHT + y) * kFinesseColumns + x + 3;
+    };
+
+    Tetromino spawn = {target.type, 0, SPAWN_X, 0};
+    if (!Game::fits(board, spawn)) {
+        return -1;
+    }
+    int targetCells[4];
+    pieceCells(target, targetCells);
+
+    // 0-1 breadth-first search: drops cost nothing, moves and rotations one input each
+    uint8_t cost[kStates];
+    std::fill(cost, cost + kStates, 0xff);
+    Tetromino deque[2 * kStates];
+    int head = kStates;
+    int tail = kStates;
+    cost[index(0, SPAWN_X, 0)] = 0;
+    deque[tail++] = spawn;
+
+    while (head < tail) {
+        Tetromino piece = deque[head++];
+        int pieceCost = cost[index(piece.rotation, piece.x, piece.y)];
+
+        Tetromino below = piece;
+        below.y++;
+        if (!Game::fits(board, below)) {
+            int cells[4];
+            pieceCells(piece, cells);
+            if (std::equal(cells, cells + 4, targetCells)) {
+                return pieceCost;
+            }
+        }
+
+        auto relax = [&](const Tetromino& next, int step) {
+            if (next.x < -3 || next.x >= BOARD_WIDTH || !Game::fits(board, next)) {
+                return;
+            }
+            uint8_t& nextCost = cost[index(next.rotation, next.x, next.y)];
+            if (pieceCost + step >= nextCost) {
+                return;
+            }
+            nextCost = static_cast<uint8_t>(pieceCost + step);
+            if (step == 0) {
+                deque[--head] = next;
+            } else {
+                deque[tail++] = next;
+            }
+        };
+        relax(below, 0);
+        relax({piece.type, piece.rotation, piece.x - 1, piece.y}, 1);
+        relax({piece.type, piece.rotation, piece.x + 1, piece.y}, 1);
+        relax({piece.type, (piece.rotation + 1) % 4, piece.x, piece.y}, 1);
+        relax({piece.type, (piece.rotation + 3) % 4, piece.x, piece.y}, 1);
+    }
+    return -1;
+}
+
+FinesseAnalyzer::FinesseAnalyzer()
+        : stackTop_(BOARD_HEIGHT), inputs_(0), eventCursor_(0), pieces_(0), faults_(0), faultyPieces_(0),
+          last_{{TetrominoType::EMPTY, 0, 0, 0}, 0, 0, false} {
+    for (auto& row : board_) {
+        row.fill(TetrominoType::EMPTY);
+    }
+    std::fill(columnTop_, columnTop_ + BOARD_WIDTH, BOARD_HEIGHT);
+}
+
+void FinesseAnalyzer::begin(const Game& game) {
+    snapshot(game);
+    inputs_ = 0;
+    eventCursor_ = game.getEventCount();
+    pieces_ = 0;
+    faults_ = 0;
+    faultyPieces_ = 0;
+}
+
+void FinesseAnalyzer::onInput(ReplayInput input, const Game& game) {
+    switch (input) {
+        case ReplayInput::MoveLeft:
+        case ReplayInput::MoveRight:
+        case ReplayInput::Rotate:
+        case ReplayInput::RotateLeft:
+            inputs_++;
+            break;
+        case ReplayInput::Hold:
+            inputs_ = 0; // A different piece is being placed now
+            break;
+        default:
+            break;
+    }
+
+    bool locked = false;
+    game.consumeEvents(eventCursor_, [this, &locked](const GameEvent& event) {
+        if (event.type == GameEventType::PieceLocked) {
+            grade(event.piece);
+            locked = true;
+        }
+    });
+    if (locked) {
+        snapshot(game);
+        inputs_ = 0;
+    }
+}
+
+void FinesseAnalyzer::snapshot(const Game& game) {
+    board_ = game.getBoard();
+    stackTop_ = BOARD_HEIGHT;
+    for (int x = 0; x < BOARD_WIDTH; ++x) {
+        int y = 0;
+        while (y < BOARD_HEIGHT && board_[y][x] == TetrominoType::EMPTY) {
+            y++;
+        }
+        columnTop_[x] = static_cast<uint8_t>(y);
+        stackTop_ = std::min<uint8_t>(stackTop_, columnTop_[x]);
+    }
+}
+
+void FinesseAnalyzer::grade(const Tetromino& piece) {
+    // The table holds if the spawn rows were free and nothing was above the piece, i.e. it
+    // could have been shifted at the top and dropped straight down
+    bool straightDrop = stackTop_ >= 4;
+    const auto& shape = tetrominoShapes[static_cast<int>(piece.type)][piece.rotation];
+    for (const Mino& mino : shape) {
+        straightDrop = straightDrop && piece.y + mino.y < columnTop_[piece.x + mino.x];
+    }
+
+    int minimal;
+    if (straightDrop) {
+        minimal = finesseEntry(piece.type, piece.rotation, piece.x).inputs;
+    } else {
+        minimal = finesseSearch(board_, piece);
+        if (minimal < 0) {
+            minimal = inputs_; // Not reachable by these rules (should not happen); don't blame the player
+        }
+    }
+
+    int fault = std::max(0, inputs_ - minimal);
+    pieces_++;
+    faults_ += fault;
+    if (fault > 0) {
+        faultyPieces_++;
+    }
+    last_ = {piece, inputs_, minimal, !straightDrop};
+}
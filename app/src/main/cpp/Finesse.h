@@ -0,0 +1,82 @@
+#ifndef PALIBRIX_FINESSE_H
+#define PALIBRIX_FINESSE_H
+
+#include <cstdint>
+
+#include "Game.h"
+#include "Replay.h"
+
+/*!
+ * Shortest way to reach a placement on an empty board: rotate at the spawn position, then
+ * shift. Drops are not counted.
+ */
+struct FinesseEntry {
+    uint8_t rotateCw;  // Presses of rotate (2 for a half turn)
+    uint8_t rotateCcw; // Presses of rotateLeft
+    int8_t shift;      // Signed number of moves
+    uint8_t inputs;    // rotateCw + rotateCcw + |shift|, 0xff if the position is off the board
+};
+
+constexpr int kFinesseColumns = BOARD_WIDTH + 3; // x = -3 .. 9
+
+/*!
+ * Minimal inputs per (type, rotation, x). Positions that leave the same cells behind (any O,
+ * flipped I, S and Z) share the cheapest of their sequences. Built at compile time from
+ * tetrominoShapes.
+ */
+const FinesseEntry& finesseEntry(TetrominoType type, int rotation, int x);
+
+/*!
+ * Minimal move and rotation count to bring a spawned piece to rest at target on this board,
+ * found by a breadth-first search over (x, y, rotation) with Game::fits. Soft drops are free,
+ * so tucks and spins cost only their sideways moves and rotations. Returns -1 if unreachable.
+ */
+int finesseSearch(const Game::Board& board, const Tetromino& target);
+
+struct FinesseResult {
+    Tetromino piece;
+    int inputs;  // Moves and rotations the player pressed for this piece
+    int minimal;
+    bool searched; // The table did not apply and the board was searched
+};
+
+/*!
+ * Follows the player's inputs and grades every placement against the minimal input count.
+ * Placements whose drop path is clear are graded by table lookup; only tucks and stacks that
+ * reach the spawn rows fall back to the search.
+ */
+class FinesseAnalyzer {
+public:
+    FinesseAnalyzer();
+
+    /*!
+     * Starts following a game from its current piece.
+     */
+    void begin(const Game& game);
+
+    /*!
+     * Call after every input was applied to the game, with the same inputs a replay records.
+     */
+    void onInput(ReplayInput input, const Game& game);
+
+    uint32_t getPieces() const { return pieces_; }
+    uint32_t getFaults() const { return faults_; } // Inputs above the minimum, summed
+    uint32_t getFaultyPieces() const { return faultyPieces_; }
+    const FinesseResult& getLastResult() const { return last_; }
+
+private:
+    void snapshot(const Game& game);
+    void grade(const Tetromino& piece);
+
+    Game::Board board_;                 // Board the current piece is being placed on
+    uint8_t columnTop_[BOARD_WIDTH];    // First filled row per column, BOARD_HEIGHT if empty
+    uint8_t stackTop_;                  // Smallest columnTop_
+    int inputs_;
+    uint32_t eventCursor_;
+    uint32_t pieces_;
+    uint32_t faults_;
+    uint32_t faultyPieces_;
+    FinesseResult last_;
+};
+
+#endif //PALIBRIX_FINESSE_H
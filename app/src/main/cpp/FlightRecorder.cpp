@@ -0,0 +1,333 @@
+#include "FlightRecorder.h"
+#include "AndroidOut.h"
+#include "ByteStream.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <ctime>
+#include <fcntl.h>
+#include <thread>
+#include <unistd.h>
+
+namespace FlightRecorder {
+
+namespace {
+
+constexpr int kFatalSignals[] = {SIGSEGV, SIGABRT, SIGBUS, SIGFPE, SIGILL};
+constexpr int kFatalSignalCount = sizeof(kFatalSignals) / sizeof(kFatalSignals[0]);
+constexpr size_t kAltStackSize = 64 * 1024;
+constexpr size_t kMaxPath = 512;
+
+struct ThreadSlot {
+    std::atomic<uint32_t> enteredMs; // 0 while outside JNI
+    std::atomic<uint16_t> method;
+    std::atomic<bool> claimed;
+};
+
+// All state is static: the signal handler may only touch memory that already exists
+FlightRecord ring[kRingSize];
+std::atomic<uint32_t> head{0};
+FlightKeyframe keyframes[kMaxSessions][kKeyframeSlots];
+std::atomic<uint32_t> keyframeCursor[kMaxSessions];
+std::atomic<uint32_t> nextSerial{0};
+std::atomic<uint32_t> nextSession{0};
+
+ThreadSlot threads[kMaxThreads];
+
+// A thread's watchdog slot, given back when the thread exits so that threads which come and go
+// (a new GL thread per surface, audio restart threads) do not use the slots up
+struct SlotClaim {
+    uint32_t slot = kMaxThreads; // kMaxThreads while the thread has none
+
+    ~SlotClaim() {
+        if (slot < kMaxThreads) {
+            threads[slot].enteredMs.store(0, std::memory_order_relaxed);
+            threads[slot].claimed.store(false, std::memory_order_release);
+        }
+    }
+};
+
+thread_local SlotClaim threadSlot;
+thread_local uint32_t threadId = 0; // 0 until the thread's first JNI call
+thread_local uint32_t jniDepth = 0;
+
+std::atomic<bool> installed{false};
+std::atomic<bool> crashDumped{false};
+char crashPath[kMaxPath];
+char stallPath[kMaxPath];
+struct sigaction previousActions[kFatalSignalCount];
+alignas(16) unsigned char altStack[kAltStackSize];
+
+static_assert((kRingSize & (kRingSize - 1)) == 0, "ring index is masked");
+
+// Tick resolution (a few ms) is enough to place records and costs half of the precise clock
+uint32_t nowMs() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    return static_cast<uint32_t>(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+void append(RecordKind kind, uint8_t session, uint16_t arg, uint32_t value, uint32_t timeMs = nowMs()) {
+    uint32_t index = head.fetch_add(1, std::memory_order_relaxed);
+    FlightRecord& record = ring[index & (kRingSize - 1)];
+    __atomic_store_n(&record.sequence, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    record.timeMs = timeMs;
+    record.kind = static_cast<uint8_t>(kind);
+    record.session = session;
+    record.arg = arg;
+    record.value = value;
+    __atomic_store_n(&record.sequence, index + 1, __ATOMIC_RELEASE);
+}
+
+bool writeAll(int fd, const void* data, size_t size) {
+    const auto* bytes = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+        ssize_t written = write(fd, bytes, size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        bytes += written;
+        size -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+void onFatalSignal(int signal, siginfo_t* info, void*) {
+    if (!crashDumped.exchange(true)) {
+        dump(crashPath, signal);
+    }
+
+    // Hand the signal to whoever had it before (debuggerd on Android). A fault re-executes the
+    // faulting instruction on return and ends up there; a sent signal (abort) is sent again
+    for (int i = 0; i < kFatalSignalCount; ++i) {
+        if (kFatalSignals[i] == signal) {
+            sigaction(signal, &previousActions[i], nullptr);
+        }
+    }
+    if (info->si_code <= 0) {
+        raise(signal);
+    }
+}
+
+// First free watchdog slot, or kMaxThreads if there is none
+uint32_t claimSlot() {
+    for (uint32_t i = 0; i < kMaxThreads; ++i) {
+        bool expected = false;
+        if (!threads[i].claimed.load(std::memory_order_relaxed)
+            && threads[i].claimed.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+            return i;
+        }
+    }
+    return kMaxThreads;
+}
+
+void watchdogLoop() {
+    uint32_t reported[kMaxThreads] = {};
+    for (;;) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
+        uint32_t now = nowMs();
+        for (uint32_t i = 0; i < kMaxThreads; ++i) {
+            uint32_t entered = threads[i].enteredMs.load(std::memory_order_acquire);
+            if (entered == 0 || entered == reported[i] || now - entered < kStallMs) {
+                continue;
+            }
+            // Once per stalled call
+            reported[i] = entered;
+            uint16_t method = threads[i].method.load(std::memory_order_relaxed);
+            append(RecordKind::Stall, 0, method, now - entered);
+            bool written = dump(stallPath, 0);
+            aout << "JNI call " << method << " stalled for " << now - entered << " ms, flight record "
+                 << (written ? "written to " : "NOT written to ") << stallPath << std::endl;
+        }
+    }
+}
+
+} // namespace
+
+bool install(const std::string& dir) {
+    if (installed.exchange(true)) {
+        return false;
+    }
+    if (snprintf(crashPath, kMaxPath, "%s/flight-crash.plfr", dir.c_str()) >= static_cast<int>(kMaxPath)
+        || snprintf(stallPath, kMaxPath, "%s/flight-stall.plfr", dir.c_str()) >= static_cast<int>(kMaxPath)) {
+        aout << "Flight recorder directory path too long" << std::endl;
+        return false;
+    }
+    for (const char* path : {crashPath, stallPath}) {
+        if (access(path, F_OK) == 0) {
+            aout << "Flight record from an earlier run: " << path << std::endl;
+        }
+    }
+
+    // A stack overflow leaves no stack to dump from. Bionic gives its threads an alternate signal
+    // stack of their own; this covers the calling thread where there is none
+    stack_t current;
+    if (sigaltstack(nullptr, &current) == 0 && (current.ss_flags & SS_DISABLE)) {
+        stack_t stack = {};
+        stack.ss_sp = altStack;
+        stack.ss_size = kAltStackSize;
+        sigaltstack(&stack, nullptr);
+    }
+    struct sigaction action = {};
+    action.sa_sigaction = onFatalSignal;
+    action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+    for (int i = 0; i < kFatalSignalCount; ++i) {
+        sigaction(kFatalSignals[i], &action, &previousActions[i]);
+    }
+
+    std::thread(watchdogLoop).detach();
+    return true;
+}
+
+uint8_t openSession(const Game& game) {
+    auto session = static_cast<uint8_t>(nextSession.fetch_add(1, std::memory_order_relaxed));
+    append(RecordKind::SessionStart, session, 0, static_cast<uint32_t>(game.getSeed()));
+    recordKeyframe(session, game, true);
+    return session;
+}
+
+void recordInput(uint8_t session, ReplayInput input, const Game& game) {
+    append(RecordKind::Input, session, static_cast<uint16_t>(input), stateHash(game));
+}
+
+void recordKeyframe(uint8_t session, const Game& game, bool newGame) {
+    uint32_t serial = nextSerial.fetch_add(1, std::memory_order_relaxed) + 1;
+    std::atomic<uint32_t>& cursor = keyframeCursor[session % kMaxSessions];
+    FlightKeyframe& slot = keyframes[session % kMaxSessions][cursor.fetch_add(1, std::memory_order_relaxed) % kKeyframeSlots];
+
+    __atomic_store_n(&slot.serial, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot.check, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    ByteWriter out(slot.state, sizeof(slot.state));
+    game.writeState(out);
+    slot.randomizer = static_cast<uint8_t>(game.getRandomizerKind());
+    slot.session = session;
+    slot.size = static_cast<uint16_t>(out.size());
+    slot.seed = game.getSeed();
+    __atomic_store_n(&slot.check, serial, __ATOMIC_RELEASE);
+    __atomic_store_n(&slot.serial, serial, __ATOMIC_RELEASE);
+
+    append(RecordKind::Keyframe, session, newGame ? 1 : 0, serial);
+}
+
+void recordFrame(uint8_t session, uint32_t renderMicros) {
+    append(RecordKind::Frame, session, 0, renderMicros);
+}
+
+uint32_t stateHash(const Game& game) {
+    const Tetromino& piece = game.getCurrentPiece();
+    const Game::NextQueue& next = game.getNextQueue();
+    uint32_t pose = static_cast<uint32_t>(piece.type) | static_cast<uint32_t>(piece.rotation) << 3
+                    | static_cast<uint32_t>(piece.x + 8) << 5 | static_cast<uint32_t>(piece.y + 8) << 10
+                    | static_cast<uint32_t>(game.getHeldPiece()) << 16 | (game.canHold() ? 1u << 19 : 0)
+                    | (game.isGameOver() ? 1u << 20 : 0)
+                    | static_cast<uint32_t>(next.empty() ? TetrominoType::EMPTY : next[0]) << 21;
+    uint32_t hash = (pose ^ static_cast<uint32_t>(game.getScore())) * 0x9e3779b1u;
+    hash = (hash ^ static_cast<uint32_t>(game.getLines() | game.getLevel() << 20)) * 0x85ebca77u;
+    hash = (hash ^ static_cast<uint32_t>(game.getCombo())) * 0xc2b2ae3du;
+    return hash ^ hash >> 16;
+}
+
+bool dump(const char* path, int reason) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    FlightDumpHeader header;
+    header.magic = kDumpMagic;
+    header.version = kDumpVersion;
+    header.recordSize = sizeof(FlightRecord);
+    header.reason = reason;
+    header.head = head.load(std::memory_order_acquire);
+    header.ringSize = kRingSize;
+    header.sessions = kMaxSessions;
+    header.keyframeSlots = kKeyframeSlots;
+    header.keyframeSize = sizeof(FlightKeyframe);
+    header.timeMs = nowMs();
+    bool written = writeAll(fd, &header, sizeof(header))
+                   && writeAll(fd, keyframes, sizeof(keyframes))
+                   && writeAll(fd, ring, sizeof(ring));
+    return close(fd) == 0 && written;
+}
+
+JniScope::JniScope(JniMethod method) : method_(method) {
+    if (threadId == 0) {
+        threadId = static_cast<uint32_t>(gettid());
+    }
+    uint32_t& slot = threadSlot.slot;
+    if (slot == kMaxThreads && jniDepth == 0) {
+        slot = claimSlot(); // Tried again on later calls while every slot is taken
+    }
+    uint32_t now = nowMs();
+    append(RecordKind::JniEnter, 0, static_cast<uint16_t>(method), threadId, now);
+    if (jniDepth++ == 0 && slot < kMaxThreads) {
+        threads[slot].method.store(static_cast<uint16_t>(method), std::memory_order_relaxed);
+        threads[slot].enteredMs.store(std::max(now, 1u), std::memory_order_release);
+    }
+}
+
+JniScope::~JniScope() {
+    uint32_t slot = threadSlot.slot;
+    if (--jniDepth == 0 && slot < kMaxThreads) {
+        threads[slot].enteredMs.store(0, std::memory_order_release);
+    }
+    append(RecordKind::JniExit, 0, static_cast<uint16_t>(method_), threadId);
+}
+
+void benchmark() {
+    constexpr int kTicks = 1 << 20;
+
+    // Scripted play with a lock every 12 ticks, several times the usual rate of keyframes
+    auto play = [](bool record) {
+        Game game(0x2545f4914f6cdd1dull);
+        uint8_t session = record ? openSession(game) : 0;
+        uint32_t cursor = game.getEventCount();
+        auto start = std::chrono::steady_clock::now();
+        for (int tick = 0; tick < kTicks; ++tick) {
+            ReplayInput input = tick % 12 == 11 ? ReplayInput::HardDrop
+                                : tick % 12 == 5 ? (tick / 12 % 2 ? ReplayInput::MoveLeft : ReplayInput::MoveRight)
+                                : ReplayInput::Tick;
+            bool locked = false;
+            if (record) {
+                JniScope scope(JniMethod::Update);
+                applyReplayInput(game, input);
+                game.consumeEvents(cursor, [&](const GameEvent& event) {
+                    locked |= event.type == GameEventType::PieceLocked;
+                });
+                recordInput(session, input, game);
+                if (locked) {
+                    recordKeyframe(session, game, false);
+                }
+                recordFrame(session, 1000);
+            } else {
+                applyReplayInput(game, input);
+                game.consumeEvents(cursor, [&](const GameEvent& event) {
+                    locked |= event.type == GameEventType::PieceLocked;
+                });
+            }
+            if (game.isGameOver()) {
+                game.reset();
+                cursor = game.getEventCount();
+                if (record) {
+                    recordKeyframe(session, game, true);
+                }
+            }
+        }
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / kTicks;
+    };
+    double plainNs = play(false);
+    double recordedNs = play(true);
+    aout << "Flight recorder: " << recordedNs - plainNs << " ns/tick recording (" << plainNs
+         << " ns/tick simulating)" << std::endl;
+}
+
+} // namespace FlightRecorder
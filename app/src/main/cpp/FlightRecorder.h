@@ -0,0 +1,148 @@
+#ifndef PALIBRIX_FLIGHTRECORDER_H
+#define PALIBRIX_FLIGHTRECORDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "Game.h"
+#include "Replay.h"
+
+/*!
+ * Always-on flight recorder for crash and hang reports. Sessions, frames and JNI calls append
+ * fixed-size records to one process-wide lock-free ring: every input with a hash of the state it
+ * led to, render times, JNI entries and exits. Each session also keeps its last few Game::writeState
+ * keyframes, taken at every piece lock, so the inputs in the ring can be replayed from one of them.
+ *
+ * After install() the ring is written to disk when the process dies on a fatal signal, or when
+ * the watchdog sees a JNI call run for longer than kStallMs. The dump only uses async-signal-safe
+ * calls (open, write, close) on memory that was set up front. tools/flight_replay turns a dump
+ * back into a replay file.
+ *
+ * A record costs an atomic increment, a coarse clock read and a 16-byte store; a played tick
+ * with its frame, JNI markers and share of keyframes stays in the low hundreds of nanoseconds.
+ */
+namespace FlightRecorder {
+
+constexpr uint32_t kRingSize = 16384;     // Records; a power of two. About 45 s of play at 60 Hz
+constexpr uint32_t kMaxSessions = 4;      // Sessions kept apart in the keyframe slots
+constexpr uint32_t kKeyframeSlots = 16;   // Per session
+constexpr uint32_t kStallMs = 5000;
+constexpr uint32_t kMaxThreads = 8;       // Live threads the watchdog follows; slots are freed on exit
+
+enum class RecordKind : uint8_t {
+    Input = 1,    // arg = ReplayInput, value = stateHash() after it
+    Frame,        // value = render time in microseconds
+    JniEnter,     // arg = JniMethod, value = thread id
+    JniExit,      // arg = JniMethod, value = thread id
+    SessionStart, // value = low bits of the seed
+    Keyframe,     // arg = 1 for a new game, value = keyframe serial
+    Stall         // arg = JniMethod, value = milliseconds it had been running
+};
+
+enum class JniMethod : uint16_t {
+    Update,
+    Input,
+    Reset,
+    DrawFrame,
+    SurfaceCreated,
+    SurfaceChanged
+};
+
+/*
+ * Dump file layout, in the device's byte order:
+ *   FlightDumpHeader
+ *   kMaxSessions * kKeyframeSlots FlightKeyframes, session by session
+ *   kRingSize FlightRecords, in ring order (record i is at i % kRingSize)
+ * Records and keyframes that were being written at the time are left as they were; their
+ * sequence and serial fields tell the reader which ones are whole.
+ */
+constexpr uint32_t kDumpMagic = 0x52464c50; // "PLFR"
+constexpr uint16_t kDumpVersion = 1;
+
+struct FlightDumpHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+    int32_t reason;      // Signal number, 0 for a stall
+    uint32_t head;       // Records written so far
+    uint32_t ringSize;
+    uint16_t sessions;
+    uint16_t keyframeSlots;
+    uint32_t keyframeSize;
+    uint32_t timeMs;     // Clock of the dump, same base as the records
+};
+
+struct FlightRecord {
+    uint32_t sequence;   // Record index + 1, stored last; 0 while being written
+    uint32_t timeMs;
+    uint8_t kind;        // RecordKind
+    uint8_t session;
+    uint16_t arg;
+    uint32_t value;
+};
+static_assert(sizeof(FlightRecord) == 16, "records are stored raw");
+
+// serial and check are stored first (as 0) and last (as the serial), so a slot dumped mid-write
+// never shows two equal nonzero values
+struct FlightKeyframe {
+    uint32_t serial;
+    uint8_t randomizer;  // RandomizerKind
+    uint8_t session;
+    uint16_t size;
+    uint64_t seed;
+    uint8_t state[Game::kMaxStateSize];
+    uint32_t check;
+    uint32_t reserved;
+};
+
+/*!
+ * Starts dumping into dir: flight-crash.plfr on SIGSEGV, SIGABRT, SIGBUS, SIGFPE and SIGILL (the
+ * previous handlers run afterwards), flight-stall.plfr on a stall. Reports a dump left by an
+ * earlier run. Only the first call does anything.
+ */
+bool install(const std::string& dir);
+
+// A new session; records its seed and a keyframe of the starting state
+uint8_t openSession(const Game& game);
+
+// An input that was just applied to the game
+void recordInput(uint8_t session, ReplayInput input, const Game& game);
+
+// The game's current state, replayable from here on; newGame marks a reset
+void recordKeyframe(uint8_t session, const Game& game, bool newGame);
+
+void recordFrame(uint8_t session, uint32_t renderMicros);
+
+// Cheap summary of the visible state: piece pose, hold, next piece, score, lines, level, combo
+uint32_t stateHash(const Game& game);
+
+// Writes a dump now; async-signal-safe. reason as in FlightDumpHeader
+bool dump(const char* path, int reason);
+
+/*!
+ * Marks a JNI call for the ring and the watchdog. Use FLIGHT_JNI_SCOPE at the top of the call.
+ */
+class JniScope {
+public:
+    explicit JniScope(JniMethod method);
+    ~JniScope();
+
+    JniScope(const JniScope&) = delete;
+    JniScope& operator=(const JniScope&) = delete;
+
+private:
+    JniMethod method_;
+};
+
+/*!
+ * Cost of recording a played tick (JNI markers, the input with its hash, keyframes at locks and
+ * a frame), against the same ticks unrecorded.
+ */
+void benchmark();
+
+} // namespace FlightRecorder
+
+#define FLIGHT_JNI_SCOPE(method) FlightRecorder::JniScope flightJniScope_(FlightRecorder::JniMethod::method)
+
+#endif //PALIBRIX_FLIGHTRECORDER_H
@@ -0,0 +1,83 @@
+#include "FrameGovernor.h"
+
+#include <chrono>
+
+// Gravity gaps longer than this are pauses or menus, not the gravity speed
+constexpr int64_t kMaxGravityGapNs = 2000000000;
+
+int64_t FrameGovernor::steadyNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+FrameGovernor::FrameGovernor(Clock clock)
+        : clock_(clock), woken_(false), paused_(false), lastInput_(clock()), lastGravity_(0),
+          gravityInterval_(0), lastFrame_(0) {}
+
+void FrameGovernor::onInput() {
+    std::lock_guard<std::mutex> lock(lock_);
+    lastInput_ = clock_();
+    woken_ = true;
+    wake_.notify_one();
+}
+
+void FrameGovernor::onGravityStep() {
+    std::lock_guard<std::mutex> lock(lock_);
+    int64_t now = clock_();
+    if (lastGravity_ != 0 && now - lastGravity_ < kMaxGravityGapNs) {
+        gravityInterval_ = now - lastGravity_;
+    }
+    lastGravity_ = now;
+}
+
+void FrameGovernor::setPaused(bool paused) {
+    std::lock_guard<std::mutex> lock(lock_);
+    paused_ = paused;
+    lastInput_ = clock_(); // Resuming counts as input, so play restarts at full rate
+    woken_ = true;
+    wake_.notify_one();
+}
+
+float FrameGovernor::beginFrame(bool gameOver, bool effectsActive) {
+    std::unique_lock<std::mutex> lock(lock_);
+    float rate = chooseRateLocked(clock_(), gameOver, effectsActive);
+    if (rate != kFullRate) {
+        int64_t delay = lastFrame_ + static_cast<int64_t>(1e9f / rate) - clock_();
+        if (delay > 0) {
+            wake_.wait_for(lock, std::chrono::nanoseconds(delay), [this]() { return woken_; });
+        }
+        if (woken_) {
+            rate = chooseRateLocked(clock_(), gameOver, effectsActive);
+        }
+    }
+    woken_ = false; // Wakes from before this frame are answered by it
+    lastFrame_ = clock_();
+    return rate;
+}
+
+float FrameGovernor::chooseRate(bool gameOver, bool effectsActive) const {
+    std::lock_guard<std::mutex> lock(lock_);
+    return chooseRateLocked(clock_(), gameOver, effectsActive);
+}
+
+int64_t FrameGovernor::getFrameDelay(float rate) const {
+    if (rate == kFullRate) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(lock_);
+    int64_t delay = lastFrame_ + static_cast<int64_t>(1e9f / rate) - clock_();
+    return delay > 0 ? delay : 0;
+}
+
+float FrameGovernor::chooseRateLocked(int64_t now, bool gameOver, bool effectsActive) const {
+    if (paused_ || gameOver) {
+        // Nothing moves but leftover particles
+        return effectsActive ? kReducedRate : kIdleRate;
+    }
+    if (effectsActive || now - lastInput_ < kInputHoldNs) {
+        return kFullRate;
+    }
+    // Unknown gravity (no steps yet) is treated as fast
+    bool slowGravity = gravityInterval_ >= kSlowGravityNs;
+    return slowGravity ? kReducedRate : kFullRate;
+}
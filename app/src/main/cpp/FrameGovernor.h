@@ -0,0 +1,70 @@
+#ifndef PALIBRIX_FRAMEGOVERNOR_H
+#define PALIBRIX_FRAMEGOVERNOR_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+
+/*!
+ * Picks how often the game surface is redrawn, from what the game is doing:
+ *  - full panel rate while the player is giving input or effects are flying,
+ *  - kReducedRate once input has been quiet for a while and gravity is slow,
+ *  - kIdleRate while paused or after game over, where the board does not move.
+ *
+ * The rate is applied twice: the caller passes it to ANativeWindow_setFrameRate so the panel can
+ * drop its refresh rate, and beginFrame() holds the render thread until the next frame is due,
+ * which saves the GPU work even where the panel ignores the hint. Input, pause and resume wake a
+ * waiting render thread at once; a wake that arrives while it is drawing makes the next
+ * beginFrame() return without waiting.
+ *
+ * Time comes from an injectable clock, so the policy can be driven with a fake clock on host.
+ */
+class FrameGovernor {
+public:
+    using Clock = int64_t (*)(); // Monotonic nanoseconds
+
+    static constexpr float kFullRate = 0.0f; // No preference, the panel's own rate
+    static constexpr float kReducedRate = 30.0f;
+    static constexpr float kIdleRate = 2.0f;
+    static constexpr int64_t kInputHoldNs = 1500000000;  // Full rate for this long after an input
+    static constexpr int64_t kSlowGravityNs = 100000000; // Gravity steps at least this far apart are slow
+
+    static int64_t steadyNanoseconds();
+
+    explicit FrameGovernor(Clock clock = steadyNanoseconds);
+
+    // Any thread
+    void onInput();
+    void onGravityStep();
+    void setPaused(bool paused);
+
+    /*!
+     * Render thread, before drawing a frame: chooses the rate for the current state and waits
+     * until a frame at that rate is due (returns at once at full rate). Returns the rate.
+     */
+    float beginFrame(bool gameOver, bool effectsActive);
+
+    /*!
+     * The policy alone: the rate the current state calls for, without waiting.
+     */
+    float chooseRate(bool gameOver, bool effectsActive) const;
+
+    // Nanoseconds until the next frame is due at the given rate, 0 if it is due now
+    int64_t getFrameDelay(float rate) const;
+
+private:
+    float chooseRateLocked(int64_t now, bool gameOver, bool effectsActive) const;
+
+    Clock clock_;
+    mutable std::mutex lock_;
+    std::condition_variable wake_;
+    bool woken_;
+
+    bool paused_;
+    int64_t lastInput_;
+    int64_t lastGravity_;
+    int64_t gravityInterval_; // Between the last two gravity steps, 0 until known
+    int64_t lastFrame_;       // Start of the last frame, written by the render thread
+};
+
+#endif //PALIBRIX_FRAMEGOVERNOR_H
@@ -1,35 +1,73 @@
 #include "Game.h"
 #include "TetrominoData.h"
+#include "ByteStream.h"
 #include <algorithm>
-#include <vector>
 #include <random>
 
 // Tetromino shapes data is now in TetrominoData.h
 
-Game::Game() : board_(BOARD_HEIGHT, std::vector<TetrominoType>(BOARD_WIDTH, TetrominoType::EMPTY)),
-               gameOver_(false), score_(0), lines_(0), level_(1), heldPiece_(TetrominoType::EMPTY), canHold_(true),
-               dropTimer_(0.0), dropInterval_(1.0), lastActionWasRotation_(false), pieceLocked(false), linesClearedFlag(false),
-               comboCount_(0), lastLinesClearedCount_(0), softDropDistance_(0), hardDropDistance_(0) { // Start with 1 second interval
-    // Initialize random number generator for the bag
-    initializeTetrominoBag();
+static uint64_t randomSeed() {
+    std::random_device rd;
+    uint64_t seed = (static_cast<uint64_t>(rd()) << 32) | rd();
+    return seed != 0 ? seed : 1;
+}
+
+Game::Game(uint64_t seed, RandomizerKind kind)
+        : randomizer_(kind, seed != 0 ? seed : randomSeed()), randomizerKind_(kind), gameOver_(false), score_(0), lines_(0), level_(1), heldPiece_(TetrominoType::EMPTY), canHold_(true),
+               gravity_(0), lastActionWasRotation_(false), boardGeneration_(0), placementGenerations_(), pieceLocked(false), linesClearedFlag(false),
+               comboCount_(0), lastLinesClearedCount_(0), softDropDistance_(0), hardDropDistance_(0), eventCount_(0) {
+    for (auto& row : board_) {
+        row.fill(TetrominoType::EMPTY);
+    }
+    rebuildColumns();
+    fillNextQueue();
     spawnNewPiece();
 }
 
 Game::~Game() {}
 
+// Rows per tick by level, in 1/kGravityOne rows. Levels 1-19 keep the old timer's speeds (a row
+// every 1.0 s down to 0.1 s at 60 ticks per second); past that it climbs through 1G to 20G.
+static constexpr uint32_t kGravityCurve[] = {
+    1092, 1150, 1214, 1285, 1365, 1456, 1560, 1680, 1820, 1986,  // Levels 1-10
+    2185, 2427, 2731, 3121, 3641, 4369, 5461, 7282, 10923,       // 11-19
+    kGravityOne / 4, kGravityOne / 3, kGravityOne / 2,           // 20-22
+    kGravityOne, 2 * kGravityOne, 3 * kGravityOne, 5 * kGravityOne, // 23-26
+    kGravity20G,                                                  // 27 on
+};
+
+uint32_t Game::gravityForLevel(int level) {
+    constexpr int kLevels = sizeof(kGravityCurve) / sizeof(kGravityCurve[0]);
+    return kGravityCurve[std::clamp(level, 1, kLevels) - 1];
+}
+
 void Game::update() {
     if (gameOver_) return;
 
-    // Automatic drop based on level
-    dropTimer_ += 1.0 / 60.0; // Assuming 60 FPS
-    if (dropTimer_ >= dropInterval_) {
-        softDrop();
-        dropTimer_ = 0;
+    gravity_ += gravityForLevel(level_);
+    int rows = static_cast<int>(gravity_ / kGravityOne);
+    if (rows == 0) {
+        return;
     }
+    gravity_ %= kGravityOne;
+
+    // However many rows are due, the piece falls to at most its landing row (the ghost) in one
+    // step. A piece already resting there locks.
+    int distance = ghostPiece_.y - currentPiece_.y;
+    if (distance == 0) {
+        lockPiece();
+        clearLines();
+        spawnNewPiece();
+        canHold_ = true;
+        return;
+    }
+    currentPiece_.y += std::min(rows, distance);
+    lastActionWasRotation_ = false;
 }
 
 void Game::move(int dx) {
     if (gameOver_) return;
+    stats_.onKey();
     
     Tetromino newPiece = currentPiece_;
     newPiece.x += dx;
@@ -43,6 +81,7 @@ void Game::move(int dx) {
 
 void Game::rotate() {
     if (gameOver_) return;
+    stats_.onKey();
     
     Tetromino newPiece = currentPiece_;
     newPiece.rotation = (newPiece.rotation + 1) % 4;
@@ -56,6 +95,7 @@ void Game::rotate() {
 
 void Game::rotateLeft() {
     if (gameOver_) return;
+    stats_.onKey();
     
     Tetromino newPiece = currentPiece_;
     newPiece.rotation = (newPiece.rotation + 3) % 4; // +3 is same as -1 in mod 4
@@ -69,7 +109,11 @@ void Game::rotateLeft() {
 
 void Game::softDrop() {
     if (gameOver_) return;
-    
+    stats_.onKey();
+    stepDown();
+}
+
+void Game::stepDown() {
     Tetromino newPiece = currentPiece_;
     newPiece.y++;
     
@@ -89,14 +133,17 @@ void Game::softDrop() {
 
 void Game::hardDrop() {
     if (gameOver_) return;
+    stats_.onKey();
     
-    int dropDistance = 0;
-    while (isValid(currentPiece_)) {
-        currentPiece_.y++;
-        dropDistance++;
-    }
-    currentPiece_.y--; // Move back to last valid position
-    hardDropDistance_ = dropDistance;
+    int distance = ghostPiece_.y - currentPiece_.y;
+    currentPiece_.y = ghostPiece_.y;
+    hardDropDistance_ = distance + 1; // Scoring has always counted one extra cell
+
+    GameEvent event{};
+    event.type = GameEventType::HardDrop;
+    event.piece = currentPiece_;
+    event.distance = distance;
+    pushEvent(event);
     
     lockPiece();
     clearLines();
@@ -106,6 +153,7 @@ void Game::hardDrop() {
 
 void Game::hold() {
     if (gameOver_ || !canHold_) return;
+    stats_.onKey();
     
     if (heldPiece_ == TetrominoType::EMPTY) {
         heldPiece_ = currentPiece_.type;
@@ -114,7 +162,7 @@ void Game::hold() {
         TetrominoType temp = currentPiece_.type;
         currentPiece_.type = heldPiece_;
         currentPiece_.rotation = 0;
-        currentPiece_.x = 3;
+        currentPiece_.x = SPAWN_X;
         currentPiece_.y = 0;
         heldPiece_ = temp;
         updateGhostPiece();
@@ -123,15 +171,22 @@ void Game::hold() {
 }
 
 void Game::reset() {
-    board_ = std::vector<std::vector<TetrominoType>>(BOARD_HEIGHT, std::vector<TetrominoType>(BOARD_WIDTH, TetrominoType::EMPTY));
+    reset(randomSeed());
+}
+
+void Game::reset(uint64_t seed) {
+    randomizer_.reset(randomizerKind_, seed);
+    for (auto& row : board_) {
+        row.fill(TetrominoType::EMPTY);
+    }
+    rebuildColumns();
     gameOver_ = false;
     score_ = 0;
     lines_ = 0;
     level_ = 1;
     heldPiece_ = TetrominoType::EMPTY;
     canHold_ = true;
-    dropTimer_ = 0.0;
-    dropInterval_ = 1.0;
+    gravity_ = 0;
     lastActionWasRotation_ = false;
     pieceLocked = false;
     linesClearedFlag = false;
@@ -139,10 +194,31 @@ void Game::reset() {
     lastLinesClearedCount_ = 0;
     softDropDistance_ = 0;
     hardDropDistance_ = 0;
-    initializeTetrominoBag();
+    stats_.reset();
+    fillNextQueue();
     spawnNewPiece();
 }
 
+void Game::setRandomizerKind(RandomizerKind kind) {
+    randomizerKind_ = kind;
+}
+
+RandomizerKind Game::getRandomizerKind() const {
+    return randomizer_.getKind();
+}
+
+uint64_t Game::getSeed() const {
+    return randomizer_.getSeed();
+}
+
+void Game::peekPieces(TetrominoType* out, int count) const {
+    int fromQueue = std::min(count, static_cast<int>(nextQueue_.size()));
+    for (int i = 0; i < fromQueue; ++i) {
+        out[i] = nextQueue_[i];
+    }
+    randomizer_.peek(out + fromQueue, count - fromQueue);
+}
+
 bool Game::wasPieceLocked() const {
     return pieceLocked;
 }
@@ -159,7 +235,24 @@ void Game::clearLinesClearedFlag() {
     linesClearedFlag = false;
 }
 
-const std::vector<std::vector<TetrominoType>>& Game::getBoard() const {
+uint32_t Game::getEventCount() const {
+    return eventCount_;
+}
+
+bool Game::getEvent(uint32_t index, GameEvent& out) const {
+    if (index >= eventCount_ || eventCount_ - index > kEventHistory) {
+        return false;
+    }
+    out = events_[index % kEventHistory];
+    return true;
+}
+
+void Game::pushEvent(const GameEvent& event) {
+    events_[eventCount_ % kEventHistory] = event;
+    eventCount_++;
+}
+
+const Game::Board& Game::getBoard() const {
     return board_;
 }
 
@@ -175,7 +268,11 @@ TetrominoType Game::getHeldPiece() const {
     return heldPiece_;
 }
 
-const std::vector<TetrominoType>& Game::getNextQueue() const {
+bool Game::canHold() const {
+    return canHold_;
+}
+
+const Game::NextQueue& Game::getNextQueue() const {
     return nextQueue_;
 }
 
@@ -196,64 +293,154 @@ int Game::getCombo() const {
 }
 
 double Game::getTime() const {
-    // TODO: Implement timer
-    return 0.0;
+    return stats_.getStats().timeSeconds;
 }
 
 bool Game::isGameOver() const {
     return gameOver_;
 }
 
-void Game::initializeTetrominoBag() {
-    // 7-bag random generator
-    std::vector<TetrominoType> bag = {
-        TetrominoType::I, TetrominoType::O, TetrominoType::T,
-        TetrominoType::J, TetrominoType::L, TetrominoType::S, TetrominoType::Z
-    };
-    
-    std::random_device rd;
-    std::mt19937 g(rd());
-    std::shuffle(bag.begin(), bag.end(), g);
-    
-    tetrominoBag_ = bag;
-    
-    // Fill initial next queue
-    for (int i = 0; i < 6; ++i) {
-        nextQueue_.push_back(getNextFromBag());
+void Game::setClock(uint32_t timeMs) {
+    stats_.setTime(timeMs);
+}
+
+const SessionStats& Game::getStats() const {
+    return stats_.getStats();
+}
+
+void Game::addFinesseFaults(int faults) {
+    stats_.onFinesseFaults(faults);
+}
+
+void Game::writeState(ByteWriter& out) const {
+    // Board cells packed two per byte
+    for (int y = 0; y < BOARD_HEIGHT; ++y) {
+        for (int x = 0; x < BOARD_WIDTH; x += 2) {
+            out.putU8(static_cast<uint8_t>(static_cast<int>(board_[y][x])
+                                           | (static_cast<int>(board_[y][x + 1]) << 4)));
+        }
+    }
+    out.putU8(static_cast<uint8_t>(currentPiece_.type));
+    out.putU8(static_cast<uint8_t>(currentPiece_.rotation));
+    out.putU8(static_cast<uint8_t>(currentPiece_.x + 8)); // Kicks can push x slightly negative
+    out.putU8(static_cast<uint8_t>(currentPiece_.y + 8));
+    out.putU8(static_cast<uint8_t>(heldPiece_));
+    out.putU8(static_cast<uint8_t>((canHold_ ? 1 : 0) | (lastActionWasRotation_ ? 2 : 0) | (gameOver_ ? 4 : 0)));
+
+    out.putU8(static_cast<uint8_t>(nextQueue_.size()));
+    for (size_t i = 0; i < nextQueue_.size(); ++i) {
+        out.putU8(static_cast<uint8_t>(nextQueue_[i]));
     }
+    randomizer_.writeState(out);
+
+    out.putVarint(static_cast<uint32_t>(score_));
+    out.putVarint(static_cast<uint32_t>(lines_));
+    out.putVarint(static_cast<uint32_t>(level_));
+    out.putVarint(gravity_);
+    out.putVarint(static_cast<uint32_t>(comboCount_));
+    out.putVarint(static_cast<uint32_t>(lastLinesClearedCount_));
+    out.putVarint(static_cast<uint32_t>(softDropDistance_));
+    out.putVarint(static_cast<uint32_t>(hardDropDistance_));
+    stats_.writeState(out);
 }
 
-TetrominoType Game::getNextFromBag() {
-    if (tetrominoBag_.empty()) {
-        // Refill bag
-        std::vector<TetrominoType> bag = {
-            TetrominoType::I, TetrominoType::O, TetrominoType::T,
-            TetrominoType::J, TetrominoType::L, TetrominoType::S, TetrominoType::Z
-        };
-        
-        std::random_device rd;
-        std::mt19937 g(rd());
-        std::shuffle(bag.begin(), bag.end(), g);
-        
-        tetrominoBag_ = bag;
+bool Game::readState(ByteReader& in) {
+    const int emptyType = static_cast<int>(TetrominoType::EMPTY);
+    Board board;
+    for (int y = 0; y < BOARD_HEIGHT; ++y) {
+        for (int x = 0; x < BOARD_WIDTH; x += 2) {
+            uint8_t cells = in.getU8();
+            if ((cells & 0x0f) > emptyType || (cells >> 4) > emptyType) {
+                return false;
+            }
+            board[y][x] = static_cast<TetrominoType>(cells & 0x0f);
+            board[y][x + 1] = static_cast<TetrominoType>(cells >> 4);
+        }
+    }
+    Tetromino piece;
+    int pieceType = in.getU8();
+    piece.type = static_cast<TetrominoType>(pieceType);
+    piece.rotation = in.getU8() & 3;
+    piece.x = in.getU8() - 8;
+    piece.y = in.getU8() - 8;
+    int heldType = in.getU8();
+    uint8_t flags = in.getU8();
+
+    size_t queueSize = in.getU8();
+    if (pieceType >= emptyType || heldType > emptyType || queueSize > NextQueue::capacity()) {
+        return false;
+    }
+    NextQueue queue;
+    for (size_t i = 0; i < queueSize; ++i) {
+        int type = in.getU8();
+        if (type >= emptyType) {
+            return false;
+        }
+        queue.push_back(static_cast<TetrominoType>(type));
+    }
+    Randomizer randomizer = randomizer_;
+    if (!randomizer.readState(in)) {
+        return false;
+    }
+
+    int score = static_cast<int>(in.getVarint());
+    int lines = static_cast<int>(in.getVarint());
+    int level = static_cast<int>(in.getVarint());
+    uint64_t gravity = in.getVarint();
+    int combo = static_cast<int>(in.getVarint());
+    int lastLinesCleared = static_cast<int>(in.getVarint());
+    int softDropDistance = static_cast<int>(in.getVarint());
+    int hardDropDistance = static_cast<int>(in.getVarint());
+    StatsTracker stats;
+    if (!stats.readState(in) || !in.ok() || gravity >= kGravityOne) {
+        return false;
+    }
+
+    board_ = board;
+    rebuildColumns();
+    currentPiece_ = piece;
+    heldPiece_ = static_cast<TetrominoType>(heldType);
+    canHold_ = (flags & 1) != 0;
+    lastActionWasRotation_ = (flags & 2) != 0;
+    gameOver_ = (flags & 4) != 0;
+    nextQueue_ = queue;
+    randomizer_ = randomizer;
+    randomizerKind_ = randomizer.getKind();
+    score_ = score;
+    lines_ = lines;
+    level_ = level;
+    gravity_ = static_cast<uint32_t>(gravity);
+    comboCount_ = combo;
+    lastLinesClearedCount_ = lastLinesCleared;
+    softDropDistance_ = softDropDistance;
+    hardDropDistance_ = hardDropDistance;
+    stats_ = stats;
+    pieceLocked = false;
+    linesClearedFlag = false;
+    updateGhostPiece();
+    return true;
+}
+
+void Game::fillNextQueue() {
+    nextQueue_.clear();
+    TetrominoType pieces[NEXT_QUEUE_SIZE];
+    randomizer_.generate(pieces, NEXT_QUEUE_SIZE);
+    for (TetrominoType piece : pieces) {
+        nextQueue_.push_back(piece);
     }
-    
-    TetrominoType next = tetrominoBag_.back();
-    tetrominoBag_.pop_back();
-    return next;
 }
 
 void Game::spawnNewPiece() {
     if (nextQueue_.empty()) {
-        initializeTetrominoBag();
+        fillNextQueue();
     }
     
     currentPiece_.type = nextQueue_.front();
-    nextQueue_.erase(nextQueue_.begin());
-    nextQueue_.push_back(getNextFromBag());
+    nextQueue_.pop_front();
+    nextQueue_.push_back(randomizer_.next());
     
     currentPiece_.rotation = 0;
-    currentPiece_.x = 3; // Center of 10-wide board
+    currentPiece_.x = SPAWN_X; // Center of 10-wide board
     currentPiece_.y = 0; // Top of board
     
     updateGhostPiece();
@@ -273,6 +460,59 @@ void Game::spawnNewPiece() {
 }
 
 bool Game::isValid(const Tetromino& piece) const {
+    return canPlace(piece);
+}
+
+bool Game::canPlace(const Tetromino& piece) const {
+    if (piece.type == TetrominoType::EMPTY) return false;
+
+    unsigned column = static_cast<unsigned>(piece.x + kPlacementXBias);
+    unsigned bit = static_cast<unsigned>(piece.y + kPlacementYBias);
+    if (column >= kPlacementColumns || bit >= 32) {
+        return false;
+    }
+    return (placements(piece.type, piece.rotation & 3)[column] >> bit & 1) != 0;
+}
+
+int Game::getLandingRow(const Tetromino& piece) const {
+    if (!canPlace(piece)) {
+        return piece.y;
+    }
+    // The pose fits from its row down to just above the first row where it does not; the map has
+    // no bits past the floor, so there always is one
+    uint32_t map = placements(piece.type, piece.rotation & 3)[piece.x + kPlacementXBias];
+    return piece.y + __builtin_ctz(~map >> (piece.y + kPlacementYBias)) - 1;
+}
+
+const Game::PlacementMap& Game::placements(TetrominoType type, int rotation) const {
+    int index = static_cast<int>(type);
+    PlacementMap& map = placements_[index][rotation];
+    if (placementGenerations_[index][rotation] == boardGeneration_) {
+        return map;
+    }
+    placementGenerations_[index][rotation] = boardGeneration_;
+
+    constexpr uint32_t kRows = (1u << BOARD_HEIGHT) - 1;
+    const auto& shape = tetrominoShapes[index][rotation];
+    for (int column = 0; column < kPlacementColumns; ++column) {
+        uint32_t fitting = ~0u;
+        for (const auto& mino : shape) {
+            int x = column - kPlacementXBias + mino.x;
+            if (x < 0 || x >= BOARD_WIDTH) {
+                fitting = 0;
+                break;
+            }
+            // Pose bit b puts this mino on row b - kPlacementYBias + mino.y
+            uint32_t empty = ~columns_[x] & kRows;
+            int shift = kPlacementYBias - mino.y;
+            fitting &= shift >= 0 ? empty << shift : empty >> -shift;
+        }
+        map[column] = fitting;
+    }
+    return map;
+}
+
+bool Game::fits(const Board& board, const Tetromino& piece) {
     if (piece.type == TetrominoType::EMPTY) return false;
 
     const auto& shape = tetrominoShapes[static_cast<int>(piece.type)][piece.rotation];
@@ -286,7 +526,7 @@ bool Game::isValid(const Tetromino& piece) const {
         }
 
         // Check for collision with existing pieces on the board
-        if (board_[boardY][boardX] != TetrominoType::EMPTY) {
+        if (board[boardY][boardX] != TetrominoType::EMPTY) {
             return false;
         }
     }
@@ -302,14 +542,23 @@ void Game::lockPiece() {
         int boardY = currentPiece_.y + mino.y;
         if (boardY >= 0 && boardY < BOARD_HEIGHT && boardX >= 0 && boardX < BOARD_WIDTH) {
             board_[boardY][boardX] = currentPiece_.type;
+            columns_[boardX] |= 1u << boardY;
         }
     }
+    boardGeneration_++;
     
     pieceLocked = true; // Set the flag here
+    stats_.onPiece();
+
+    GameEvent event{};
+    event.type = GameEventType::PieceLocked;
+    event.piece = currentPiece_;
+    pushEvent(event);
 }
 
 void Game::clearLines() {
     int linesCleared = 0;
+    uint32_t clearedRowMask = 0;
     bool tSpin = false;
 
     if (lastActionWasRotation_ && currentPiece_.type == TetrominoType::T) {
@@ -337,14 +586,20 @@ void Game::clearLines() {
         }
         
         if (fullLine) {
-            // Remove this line
-            board_.erase(board_.begin() + y);
+            // Rows above have already shifted down once per cleared line
+            clearedRowMask |= 1u << (y - linesCleared);
+
+            // Remove this line by shifting everything above it down in place
+            std::move_backward(board_.begin(), board_.begin() + y, board_.begin() + y + 1);
             // Add empty line at top
-            board_.insert(board_.begin(), std::vector<TetrominoType>(BOARD_WIDTH, TetrominoType::EMPTY));
+            board_[0].fill(TetrominoType::EMPTY);
             linesCleared++;
             y++; // Check this line again since we shifted everything down
         }
     }
+    if (linesCleared > 0) {
+        rebuildColumns();
+    }
     
     // Add drop scores (soft drop: 1 point per cell, hard drop: 2 points per cell)
     score_ += softDropDistance_ * 1; // 1 point per soft drop cell
@@ -393,15 +648,27 @@ void Game::clearLines() {
         
         score_ += levelMultipliedScore + comboBonus;
 
-        // Increase level every 10 lines
+        // Increase level every 10 lines; gravity follows the level through the curve table
         if (lines_ / 10 >= level_) {
             level_++;
-            // Decrease drop interval as level increases, making the game faster
-            dropInterval_ = std::max(0.1, 1.0 - (level_ - 1) * 0.05);
         }
 
+        // Nothing can rest above an empty floor row, so an empty bottom row means an empty board
+        bool perfectClear = linesCleared > 0
+                && std::all_of(board_[BOARD_HEIGHT - 1].begin(), board_[BOARD_HEIGHT - 1].end(),
+                               [](TetrominoType cell) { return cell == TetrominoType::EMPTY; });
+        stats_.onClear(linesCleared, tSpin, comboCount_, perfectClear);
+
         linesClearedFlag = true; // Set the flag here
         lastLinesClearedCount_ = linesCleared; // Store for future reference
+
+        GameEvent event{};
+        event.type = GameEventType::LineClear;
+        event.piece = currentPiece_;
+        event.rowMask = clearedRowMask;
+        event.lines = linesCleared;
+        event.tSpin = tSpin;
+        pushEvent(event);
     } else {
         // No lines cleared, reset combo
         comboCount_ = 0;
@@ -411,8 +678,16 @@ void Game::clearLines() {
 
 void Game::updateGhostPiece() {
     ghostPiece_ = currentPiece_;
-    while (isValid(ghostPiece_)) {
-        ghostPiece_.y++;
+    ghostPiece_.y = getLandingRow(currentPiece_);
+}
+
+void Game::rebuildColumns() {
+    for (int x = 0; x < BOARD_WIDTH; ++x) {
+        uint32_t column = 1u << BOARD_HEIGHT;
+        for (int y = 0; y < BOARD_HEIGHT; ++y) {
+            column |= board_[y][x] != TetrominoType::EMPTY ? 1u << y : 0u;
+        }
+        columns_[x] = column;
     }
-    ghostPiece_.y--; // Move it back to the last valid position
-} 
\ No newline at end of file
+    boardGeneration_++;
+}
\ No newline at end of file
@@ -1,12 +1,25 @@
 #ifndef PALIBRIX_GAME_H
 #define PALIBRIX_GAME_H
 
-#include <vector>
+#include <array>
 #include <cstdint>
-#include <random>
+
+#include "RingBuffer.h"
+#include "Randomizer.h"
+#include "SessionStats.h"
+
+class ByteWriter;
+class ByteReader;
 
 constexpr int BOARD_WIDTH = 10;
 constexpr int BOARD_HEIGHT = 22; // Standard Tetris is 20 rows visible, with 2 hidden rows above.
+constexpr int NEXT_QUEUE_SIZE = 6;
+// Gravity in fixed point: rows per tick in units of 1/kGravityOne row. 1G is a row every tick,
+// 20G takes a piece straight to where it lands.
+constexpr uint32_t kGravityOne = 1u << 16;
+constexpr uint32_t kGravity20G = 20 * kGravityOne;
+
+constexpr int SPAWN_X = 3; // New pieces enter in rotation 0 at this x, y = 0
 
 struct Mino {
     int x, y;
@@ -22,12 +35,35 @@ struct Tetromino {
     int x, y; // Position of the top-left corner of the bounding box
 };
 
+enum class GameEventType {
+    PieceLocked, // piece = locked piece
+    HardDrop,    // piece = landed piece, distance = rows dropped
+    LineClear    // rowMask = cleared rows (pre-clear indices), lines = count, tSpin = T-spin flag
+};
+
+struct GameEvent {
+    GameEventType type;
+    Tetromino piece;
+    uint32_t rowMask;
+    int lines;
+    int distance;
+    bool tSpin;
+};
+
 class Game {
 public:
-    Game();
+    // Fixed-size containers so that steady-state play never touches the heap
+    using Board = std::array<std::array<TetrominoType, BOARD_WIDTH>, BOARD_HEIGHT>;
+    using NextQueue = RingBuffer<TetrominoType, 8>;
+
+    // seed 0 picks a random seed
+    explicit Game(uint64_t seed = 0, RandomizerKind kind = RandomizerKind::Bag7);
     ~Game();
 
-    void update(); // Main game logic tick
+    void update(); // Main game logic tick, 60 per second: applies gravity
+
+    // The level's gravity from the curve table; levels past the end stay at 20G
+    static uint32_t gravityForLevel(int level);
 
     // Game Actions
     void move(int dx);
@@ -36,14 +72,39 @@ public:
     void softDrop();
     void hardDrop();
     void hold();
-    void reset();
+    void reset(); // New game with a fresh random seed
+    void reset(uint64_t seed);
+
+    // Piece generation; a new kind takes effect on the next reset
+    void setRandomizerKind(RandomizerKind kind);
+    RandomizerKind getRandomizerKind() const;
+    uint64_t getSeed() const;
+
+    // Writes the upcoming count pieces (next queue first, then beyond it) without changing state
+    void peekPieces(TetrominoType* out, int count) const;
+
+    // Replay keyframes: everything needed to continue play identically from this point. Event
+    // history and sound flags are not part of the state.
+    static constexpr size_t kMaxStateSize = 320;
+    void writeState(ByteWriter& out) const;
+    bool readState(ByteReader& in); // false if the data is malformed; the game is then unchanged
+
+    // The collision rule used for every move: inside the board and on empty cells only
+    static bool fits(const Board& board, const Tetromino& piece);
+
+    // fits() against the current board, answered from the placement cache (one bit lookup)
+    bool canPlace(const Tetromino& piece) const;
+
+    // Row the piece comes to rest on when dropped straight down; its own row if it does not fit
+    int getLandingRow(const Tetromino& piece) const;
 
     // Getters for rendering
-    const std::vector<std::vector<TetrominoType>>& getBoard() const;
+    const Board& getBoard() const;
     const Tetromino& getCurrentPiece() const;
     const Tetromino& getGhostPiece() const;
     TetrominoType getHeldPiece() const;
-    const std::vector<TetrominoType>& getNextQueue() const;
+    bool canHold() const; // false once hold was used for the current piece
+    const NextQueue& getNextQueue() const;
 
     // Game State
     int getScore() const;
@@ -53,27 +114,65 @@ public:
     double getTime() const; // Game time in seconds
     bool isGameOver() const;
 
+    // Session clock in ms since reset, set by whoever drives the game (the activity or a replay)
+    // before each input. Only the statistics use it; gameplay stays tick-driven.
+    void setClock(uint32_t timeMs);
+
+    // PPS, APM, KPP, clear-type counts and so on, updated as the game is played
+    const SessionStats& getStats() const;
+    void addFinesseFaults(int faults); // Reported by FinesseAnalyzer; not part of the state
+
     // Sound-related status
     bool wasPieceLocked() const;
     void clearPieceLockedFlag();
     bool wereLinesCleared() const;
     void clearLinesClearedFlag();
 
+    // Gameplay events for effects. The last kEventHistory events are kept in a ring so that
+    // several consumers can each follow them with their own cursor.
+    static constexpr uint32_t kEventHistory = 16;
+    uint32_t getEventCount() const; // Total events emitted so far
+    bool getEvent(uint32_t index, GameEvent& out) const; // false if not emitted yet or overwritten
+
+    // Calls fn for every event from cursor onward and advances cursor past them. Events that
+    // already fell out of the ring are skipped.
+    template <typename Fn>
+    void consumeEvents(uint32_t& cursor, Fn&& fn) const {
+        if (eventCount_ - cursor > kEventHistory) {
+            cursor = eventCount_ - kEventHistory;
+        }
+        for (; cursor != eventCount_; ++cursor) {
+            fn(events_[cursor % kEventHistory]);
+        }
+    }
+
 private:
     void spawnNewPiece();
     bool isValid(const Tetromino& piece) const;
     void lockPiece();
     void clearLines();
     void updateGhostPiece();
-    void initializeTetrominoBag();
-    TetrominoType getNextFromBag();
-
-    std::vector<std::vector<TetrominoType>> board_;
+    void fillNextQueue();
+    void stepDown();
+    void rebuildColumns();
+
+    // Placement cache: for one (type, rotation), bit y + kPlacementYBias of entry x + kPlacementXBias
+    // is set where the piece fits at (x, y) on the current board. Built on first use after each
+    // board change, from the column masks.
+    static constexpr int kPlacementXBias = 3; // Bounding boxes may start left of the board
+    static constexpr int kPlacementYBias = 2; // ... or above it
+    static constexpr int kPlacementColumns = BOARD_WIDTH + kPlacementXBias;
+    using PlacementMap = std::array<uint32_t, kPlacementColumns>;
+    const PlacementMap& placements(TetrominoType type, int rotation) const;
+    void pushEvent(const GameEvent& event);
+
+    Board board_;
     Tetromino currentPiece_;
     Tetromino ghostPiece_;
 
-    std::vector<TetrominoType> tetrominoBag_;
-    std::vector<TetrominoType> nextQueue_;
+    Randomizer randomizer_;
+    RandomizerKind randomizerKind_;
+    NextQueue nextQueue_;
     
     TetrominoType heldPiece_;
     bool canHold_;
@@ -82,11 +181,15 @@ private:
     int score_;
     int lines_;
     int level_;
-    double dropTimer_;
-    double dropInterval_;
-    // a timer will be needed
+    uint32_t gravity_; // Fraction of a row fallen so far, in 1/kGravityOne rows
     bool gameOver_;
 
+    // Bit y set where column x has a filled cell at row y; bit BOARD_HEIGHT is the floor
+    std::array<uint32_t, BOARD_WIDTH> columns_;
+    uint32_t boardGeneration_; // Bumped whenever a cell changes
+    mutable PlacementMap placements_[7][4];
+    mutable uint32_t placementGenerations_[7][4]; // boardGeneration_ each map was built for
+
     bool pieceLocked; // Flag to indicate a piece was just locked
     bool linesClearedFlag; // Flag to indicate lines were just cleared
     
@@ -98,8 +201,10 @@ private:
     int softDropDistance_;
     int hardDropDistance_;
 
-    std::mt19937 rng;
-    std::uniform_int_distribution<int> dist;
+    StatsTracker stats_;
+
+    GameEvent events_[kEventHistory];
+    uint32_t eventCount_;
 };
 
 #endif //PALIBRIX_GAME_H 
\ No newline at end of file
@@ -0,0 +1,144 @@
+#include "GameSession.h"
+#include "AudioEngine.h"
+#include "FlightRecorder.h"
+#include "Renderer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+
+GameSession::GameSession(uint64_t seed)
+        : game_(seed), sessionStart_(std::chrono::steady_clock::now()), audio_(nullptr),
+          eventCursor_(game_.getEventCount()), flightSession_(FlightRecorder::openSession(game_)) {
+    finesse_.begin(game_);
+    scheduler_.spawn(playEventSounds(scheduler_));
+}
+
+void GameSession::setReplayDirectory(const std::string& dir) {
+    std::lock_guard<std::mutex> lock(lock_);
+    replayDir_ = dir;
+    startReplay();
+}
+
+void GameSession::setAudio(AudioEngine* audio) {
+    std::lock_guard<std::mutex> lock(lock_);
+    audio_ = audio;
+}
+
+void GameSession::spawn(Task task) {
+    std::lock_guard<std::mutex> lock(lock_);
+    scheduler_.spawn(std::move(task));
+}
+
+void GameSession::apply(ReplayInput input) {
+    std::lock_guard<std::mutex> lock(lock_);
+    syncClock();
+    int pieceY = game_.getCurrentPiece().y;
+    uint32_t events = game_.getEventCount();
+    applyReplayInput(game_, input);
+
+    if (input != ReplayInput::Tick) {
+        governor_.onInput();
+    } else if (game_.getCurrentPiece().y != pieceY || game_.getEventCount() != events) {
+        governor_.onGravityStep(); // Ticks come at 60 Hz; only the ones that moved the piece count
+    }
+    replay_.record(input, game_);
+
+    uint32_t graded = finesse_.getPieces();
+    finesse_.onInput(input, game_);
+    if (finesse_.getPieces() != graded) {
+        const FinesseResult& result = finesse_.getLastResult();
+        game_.addFinesseFaults(std::max(0, result.inputs - result.minimal));
+    }
+
+    // Events first, so a task woken by a lock sees the tick it happened on
+    bool locked = false;
+    game_.consumeEvents(eventCursor_, [this, &locked](const GameEvent& event) {
+        locked |= event.type == GameEventType::PieceLocked;
+        scheduler_.signal(event);
+    });
+    if (input == ReplayInput::Tick) {
+        scheduler_.advance();
+    }
+
+    FlightRecorder::recordInput(flightSession_, input, game_);
+    if (locked) {
+        FlightRecorder::recordKeyframe(flightSession_, game_, false);
+    }
+}
+
+void GameSession::reset() {
+    std::lock_guard<std::mutex> lock(lock_);
+    game_.reset();
+    eventCursor_ = game_.getEventCount();
+    sessionStart_ = std::chrono::steady_clock::now();
+    startReplay();
+    finesse_.begin(game_);
+    FlightRecorder::recordKeyframe(flightSession_, game_, true);
+}
+
+void GameSession::setPaused(bool paused) {
+    if (paused) {
+        // The process may be killed while paused; get the recording onto storage
+        std::lock_guard<std::mutex> lock(lock_);
+        replay_.flush();
+    }
+    governor_.setPaused(paused);
+}
+
+int GameSession::getScore() const {
+    std::lock_guard<std::mutex> lock(lock_);
+    return game_.getScore();
+}
+
+int GameSession::getLines() const {
+    std::lock_guard<std::mutex> lock(lock_);
+    return game_.getLines();
+}
+
+int GameSession::getCombo() const {
+    std::lock_guard<std::mutex> lock(lock_);
+    return game_.getCombo();
+}
+
+bool GameSession::isGameOver() const {
+    std::lock_guard<std::mutex> lock(lock_);
+    return game_.isGameOver();
+}
+
+float GameSession::draw(Renderer& renderer) {
+    // The governor may hold this thread for a while; inputs must still get through meanwhile
+    float rate = governor_.beginFrame(isGameOver(), renderer.hasActiveEffects());
+    std::lock_guard<std::mutex> lock(lock_);
+    auto start = std::chrono::steady_clock::now();
+    renderer.render(game_);
+    auto micros = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    FlightRecorder::recordFrame(flightSession_, static_cast<uint32_t>(micros.count()));
+    return rate;
+}
+
+void GameSession::syncClock() {
+    auto elapsed = std::chrono::steady_clock::now() - sessionStart_;
+    game_.setClock(static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()));
+}
+
+void GameSession::startReplay() {
+    if (replayDir_.empty()) {
+        return;
+    }
+    char name[64];
+    snprintf(name, sizeof(name), "/%lld_%016llx.plr", static_cast<long long>(time(nullptr)),
+             static_cast<unsigned long long>(game_.getSeed()));
+    replay_.begin(replayDir_ + name, game_);
+    pruneReplays(replayDir_, kMaxReplays, kMaxReplayBytes);
+}
+
+Task GameSession::playEventSounds(TaskScheduler& scheduler) {
+    for (;;) {
+        GameEvent event = co_await scheduler.event();
+        if (audio_) {
+            audio_->onGameEvent(event);
+        }
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef PALIBRIX_GAMESESSION_H
+#define PALIBRIX_GAMESESSION_H
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "Game.h"
+#include "Finesse.h"
+#include "FrameGovernor.h"
+#include "Replay.h"
+#include "TaskScheduler.h"
+
+class AudioEngine;
+class Renderer;
+
+/*!
+ * One running game and everything that follows it: the replay recording, finesse grading, the
+ * session clock for the statistics, sound event dispatch and the redraw rate governor.
+ *
+ * Timed and event-driven sequences run as Tasks on the session's scheduler, which advances with
+ * every gravity tick and sees every game event. Inputs are the simulation thread here. Inputs,
+ * piece locks and frames also go to the flight recorder.
+ *
+ * This is what a native game handle points to. Sessions share no state, so any number can run at
+ * once (split screen, an AI opponent, background simulations). Inputs usually arrive on the UI
+ * thread while draw() runs on the GL thread, so the game is guarded by a per-session mutex.
+ */
+class GameSession {
+public:
+    explicit GameSession(uint64_t seed = 0);
+
+    GameSession(const GameSession&) = delete;
+    GameSession& operator=(const GameSession&) = delete;
+
+    // Records every game from now on into this directory; empty stops recording new games. Each
+    // new recording prunes the oldest ones beyond kMaxReplays or kMaxReplayBytes.
+    void setReplayDirectory(const std::string& dir);
+
+    // Game events trigger voices on this engine; nullptr detaches. The engine must outlive the link
+    void setAudio(AudioEngine* audio);
+
+    /*!
+     * Applies a gravity step or a player input, then records it, grades finesse and hands the
+     * resulting game events to the scheduler's tasks. A gravity step also advances the scheduler.
+     */
+    void apply(ReplayInput input);
+
+    // Starts a sequence on the session's scheduler; it runs under the session lock
+    void spawn(Task task);
+
+    void reset(); // New game, new recording
+    void setPaused(bool paused);
+
+    int getScore() const;
+    int getLines() const;
+    int getCombo() const;
+    bool isGameOver() const;
+
+    /*!
+     * GL thread: waits until the governor wants the next frame, then draws the game. Returns the
+     * redraw rate chosen for this frame.
+     */
+    float draw(Renderer& renderer);
+
+    static constexpr size_t kMaxReplays = 100;
+    static constexpr uint64_t kMaxReplayBytes = 16u << 20; // For long games; 100 of 20 minutes take about 5 MB
+
+private:
+    void syncClock();
+    void startReplay();
+    Task playEventSounds(TaskScheduler& scheduler);
+
+    mutable std::mutex lock_;
+    Game game_;
+    FinesseAnalyzer finesse_;
+    ReplayWriter replay_; // Finishes the file when the session is destroyed
+    std::string replayDir_;
+    std::chrono::steady_clock::time_point sessionStart_;
+    AudioEngine* audio_;
+    TaskScheduler scheduler_;
+    uint32_t eventCursor_; // Events up to here were signalled to the scheduler
+    uint8_t flightSession_; // Id of this session in the flight recorder
+    FrameGovernor governor_; // Has its own lock; never waited on while holding lock_
+};
+
+#endif //PALIBRIX_GAMESESSION_H
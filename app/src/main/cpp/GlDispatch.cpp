@@ -0,0 +1,13 @@
+#include "GlDispatch.h"
+
+static constexpr GlDispatch kGles = {
+#define PALIBRIX_GL_ENTRY(ret, name, params) gl##name,
+    PALIBRIX_GL_FUNCTIONS(PALIBRIX_GL_ENTRY)
+#undef PALIBRIX_GL_ENTRY
+};
+
+GlDispatch gl = kGles;
+
+const GlDispatch& glesDispatch() {
+    return kGles;
+}
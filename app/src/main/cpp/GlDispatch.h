@@ -0,0 +1,83 @@
+#ifndef PALIBRIX_GLDISPATCH_H
+#define PALIBRIX_GLDISPATCH_H
+
+#include <GLES3/gl3.h>
+
+// Every GLES entry point the renderer uses, as X(return type, name without the gl prefix, parameters)
+#define PALIBRIX_GL_FUNCTIONS(X) \
+    X(void, ActiveTexture, (GLenum texture)) \
+    X(void, AttachShader, (GLuint program, GLuint shader)) \
+    X(void, BindBuffer, (GLenum target, GLuint buffer)) \
+    X(void, BindTexture, (GLenum target, GLuint texture)) \
+    X(void, BindVertexArray, (GLuint array)) \
+    X(void, BlendFunc, (GLenum sfactor, GLenum dfactor)) \
+    X(void, BufferData, (GLenum target, GLsizeiptr size, const void* data, GLenum usage)) \
+    X(void, BufferSubData, (GLenum target, GLintptr offset, GLsizeiptr size, const void* data)) \
+    X(void, Clear, (GLbitfield mask)) \
+    X(void, ClearColor, (GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)) \
+    X(void, CompileShader, (GLuint shader)) \
+    X(GLuint, CreateProgram, ()) \
+    X(GLuint, CreateShader, (GLenum type)) \
+    X(void, DeleteBuffers, (GLsizei n, const GLuint* buffers)) \
+    X(void, DeleteProgram, (GLuint program)) \
+    X(void, DeleteShader, (GLuint shader)) \
+    X(void, DeleteTextures, (GLsizei n, const GLuint* textures)) \
+    X(void, DeleteVertexArrays, (GLsizei n, const GLuint* arrays)) \
+    X(void, DrawArrays, (GLenum mode, GLint first, GLsizei count)) \
+    X(void, DrawArraysInstanced, (GLenum mode, GLint first, GLsizei count, GLsizei instancecount)) \
+    X(void, Enable, (GLenum cap)) \
+    X(void, EnableVertexAttribArray, (GLuint index)) \
+    X(void, GenBuffers, (GLsizei n, GLuint* buffers)) \
+    X(void, GenTextures, (GLsizei n, GLuint* textures)) \
+    X(void, GenVertexArrays, (GLsizei n, GLuint* arrays)) \
+    X(void, GetIntegerv, (GLenum pname, GLint* data)) \
+    X(void, GetProgramBinary, (GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary)) \
+    X(void, GetProgramInfoLog, (GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog)) \
+    X(void, GetProgramiv, (GLuint program, GLenum pname, GLint* params)) \
+    X(void, GetShaderInfoLog, (GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog)) \
+    X(void, GetShaderiv, (GLuint shader, GLenum pname, GLint* params)) \
+    X(const GLubyte*, GetString, (GLenum name)) \
+    X(GLint, GetUniformLocation, (GLuint program, const GLchar* name)) \
+    X(GLboolean, IsBuffer, (GLuint buffer)) \
+    X(void, LinkProgram, (GLuint program)) \
+    X(void, PixelStorei, (GLenum pname, GLint param)) \
+    X(void, ProgramBinary, (GLuint program, GLenum binaryFormat, const void* binary, GLsizei length)) \
+    X(void, ProgramParameteri, (GLuint program, GLenum pname, GLint value)) \
+    X(void, ShaderSource, (GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length)) \
+    X(void, TexImage2D, (GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, \
+                         GLint border, GLenum format, GLenum type, const void* pixels)) \
+    X(void, TexParameteri, (GLenum target, GLenum pname, GLint param)) \
+    X(void, TexStorage2D, (GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height)) \
+    X(void, TexSubImage2D, (GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, \
+                            GLsizei height, GLenum format, GLenum type, const void* pixels)) \
+    X(void, Uniform1f, (GLint location, GLfloat v0)) \
+    X(void, Uniform1i, (GLint location, GLint v0)) \
+    X(void, Uniform2f, (GLint location, GLfloat v0, GLfloat v1)) \
+    X(void, Uniform3f, (GLint location, GLfloat v0, GLfloat v1, GLfloat v2)) \
+    X(void, Uniform3fv, (GLint location, GLsizei count, const GLfloat* value)) \
+    X(void, UniformMatrix4fv, (GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)) \
+    X(void, UseProgram, (GLuint program)) \
+    X(void, VertexAttribDivisor, (GLuint index, GLuint divisor)) \
+    X(void, VertexAttribPointer, (GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, \
+                                  const void* pointer)) \
+    X(void, Viewport, (GLint x, GLint y, GLsizei width, GLsizei height))
+
+/*!
+ * Table the renderer calls GLES through (gl.DrawArrays(...) instead of glDrawArrays(...)), so
+ * that a recording backend such as GlRecorder can be swapped in underneath Renderer, Shader and
+ * the other GL users. It points at the real GLES functions by default; one extra indirect call
+ * per GL call is noise next to the driver's own dispatch.
+ */
+struct GlDispatch {
+#define PALIBRIX_GL_MEMBER(ret, name, params) ret (GL_APIENTRY* name) params;
+    PALIBRIX_GL_FUNCTIONS(PALIBRIX_GL_MEMBER)
+#undef PALIBRIX_GL_MEMBER
+};
+
+// The table currently in use, only swapped on the GL thread between frames
+extern GlDispatch gl;
+
+// The real GLES functions, for restoring gl or forwarding to the driver
+const GlDispatch& glesDispatch();
+
+#endif //PALIBRIX_GLDISPATCH_H
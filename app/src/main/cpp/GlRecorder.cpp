@@ -0,0 +1,523 @@
+#include "GlRecorder.h"
+#include "AllocAudit.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+GlRecorder* GlRecorder::active_ = nullptr;
+
+namespace {
+
+// Shadowed state kinds, stored in the top half of a binding key
+enum BindingKind : uint64_t {
+    kBindProgram = 1,
+    kBindVertexArray,
+    kBindBuffer,   // Per target
+    kBindTexture,  // Per unit and target
+    kBindCap,      // glEnable per capability
+    kBindBlendFunc,
+    kBindClearColor,
+    kBindViewport,
+    kBindPixelStore // Per parameter
+};
+
+constexpr uint64_t bindingKey(BindingKind kind, uint64_t sub = 0) {
+    return kind << 32 | sub;
+}
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull) {
+    auto bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+int64_t imageBytes(GLsizei width, GLsizei height, GLenum format, GLenum type) {
+    int components = 4;
+    switch (format) {
+        case GL_RED: case GL_RED_INTEGER: case GL_ALPHA: case GL_LUMINANCE: components = 1; break;
+        case GL_RG: case GL_RG_INTEGER: case GL_LUMINANCE_ALPHA: components = 2; break;
+        case GL_RGB: case GL_RGB_INTEGER: components = 3; break;
+        default: break;
+    }
+    int componentSize = (type == GL_UNSIGNED_BYTE || type == GL_BYTE) ? 1 : 4;
+    return int64_t(width) * height * components * componentSize;
+}
+
+const char* const kOpNames[] = {
+#define PALIBRIX_GL_NAME(ret, name, params) "gl" #name,
+    PALIBRIX_GL_FUNCTIONS(PALIBRIX_GL_NAME)
+#undef PALIBRIX_GL_NAME
+};
+
+} // namespace
+
+// The dispatch entries. Each records the call, then either forwards it to GLES or emulates just
+// enough of the driver for the renderer to run.
+struct GlRecorder::Recorded {
+    static GlRecorder& r() { return *active_; }
+    static const GlDispatch& gles() { return glesDispatch(); }
+
+    // ---- Binds and state ----
+
+    static void GL_APIENTRY ActiveTexture(GLenum texture) {
+        r().record(GlOp::ActiveTexture, texture, 0, r().activeTexture_ == texture);
+        r().counts_.stateChanges++;
+        r().activeTexture_ = texture;
+        if (r().forward_) gles().ActiveTexture(texture);
+    }
+
+    static void GL_APIENTRY BindBuffer(GLenum target, GLuint buffer) {
+        r().record(GlOp::BindBuffer, target, buffer, r().trackBinding(bindingKey(kBindBuffer, target), buffer));
+        r().counts_.binds++;
+        if (r().forward_) {
+            gles().BindBuffer(target, buffer);
+        } else {
+            ALLOC_AUDIT_UNTRACKED();
+            r().buffers_.insert(buffer);
+        }
+    }
+
+    static void GL_APIENTRY BindTexture(GLenum target, GLuint texture) {
+        uint64_t key = bindingKey(kBindTexture, uint64_t(r().activeTexture_ - GL_TEXTURE0) << 16 | (target & 0xFFFF));
+        r().record(GlOp::BindTexture, target, texture, r().trackBinding(key, texture));
+        r().counts_.binds++;
+        if (r().forward_) gles().BindTexture(target, texture);
+    }
+
+    static void GL_APIENTRY BindVertexArray(GLuint array) {
+        r().record(GlOp::BindVertexArray, array, 0, r().trackBinding(bindingKey(kBindVertexArray), array));
+        r().counts_.binds++;
+        if (r().forward_) gles().BindVertexArray(array);
+    }
+
+    static void GL_APIENTRY UseProgram(GLuint program) {
+        r().record(GlOp::UseProgram, program, 0, r().trackBinding(bindingKey(kBindProgram), program));
+        r().counts_.binds++;
+        r().currentProgram_ = program;
+        if (r().forward_) gles().UseProgram(program);
+    }
+
+    static void GL_APIENTRY Enable(GLenum cap) {
+        r().record(GlOp::Enable, cap, 0, r().trackBinding(bindingKey(kBindCap, cap), 1));
+        r().counts_.stateChanges++;
+        if (r().forward_) gles().Enable(cap);
+    }
+
+    static void GL_APIENTRY BlendFunc(GLenum sfactor, GLenum dfactor) {
+        uint32_t value = sfactor << 16 | (dfactor & 0xFFFF);
+        r().record(GlOp::BlendFunc, sfactor, dfactor, r().trackBinding(bindingKey(kBindBlendFunc), value));
+        r().counts_.stateChanges++;
+        if (r().forward_) gles().BlendFunc(sfactor, dfactor);
+    }
+
+    static void GL_APIENTRY ClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+        const GLfloat color[] = {red, green, blue, alpha};
+        auto value = static_cast<uint32_t>(hashBytes(color, sizeof(color)));
+        r().record(GlOp::ClearColor, 0, 0, r().trackBinding(bindingKey(kBindClearColor), value));
+        r().counts_.stateChanges++;
+        if (r().forward_) gles().ClearColor(red, green, blue, alpha);
+    }
+
+    static void GL_APIENTRY Viewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+        const GLint box[] = {x, y, width, height};
+        auto value = static_cast<uint32_t>(hashBytes(box, sizeof(box)));
+        r().record(GlOp::Viewport, width, height, r().trackBinding(bindingKey(kBindViewport), value));
+        r().counts_.stateChanges++;
+        if (r().forward_) gles().Viewport(x, y, width, height);
+    }
+
+    static void GL_APIENTRY PixelStorei(GLenum pname, GLint param) {
+        r().record(GlOp::PixelStorei, pname, param, r().trackBinding(bindingKey(kBindPixelStore, pname), param));
+        r().counts_.stateChanges++;
+        if (r().forward_) gles().PixelStorei(pname, param);
+    }
+
+    // ---- Uniforms ----
+
+    static void GL_APIENTRY Uniform1f(GLint location, GLfloat v0) {
+        r().record(GlOp::Uniform1f, location, 0, r().trackUniform(location, &v0, sizeof(v0)));
+        if (r().forward_) gles().Uniform1f(location, v0);
+    }
+
+    static void GL_APIENTRY Uniform1i(GLint location, GLint v0) {
+        r().record(GlOp::Uniform1i, location, 0, r().trackUniform(location, &v0, sizeof(v0)));
+        if (r().forward_) gles().Uniform1i(location, v0);
+    }
+
+    static void GL_APIENTRY Uniform2f(GLint location, GLfloat v0, GLfloat v1) {
+        const GLfloat value[] = {v0, v1};
+        r().record(GlOp::Uniform2f, location, 0, r().trackUniform(location, value, sizeof(value)));
+        if (r().forward_) gles().Uniform2f(location, v0, v1);
+    }
+
+    static void GL_APIENTRY Uniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) {
+        const GLfloat value[] = {v0, v1, v2};
+        r().record(GlOp::Uniform3f, location, 0, r().trackUniform(location, value, sizeof(value)));
+        if (r().forward_) gles().Uniform3f(location, v0, v1, v2);
+    }
+
+    static void GL_APIENTRY Uniform3fv(GLint location, GLsizei count, const GLfloat* value) {
+        r().record(GlOp::Uniform3fv, location, count,
+                   r().trackUniform(location, value, sizeof(GLfloat) * 3 * count));
+        if (r().forward_) gles().Uniform3fv(location, count, value);
+    }
+
+    static void GL_APIENTRY UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) {
+        r().record(GlOp::UniformMatrix4fv, location, count,
+                   r().trackUniform(location, value, sizeof(GLfloat) * 16 * count));
+        if (r().forward_) gles().UniformMatrix4fv(location, count, transpose, value);
+    }
+
+    // ---- Uploads and draws ----
+
+    static void GL_APIENTRY BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+        r().record(GlOp::BufferData, target, static_cast<uint32_t>(size));
+        if (data) {
+            r().counts_.bufferUploads++;
+            r().counts_.uploadBytes += size;
+        }
+        if (r().forward_) gles().BufferData(target, size, data, usage);
+    }
+
+    static void GL_APIENTRY BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) {
+        r().record(GlOp::BufferSubData, target, static_cast<uint32_t>(size));
+        r().counts_.bufferUploads++;
+        r().counts_.uploadBytes += size;
+        if (r().forward_) gles().BufferSubData(target, offset, size, data);
+    }
+
+    static void GL_APIENTRY TexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width,
+                                       GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels) {
+        r().record(GlOp::TexImage2D, width, height);
+        if (pixels) {
+            r().counts_.bufferUploads++;
+            r().counts_.uploadBytes += imageBytes(width, height, format, type);
+        }
+        if (r().forward_) gles().TexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+    }
+
+    static void GL_APIENTRY TexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width,
+                                          GLsizei height, GLenum format, GLenum type, const void* pixels) {
+        r().record(GlOp::TexSubImage2D, width, height);
+        r().counts_.bufferUploads++;
+        r().counts_.uploadBytes += imageBytes(width, height, format, type);
+        if (r().forward_) gles().TexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels);
+    }
+
+    static void GL_APIENTRY DrawArrays(GLenum mode, GLint first, GLsizei count) {
+        r().record(GlOp::DrawArrays, mode, count);
+        r().counts_.draws++;
+        if (r().forward_) gles().DrawArrays(mode, first, count);
+    }
+
+    static void GL_APIENTRY DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount) {
+        r().record(GlOp::DrawArraysInstanced, count, instancecount);
+        r().counts_.draws++;
+        if (r().forward_) gles().DrawArraysInstanced(mode, first, count, instancecount);
+    }
+
+    static void GL_APIENTRY Clear(GLbitfield mask) {
+        r().record(GlOp::Clear, mask);
+        if (r().forward_) gles().Clear(mask);
+    }
+
+    // ---- Object lifetime ----
+
+    static void GL_APIENTRY GenBuffers(GLsizei n, GLuint* buffers) {
+        r().record(GlOp::GenBuffers, n);
+        if (r().forward_) return gles().GenBuffers(n, buffers);
+        for (GLsizei i = 0; i < n; ++i) buffers[i] = r().newName();
+    }
+
+    static void GL_APIENTRY GenTextures(GLsizei n, GLuint* textures) {
+        r().record(GlOp::GenTextures, n);
+        if (r().forward_) return gles().GenTextures(n, textures);
+        for (GLsizei i = 0; i < n; ++i) textures[i] = r().newName();
+    }
+
+    static void GL_APIENTRY GenVertexArrays(GLsizei n, GLuint* arrays) {
+        r().record(GlOp::GenVertexArrays, n);
+        if (r().forward_) return gles().GenVertexArrays(n, arrays);
+        for (GLsizei i = 0; i < n; ++i) arrays[i] = r().newName();
+    }
+
+    // Deleting a bound object unbinds it, so the shadow state has to follow
+    static void unbindDeleted(BindingKind kind, GLsizei n, const GLuint* names) {
+        for (auto& binding : r().bindings_) {
+            if ((binding.first >> 32) != kind) continue;
+            for (GLsizei i = 0; i < n; ++i) {
+                if (binding.second == names[i]) binding.second = 0;
+            }
+        }
+    }
+
+    static void GL_APIENTRY DeleteBuffers(GLsizei n, const GLuint* buffers) {
+        r().record(GlOp::DeleteBuffers, n, n > 0 ? buffers[0] : 0);
+        unbindDeleted(kBindBuffer, n, buffers);
+        for (GLsizei i = 0; i < n; ++i) r().buffers_.erase(buffers[i]);
+        if (r().forward_) gles().DeleteBuffers(n, buffers);
+    }
+
+    static void GL_APIENTRY DeleteTextures(GLsizei n, const GLuint* textures) {
+        r().record(GlOp::DeleteTextures, n, n > 0 ? textures[0] : 0);
+        unbindDeleted(kBindTexture, n, textures);
+        if (r().forward_) gles().DeleteTextures(n, textures);
+    }
+
+    static void GL_APIENTRY DeleteVertexArrays(GLsizei n, const GLuint* arrays) {
+        r().record(GlOp::DeleteVertexArrays, n, n > 0 ? arrays[0] : 0);
+        unbindDeleted(kBindVertexArray, n, arrays);
+        if (r().forward_) gles().DeleteVertexArrays(n, arrays);
+    }
+
+    static GLboolean GL_APIENTRY IsBuffer(GLuint buffer) {
+        r().record(GlOp::IsBuffer, buffer);
+        if (r().forward_) return gles().IsBuffer(buffer);
+        return buffer != 0 && r().buffers_.count(buffer) ? GL_TRUE : GL_FALSE;
+    }
+
+    // ---- Shaders and programs ----
+
+    static GLuint GL_APIENTRY CreateShader(GLenum type) {
+        r().record(GlOp::CreateShader, type);
+        return r().forward_ ? gles().CreateShader(type) : r().newName();
+    }
+
+    static GLuint GL_APIENTRY CreateProgram() {
+        r().record(GlOp::CreateProgram);
+        return r().forward_ ? gles().CreateProgram() : r().newName();
+    }
+
+    static void GL_APIENTRY GetShaderiv(GLuint shader, GLenum pname, GLint* params) {
+        r().record(GlOp::GetShaderiv, shader, pname);
+        if (r().forward_) return gles().GetShaderiv(shader, pname, params);
+        *params = pname == GL_COMPILE_STATUS ? GL_TRUE : 0;
+    }
+
+    static void GL_APIENTRY GetProgramiv(GLuint program, GLenum pname, GLint* params) {
+        r().record(GlOp::GetProgramiv, program, pname);
+        if (r().forward_) return gles().GetProgramiv(program, pname, params);
+        *params = pname == GL_LINK_STATUS ? GL_TRUE : 0;
+    }
+
+    static void GL_APIENTRY GetShaderInfoLog(GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog) {
+        r().record(GlOp::GetShaderInfoLog, shader);
+        if (r().forward_) return gles().GetShaderInfoLog(shader, bufSize, length, infoLog);
+        if (length) *length = 0;
+        if (bufSize > 0) infoLog[0] = '\0';
+    }
+
+    static void GL_APIENTRY GetProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog) {
+        r().record(GlOp::GetProgramInfoLog, program);
+        if (r().forward_) return gles().GetProgramInfoLog(program, bufSize, length, infoLog);
+        if (length) *length = 0;
+        if (bufSize > 0) infoLog[0] = '\0';
+    }
+
+    static GLint GL_APIENTRY GetUniformLocation(GLuint program, const GLchar* name) {
+        r().record(GlOp::GetUniformLocation, program);
+        if (r().forward_) return gles().GetUniformLocation(program, name);
+        uint64_t key = uint64_t(program) << 32 | static_cast<uint32_t>(hashBytes(name, strlen(name)));
+        ALLOC_AUDIT_UNTRACKED();
+        auto found = r().locations_.emplace(key, static_cast<GLint>(r().locations_.size()));
+        return found.first->second;
+    }
+
+    static void GL_APIENTRY GetProgramBinary(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat,
+                                             void* binary) {
+        r().record(GlOp::GetProgramBinary, program);
+        if (r().forward_) return gles().GetProgramBinary(program, bufSize, length, binaryFormat, binary);
+        if (length) *length = 0;
+    }
+
+    // Emulated contexts report no binary formats, so the program cache stays off
+    static void GL_APIENTRY GetIntegerv(GLenum pname, GLint* data) {
+        r().record(GlOp::GetIntegerv, pname);
+        if (r().forward_) return gles().GetIntegerv(pname, data);
+        *data = 0;
+    }
+
+    static const GLubyte* GL_APIENTRY GetString(GLenum name) {
+        r().record(GlOp::GetString, name);
+        if (r().forward_) return gles().GetString(name);
+        return reinterpret_cast<const GLubyte*>("GlRecorder");
+    }
+
+    // ---- Calls that are only recorded ----
+
+    static void GL_APIENTRY AttachShader(GLuint program, GLuint shader) {
+        r().record(GlOp::AttachShader, program, shader);
+        if (r().forward_) gles().AttachShader(program, shader);
+    }
+
+    static void GL_APIENTRY CompileShader(GLuint shader) {
+        r().record(GlOp::CompileShader, shader);
+        if (r().forward_) gles().CompileShader(shader);
+    }
+
+    static void GL_APIENTRY DeleteProgram(GLuint program) {
+        r().record(GlOp::DeleteProgram, program);
+        // The name may come back for a new program whose uniforms start out unset
+        for (auto it = r().uniforms_.begin(); it != r().uniforms_.end();) {
+            it = (it->first >> 32) == program ? r().uniforms_.erase(it) : std::next(it);
+        }
+        if (r().forward_) gles().DeleteProgram(program);
+    }
+
+    static void GL_APIENTRY DeleteShader(GLuint shader) {
+        r().record(GlOp::DeleteShader, shader);
+        if (r().forward_) gles().DeleteShader(shader);
+    }
+
+    static void GL_APIENTRY EnableVertexAttribArray(GLuint index) {
+        r().record(GlOp::EnableVertexAttribArray, index);
+        if (r().forward_) gles().EnableVertexAttribArray(index);
+    }
+
+    static void GL_APIENTRY LinkProgram(GLuint program) {
+        r().record(GlOp::LinkProgram, program);
+        if (r().forward_) gles().LinkProgram(program);
+    }
+
+    static void GL_APIENTRY ProgramBinary(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length) {
+        r().record(GlOp::ProgramBinary, program, length);
+        if (r().forward_) gles().ProgramBinary(program, binaryFormat, binary, length);
+    }
+
+    static void GL_APIENTRY ProgramParameteri(GLuint program, GLenum pname, GLint value) {
+        r().record(GlOp::ProgramParameteri, program, pname);
+        if (r().forward_) gles().ProgramParameteri(program, pname, value);
+    }
+
+    static void GL_APIENTRY ShaderSource(GLuint shader, GLsizei count, const GLchar* const* string,
+                                         const GLint* length) {
+        r().record(GlOp::ShaderSource, shader, count);
+        if (r().forward_) gles().ShaderSource(shader, count, string, length);
+    }
+
+    static void GL_APIENTRY TexParameteri(GLenum target, GLenum pname, GLint param) {
+        r().record(GlOp::TexParameteri, pname, param);
+        if (r().forward_) gles().TexParameteri(target, pname, param);
+    }
+
+    static void GL_APIENTRY TexStorage2D(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width,
+                                         GLsizei height) {
+        r().record(GlOp::TexStorage2D, width, height);
+        if (r().forward_) gles().TexStorage2D(target, levels, internalformat, width, height);
+    }
+
+    static void GL_APIENTRY VertexAttribDivisor(GLuint index, GLuint divisor) {
+        r().record(GlOp::VertexAttribDivisor, index, divisor);
+        if (r().forward_) gles().VertexAttribDivisor(index, divisor);
+    }
+
+    static void GL_APIENTRY VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized,
+                                                GLsizei stride, const void* pointer) {
+        r().record(GlOp::VertexAttribPointer, index, size);
+        if (r().forward_) gles().VertexAttribPointer(index, size, type, normalized, stride, pointer);
+    }
+
+    static const GlDispatch& table() {
+        static constexpr GlDispatch kRecording = {
+#define PALIBRIX_GL_RECORDED(ret, name, params) &Recorded::name,
+            PALIBRIX_GL_FUNCTIONS(PALIBRIX_GL_RECORDED)
+#undef PALIBRIX_GL_RECORDED
+        };
+        return kRecording;
+    }
+};
+
+
+GlRecorder::GlRecorder(bool forwardToGles)
+        : forward_(forwardToGles), previous_(glesDispatch()), installed_(false), counts_{}, opCounts_{},
+          currentProgram_(0), activeTexture_(GL_TEXTURE0), nextName_(1) {
+    calls_.reserve(1024);
+}
+
+GlRecorder::~GlRecorder() {
+    uninstall();
+}
+
+void GlRecorder::install() {
+    if (installed_) return;
+    if (active_) {
+        active_->uninstall();
+    }
+    previous_ = gl;
+    gl = Recorded::table();
+    active_ = this;
+    installed_ = true;
+}
+
+void GlRecorder::uninstall() {
+    if (!installed_) return;
+    gl = previous_;
+    active_ = nullptr;
+    installed_ = false;
+}
+
+void GlRecorder::beginFrame() {
+    counts_ = {};
+    std::fill(std::begin(opCounts_), std::end(opCounts_), 0);
+    calls_.clear();
+}
+
+GlFrameCounts GlRecorder::endFrame() {
+    return counts_;
+}
+
+void GlRecorder::dumpFrame(FILE* out) const {
+    for (size_t i = 0; i < calls_.size(); ++i) {
+        const GlCall& call = calls_[i];
+        fprintf(out, "%5zu %-26s %#x %#x%s\n", i, opName(call.op), call.arg0, call.arg1,
+                call.redundant ? "  <- redundant" : "");
+    }
+}
+
+const char* GlRecorder::opName(GlOp op) {
+    return op < GlOp::Count ? kOpNames[static_cast<int>(op)] : "?";
+}
+
+// The recorder's bookkeeping stands in for the driver's, which the allocation audit does not see
+void GlRecorder::record(GlOp op, uint32_t arg0, uint32_t arg1, bool redundant) {
+    ALLOC_AUDIT_UNTRACKED();
+    calls_.push_back({op, redundant, arg0, arg1});
+    counts_.calls++;
+    counts_.redundant += redundant;
+    opCounts_[static_cast<int>(op)]++;
+}
+
+bool GlRecorder::trackBinding(uint64_t key, uint32_t value) {
+    ALLOC_AUDIT_UNTRACKED();
+    auto found = bindings_.emplace(key, value);
+    if (found.second) {
+        return value == 0; // Everything starts out unbound / zero
+    }
+    bool same = found.first->second == value;
+    found.first->second = value;
+    return same;
+}
+
+bool GlRecorder::trackUniform(GLint location, const void* data, size_t size) {
+    counts_.uniformUploads++;
+    if (location < 0) {
+        return true; // Ignored by GL, still a call
+    }
+    uint64_t key = uint64_t(currentProgram_) << 32 | static_cast<uint32_t>(location);
+    uint64_t hash = hashBytes(data, size);
+    ALLOC_AUDIT_UNTRACKED();
+    auto found = uniforms_.emplace(key, hash);
+    if (found.second) {
+        return false;
+    }
+    bool same = found.first->second == hash;
+    found.first->second = hash;
+    return same;
+}
+
+GLuint GlRecorder::newName() {
+    return nextName_++;
+}
@@ -0,0 +1,101 @@
+#ifndef PALIBRIX_GLRECORDER_H
+#define PALIBRIX_GLRECORDER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "GlDispatch.h"
+
+enum class GlOp : uint8_t {
+#define PALIBRIX_GL_OP(ret, name, params) name,
+    PALIBRIX_GL_FUNCTIONS(PALIBRIX_GL_OP)
+#undef PALIBRIX_GL_OP
+    Count
+};
+
+/*!
+ * One recorded call: the op and its first two integer arguments (target, name or location).
+ */
+struct GlCall {
+    GlOp op;
+    bool redundant; // Set state to the value it already had, or uploaded to location -1
+    uint32_t arg0;
+    uint32_t arg1;
+};
+
+/*!
+ * Totals for one frame, the numbers rendering budgets are written against.
+ */
+struct GlFrameCounts {
+    int calls;
+    int draws;          // glDrawArrays*
+    int binds;          // Programs, vertex arrays, buffers and textures
+    int stateChanges;   // Active texture unit, blend, clear color, viewport, pixel store
+    int uniformUploads;
+    int bufferUploads;  // Buffer and texture data uploads
+    int64_t uploadBytes;
+    int redundant;
+};
+
+/*!
+ * GlDispatch backend that records the call stream of each frame, counts draws, binds, uniform and
+ * buffer uploads, and flags redundant state changes by shadowing the bound state.
+ *
+ * It either forwards every call to GLES after recording it, or stands in for the driver
+ * altogether: names are handed out, shaders always compile and link, uniform locations are
+ * assigned per name, and nothing is drawn. The second mode runs without any GPU or context.
+ *
+ * Only one recorder can be installed at a time; install and uninstall on the GL thread.
+ */
+class GlRecorder {
+public:
+    explicit GlRecorder(bool forwardToGles);
+    ~GlRecorder();
+
+    void install();
+    void uninstall(); // Restores the dispatch table that was in use before install()
+
+    void beginFrame();
+    GlFrameCounts endFrame();
+
+    const GlFrameCounts& getCounts() const { return counts_; }
+    int getOpCount(GlOp op) const { return opCounts_[static_cast<int>(op)]; }
+    const std::vector<GlCall>& getCalls() const { return calls_; } // Since beginFrame()
+
+    // Prints the recorded frame, one call per line, redundant calls marked
+    void dumpFrame(FILE* out) const;
+
+    static const char* opName(GlOp op);
+
+private:
+    struct Recorded; // The dispatch entries, defined in GlRecorder.cpp
+
+    void record(GlOp op, uint32_t arg0 = 0, uint32_t arg1 = 0, bool redundant = false);
+    bool trackBinding(uint64_t key, uint32_t value);
+    bool trackUniform(GLint location, const void* data, size_t size);
+    GLuint newName();
+
+    static GlRecorder* active_;
+
+    bool forward_;
+    GlDispatch previous_;
+    bool installed_;
+
+    GlFrameCounts counts_;
+    int opCounts_[static_cast<int>(GlOp::Count)];
+    std::vector<GlCall> calls_;
+
+    // Shadowed GL state; survives frames like the real state does
+    std::unordered_map<uint64_t, uint32_t> bindings_;    // Keyed by kind and target or unit
+    std::unordered_map<uint64_t, uint64_t> uniforms_;    // (program, location) -> value hash
+    std::unordered_map<uint64_t, GLint> locations_;      // (program, name hash) -> location, emulated
+    std::unordered_set<GLuint> buffers_;                 // Live buffer names, emulated
+    GLuint currentProgram_;
+    GLenum activeTexture_;
+    GLuint nextName_;
+};
+
+#endif //PALIBRIX_GLRECORDER_H
@@ -0,0 +1,568 @@
+#include "GlesBackend.h"
+#include "GlDispatch.h"
+#include "AndroidOut.h"
+#include "TetrominoData.h"
+#include "TextRenderer.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+// Vertex shader for colored quads, the unit quad is instanced once per rectangle
+const char* QUAD_VERTEX_SHADER =
+    "#version 300 es\n"
+    "layout(location = 0) in vec2 aPosition;\n"
+    "layout(location = 1) in vec4 aRect; // x, y, width, height\n"
+    "layout(location = 2) in vec4 aColor;\n"
+    "uniform mat4 uProjection;\n"
+    "out vec4 vColor;\n"
+    "void main() {\n"
+    "    vColor = aColor;\n"
+    "    gl_Position = uProjection * vec4(aRect.xy + aPosition * aRect.zw, 0.0, 1.0);\n"
+    "}\n";
+
+const char* QUAD_FRAGMENT_SHADER =
+    "#version 300 es\n"
+    "precision mediump float;\n"
+    "in vec4 vColor;\n"
+    "out vec4 FragColor;\n"
+    "void main() {\n"
+    "    FragColor = vColor;\n"
+    "}\n";
+
+// Vertex shader for the playfield quad, passes the unit quad coordinate through
+const char* BOARD_VERTEX_SHADER =
+    "#version 300 es\n"
+    "layout(location = 0) in vec2 aPosition;\n"
+    "uniform mat4 uProjection;\n"
+    "uniform vec2 uOffset;\n"
+    "uniform vec2 uScale;\n"
+    "out vec2 vLocal;\n"
+    "void main() {\n"
+    "    vLocal = aPosition;\n"
+    "    gl_Position = uProjection * vec4((aPosition * uScale) + uOffset, 0.0, 1.0);\n"
+    "}\n";
+
+// Fragment shader that draws every board cell from the R8UI board texture.
+// Texels hold TetrominoType values; EMPTY (7) shows the board background.
+const char* BOARD_FRAGMENT_SHADER =
+    "#version 300 es\n"
+    "precision mediump float;\n"
+    "precision mediump usampler2D;\n"
+    "in vec2 vLocal;\n"
+    "out vec4 FragColor;\n"
+    "uniform usampler2D uBoard;\n"
+    "uniform vec3 uPalette[7];\n"
+    "uniform vec2 uBoardSize;\n"
+    "void main() {\n"
+    "    vec2 cellPos = vLocal * uBoardSize;\n"
+    "    ivec2 cell = clamp(ivec2(cellPos), ivec2(0), ivec2(uBoardSize) - 1);\n"
+    "    vec2 f = cellPos - vec2(cell);\n"
+    "    uint type = texelFetch(uBoard, cell, 0).r;\n"
+    "    vec3 background = vec3(0.1);\n"
+    "    if (type >= 7u || f.x > 0.9 || f.y > 0.9) {\n"
+    "        FragColor = vec4(background, 1.0);\n"
+    "        return;\n"
+    "    }\n"
+    "    vec3 color = uPalette[type];\n"
+    "    // Bevel: lighter top-left edge, darker bottom-right edge\n"
+    "    if (f.x < 0.1 || f.y < 0.1) {\n"
+    "        color = mix(color, vec3(1.0), 0.3);\n"
+    "    } else if (f.x > 0.8 || f.y > 0.8) {\n"
+    "        color *= 0.7;\n"
+    "    }\n"
+    "    FragColor = vec4(color, 1.0);\n"
+    "}\n";
+
+// Vertex shader for HUD text, one interleaved position/uv/color vertex per quad corner
+const char* TEXT_VERTEX_SHADER =
+    "#version 300 es\n"
+    "layout(location = 0) in vec2 aPosition;\n"
+    "layout(location = 1) in vec2 aUV;\n"
+    "layout(location = 2) in vec3 aColor;\n"
+    "uniform mat4 uProjection;\n"
+    "out vec2 vUV;\n"
+    "out vec3 vColor;\n"
+    "void main() {\n"
+    "    vUV = aUV;\n"
+    "    vColor = aColor;\n"
+    "    gl_Position = uProjection * vec4(aPosition, 0.0, 1.0);\n"
+    "}\n";
+
+// Fragment shader for HUD text, the atlas holds glyph coverage in the red channel
+const char* TEXT_FRAGMENT_SHADER =
+    "#version 300 es\n"
+    "precision mediump float;\n"
+    "in vec2 vUV;\n"
+    "in vec3 vColor;\n"
+    "out vec4 FragColor;\n"
+    "uniform sampler2D uAtlas;\n"
+    "void main() {\n"
+    "    FragColor = vec4(vColor, texture(uAtlas, vUV).r);\n"
+    "}\n";
+
+// Vertex shader for particles, the unit quad is instanced once per particle
+const char* PARTICLE_VERTEX_SHADER =
+    "#version 300 es\n"
+    "layout(location = 0) in vec2 aPosition;\n"
+    "layout(location = 1) in vec3 aInstance; // x, y, size\n"
+    "layout(location = 2) in vec4 aColor;\n"
+    "uniform mat4 uProjection;\n"
+    "uniform vec2 uOffset;\n"
+    "out vec2 vLocal;\n"
+    "out vec4 vColor;\n"
+    "void main() {\n"
+    "    vLocal = aPosition;\n"
+    "    vColor = aColor;\n"
+    "    vec2 pos = uOffset + aInstance.xy + (aPosition - 0.5) * aInstance.z;\n"
+    "    gl_Position = uProjection * vec4(pos, 0.0, 1.0);\n"
+    "}\n";
+
+// Fragment shader for particles, a soft round dot
+const char* PARTICLE_FRAGMENT_SHADER =
+    "#version 300 es\n"
+    "precision mediump float;\n"
+    "in vec2 vLocal;\n"
+    "in vec4 vColor;\n"
+    "out vec4 FragColor;\n"
+    "void main() {\n"
+    "    float d = length(vLocal - 0.5) * 2.0;\n"
+    "    FragColor = vec4(vColor.rgb, vColor.a * (1.0 - smoothstep(0.4, 1.0, d)));\n"
+    "}\n";
+
+GlesBackend::GlesBackend()
+        : quadVbo_(0), quadVao_(0), staticQuads_{}, staticQuadCount_(0), staticVbo_(0), staticVao_(0),
+          dynamicVbo_(0), dynamicVao_(0), boardTexture_(0), atlasTexture_(0), textVbo_(0), textVao_(0),
+          textGeneration_(0), textUploaded_(false), particleVbo_(0), particleVao_(0), projection_{},
+          boardX_(0.0f), boardY_(0.0f), viewSerial_(0) {
+    // Everything a frame needs at all is critical; the rest fills in over the next frames
+    gpu_.add("quad vertices", GpuResourceKind::Buffer, GpuResources::kPriorityCritical,
+             [this]() { return createQuad(); },
+             [this](bool contextAlive) {
+                 if (contextAlive) gl.DeleteBuffers(1, &quadVbo_);
+                 quadVbo_ = 0;
+             });
+    gpu_.add("quad vertex array", GpuResourceKind::VertexArray, GpuResources::kPriorityCritical,
+             [this]() { return createQuadVertexArray(); },
+             [this](bool contextAlive) {
+                 if (contextAlive) gl.DeleteVertexArrays(1, &quadVao_);
+                 quadVao_ = 0;
+             });
+    addProgram("quad program", GpuResources::kPriorityCritical, quadProgram_, QUAD_VERTEX_SHADER,
+               QUAD_FRAGMENT_SHADER);
+    // Static quads are written once; setStaticQuads() updates a buffer that already exists
+    addBuffer("static quads", GpuResources::kPriorityCritical, staticVbo_, sizeof(staticQuads_), staticQuads_);
+    addVertexArray("static quad vertex array", GpuResources::kPriorityCritical, staticVao_,
+                   [this]() { return createInstanceVertexArray(staticVao_, staticVbo_); });
+    // Sized for the most quads a frame may have; frames only update the used prefix
+    addBuffer("dynamic quads", GpuResources::kPriorityCritical, dynamicVbo_,
+              kMaxFrameQuads * sizeof(QuadInstance), nullptr);
+    addVertexArray("dynamic quad vertex array", GpuResources::kPriorityCritical, dynamicVao_,
+                   [this]() { return createInstanceVertexArray(dynamicVao_, dynamicVbo_); });
+
+    gpu_.add("board texture", GpuResourceKind::Texture, kPriorityBoard,
+             [this]() { return createBoardTexture(); },
+             [this](bool contextAlive) {
+                 if (contextAlive) gl.DeleteTextures(1, &boardTexture_);
+                 boardTexture_ = 0;
+             });
+    gpu_.add("board program", GpuResourceKind::Program, kPriorityBoard,
+             [this]() { return createBoardProgram(); },
+             [this](bool contextAlive) {
+                 if (!contextAlive) boardProgram_.shader->abandon();
+                 boardProgram_.shader.reset();
+             });
+
+    gpu_.add("text atlas", GpuResourceKind::Texture, kPriorityHud,
+             [this]() { return createAtlas(); },
+             [this](bool contextAlive) {
+                 if (contextAlive) gl.DeleteTextures(1, &atlasTexture_);
+                 atlasTexture_ = 0;
+             });
+    addBuffer("text vertices", kPriorityHud, textVbo_, kMaxTextVertices * kTextVertexFloats * sizeof(float),
+              nullptr);
+    addVertexArray("text vertex array", kPriorityHud, textVao_, [this]() { return createTextVertexArray(); });
+    gpu_.add("text program", GpuResourceKind::Program, kPriorityHud,
+             [this]() {
+                 ProgramStatus status = createProgram(textProgram_, TEXT_VERTEX_SHADER, TEXT_FRAGMENT_SHADER);
+                 if (status == ProgramStatus::Ready) {
+                     textProgram_.shader->use();
+                     textProgram_.shader->setInt("uAtlas", 0);
+                     textProgram_.shader->unuse();
+                 }
+                 return status;
+             },
+             [this](bool contextAlive) {
+                 if (!contextAlive) textProgram_.shader->abandon();
+                 textProgram_.shader.reset();
+             });
+
+    addBuffer("particle instances", kPriorityEffects, particleVbo_,
+              kMaxParticles * kParticleFloats * sizeof(float), nullptr);
+    addVertexArray("particle vertex array", kPriorityEffects, particleVao_,
+                   [this]() { return createParticleVertexArray(); });
+    addProgram("particle program", kPriorityEffects, particleProgram_, PARTICLE_VERTEX_SHADER,
+               PARTICLE_FRAGMENT_SHADER);
+}
+
+GlesBackend::~GlesBackend() {
+    // The recipes point into this object, so release while every member is still alive
+    gpu_.releaseAll();
+}
+
+void GlesBackend::addBuffer(const char* name, int priority, GLuint& buffer, GLsizeiptr size, const void* data) {
+    gpu_.add(name, GpuResourceKind::Buffer, priority,
+             [this, &buffer, size, data]() {
+                 gl.GenBuffers(1, &buffer);
+                 gl.BindBuffer(GL_ARRAY_BUFFER, buffer);
+                 gl.BufferData(GL_ARRAY_BUFFER, size, data, data ? GL_STATIC_DRAW : GL_DYNAMIC_DRAW);
+                 gl.BindBuffer(GL_ARRAY_BUFFER, 0);
+                 return ProgramStatus::Ready;
+             },
+             [&buffer](bool contextAlive) {
+                 if (contextAlive) gl.DeleteBuffers(1, &buffer);
+                 buffer = 0;
+             });
+}
+
+void GlesBackend::addVertexArray(const char* name, int priority, GLuint& vao, std::function<ProgramStatus()> create) {
+    gpu_.add(name, GpuResourceKind::VertexArray, priority, std::move(create),
+             [&vao](bool contextAlive) {
+                 if (contextAlive) gl.DeleteVertexArrays(1, &vao);
+                 vao = 0;
+             });
+}
+
+void GlesBackend::addProgram(const char* name, int priority, Program& program, const char* vertexSource,
+                             const char* fragmentSource) {
+    gpu_.add(name, GpuResourceKind::Program, priority,
+             [this, &program, vertexSource, fragmentSource]() {
+                 return createProgram(program, vertexSource, fragmentSource);
+             },
+             [&program](bool contextAlive) {
+                 if (!contextAlive) program.shader->abandon();
+                 program.shader.reset();
+             });
+}
+
+ProgramStatus GlesBackend::createProgram(Program& program, const char* vertexSource, const char* fragmentSource) {
+    program.shader = std::make_unique<Shader>(vertexSource, fragmentSource, &programCache_);
+    program.viewSerial = 0;
+    ProgramStatus status = program.shader->getStatus();
+    if (status != ProgramStatus::Ready) {
+        program.shader.reset();
+    }
+    return status;
+}
+
+void GlesBackend::setCacheDirectory(const std::string& directory) {
+    programCache_.setDirectory(directory);
+}
+
+void GlesBackend::initialize() {
+    if (gpu_.onContextCreated()) {
+        return; // Same context as before, every object and all GL state are still there
+    }
+
+    // A new context: objects are recreated lazily by beginFrame(), state is set here
+    programCache_.onContextCreated();
+
+    gl.Enable(GL_BLEND);
+    gl.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    gl.ClearColor(0.05f, 0.1f, 0.15f, 1.0f); // Dark blue background
+}
+
+void GlesBackend::resize(int width, int height) {
+    gl.Viewport(0, 0, width, height);
+}
+
+void GlesBackend::setStaticQuads(const QuadInstance* quads, int count) {
+    staticQuadCount_ = std::min(count, kMaxStaticQuads);
+    memcpy(staticQuads_, quads, staticQuadCount_ * sizeof(QuadInstance));
+    if (staticVbo_ != 0) {
+        gl.BindBuffer(GL_ARRAY_BUFFER, staticVbo_);
+        gl.BufferSubData(GL_ARRAY_BUFFER, 0, sizeof(staticQuads_), staticQuads_);
+        gl.BindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+}
+
+ProgramStatus GlesBackend::createQuad() {
+    // A single 1x1 quad (0,0) to (1,1)
+    static const float kVertices[] = {
+        0.0f, 1.0f,  // Top-left
+        1.0f, 0.0f,  // Bottom-right
+        0.0f, 0.0f,  // Bottom-left
+        0.0f, 1.0f,  // Top-left
+        1.0f, 1.0f,  // Top-right
+        1.0f, 0.0f   // Bottom-right
+    };
+
+    gl.GenBuffers(1, &quadVbo_);
+    gl.BindBuffer(GL_ARRAY_BUFFER, quadVbo_);
+    gl.BufferData(GL_ARRAY_BUFFER, sizeof(kVertices), kVertices, GL_STATIC_DRAW);
+    gl.BindBuffer(GL_ARRAY_BUFFER, 0);
+    return ProgramStatus::Ready;
+}
+
+ProgramStatus GlesBackend::createQuadVertexArray() {
+    if (quadVbo_ == 0) {
+        return ProgramStatus::Failed;
+    }
+    gl.GenVertexArrays(1, &quadVao_);
+    gl.BindVertexArray(quadVao_);
+    gl.BindBuffer(GL_ARRAY_BUFFER, quadVbo_);
+    gl.VertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    gl.EnableVertexAttribArray(0);
+    gl.BindBuffer(GL_ARRAY_BUFFER, 0);
+    gl.BindVertexArray(0);
+    return ProgramStatus::Ready;
+}
+
+ProgramStatus GlesBackend::createInstanceVertexArray(GLuint& vao, GLuint instanceVbo) {
+    if (quadVbo_ == 0 || instanceVbo == 0) {
+        return ProgramStatus::Failed;
+    }
+    gl.GenVertexArrays(1, &vao);
+    gl.BindVertexArray(vao);
+
+    gl.BindBuffer(GL_ARRAY_BUFFER, quadVbo_);
+    gl.VertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    gl.EnableVertexAttribArray(0);
+
+    gl.BindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+    const GLsizei stride = sizeof(QuadInstance);
+    gl.VertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(QuadInstance, x));
+    gl.EnableVertexAttribArray(1);
+    gl.VertexAttribDivisor(1, 1);
+    gl.VertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(QuadInstance, r));
+    gl.EnableVertexAttribArray(2);
+    gl.VertexAttribDivisor(2, 1);
+
+    gl.BindBuffer(GL_ARRAY_BUFFER, 0);
+    gl.BindVertexArray(0);
+    return ProgramStatus::Ready;
+}
+
+ProgramStatus GlesBackend::createBoardTexture() {
+    // One texel per cell holding the TetrominoType of that cell
+    gl.GenTextures(1, &boardTexture_);
+    gl.BindTexture(GL_TEXTURE_2D, boardTexture_);
+    gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    gl.TexStorage2D(GL_TEXTURE_2D, 1, GL_R8UI, BOARD_WIDTH, BOARD_HEIGHT);
+    gl.BindTexture(GL_TEXTURE_2D, 0);
+
+    // Force a full upload on the first frame after (re)creation
+    boardShadow_.invalidate();
+    return ProgramStatus::Ready;
+}
+
+ProgramStatus GlesBackend::createBoardProgram() {
+    ProgramStatus status = createProgram(boardProgram_, BOARD_VERTEX_SHADER, BOARD_FRAGMENT_SHADER);
+    if (status != ProgramStatus::Ready) {
+        return status;
+    }
+
+    // The palette, size and sampler never change, so set them once here
+    Shader& shader = *boardProgram_.shader;
+    shader.use();
+    shader.setInt("uBoard", 0);
+    shader.setVec2("uBoardSize", (float)BOARD_WIDTH, (float)BOARD_HEIGHT);
+    shader.setVec2("uScale", (float)BOARD_WIDTH, (float)BOARD_HEIGHT);
+    gl.Uniform3fv(shader.getUniformLocation("uPalette"), 7, &tetrominoColors[0][0]);
+    shader.unuse();
+    return ProgramStatus::Ready;
+}
+
+ProgramStatus GlesBackend::createAtlas() {
+    std::vector<uint8_t> atlas(TextRenderer::kAtlasWidth * TextRenderer::kAtlasHeight);
+    TextRenderer::bakeAtlas(atlas.data());
+
+    gl.GenTextures(1, &atlasTexture_);
+    gl.BindTexture(GL_TEXTURE_2D, atlasTexture_);
+    gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    gl.TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    gl.PixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    gl.TexImage2D(GL_TEXTURE_2D, 0, GL_R8, TextRenderer::kAtlasWidth, TextRenderer::kAtlasHeight, 0,
+                  GL_RED, GL_UNSIGNED_BYTE, atlas.data());
+    gl.BindTexture(GL_TEXTURE_2D, 0);
+    return ProgramStatus::Ready;
+}
+
+ProgramStatus GlesBackend::createTextVertexArray() {
+    if (textVbo_ == 0) {
+        return ProgramStatus::Failed;
+    }
+    textUploaded_ = false; // Only ever made along with a new, empty text buffer
+    gl.GenVertexArrays(1, &textVao_);
+    gl.BindVertexArray(textVao_);
+    gl.BindBuffer(GL_ARRAY_BUFFER, textVbo_);
+
+    const GLsizei stride = kTextVertexFloats * sizeof(float);
+    gl.VertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, (void*)0);
+    gl.EnableVertexAttribArray(0);
+    gl.VertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)(2 * sizeof(float)));
+    gl.EnableVertexAttribArray(1);
+    gl.VertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (void*)(4 * sizeof(float)));
+    gl.EnableVertexAttribArray(2);
+
+    gl.BindBuffer(GL_ARRAY_BUFFER, 0);
+    gl.BindVertexArray(0);
+    return ProgramStatus::Ready;
+}
+
+ProgramStatus GlesBackend::createParticleVertexArray() {
+    if (quadVbo_ == 0 || particleVbo_ == 0) {
+        return ProgramStatus::Failed;
+    }
+    gl.GenVertexArrays(1, &particleVao_);
+    gl.BindVertexArray(particleVao_);
+
+    gl.BindBuffer(GL_ARRAY_BUFFER, quadVbo_);
+    gl.VertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    gl.EnableVertexAttribArray(0);
+
+    gl.BindBuffer(GL_ARRAY_BUFFER, particleVbo_);
+    const GLsizei stride = kParticleFloats * sizeof(float);
+    gl.VertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+    gl.EnableVertexAttribArray(1);
+    gl.VertexAttribDivisor(1, 1);
+    gl.VertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
+    gl.EnableVertexAttribArray(2);
+    gl.VertexAttribDivisor(2, 1);
+
+    gl.BindBuffer(GL_ARRAY_BUFFER, 0);
+    gl.BindVertexArray(0);
+    return ProgramStatus::Ready;
+}
+
+bool GlesBackend::beginFrame() {
+    gl.Clear(GL_COLOR_BUFFER_BIT);
+
+    // Recreate what a context loss took, a few objects per frame
+    programCache_.beginFrame();
+    gpu_.restore(kRestoreBudgetMs);
+    return quadProgram_.shader && quadVao_ != 0 && staticVao_ != 0 && dynamicVao_ != 0;
+}
+
+void GlesBackend::render(const RenderFrame& frame) {
+    updateView(frame);
+    drawBoard(frame);
+    drawQuads(frame);
+    drawParticles(frame);
+    drawText(frame);
+}
+
+void GlesBackend::updateView(const RenderFrame& frame) {
+    if (viewSerial_ != 0 && memcmp(projection_, frame.projection, sizeof(projection_)) == 0
+        && boardX_ == frame.boardX && boardY_ == frame.boardY) {
+        return;
+    }
+    memcpy(projection_, frame.projection, sizeof(projection_));
+    boardX_ = frame.boardX;
+    boardY_ = frame.boardY;
+    viewSerial_++;
+}
+
+bool GlesBackend::useProgram(Program& program) {
+    program.shader->use();
+    if (program.viewSerial == viewSerial_) {
+        return false;
+    }
+    program.viewSerial = viewSerial_;
+    return true;
+}
+
+void GlesBackend::drawBoard(const RenderFrame& frame) {
+    if (!boardProgram_.shader || boardTexture_ == 0) return;
+
+    // Both textures are only ever bound to unit 0, the default active unit
+    gl.BindTexture(GL_TEXTURE_2D, boardTexture_);
+    int firstRow, lastRow;
+    if (boardShadow_.update(*frame.board, firstRow, lastRow)) {
+        gl.PixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        gl.TexSubImage2D(GL_TEXTURE_2D, 0, 0, firstRow, BOARD_WIDTH, lastRow - firstRow + 1,
+                         GL_RED_INTEGER, GL_UNSIGNED_BYTE, boardShadow_.row(firstRow));
+    }
+
+    if (useProgram(boardProgram_)) {
+        boardProgram_.shader->setMat4("uProjection", projection_);
+        boardProgram_.shader->setVec2("uOffset", boardX_, boardY_);
+    }
+
+    gl.BindVertexArray(quadVao_);
+    gl.DrawArrays(GL_TRIANGLES, 0, 6);
+    gl.BindVertexArray(0);
+
+    gl.BindTexture(GL_TEXTURE_2D, 0);
+}
+
+void GlesBackend::drawQuads(const RenderFrame& frame) {
+    if (useProgram(quadProgram_)) {
+        quadProgram_.shader->setMat4("uProjection", projection_);
+    }
+
+    // The playfield first, then pieces over it
+    gl.BindVertexArray(staticVao_);
+    gl.DrawArraysInstanced(GL_TRIANGLES, 0, 6, staticQuadCount_);
+
+    if (frame.quadCount > 0) {
+        gl.BindBuffer(GL_ARRAY_BUFFER, dynamicVbo_);
+        gl.BufferSubData(GL_ARRAY_BUFFER, 0, frame.quadCount * sizeof(QuadInstance), frame.quads);
+        gl.BindBuffer(GL_ARRAY_BUFFER, 0);
+        gl.BindVertexArray(dynamicVao_);
+        gl.DrawArraysInstanced(GL_TRIANGLES, 0, 6, frame.quadCount);
+    }
+    gl.BindVertexArray(0);
+}
+
+void GlesBackend::drawParticles(const RenderFrame& frame) {
+    // Also skipped while being restored after a context loss
+    if (!particleProgram_.shader || particleVao_ == 0 || frame.particleCount == 0) return;
+
+    gl.BindBuffer(GL_ARRAY_BUFFER, particleVbo_);
+    gl.BufferSubData(GL_ARRAY_BUFFER, 0, frame.particleCount * kParticleFloats * sizeof(float), frame.particles);
+    gl.BindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if (useProgram(particleProgram_)) {
+        particleProgram_.shader->setMat4("uProjection", projection_);
+        particleProgram_.shader->setVec2("uOffset", boardX_, boardY_);
+    }
+
+    // Additive blending so overlapping particles glow
+    gl.BlendFunc(GL_SRC_ALPHA, GL_ONE);
+    gl.BindVertexArray(particleVao_);
+    gl.DrawArraysInstanced(GL_TRIANGLES, 0, 6, frame.particleCount);
+    gl.BindVertexArray(0);
+    gl.BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void GlesBackend::drawText(const RenderFrame& frame) {
+    // Parts still being restored after a context loss: skip the text for now
+    if (!textProgram_.shader || textVao_ == 0 || atlasTexture_ == 0) return;
+
+    if (!textUploaded_ || textGeneration_ != frame.textGeneration) {
+        gl.BindBuffer(GL_ARRAY_BUFFER, textVbo_);
+        gl.BufferSubData(GL_ARRAY_BUFFER, 0, frame.textVertexCount * kTextVertexFloats * sizeof(float),
+                         frame.textVertices);
+        gl.BindBuffer(GL_ARRAY_BUFFER, 0);
+        textGeneration_ = frame.textGeneration;
+        textUploaded_ = true;
+    }
+    if (frame.textVertexCount == 0) return;
+
+    if (useProgram(textProgram_)) {
+        textProgram_.shader->setMat4("uProjection", projection_);
+    }
+
+    gl.BindTexture(GL_TEXTURE_2D, atlasTexture_);
+    gl.BindVertexArray(textVao_);
+    gl.DrawArrays(GL_TRIANGLES, 0, frame.textVertexCount);
+    gl.BindVertexArray(0);
+    gl.BindTexture(GL_TEXTURE_2D, 0);
+}
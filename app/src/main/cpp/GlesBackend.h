@@ -0,0 +1,109 @@
+#ifndef PALIBRIX_GLESBACKEND_H
+#define PALIBRIX_GLESBACKEND_H
+
+#include <GLES3/gl3.h>
+#include <functional>
+#include <memory>
+
+#include "GpuResources.h"
+#include "ProgramCache.h"
+#include "RenderBackend.h"
+#include "Shader.h"
+
+/*!
+ * GLES3 backend, drawing into whatever context is current on the GL thread (GLSurfaceView's, or
+ * the harness's offscreen one). All GL calls go through GlDispatch.
+ *
+ * A frame is five draws: the board from an R8UI texture of TetrominoType values, the static
+ * quads from a buffer written once, the dynamic quads and the particles as instances of the unit
+ * quad, and the text from a vertex buffer that is only rewritten when the text changes.
+ */
+class GlesBackend : public RenderBackend {
+public:
+    GlesBackend();
+    ~GlesBackend() override;
+
+    void setCacheDirectory(const std::string& directory) override;
+    void initialize() override;
+    void resize(int width, int height) override;
+    void setStaticQuads(const QuadInstance* quads, int count) override;
+    bool beginFrame() override;
+    void render(const RenderFrame& frame) override;
+    bool isRestoring() const override { return gpu_.getPendingCount() > 0; }
+
+private:
+    // A program and whether it has the current view uniforms
+    struct Program {
+        std::unique_ptr<Shader> shader;
+        uint32_t viewSerial = 0;
+    };
+
+    ProgramStatus createQuad();
+    ProgramStatus createQuadVertexArray();
+    ProgramStatus createInstanceVertexArray(GLuint& vao, GLuint instanceVbo);
+    ProgramStatus createBoardTexture();
+    ProgramStatus createBoardProgram();
+    ProgramStatus createAtlas();
+    ProgramStatus createTextVertexArray();
+    ProgramStatus createParticleVertexArray();
+    ProgramStatus createProgram(Program& program, const char* vertexSource, const char* fragmentSource);
+    void addBuffer(const char* name, int priority, GLuint& buffer, GLsizeiptr size, const void* data);
+    void addVertexArray(const char* name, int priority, GLuint& vao, std::function<ProgramStatus()> create);
+    void addProgram(const char* name, int priority, Program& program, const char* vertexSource,
+                    const char* fragmentSource);
+    bool useProgram(Program& program);
+    void updateView(const RenderFrame& frame);
+    void drawBoard(const RenderFrame& frame);
+    void drawQuads(const RenderFrame& frame);
+    void drawParticles(const RenderFrame& frame);
+    void drawText(const RenderFrame& frame);
+
+    // Every GL object is registered with its recipe. After a context loss the critical ones
+    // come back in the first frame and the rest within kRestoreBudgetMs per frame, preferring
+    // programs from the binary cache; a pass is skipped until its objects exist.
+    static constexpr int kPriorityBoard = 1;
+    static constexpr int kPriorityHud = 2;
+    static constexpr int kPriorityEffects = 3;
+    static constexpr double kRestoreBudgetMs = 4.0;
+    GpuResources gpu_;
+    ProgramCache programCache_;
+
+    // Unit quad, alone for the board and instanced for everything else
+    GLuint quadVbo_;
+    GLuint quadVao_;
+
+    // Colored quads: x, y, width, height and color per instance
+    Program quadProgram_;
+    QuadInstance staticQuads_[kMaxStaticQuads];
+    int staticQuadCount_;
+    GLuint staticVbo_;
+    GLuint staticVao_;
+    GLuint dynamicVbo_;
+    GLuint dynamicVao_;
+
+    // Playfield drawn from an R8UI texture of TetrominoType values
+    Program boardProgram_;
+    GLuint boardTexture_;
+    BoardShadow boardShadow_;
+
+    // HUD text, uploaded when its generation changes
+    Program textProgram_;
+    GLuint atlasTexture_;
+    GLuint textVbo_;
+    GLuint textVao_;
+    uint32_t textGeneration_; // Of the vertices in textVbo_
+    bool textUploaded_;
+
+    // Effect particles, additive
+    Program particleProgram_;
+    GLuint particleVbo_;
+    GLuint particleVao_;
+
+    // View uniforms (projection, board origin); programs catch up when the serial moves
+    float projection_[16];
+    float boardX_;
+    float boardY_;
+    uint32_t viewSerial_;
+};
+
+#endif //PALIBRIX_GLESBACKEND_H
@@ -0,0 +1,105 @@
+#include "GpuResources.h"
+#include "AllocAudit.h"
+#include "GlDispatch.h"
+#include "AndroidOut.h"
+
+#include <algorithm>
+#include <chrono>
+
+static const char* const kKindNames[] = {"buffer", "texture", "vertex array", "program", "framebuffer"};
+
+GpuResources::GpuResources() : pending_(0), restoreFrames_(0), context_(EGL_NO_CONTEXT), sentinel_(0) {}
+
+GpuResources::~GpuResources() {
+    releaseAll();
+}
+
+int GpuResources::add(const char* name, GpuResourceKind kind, int priority, Create create, Release release) {
+    int id = static_cast<int>(entries_.size());
+    entries_.push_back({name, kind, priority, std::move(create), std::move(release), State::Pending});
+    pending_++;
+
+    // Registration happens once at startup, so keeping the order sorted here is free
+    auto position = std::upper_bound(order_.begin(), order_.end(), priority,
+                                     [this](int p, int other) { return p < entries_[other].priority; });
+    order_.insert(position, id);
+    return id;
+}
+
+bool GpuResources::onContextCreated() {
+    EGLContext current = eglGetCurrentContext();
+    if (sentinel_ != 0 && current == context_ && gl.IsBuffer(sentinel_)) {
+        aout << "GL context survived, keeping " << entries_.size() << " resources" << std::endl;
+        return true;
+    }
+
+    // The old names belong to a dead context and may already be reused by the new one
+    releaseEntries(false);
+    context_ = current;
+    gl.GenBuffers(1, &sentinel_);
+    gl.BindBuffer(GL_ARRAY_BUFFER, sentinel_); // A name only counts as a buffer once bound
+    gl.BindBuffer(GL_ARRAY_BUFFER, 0);
+    restoreFrames_ = 0;
+    return false;
+}
+
+void GpuResources::restore(double budgetMs) {
+    if (pending_ == 0) {
+        return;
+    }
+    // Shaders, cache lookups and the log allocate; a restore is setup however late it comes
+    ALLOC_AUDIT_EXEMPT();
+    auto start = std::chrono::steady_clock::now();
+    restoreFrames_++;
+
+    for (int id : order_) {
+        Entry& entry = entries_[id];
+        if (entry.state != State::Pending) {
+            continue;
+        }
+        if (entry.priority > kPriorityCritical) {
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+            if (elapsed.count() >= budgetMs) {
+                break;
+            }
+        }
+
+        ProgramStatus status = entry.create();
+        if (status == ProgramStatus::Deferred) {
+            continue;
+        }
+        if (status == ProgramStatus::Failed) {
+            aout << "Could not create " << kKindNames[static_cast<int>(entry.kind)] << " " << entry.name << std::endl;
+        }
+        entry.state = status == ProgramStatus::Ready ? State::Ready : State::Failed;
+        pending_--;
+    }
+
+    if (pending_ == 0) {
+        aout << "GPU resources restored over " << restoreFrames_ << " frames" << std::endl;
+    }
+}
+
+void GpuResources::releaseAll() {
+    bool contextAlive = sentinel_ != 0 && eglGetCurrentContext() == context_;
+    releaseEntries(contextAlive);
+    if (contextAlive) {
+        gl.DeleteBuffers(1, &sentinel_);
+    }
+    sentinel_ = 0;
+    context_ = EGL_NO_CONTEXT;
+}
+
+void GpuResources::releaseEntries(bool contextAlive) {
+    // Reverse priority order, so objects go before the ones they were built from
+    for (auto it = order_.rbegin(); it != order_.rend(); ++it) {
+        Entry& entry = entries_[*it];
+        if (entry.state == State::Ready) {
+            entry.release(contextAlive);
+        }
+        if (entry.state != State::Pending) {
+            entry.state = State::Pending;
+            pending_++;
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#ifndef PALIBRIX_GPURESOURCES_H
+#define PALIBRIX_GPURESOURCES_H
+
+#include <EGL/egl.h>
+#include <GLES3/gl3.h>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "ProgramCache.h"
+
+enum class GpuResourceKind : uint8_t {
+    Buffer, Texture, VertexArray, Program, Framebuffer
+};
+
+/*!
+ * Registry of every GL object the renderer owns, each with the recipe that creates it.
+ *
+ * When a surface is created the registry checks whether the previous context survived (same
+ * EGLContext and its sentinel buffer still exists). If it did, nothing is touched. If not, every
+ * object is forgotten without being deleted, and restore() recreates them over the following
+ * frames in priority order within a time budget. Critical objects are always restored in the
+ * first frame, so a frame can be shown right away.
+ */
+class GpuResources {
+public:
+    static constexpr int kPriorityCritical = 0; // Lower numbers restore first
+
+    // Creates the object; Deferred means try again next frame (e.g. no compile budget left)
+    using Create = std::function<ProgramStatus()>;
+    // Deletes the object if the context is alive, and always clears the owner's handle
+    using Release = std::function<void(bool contextAlive)>;
+
+    GpuResources();
+    ~GpuResources();
+
+    /*!
+     * Registers an object; it is created by the next restore(). Returns its id.
+     */
+    int add(const char* name, GpuResourceKind kind, int priority, Create create, Release release);
+
+    bool isReady(int id) const { return entries_[id].state == State::Ready; }
+    int getPendingCount() const { return pending_; }
+
+    /*!
+     * Call with the new context current. Returns true if the previous context survived and
+     * every object is still valid.
+     */
+    bool onContextCreated();
+
+    /*!
+     * Creates pending objects, highest priority first, until budgetMs has been spent.
+     */
+    void restore(double budgetMs);
+
+    /*!
+     * Releases everything, deleting the GL objects only if our context is current.
+     */
+    void releaseAll();
+
+private:
+    enum class State : uint8_t {
+        Pending, Ready, Failed
+    };
+
+    struct Entry {
+        const char* name;
+        GpuResourceKind kind;
+        int priority;
+        Create create;
+        Release release;
+        State state;
+    };
+
+    void releaseEntries(bool contextAlive);
+
+    std::vector<Entry> entries_; // Indexed by id
+    std::vector<int> order_;     // Ids by priority, then registration order
+    int pending_;
+    int restoreFrames_; // Frames the current restore has taken so far
+
+    EGLContext context_;
+    GLuint sentinel_; // Tiny buffer whose survival shows the context survived
+};
+
+#endif //PALIBRIX_GPURESOURCES_H
@@ -1,184 +1,353 @@
 #include <jni.h>
+#include <android/asset_manager_jni.h>
+#include <android/native_window_jni.h>
 #include <memory>
-#include "Game.h"
+#include <mutex>
+#include <string>
+#include "GameSession.h"
 #include "Renderer.h"
+#include "AudioEngine.h"
+#include "AudioSink.h"
+#include "AssetBundle.h"
 #include "AndroidOut.h"
+#include "AllocAudit.h"
+#include "FlightRecorder.h"
+#include "Benchmarks.h"
+#include "TrainingWorkload.h"
 
-// Using a static pointer to the game and renderer instances.
-// This is okay for a simple app where there's only one game instance.
-static std::unique_ptr<Game> g_game;
-static std::unique_ptr<Renderer> g_renderer;
-
-void checkAndPlayLockSound(JNIEnv* env, jobject thiz) {
-    if (g_game && g_game->wasPieceLocked()) {
-        jclass mainActivityClass = env->GetObjectClass(thiz);
-        jmethodID playLockSoundMethod = env->GetMethodID(mainActivityClass, "playLockSound", "()V");
-        if (playLockSoundMethod != nullptr) {
-            env->CallVoidMethod(thiz, playLockSoundMethod);
+// Native objects are handed to Kotlin as opaque jlong handles; there is no global game state.
+// A handle is used from one thread at a time, except that a game's inputs and its draws may
+// come from different threads (GameSession locks for that).
+
+// A renderer draws into one surface; the window is set from the UI thread and used on the GL thread
+struct RendererHandle {
+    Renderer renderer;
+    std::mutex windowLock;
+    ANativeWindow* window = nullptr;
+    float windowFrameRate = -1.0f; // Last rate passed to the window, -1 = none yet
+
+    ~RendererHandle() {
+        if (window) {
+            ANativeWindow_release(window);
         }
-        g_game->clearPieceLockedFlag();
     }
+};
+
+// Sound effects are mixed natively; game events trigger voices without a JNI round trip.
+// Effects may play straight from the mapped bundle, so it is declared first and unmapped last.
+struct AudioHandle {
+    AssetBundle bundle;
+    AudioEngine engine;
+    std::unique_ptr<AudioSink> sink = std::make_unique<AAudioSink>();
+};
+
+template<typename T>
+static T* fromHandle(jlong handle) {
+    return reinterpret_cast<T*>(static_cast<intptr_t>(handle));
 }
 
-void checkAndPlayLineClearSound(JNIEnv* env, jobject thiz) {
-    if (g_game && g_game->wereLinesCleared()) {
-        jclass mainActivityClass = env->GetObjectClass(thiz);
-        jmethodID playLineClearSoundMethod = env->GetMethodID(mainActivityClass, "playLineClearSound", "()V");
-        if (playLineClearSoundMethod != nullptr) {
-            env->CallVoidMethod(thiz, playLineClearSoundMethod);
-        }
-        g_game->clearLinesClearedFlag();
-    }
+template<typename T>
+static jlong toHandle(T* object) {
+    return static_cast<jlong>(reinterpret_cast<intptr_t>(object));
+}
+
+static std::string toString(JNIEnv* env, jstring string) {
+    const char* chars = env->GetStringUTFChars(string, nullptr);
+    std::string result(chars);
+    env->ReleaseStringUTFChars(string, chars);
+    return result;
 }
 
-extern "C" {
+#ifdef PALIBRIX_PGO_GENERATE
+constexpr int kPgoTrainingGames = 8;
+#endif
 
-JNIEXPORT void JNICALL
-Java_com_example_palibrix_MainActivity_nativeOnCreate(JNIEnv *env, jobject thiz) {
-    aout << "nativeOnCreate" << std::endl;
-    g_game = std::make_unique<Game>();
-    g_renderer = std::make_unique<Renderer>();
+static void applyFrameRate(RendererHandle& handle, float rate) {
+    std::lock_guard<std::mutex> lock(handle.windowLock);
+    if (handle.window && rate != handle.windowFrameRate) {
+        ANativeWindow_setFrameRate(handle.window, rate, ANATIVEWINDOW_FRAME_RATE_COMPATIBILITY_DEFAULT);
+        handle.windowFrameRate = rate;
+    }
 }
 
-JNIEXPORT void JNICALL
-Java_com_example_palibrix_MainActivity_nativeOnSurfaceCreated(JNIEnv *env, jobject thiz) {
-    aout << "nativeOnSurfaceCreated" << std::endl;
-    if (g_renderer) {
-        g_renderer->initRenderer();
+static void applyInput(jlong game, ReplayInput input) {
+    if (auto* session = fromHandle<GameSession>(game)) {
+        session->apply(input);
     }
 }
 
-JNIEXPORT void JNICALL
-Java_com_example_palibrix_MainActivity_nativeOnSurfaceChanged(JNIEnv *env, jobject thiz, jint width, jint height) {
-    aout << "nativeOnSurfaceChanged" << std::endl;
-    if (g_renderer) {
-        g_renderer->updateRenderArea(width, height);
+// --- Games ---
+
+static jlong createGame(JNIEnv* env, jclass clazz, jlong seed) {
+    return toHandle(new GameSession(static_cast<uint64_t>(seed)));
+}
+
+static void destroyGame(JNIEnv* env, jclass clazz, jlong game) {
+    delete fromHandle<GameSession>(game); // Finishes the replay file
+}
+
+static void setReplayDirectory(JNIEnv* env, jclass clazz, jlong game, jstring path) {
+    if (auto* session = fromHandle<GameSession>(game)) {
+        session->setReplayDirectory(toString(env, path));
     }
 }
 
-JNIEXPORT void JNICALL
-Java_com_example_palibrix_MainActivity_nativeOnDrawFrame(JNIEnv *env, jobject thiz) {
-    if (g_renderer && g_game) {
-        // For now, game logic is not tied to a timer, so we don't call g_game->update() here.
-        // It will be driven by user input.
-        g_renderer->render(*g_game);
+static void attachAudio(JNIEnv* env, jclass clazz, jlong game, jlong audio) {
+    if (auto* session = fromHandle<GameSession>(game)) {
+        auto* handle = fromHandle<AudioHandle>(audio);
+        session->setAudio(handle ? &handle->engine : nullptr);
     }
 }
 
-JNIEXPORT void JNICALL
-Java_com_example_palibrix_MainActivity_nativeOnDestroy(JNIEnv *env, jobject thiz) {
-    aout << "nativeOnDestroy" << std::endl;
-    g_renderer.reset();
-    g_game.reset();
+static void update(JNIEnv* env, jclass clazz, jlong game) {
+    ALLOC_AUDIT_SCOPE("tick");
+    FLIGHT_JNI_SCOPE(Update);
+    applyInput(game, ReplayInput::Tick); // Automatic dropping
 }
 
-JNIEXPORT void JNICALL
-Java_com_example_palibrix_MainActivity_nativeUpdate(JNIEnv *env, jobject thiz) {
-    if (g_game) {
-        g_game->update(); // Call game update for automatic dropping
-        checkAndPlayLockSound(env, thiz);
-        checkAndPlayLineClearSound(env, thiz);
-    }
+static void move(JNIEnv* env, jclass clazz, jlong game, jint direction) {
+    ALLOC_AUDIT_SCOPE("input");
+    FLIGHT_JNI_SCOPE(Input);
+    applyInput(game, direction < 0 ? ReplayInput::MoveLeft : ReplayInput::MoveRight);
 }
 
-// --- Input Functions ---
+static void rotate(JNIEnv* env, jclass clazz, jlong game) {
+    ALLOC_AUDIT_SCOPE("input");
+    FLIGHT_JNI_SCOPE(Input);
+    applyInput(game, ReplayInput::Rotate);
+}
 
-JNIEXPORT void JNICALL
-Java_com_example_palibrix_MainActivity_nativeMove(JNIEnv *env, jobject thiz, jint direction) {
-    if (g_game) {
-        g_game->move(direction);
-        checkAndPlayLockSound(env, thiz);
-    }
+static void rotateLeft(JNIEnv* env, jclass clazz, jlong game) {
+    ALLOC_AUDIT_SCOPE("input");
+    FLIGHT_JNI_SCOPE(Input);
+    applyInput(game, ReplayInput::RotateLeft);
+}
+
+static void softDrop(JNIEnv* env, jclass clazz, jlong game) {
+    ALLOC_AUDIT_SCOPE("input");
+    FLIGHT_JNI_SCOPE(Input);
+    applyInput(game, ReplayInput::SoftDrop);
+}
+
+static void hardDrop(JNIEnv* env, jclass clazz, jlong game) {
+    ALLOC_AUDIT_SCOPE("input");
+    FLIGHT_JNI_SCOPE(Input);
+    applyInput(game, ReplayInput::HardDrop);
 }
 
-JNIEXPORT void JNICALL
-Java_com_example_palibrix_MainActivity_nativeRotate(JNIEnv *env, jobject thiz) {
-    if (g_game) {
-        g_game->rotate();
-        checkAndPlayLockSound(env, thiz);
+static void hold(JNIEnv* env, jclass clazz, jlong game) {
+    ALLOC_AUDIT_SCOPE("input");
+    FLIGHT_JNI_SCOPE(Input);
+    applyInput(game, ReplayInput::Hold);
+}
+
+static void reset(JNIEnv* env, jclass clazz, jlong game) {
+    FLIGHT_JNI_SCOPE(Reset);
+    if (auto* session = fromHandle<GameSession>(game)) {
+        session->reset();
     }
 }
 
-JNIEXPORT void JNICALL
-Java_com_example_palibrix_MainActivity_nativeRotateLeft(JNIEnv *env, jobject thiz) {
-    if (g_game) {
-        g_game->rotateLeft();
-        checkAndPlayLockSound(env, thiz);
+static void setPaused(JNIEnv* env, jclass clazz, jlong game, jboolean paused) {
+    if (auto* session = fromHandle<GameSession>(game)) {
+        session->setPaused(paused);
     }
 }
 
-JNIEXPORT void JNICALL
-Java_com_example_palibrix_MainActivity_nativeSoftDrop(JNIEnv *env, jobject thiz) {
-     if (g_game) {
-        g_game->softDrop();
-        checkAndPlayLockSound(env, thiz);
-        checkAndPlayLineClearSound(env, thiz);
+static jint getScore(JNIEnv* env, jclass clazz, jlong game) {
+    auto* session = fromHandle<GameSession>(game);
+    return session ? session->getScore() : 0;
+}
+
+static jint getLines(JNIEnv* env, jclass clazz, jlong game) {
+    auto* session = fromHandle<GameSession>(game);
+    return session ? session->getLines() : 0;
+}
+
+static jint getCombo(JNIEnv* env, jclass clazz, jlong game) {
+    auto* session = fromHandle<GameSession>(game);
+    return session ? session->getCombo() : 0;
+}
+
+static jboolean isGameOver(JNIEnv* env, jclass clazz, jlong game) {
+    auto* session = fromHandle<GameSession>(game);
+    return session ? session->isGameOver() : false;
+}
+
+// --- Flight recorder ---
+
+static jboolean installFlightRecorder(JNIEnv* env, jclass clazz, jstring path) {
+    return FlightRecorder::install(toString(env, path));
+}
+
+// --- Audio ---
+
+static jlong createAudio(JNIEnv* env, jclass clazz) {
+    return toHandle(new AudioHandle());
+}
+
+static void destroyAudio(JNIEnv* env, jclass clazz, jlong audio) {
+    // The caller must have detached it from every game (attachAudio with 0) or destroyed those games;
+    // a session keeps the engine pointer and would play through it after this
+    delete fromHandle<AudioHandle>(audio);
+}
+
+static jint loadSoundBank(JNIEnv* env, jclass clazz, jlong audio, jobject assetManager, jstring name) {
+    auto* handle = fromHandle<AudioHandle>(audio);
+    if (!handle || handle->bundle.isOpen()) {
+        return 0;
     }
+    AAssetManager* assets = AAssetManager_fromJava(env, assetManager);
+    if (!assets || !handle->bundle.openAsset(assets, toString(env, name).c_str())) {
+        return 0;
+    }
+    return handle->engine.loadBundle(handle->bundle);
 }
 
-JNIEXPORT void JNICALL
-Java_com_example_palibrix_MainActivity_nativeHardDrop(JNIEnv *env, jobject thiz) {
-     if (g_game) {
-        g_game->hardDrop();
-        checkAndPlayLockSound(env, thiz);
-        checkAndPlayLineClearSound(env, thiz);
+static void playSound(JNIEnv* env, jclass clazz, jlong audio, jint id) {
+    auto* handle = fromHandle<AudioHandle>(audio);
+    if (handle && id >= 0 && id < static_cast<int>(SoundEffect::Count)) {
+        handle->engine.play(static_cast<SoundEffect>(id));
+    }
+}
 
-        // Vibrate on hard drop
-        jclass mainActivityClass = env->GetObjectClass(thiz);
-        jmethodID vibrateMethod = env->GetMethodID(mainActivityClass, "vibrate", "(J)V");
-        if (vibrateMethod != nullptr) {
-            env->CallVoidMethod(thiz, vibrateMethod, 50L); // 50ms vibration
-        }
+static jboolean startAudio(JNIEnv* env, jclass clazz, jlong audio) {
+    auto* handle = fromHandle<AudioHandle>(audio);
+    if (!handle) {
+        return false;
+    }
+    if (!handle->sink->start(handle->engine)) {
+        aout << "Audio output unavailable, sound effects disabled" << std::endl;
+        return false;
     }
+    return true;
 }
 
-JNIEXPORT void JNICALL
-Java_com_example_palibrix_MainActivity_nativeHold(JNIEnv *env, jobject thiz) {
-     if (g_game) {
-        g_game->hold();
+static void stopAudio(JNIEnv* env, jclass clazz, jlong audio) {
+    if (auto* handle = fromHandle<AudioHandle>(audio)) {
+        handle->sink->stop();
     }
 }
 
-// Game state functions
-JNIEXPORT jint JNICALL
-Java_com_example_palibrix_MainActivity_nativeGetScore(JNIEnv *env, jobject thiz) {
-    if (g_game) {
-        return g_game->getScore();
+// --- Renderers ---
+
+static jlong createRenderer(JNIEnv* env, jclass clazz) {
+    return toHandle(new RendererHandle());
+}
+
+static void destroyRenderer(JNIEnv* env, jclass clazz, jlong renderer) {
+    delete fromHandle<RendererHandle>(renderer);
+}
+
+static void setShaderCacheDirectory(JNIEnv* env, jclass clazz, jlong renderer, jstring path) {
+    // Set before the surface exists, so the GL thread only ever reads it
+    if (auto* handle = fromHandle<RendererHandle>(renderer)) {
+        handle->renderer.setShaderCacheDirectory(toString(env, path));
     }
-    return 0;
 }
 
-JNIEXPORT jint JNICALL
-Java_com_example_palibrix_MainActivity_nativeGetLines(JNIEnv *env, jobject thiz) {
-    if (g_game) {
-        return g_game->getLines();
+static void setSurface(JNIEnv* env, jclass clazz, jlong renderer, jobject surface) {
+    auto* handle = fromHandle<RendererHandle>(renderer);
+    if (!handle) {
+        return;
     }
-    return 0;
+    // Keeps our own reference, so the window stays valid until it is replaced here
+    std::lock_guard<std::mutex> lock(handle->windowLock);
+    if (handle->window) {
+        ANativeWindow_release(handle->window);
+    }
+    handle->window = surface ? ANativeWindow_fromSurface(env, surface) : nullptr;
+    handle->windowFrameRate = -1.0f;
 }
 
-JNIEXPORT jint JNICALL
-Java_com_example_palibrix_MainActivity_nativeGetCombo(JNIEnv *env, jobject thiz) {
-    if (g_game) {
-        return g_game->getCombo();
+static void onSurfaceCreated(JNIEnv* env, jclass clazz, jlong renderer) {
+    FLIGHT_JNI_SCOPE(SurfaceCreated);
+    aout << "onSurfaceCreated" << std::endl;
+    if (auto* handle = fromHandle<RendererHandle>(renderer)) {
+        handle->renderer.initRenderer();
+#ifdef PALIBRIX_PGO_GENERATE
+        // Instrumented build: play the scripted games through this renderer, then save the counters
+        // (see PALIBRIX_PGO in CMakeLists.txt for collecting them)
+        TrainingResult result = runTrainingWorkload(kPgoTrainingGames, &handle->renderer);
+        aout << "PGO training: " << result.pieces << " pieces, " << result.frames << " frames in "
+             << result.seconds << " s, profile " << (writeTrainingProfile() ? "written" : "NOT written")
+             << std::endl;
+#endif
     }
-    return 0;
 }
 
-JNIEXPORT jboolean JNICALL
-Java_com_example_palibrix_MainActivity_nativeIsGameOver(JNIEnv *env, jobject thiz) {
-    if (g_game) {
-        return g_game->isGameOver();
+static void onSurfaceChanged(JNIEnv* env, jclass clazz, jlong renderer, jint width, jint height) {
+    FLIGHT_JNI_SCOPE(SurfaceChanged);
+    aout << "onSurfaceChanged" << std::endl;
+    if (auto* handle = fromHandle<RendererHandle>(renderer)) {
+        handle->renderer.updateRenderArea(width, height);
     }
-    return false;
 }
 
-JNIEXPORT void JNICALL
-Java_com_example_palibrix_MainActivity_nativeReset(JNIEnv *env, jobject thiz) {
-    if (g_game) {
-        g_game->reset();
+static void drawFrame(JNIEnv* env, jclass clazz, jlong renderer, jlong game) {
+    ALLOC_AUDIT_SCOPE("frame");
+    FLIGHT_JNI_SCOPE(DrawFrame);
+    auto* handle = fromHandle<RendererHandle>(renderer);
+    auto* session = fromHandle<GameSession>(game);
+    if (handle && session) {
+        applyFrameRate(*handle, session->draw(handle->renderer));
     }
 }
 
-// TODO: Add a function to get game state (score, lines, etc.) to display on the UI
+static const JNINativeMethod kNativeMethods[] = {
+        {"createGame", "(J)J", reinterpret_cast<void*>(createGame)},
+        {"destroyGame", "(J)V", reinterpret_cast<void*>(destroyGame)},
+        {"setReplayDirectory", "(JLjava/lang/String;)V", reinterpret_cast<void*>(setReplayDirectory)},
+        {"attachAudio", "(JJ)V", reinterpret_cast<void*>(attachAudio)},
+        {"update", "(J)V", reinterpret_cast<void*>(update)},
+        {"move", "(JI)V", reinterpret_cast<void*>(move)},
+        {"rotate", "(J)V", reinterpret_cast<void*>(rotate)},
+        {"rotateLeft", "(J)V", reinterpret_cast<void*>(rotateLeft)},
+        {"softDrop", "(J)V", reinterpret_cast<void*>(softDrop)},
+        {"hardDrop", "(J)V", reinterpret_cast<void*>(hardDrop)},
+        {"hold", "(J)V", reinterpret_cast<void*>(hold)},
+        {"reset", "(J)V", reinterpret_cast<void*>(reset)},
+        {"setPaused", "(JZ)V", reinterpret_cast<void*>(setPaused)},
+        {"getScore", "(J)I", reinterpret_cast<void*>(getScore)},
+        {"getLines", "(J)I", reinterpret_cast<void*>(getLines)},
+        {"getCombo", "(J)I", reinterpret_cast<void*>(getCombo)},
+        {"isGameOver", "(J)Z", reinterpret_cast<void*>(isGameOver)},
+        {"installFlightRecorder", "(Ljava/lang/String;)Z", reinterpret_cast<void*>(installFlightRecorder)},
+        {"createAudio", "()J", reinterpret_cast<void*>(createAudio)},
+        {"destroyAudio", "(J)V", reinterpret_cast<void*>(destroyAudio)},
+        {"loadSoundBank", "(JLandroid/content/res/AssetManager;Ljava/lang/String;)I",
+         reinterpret_cast<void*>(loadSoundBank)},
+        {"playSound", "(JI)V", reinterpret_cast<void*>(playSound)},
+        {"startAudio", "(J)Z", reinterpret_cast<void*>(startAudio)},
+        {"stopAudio", "(J)V", reinterpret_cast<void*>(stopAudio)},
+        {"createRenderer", "()J", reinterpret_cast<void*>(createRenderer)},
+        {"destroyRenderer", "(J)V", reinterpret_cast<void*>(destroyRenderer)},
+        {"setShaderCacheDirectory", "(JLjava/lang/String;)V", reinterpret_cast<void*>(setShaderCacheDirectory)},
+        {"setSurface", "(JLandroid/view/Surface;)V", reinterpret_cast<void*>(setSurface)},
+        {"onSurfaceCreated", "(J)V", reinterpret_cast<void*>(onSurfaceCreated)},
+        {"onSurfaceChanged", "(JII)V", reinterpret_cast<void*>(onSurfaceChanged)},
+        {"drawFrame", "(JJ)V", reinterpret_cast<void*>(drawFrame)},
+};
+
+extern "C" JNIEXPORT jint JNICALL JNI_OnLoad(JavaVM* vm, void* reserved) {
+    JNIEnv* env = nullptr;
+    if (vm->GetEnv(reinterpret_cast<void**>(&env), JNI_VERSION_1_6) != JNI_OK) {
+        return JNI_ERR;
+    }
+    jclass bridge = env->FindClass("com/example/palibrix/NativeBridge");
+    if (!bridge) {
+        return JNI_ERR;
+    }
+    jint registered = env->RegisterNatives(bridge, kNativeMethods,
+                                           sizeof(kNativeMethods) / sizeof(kNativeMethods[0]));
+    env->DeleteLocalRef(bridge);
+    if (registered != JNI_OK) {
+        aout << "RegisterNatives failed" << std::endl;
+        return JNI_ERR;
+    }
 
-} // extern "C" 
\ No newline at end of file
+#ifdef PALIBRIX_BENCHMARKS
+    runBenchmarks();
+#endif
+    return JNI_VERSION_1_6;
+}
@@ -0,0 +1,142 @@
+#include "ParticleSystem.h"
+#include "TetrominoData.h"
+#include <algorithm>
+
+// Particles spawned per effect at full quality, independent of how many lines were cleared
+constexpr int kLineClearParticles = 96;
+constexpr int kHardDropParticles = 32;
+constexpr int kTSpinParticles = 48;
+
+constexpr float kGravity = 12.0f; // Board cells per second squared, +y is down
+
+static const float kWhite[3] = {1.0f, 1.0f, 1.0f};
+
+ParticleSystem::ParticleSystem()
+        : count_(0), spawnScale_(1.0f), rngState_(0x9E3779B9u) {}
+
+ParticleSystem::~ParticleSystem() = default;
+
+float ParticleSystem::nextRandom() {
+    // xorshift32
+    rngState_ ^= rngState_ << 13;
+    rngState_ ^= rngState_ >> 17;
+    rngState_ ^= rngState_ << 5;
+    return (rngState_ >> 8) * (1.0f / 16777216.0f);
+}
+
+void ParticleSystem::emit(int count, float x, float y, float spreadX, float spreadY,
+                          float speed, float upward, float life, float size, const float* color) {
+    int n = std::min((int)(count * spawnScale_), kCapacity - count_);
+    for (int i = 0; i < n; ++i) {
+        int p = count_++;
+        float dirX = nextRandom() * 2.0f - 1.0f;
+        float dirY = nextRandom() * 2.0f - 1.0f;
+        posX_[p] = x + nextRandom() * spreadX;
+        posY_[p] = y + nextRandom() * spreadY;
+        velX_[p] = dirX * speed;
+        velY_[p] = dirY * speed - upward;
+        life_[p] = life * (0.6f + 0.4f * nextRandom());
+        invLife_[p] = 1.0f / life_[p];
+        size_[p] = size * (0.7f + 0.6f * nextRandom());
+        colorR_[p] = color[0];
+        colorG_[p] = color[1];
+        colorB_[p] = color[2];
+    }
+}
+
+void ParticleSystem::spawn(const GameEvent& event) {
+    if (event.piece.type == TetrominoType::EMPTY) return;
+
+    const float* pieceColor = tetrominoColors[static_cast<int>(event.piece.type)];
+    const auto& shape = tetrominoShapes[static_cast<int>(event.piece.type)][event.piece.rotation];
+
+    switch (event.type) {
+        case GameEventType::HardDrop: {
+            // Trail above each mino, spread over the distance it fell
+            int perMino = kHardDropParticles / 4;
+            for (const auto& mino : shape) {
+                float x = event.piece.x + mino.x;
+                float bottom = event.piece.y + mino.y + 1.0f;
+                float height = std::max(1.0f, (float)event.distance);
+                emit(perMino, x, bottom - height, 1.0f, height, 0.5f, 1.0f, 0.35f, 0.25f, pieceColor);
+            }
+            break;
+        }
+        case GameEventType::LineClear: {
+            // Split a fixed budget across the cleared rows so a Tetris costs the same as a single
+            int rows[4];
+            int rowCount = 0;
+            for (int y = 0; y < BOARD_HEIGHT && rowCount < 4; ++y) {
+                if (event.rowMask & (1u << y)) rows[rowCount++] = y;
+            }
+            for (int i = 0; i < rowCount; ++i) {
+                emit(kLineClearParticles / rowCount, 0.0f, (float)rows[i], (float)BOARD_WIDTH, 1.0f,
+                     6.0f, 2.0f, 0.6f, 0.3f, i % 2 == 0 ? kWhite : pieceColor);
+            }
+            if (event.tSpin) {
+                emit(kTSpinParticles, event.piece.x + 1.0f, event.piece.y + 1.0f, 1.0f, 1.0f,
+                     8.0f, 0.0f, 0.5f, 0.4f, pieceColor);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void ParticleSystem::update(float dt, float frameCost, float frameBudget) {
+    // Back off quickly when frames get expensive, recover slowly once they're back on budget
+    if (frameCost > frameBudget * 1.2f) {
+        spawnScale_ = std::max(0.25f, spawnScale_ * 0.8f);
+    } else {
+        spawnScale_ = std::min(1.0f, spawnScale_ + dt * 0.5f);
+    }
+
+    // Integrate; kept branch-free over flat arrays so the compiler can vectorize it
+    const int n = count_;
+    const float gravityStep = kGravity * dt;
+    for (int i = 0; i < n; ++i) {
+        velY_[i] += gravityStep;
+    }
+    for (int i = 0; i < n; ++i) {
+        posX_[i] += velX_[i] * dt;
+        posY_[i] += velY_[i] * dt;
+    }
+    for (int i = 0; i < n; ++i) {
+        life_[i] -= dt;
+    }
+
+    // Swap-remove dead particles to keep the live range dense
+    int i = 0;
+    while (i < count_) {
+        if (life_[i] > 0.0f) {
+            ++i;
+            continue;
+        }
+        int last = --count_;
+        posX_[i] = posX_[last];
+        posY_[i] = posY_[last];
+        velX_[i] = velX_[last];
+        velY_[i] = velY_[last];
+        life_[i] = life_[last];
+        invLife_[i] = invLife_[last];
+        size_[i] = size_[last];
+        colorR_[i] = colorR_[last];
+        colorG_[i] = colorG_[last];
+        colorB_[i] = colorB_[last];
+    }
+}
+
+const float* ParticleSystem::packInstances() {
+    for (int i = 0; i < count_; ++i) {
+        float* out = &instanceData_[i * kFloatsPerInstance];
+        out[0] = posX_[i];
+        out[1] = posY_[i];
+        out[2] = size_[i];
+        out[3] = colorR_[i];
+        out[4] = colorG_[i];
+        out[5] = colorB_[i];
+        out[6] = life_[i] * invLife_[i];
+    }
+    return instanceData_;
+}
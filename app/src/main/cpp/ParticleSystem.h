@@ -0,0 +1,71 @@
+#ifndef PALIBRIX_PARTICLESYSTEM_H
+#define PALIBRIX_PARTICLESYSTEM_H
+
+#include <cstdint>
+
+#include "Game.h"
+
+/*!
+ * Fixed-capacity particle pool for line clear, hard drop and T-spin effects.
+ *
+ * Particles live in preallocated structure-of-arrays storage that is updated with plain
+ * branch-free loops, and the whole pool is handed to the render backend as one array of instances. Nothing is
+ * allocated after construction. Every effect spawns a fixed particle count regardless of how
+ * many lines it covers, scaled down while frames cost more than the budget to render.
+ */
+class ParticleSystem {
+public:
+    static constexpr int kCapacity = 1024;
+    static constexpr int kFloatsPerInstance = 7; // x, y, size, r, g, b, a
+
+    ParticleSystem();
+    ~ParticleSystem();
+
+    /*!
+     * Spawns particles for a game event. Positions are in board cells.
+     */
+    void spawn(const GameEvent& event);
+
+    /*!
+     * Advances the simulation and adapts the spawn rate.
+     * @param dt seconds since the last update
+     * @param frameCost CPU seconds the last frame took to render. Not dt: a frame rate lowered on
+     *        purpose to save power stretches dt without any frame being expensive.
+     * @param frameBudget frames costlier than this reduce spawning
+     */
+    void update(float dt, float frameCost, float frameBudget);
+
+    /*!
+     * Packs every live particle into interleaved instances, getLiveCount() of them, in board
+     * cells with the alpha fading over the particle's life. Valid until the next call.
+     */
+    const float* packInstances();
+
+    int getLiveCount() const { return count_; }
+
+private:
+    void emit(int count, float x, float y, float spreadX, float spreadY,
+              float speed, float upward, float life, float size, const float* color);
+    float nextRandom(); // Uniform in [0, 1)
+
+    // Structure-of-arrays particle state, indices [0, count_) are alive
+    float posX_[kCapacity];
+    float posY_[kCapacity];
+    float velX_[kCapacity];
+    float velY_[kCapacity];
+    float life_[kCapacity];    // Remaining seconds
+    float invLife_[kCapacity]; // 1 / starting life, for the fade
+    float size_[kCapacity];
+    float colorR_[kCapacity];
+    float colorG_[kCapacity];
+    float colorB_[kCapacity];
+    int count_;
+
+    float spawnScale_; // 1.0 at full quality, lowered while frames cost more than the budget
+    uint32_t rngState_;
+
+    // Interleaved per-instance staging for the backend
+    float instanceData_[kCapacity * kFloatsPerInstance];
+};
+
+#endif //PALIBRIX_PARTICLESYSTEM_H
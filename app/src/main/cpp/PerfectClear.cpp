@@ -0,0 +1,507 @@
+#include "PerfectClear.h"
+#include "TetrominoData.h"
+#include "AndroidOut.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+constexpr int kTypeCount = 7;
+constexpr int kSpawnRows = 4; // Empty rows above the window where pieces come in
+constexpr int kMaxRows = PerfectClearFinder::kMaxLines + kSpawnRows;
+constexpr uint16_t kFullRow = (1u << BOARD_WIDTH) - 1;
+constexpr uint16_t kEvenColumns = 0x155; // Columns 0, 2, 4, 6, 8
+constexpr int kMaxPlacements = 128;
+constexpr int kMemoBits = 17;
+
+// Mino row masks per type and rotation, from tetrominoShapes
+struct Shape {
+    uint16_t rows[4]; // Bit mx set for every mino at (mx, my)
+    int minX, maxX, minY, maxY;
+};
+
+struct ShapeTable {
+    Shape shapes[kTypeCount][4];
+
+    ShapeTable() {
+        for (int type = 0; type < kTypeCount; ++type) {
+            for (int rot = 0; rot < 4; ++rot) {
+                Shape& shape = shapes[type][rot];
+                memset(shape.rows, 0, sizeof(shape.rows));
+                shape.minX = shape.minY = 4;
+                shape.maxX = shape.maxY = -1;
+                for (const Mino& mino : tetrominoShapes[type][rot]) {
+                    shape.rows[mino.y] |= static_cast<uint16_t>(1u << mino.x);
+                    shape.minX = std::min(shape.minX, mino.x);
+                    shape.maxX = std::max(shape.maxX, mino.x);
+                    shape.minY = std::min(shape.minY, mino.y);
+                    shape.maxY = std::max(shape.maxY, mino.y);
+                }
+            }
+        }
+    }
+};
+
+const ShapeTable& shapeTable() {
+    static const ShapeTable table;
+    return table;
+}
+
+// The part of the board still to be filled: rows[0] is the top window row, rows[height - 1]
+// the bottom row of the board. Everything above the window is empty.
+struct Field {
+    uint16_t rows[PerfectClearFinder::kMaxLines];
+    int height;
+
+    uint64_t key() const {
+        uint64_t bits = 0;
+        for (int r = 0; r < height; ++r) {
+            bits = (bits << BOARD_WIDTH) | rows[r];
+        }
+        return bits;
+    }
+};
+
+struct Placement {
+    Field after; // Lines already cleared
+    int lines;
+    Tetromino piece;
+};
+
+// Cells of a piece row at x; x + minX >= 0 has been checked, so nothing is shifted out
+inline uint16_t shiftRow(uint16_t row, int x) {
+    return static_cast<uint16_t>(x >= 0 ? row << x : row >> -x);
+}
+
+// Every distinct resting place for a piece that fits completely inside the window. Reachable
+// positions are flood-filled a row at a time as bitmasks over x (bit x + 3): within a row by
+// moves and rotations, then down into the next row, so tucks and spins are found too.
+int generatePlacements(const Field& field, int type, Placement* out) {
+    const Shape* shapes = shapeTable().shapes[type];
+    const int rows = field.height + kSpawnRows;
+    const int realTop = BOARD_HEIGHT - rows; // Board row of the first spawn row
+
+    // valid[rot][y]: x positions where the piece fits
+    uint16_t valid[4][kMaxRows + 1];
+    for (int rot = 0; rot < 4; ++rot) {
+        const Shape& shape = shapes[rot];
+        uint16_t inBounds = 0;
+        for (int x = -shape.minX; x + shape.maxX < BOARD_WIDTH; ++x) {
+            inBounds |= static_cast<uint16_t>(1u << (x + 3));
+        }
+        for (int y = 0; y <= rows; ++y) {
+            uint16_t blocked = 0;
+            for (int my = shape.minY; my <= shape.maxY; ++my) {
+                int row = y + my;
+                if (row >= rows) {
+                    blocked = 0xffff;
+                    break;
+                }
+                if (row < kSpawnRows) {
+                    continue;
+                }
+                uint32_t cells = static_cast<uint32_t>(field.rows[row - kSpawnRows]) << 3;
+                for (uint16_t bits = shape.rows[my]; bits; bits &= bits - 1) {
+                    blocked |= static_cast<uint16_t>(cells >> __builtin_ctz(bits));
+                }
+            }
+            valid[rot][y] = static_cast<uint16_t>(inBounds & ~blocked);
+        }
+    }
+
+    uint64_t seen[kMaxPlacements];
+    int count = 0;
+    uint16_t reach[4];
+    for (int rot = 0; rot < 4; ++rot) {
+        reach[rot] = valid[rot][0]; // Above the stack every rotation and column is reachable
+    }
+
+    for (int y = 0; y < rows; ++y) {
+        // Spread sideways and through rotations until nothing new is reached in this row
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            for (int rot = 0; rot < 4; ++rot) {
+                uint16_t r = reach[rot];
+                uint16_t spread = static_cast<uint16_t>((r | (r << 1) | (r >> 1)) & valid[rot][y]);
+                spread |= reach[(rot + 1) & 3] & valid[rot][y];
+                spread |= reach[(rot + 3) & 3] & valid[rot][y];
+                if (spread != r) {
+                    reach[rot] = static_cast<uint16_t>(r | spread);
+                    changed = true;
+                }
+            }
+        }
+
+        for (int rot = 0; rot < 4; ++rot) {
+            const Shape& shape = shapes[rot];
+            uint16_t landed = static_cast<uint16_t>(reach[rot] & ~valid[rot][y + 1]);
+            if (y + shape.minY < kSpawnRows) {
+                landed = 0; // Would stick out above the window
+            }
+            for (; landed && count < kMaxPlacements; landed &= landed - 1) {
+                int x = __builtin_ctz(landed) - 3;
+                Field placed = field;
+                for (int my = shape.minY; my <= shape.maxY; ++my) {
+                    placed.rows[y + my - kSpawnRows] |= shiftRow(shape.rows[my], x);
+                }
+                uint64_t key = placed.key();
+                if (std::find(seen, seen + count, key) != seen + count) {
+                    continue; // Same cells as another rotation, e.g. any O or a flipped I/S/Z
+                }
+                seen[count] = key;
+
+                Placement& placement = out[count++];
+                placement.after.height = 0;
+                for (int r = 0; r < field.height; ++r) {
+                    if (placed.rows[r] != kFullRow) {
+                        placement.after.rows[placement.after.height++] = placed.rows[r];
+                    }
+                }
+                placement.lines = field.height - placement.after.height;
+                placement.piece = {static_cast<TetrominoType>(type), rot, x, y + realTop};
+            }
+            reach[rot] &= valid[rot][y + 1]; // Soft drop into the next row
+        }
+    }
+    return count;
+}
+
+int emptyCells(const Field& field, int& evenMinusOdd) {
+    int empty = 0;
+    evenMinusOdd = 0;
+    for (int r = 0; r < field.height; ++r) {
+        uint16_t holes = static_cast<uint16_t>(~field.rows[r] & kFullRow);
+        int even = __builtin_popcount(holes & kEvenColumns);
+        int odd = __builtin_popcount(holes & ~kEvenColumns);
+        empty += even + odd;
+        evenMinusOdd += even - odd;
+    }
+    return empty;
+}
+
+} // namespace
+
+// Shared by all workers of one search
+struct SearchContext {
+    TetrominoType sequence[PerfectClearResult::kMaxSteps]; // Current piece, then the next queue
+    int sequenceLength;
+    int lines; // Window height being searched
+    std::chrono::steady_clock::time_point deadline;
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> nodes{0};
+    std::mutex resultLock;
+    PerfectClearResult* result;
+};
+
+struct PerfectClearFinder::Worker {
+    struct MemoEntry {
+        uint64_t field;
+        uint32_t meta;
+        uint32_t generation;
+    };
+
+    std::vector<MemoEntry> memo;
+    uint32_t generation = 0;
+    SearchContext* context = nullptr;
+    PerfectClearStep steps[PerfectClearResult::kMaxSteps];
+    uint64_t nodes = 0;
+    bool aborted = false;
+
+    Worker() : memo(size_t(1) << kMemoBits, MemoEntry{0, 0, 0}) {}
+
+    static uint32_t hash(uint64_t field, uint32_t meta) {
+        uint64_t h = (field ^ (uint64_t(meta) << 52)) * 0x9e3779b97f4a7c15ULL;
+        return static_cast<uint32_t>(h >> (64 - kMemoBits));
+    }
+
+    bool isDead(uint64_t field, uint32_t meta) const {
+        uint32_t slot = hash(field, meta);
+        for (int probe = 0; probe < 8; ++probe) {
+            const MemoEntry& entry = memo[(slot + probe) & (memo.size() - 1)];
+            if (entry.generation != generation) {
+                return false;
+            }
+            if (entry.field == field && entry.meta == meta) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void markDead(uint64_t field, uint32_t meta) {
+        uint32_t slot = hash(field, meta);
+        for (int probe = 0; probe < 8; ++probe) {
+            MemoEntry& entry = memo[(slot + probe) & (memo.size() - 1)];
+            if (entry.generation != generation) {
+                entry = {field, meta, generation};
+                return;
+            }
+        }
+        // Neighbourhood full; the state may just be searched again
+    }
+
+    // Pieces left to choose from, and whether they can still fix the column parity
+    bool feasible(const Field& field, int index, int hold) const {
+        int evenMinusOdd;
+        int empty = emptyCells(field, evenMinusOdd);
+        int available = context->sequenceLength - index + (hold != static_cast<int>(TetrominoType::EMPTY));
+        if (empty / 4 > available) {
+            return false;
+        }
+
+        // Only I (vertical, 4) and T, J, L (2) change the even/odd column balance of the
+        // empty cells; line clears never do
+        int correction = 0;
+        auto count = [&correction](int type) {
+            switch (static_cast<TetrominoType>(type)) {
+                case TetrominoType::I:
+                    correction += 4;
+                    break;
+                case TetrominoType::T:
+                case TetrominoType::J:
+                case TetrominoType::L:
+                    correction += 2;
+                    break;
+                default:
+                    break;
+            }
+        };
+        for (int i = index; i < context->sequenceLength; ++i) {
+            count(static_cast<int>(context->sequence[i]));
+        }
+        count(hold);
+        return std::abs(evenMinusOdd) <= correction;
+    }
+
+    bool timeUp() {
+        if ((++nodes & 255) == 0 && std::chrono::steady_clock::now() > context->deadline) {
+            context->stop = true;
+        }
+        if (context->stop.load(std::memory_order_relaxed)) {
+            aborted = true;
+            return true;
+        }
+        return false;
+    }
+
+    // Depth-first search from a state with the given piece to place next. Returns true when a
+    // solution was recorded.
+    bool search(const Field& field, int index, int hold, int depth) {
+        if (field.height == 0) {
+            publish(depth);
+            return true;
+        }
+        if (index >= context->sequenceLength || timeUp() || !feasible(field, index, hold)) {
+            return false;
+        }
+
+        uint64_t key = field.key();
+        uint32_t meta = static_cast<uint32_t>(field.height | (index << 3) | (hold << 7));
+        if (isDead(key, meta)) {
+            return false;
+        }
+
+        const int current = static_cast<int>(context->sequence[index]);
+        if (tryPiece(field, current, false, index + 1, hold, depth)) {
+            return true;
+        }
+        if (hold == static_cast<int>(TetrominoType::EMPTY)) {
+            if (index + 1 < context->sequenceLength
+                && tryPiece(field, static_cast<int>(context->sequence[index + 1]), true, index + 2, current, depth)) {
+                return true;
+            }
+        } else if (hold != current && tryPiece(field, hold, true, index + 1, current, depth)) {
+            return true;
+        }
+
+        if (!aborted) {
+            markDead(key, meta);
+        }
+        return false;
+    }
+
+    bool tryPiece(const Field& field, int type, bool useHold, int nextIndex, int nextHold, int depth) {
+        Placement placements[kMaxPlacements];
+        int count = generatePlacements(field, type, placements);
+        for (int i = 0; i < count; ++i) {
+            steps[depth] = {useHold, placements[i].piece};
+            if (search(placements[i].after, nextIndex, nextHold, depth + 1)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void publish(int stepCount) {
+        std::lock_guard<std::mutex> guard(context->resultLock);
+        PerfectClearResult& result = *context->result;
+        if (result.found) {
+            return;
+        }
+        result.found = true;
+        result.lines = context->lines;
+        result.stepCount = stepCount;
+        std::copy(steps, steps + stepCount, result.steps);
+        context->stop = true;
+    }
+};
+
+PerfectClearFinder::PerfectClearFinder(int threads) {
+    if (threads <= 0) {
+        threads = static_cast<int>(std::thread::hardware_concurrency());
+        threads = std::min(std::max(threads, 1), 4);
+    }
+    threads_ = threads;
+    for (int i = 0; i < threads_; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+}
+
+PerfectClearFinder::~PerfectClearFinder() = default;
+
+bool PerfectClearFinder::find(const Game& game, int maxPieces, PerfectClearResult& out, double timeLimitMs) {
+    auto start = std::chrono::steady_clock::now();
+    out = PerfectClearResult();
+
+    SearchContext context;
+    context.result = &out;
+    context.deadline = start + std::chrono::microseconds(static_cast<int64_t>(timeLimitMs * 1000.0));
+    context.sequence[0] = game.getCurrentPiece().type;
+    context.sequenceLength = 1;
+    const Game::NextQueue& queue = game.getNextQueue();
+    for (size_t i = 0; i < queue.size() && context.sequenceLength < PerfectClearResult::kMaxSteps; ++i) {
+        context.sequence[context.sequenceLength++] = queue[i];
+    }
+    const int hold = static_cast<int>(game.getHeldPiece());
+
+    // Stack height and cell count of the current board
+    const Game::Board& board = game.getBoard();
+    int stackHeight = 0;
+    int filled = 0;
+    for (int y = 0; y < BOARD_HEIGHT; ++y) {
+        for (int x = 0; x < BOARD_WIDTH; ++x) {
+            if (board[y][x] != TetrominoType::EMPTY) {
+                stackHeight = std::max(stackHeight, BOARD_HEIGHT - y);
+                filled++;
+            }
+        }
+    }
+    if (filled == 0) {
+        // Already clear; a solution for an empty board starts a fresh 4-line setup
+        stackHeight = 0;
+    }
+
+    for (int height = std::max(stackHeight, 1); height <= kMaxLines && !out.found && !context.stop; ++height) {
+        int cells = height * BOARD_WIDTH - filled;
+        if (cells % 4 != 0 || cells / 4 > maxPieces) {
+            continue;
+        }
+
+        context.lines = height;
+        Field field;
+        field.height = height;
+        for (int r = 0; r < height; ++r) {
+            uint16_t bits = 0;
+            for (int x = 0; x < BOARD_WIDTH; ++x) {
+                if (board[BOARD_HEIGHT - height + r][x] != TetrominoType::EMPTY) {
+                    bits |= static_cast<uint16_t>(1u << x);
+                }
+            }
+            field.rows[r] = bits;
+        }
+
+        // First placements become tasks; workers take them in order and search each subtree
+        struct Task {
+            Placement placement;
+            bool hold;
+            int nextIndex;
+            int nextHold;
+        };
+        std::vector<Task> tasks;
+        Placement placements[kMaxPlacements];
+        auto addTasks = [&](int type, bool useHold, int nextIndex, int nextHold) {
+            int count = generatePlacements(field, type, placements);
+            for (int i = 0; i < count; ++i) {
+                tasks.push_back({placements[i], useHold, nextIndex, nextHold});
+            }
+        };
+        const int current = static_cast<int>(context.sequence[0]);
+        addTasks(current, false, 1, hold);
+        if (game.canHold()) {
+            if (hold == static_cast<int>(TetrominoType::EMPTY)) {
+                if (context.sequenceLength > 1) {
+                    addTasks(static_cast<int>(context.sequence[1]), true, 2, current);
+                }
+            } else if (hold != current) {
+                addTasks(hold, true, 1, current);
+            }
+        }
+
+        std::atomic<size_t> nextTask{0};
+        auto run = [&](Worker& worker) {
+            worker.context = &context;
+            worker.generation++;
+            worker.nodes = 0;
+            worker.aborted = false;
+            for (size_t t = nextTask++; t < tasks.size() && !context.stop; t = nextTask++) {
+                const Task& task = tasks[t];
+                worker.steps[0] = {task.hold, task.placement.piece};
+                if (worker.search(task.placement.after, task.nextIndex, task.nextHold, 1)) {
+                    break;
+                }
+            }
+            context.nodes += worker.nodes;
+        };
+
+        std::vector<std::thread> pool;
+        for (int i = 1; i < threads_; ++i) {
+            pool.emplace_back(run, std::ref(*workers_[i]));
+        }
+        run(*workers_[0]);
+        for (std::thread& thread : pool) {
+            thread.join();
+        }
+    }
+
+    out.nodes = context.nodes;
+    out.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return out.found;
+}
+
+void PerfectClearFinder::benchmark() {
+    PerfectClearFinder finder;
+    int setups = 0;
+    int found = 0;
+    double totalMs = 0.0;
+    double worstMs = 0.0;
+    for (uint64_t seed = 1; setups < 32; ++seed) {
+        // Three pieces spread over the floor, leaving 7 known pieces for the remaining 28 cells
+        Game game(seed);
+        for (int i = 0; i < 3; ++i) {
+            game.move(i * 3 - 3);
+            game.hardDrop();
+        }
+        const Game::Board& board = game.getBoard();
+        bool flat = true;
+        for (int x = 0; x < BOARD_WIDTH; ++x) {
+            flat = flat && board[BOARD_HEIGHT - 5][x] == TetrominoType::EMPTY;
+        }
+        if (!flat || game.getLines() > 0) {
+            continue;
+        }
+
+        PerfectClearResult result;
+        found += finder.find(game, PerfectClearResult::kMaxSteps, result) ? 1 : 0;
+        totalMs += result.elapsedMs;
+        worstMs = std::max(worstMs, result.elapsedMs);
+        setups++;
+    }
+    aout << "Perfect clear: " << found << "/" << setups << " setups solvable, average "
+         << totalMs / setups << " ms, worst " << worstMs << " ms" << std::endl;
+}
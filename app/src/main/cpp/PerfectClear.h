@@ -0,0 +1,64 @@
+#ifndef PALIBRIX_PERFECTCLEAR_H
+#define PALIBRIX_PERFECTCLEAR_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Game.h"
+
+/*!
+ * One placement of a perfect-clear solution.
+ */
+struct PerfectClearStep {
+    bool hold;           // Press hold before placing
+    Tetromino placement; // Final position in board coordinates at the time it is placed
+};
+
+struct PerfectClearResult {
+    static constexpr int kMaxSteps = NEXT_QUEUE_SIZE + 2;
+
+    bool found = false;
+    int lines = 0; // Rows the solution clears
+    int stepCount = 0;
+    PerfectClearStep steps[kMaxSteps];
+    uint64_t nodes = 0; // Search states expanded
+    double elapsedMs = 0.0;
+};
+
+/*!
+ * Searches for a sequence of placements that empties the board, using the current piece, the
+ * held piece and the visible next queue. Placements are everything reachable with moves,
+ * rotations and soft drops, so tucks and spins are included.
+ *
+ * The stack is treated as an h-row window (h = 1..kMaxLines) that must be filled exactly.
+ * States are pruned when the known pieces cannot cover the empty cells or cannot fix the
+ * checkerboard and column parity, and dead (window, piece, hold) states are remembered per
+ * worker. The first placements are spread over a thread pool.
+ */
+class PerfectClearFinder {
+public:
+    static constexpr int kMaxLines = 6;
+
+    explicit PerfectClearFinder(int threads = 0); // 0 = hardware concurrency, at most 4
+    ~PerfectClearFinder();
+
+    /*!
+     * Looks for a perfect clear within maxPieces placements. The search is abandoned after
+     * timeLimitMs; the result then reports found = false.
+     */
+    bool find(const Game& game, int maxPieces, PerfectClearResult& out, double timeLimitMs = 100.0);
+
+    /*!
+     * Times find() on a fixed set of partly built 4-line setups and logs the results.
+     */
+    static void benchmark();
+
+    struct Worker;
+
+private:
+    int threads_;
+    std::vector<std::unique_ptr<Worker>> workers_; // Kept between calls to reuse the memo tables
+};
+
+#endif //PALIBRIX_PERFECTCLEAR_H
@@ -0,0 +1,155 @@
+#include "ProgramCache.h"
+#include "GlDispatch.h"
+#include "AndroidOut.h"
+#include "ByteStream.h"
+
+#include <cstdio>
+
+// Entry file: header, then the driver's binary blob
+//   "PLPB", u32 binary format, u32 binary length, u64 source hash, u64 device hash
+static constexpr uint32_t kEntryMagic = 0x42504c50; // "PLPB"
+static constexpr size_t kEntryHeaderSize = 28;
+
+static uint64_t fnv1a(uint64_t hash, const char* text) {
+    // The terminating zero is hashed too, so "ab" + "c" differs from "a" + "bc"
+    do {
+        hash ^= static_cast<uint8_t>(*text);
+        hash *= 0x100000001b3ULL;
+    } while (*text++ != '\0');
+    return hash;
+}
+
+static constexpr uint64_t kFnvOffset = 0xcbf29ce484222325ULL;
+
+ProgramCache::ProgramCache() : enabled_(false), deviceHash_(0), compileBudget_(kCompilesPerFrame) {}
+
+void ProgramCache::setDirectory(const std::string& directory) {
+    directory_ = directory;
+}
+
+void ProgramCache::onContextCreated() {
+    GLint formats = 0;
+    gl.GetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    enabled_ = formats > 0;
+
+    uint64_t hash = kFnvOffset;
+    const GLenum names[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+    for (GLenum name : names) {
+        auto value = reinterpret_cast<const char*>(gl.GetString(name));
+        hash = fnv1a(hash, value ? value : "");
+    }
+    deviceHash_ = hash;
+
+    if (!enabled_) {
+        aout << "Program binaries not supported, shaders are always compiled" << std::endl;
+    }
+}
+
+void ProgramCache::beginFrame() {
+    compileBudget_ = kCompilesPerFrame;
+}
+
+bool ProgramCache::reserveCompile() {
+    if (compileBudget_ <= 0) {
+        return false;
+    }
+    compileBudget_--;
+    return true;
+}
+
+uint64_t ProgramCache::hashSources(const char* vertexSource, const char* fragmentSource) {
+    return fnv1a(fnv1a(kFnvOffset, vertexSource), fragmentSource);
+}
+
+std::string ProgramCache::entryPath(uint64_t sourceHash) const {
+    // The device is part of the name so entries of an old driver are not overwritten in place
+    char name[48];
+    snprintf(name, sizeof(name), "/%016llx_%08x.bin", static_cast<unsigned long long>(sourceHash),
+             static_cast<unsigned>(deviceHash_));
+    return directory_ + name;
+}
+
+GLuint ProgramCache::load(const char* vertexSource, const char* fragmentSource) {
+    if (!isEnabled()) {
+        return 0;
+    }
+    uint64_t sourceHash = hashSources(vertexSource, fragmentSource);
+    std::string path = entryPath(sourceHash);
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        return 0;
+    }
+
+    uint8_t header[kEntryHeaderSize];
+    bool ok = fread(header, 1, sizeof(header), file) == sizeof(header);
+    ByteReader in(header, sizeof(header));
+    uint32_t magic = in.getU32();
+    GLenum format = in.getU32();
+    uint32_t length = in.getU32();
+    ok = ok && magic == kEntryMagic && in.getU64() == sourceHash && in.getU64() == deviceHash_
+            && length > 0 && length < (16u << 20);
+    if (ok) {
+        buffer_.resize(length);
+        ok = fread(buffer_.data(), 1, length, file) == length;
+    }
+    fclose(file);
+
+    GLuint program = 0;
+    if (ok) {
+        program = gl.CreateProgram();
+        gl.ProgramBinary(program, format, buffer_.data(), static_cast<GLsizei>(length));
+        GLint linked = GL_FALSE;
+        gl.GetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked) {
+            gl.DeleteProgram(program);
+            program = 0;
+        }
+    }
+    if (program == 0) {
+        // Corrupt, or the driver no longer accepts it; the next compile writes a fresh one
+        aout << "Discarding cached program " << path << std::endl;
+        remove(path.c_str());
+    }
+    return program;
+}
+
+void ProgramCache::store(GLuint program, const char* vertexSource, const char* fragmentSource) {
+    if (!isEnabled()) {
+        return;
+    }
+    GLint length = 0;
+    gl.GetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    buffer_.resize(kEntryHeaderSize + static_cast<size_t>(length));
+    GLenum format = 0;
+    GLsizei written = 0;
+    gl.GetProgramBinary(program, length, &written, &format, buffer_.data() + kEntryHeaderSize);
+    if (written <= 0) {
+        return;
+    }
+
+    uint64_t sourceHash = hashSources(vertexSource, fragmentSource);
+    ByteWriter out(buffer_.data(), kEntryHeaderSize);
+    out.putU32(kEntryMagic);
+    out.putU32(format);
+    out.putU32(static_cast<uint32_t>(written));
+    out.putU64(sourceHash);
+    out.putU64(deviceHash_);
+
+    // Written beside the entry and renamed over it, so a crash never leaves half a binary
+    std::string path = entryPath(sourceHash);
+    std::string temporary = path + ".tmp";
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if (!file) {
+        return;
+    }
+    size_t total = kEntryHeaderSize + static_cast<size_t>(written);
+    bool ok = fwrite(buffer_.data(), 1, total, file) == total;
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(temporary.c_str(), path.c_str()) != 0) {
+        remove(temporary.c_str());
+    }
+}
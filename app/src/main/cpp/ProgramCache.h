@@ -0,0 +1,76 @@
+#ifndef PALIBRIX_PROGRAMCACHE_H
+#define PALIBRIX_PROGRAMCACHE_H
+
+#include <GLES3/gl3.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*!
+ * Outcome of setting up something that needs a shader program.
+ */
+enum class ProgramStatus {
+    Ready,
+    Deferred, // Not cached and this frame's compile budget is spent; try again next frame
+    Failed
+};
+
+/*!
+ * Keeps linked program binaries (glGetProgramBinary) on disk so that cold starts and context
+ * recreation skip the compiler. Entries are keyed by a hash of both shader sources and the GL
+ * vendor, renderer and version strings, so a driver update simply misses. Binaries the driver
+ * rejects are deleted and the program is compiled from source as usual.
+ *
+ * Compiles that do miss are limited per frame; callers get ProgramStatus::Deferred and retry.
+ */
+class ProgramCache {
+public:
+    static constexpr int kCompilesPerFrame = 1;
+
+    ProgramCache();
+
+    /*!
+     * Where binaries are kept. Until this is set (or if it is empty) nothing is read or written,
+     * but the per-frame compile budget still applies.
+     */
+    void setDirectory(const std::string& directory);
+
+    /*!
+     * Reads the driver identification; call with the new context current.
+     */
+    void onContextCreated();
+
+    /*!
+     * Refills the compile budget. Call once per frame before setting anything up.
+     */
+    void beginFrame();
+
+    /*!
+     * Takes one compile from this frame's budget, false if none is left.
+     */
+    bool reserveCompile();
+
+    /*!
+     * Creates a program from a cached binary, 0 if there is none or the driver rejected it.
+     */
+    GLuint load(const char* vertexSource, const char* fragmentSource);
+
+    /*!
+     * Saves a linked program. It should have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT.
+     */
+    void store(GLuint program, const char* vertexSource, const char* fragmentSource);
+
+    bool isEnabled() const { return enabled_ && !directory_.empty(); }
+
+private:
+    static uint64_t hashSources(const char* vertexSource, const char* fragmentSource);
+    std::string entryPath(uint64_t sourceHash) const;
+
+    std::string directory_;
+    bool enabled_;        // The driver offers at least one binary format
+    uint64_t deviceHash_; // GL_VENDOR, GL_RENDERER and GL_VERSION
+    int compileBudget_;
+    std::vector<uint8_t> buffer_; // Reused for reading and writing entries
+};
+
+#endif //PALIBRIX_PROGRAMCACHE_H
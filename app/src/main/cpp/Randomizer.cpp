@@ -0,0 +1,181 @@
+#include "Randomizer.h"
+#include "Game.h"
+#include "ByteStream.h"
+#include <cstring>
+
+Pcg32::Pcg32(uint64_t seed, uint64_t stream) : state_(0), inc_((stream << 1u) | 1u) {
+    next();
+    state_ += seed;
+    next();
+}
+
+uint32_t Pcg32::next() {
+    uint64_t old = state_;
+    state_ = old * 6364136223846793005ULL + inc_;
+    uint32_t xorshifted = (uint32_t)(((old >> 18u) ^ old) >> 27u);
+    uint32_t rot = (uint32_t)(old >> 59u);
+    return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+}
+
+uint32_t Pcg32::nextBounded(uint32_t bound) {
+    // Reject the low values that would make the modulo uneven
+    uint32_t threshold = (0u - bound) % bound;
+    for (;;) {
+        uint32_t r = next();
+        if (r >= threshold) {
+            return r % bound;
+        }
+    }
+}
+
+void Pcg32::writeState(ByteWriter& out) const {
+    out.putU64(state_);
+    out.putU64(inc_);
+}
+
+bool Pcg32::readState(ByteReader& in) {
+    uint64_t state = in.getU64();
+    uint64_t inc = in.getU64();
+    if ((inc & 1u) == 0) {
+        return false;
+    }
+    state_ = state;
+    inc_ = inc;
+    return true;
+}
+
+Randomizer::Randomizer(RandomizerKind kind, uint64_t seed) {
+    reset(kind, seed);
+}
+
+void Randomizer::reset(RandomizerKind kind, uint64_t seed) {
+    kind_ = kind;
+    seed_ = seed;
+    rng_ = Pcg32(seed);
+    bagCount_ = 0;
+    firstPiece_ = true;
+
+    // TGM starts with a history of S/Z so the first pieces avoid them
+    history_[0] = static_cast<uint8_t>(TetrominoType::Z);
+    history_[1] = static_cast<uint8_t>(TetrominoType::S);
+    history_[2] = static_cast<uint8_t>(TetrominoType::S);
+    history_[3] = static_cast<uint8_t>(TetrominoType::Z);
+}
+
+TetrominoType Randomizer::nextFromBag(int copies) {
+    if (bagCount_ == 0) {
+        bagCount_ = 7 * copies;
+        for (int i = 0; i < bagCount_; ++i) {
+            bag_[i] = static_cast<uint8_t>(i % 7);
+        }
+        // Fisher-Yates
+        for (int i = bagCount_ - 1; i > 0; --i) {
+            int j = (int)rng_.nextBounded(i + 1);
+            uint8_t tmp = bag_[i];
+            bag_[i] = bag_[j];
+            bag_[j] = tmp;
+        }
+    }
+    return static_cast<TetrominoType>(bag_[--bagCount_]);
+}
+
+TetrominoType Randomizer::nextFromHistory() {
+    uint8_t piece = 0;
+    if (firstPiece_) {
+        // The first piece is never S, Z or O
+        static const uint8_t kFirst[4] = {
+            static_cast<uint8_t>(TetrominoType::I), static_cast<uint8_t>(TetrominoType::T),
+            static_cast<uint8_t>(TetrominoType::J), static_cast<uint8_t>(TetrominoType::L)
+        };
+        piece = kFirst[rng_.nextBounded(4)];
+        firstPiece_ = false;
+    } else {
+        for (int roll = 0; roll < 6; ++roll) {
+            piece = (uint8_t)rng_.nextBounded(7);
+            if (piece != history_[0] && piece != history_[1]
+                && piece != history_[2] && piece != history_[3]) {
+                break;
+            }
+        }
+    }
+
+    history_[3] = history_[2];
+    history_[2] = history_[1];
+    history_[1] = history_[0];
+    history_[0] = piece;
+    return static_cast<TetrominoType>(piece);
+}
+
+TetrominoType Randomizer::next() {
+    switch (kind_) {
+        case RandomizerKind::Bag7:
+            return nextFromBag(1);
+        case RandomizerKind::Bag14:
+            return nextFromBag(2);
+        case RandomizerKind::History4:
+            return nextFromHistory();
+        case RandomizerKind::PureRandom:
+        default:
+            return static_cast<TetrominoType>(rng_.nextBounded(7));
+    }
+}
+
+void Randomizer::generate(TetrominoType* out, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = next();
+    }
+}
+
+void Randomizer::peek(TetrominoType* out, size_t count) const {
+    Randomizer copy = *this;
+    copy.generate(out, count);
+}
+
+void Randomizer::writeState(ByteWriter& out) const {
+    out.putU8(static_cast<uint8_t>(kind_));
+    out.putU64(seed_);
+    rng_.writeState(out);
+    out.putU8(static_cast<uint8_t>(bagCount_));
+    out.putBytes(bag_, static_cast<size_t>(bagCount_));
+    out.putBytes(history_, sizeof(history_));
+    out.putU8(firstPiece_ ? 1 : 0);
+}
+
+bool Randomizer::readState(ByteReader& in) {
+    uint8_t kind = in.getU8();
+    if (kind > static_cast<uint8_t>(RandomizerKind::PureRandom)) {
+        return false;
+    }
+    kind_ = static_cast<RandomizerKind>(kind);
+    seed_ = in.getU64();
+    if (!rng_.readState(in)) {
+        return false;
+    }
+
+    // Only the bag kinds keep pieces in bag_, at most one bag's worth
+    int bagSize = kind_ == RandomizerKind::Bag7 ? 7 : kind_ == RandomizerKind::Bag14 ? 14 : 0;
+    int bagCount = in.getU8();
+    const uint8_t* bag = in.getBytes(bagCount <= bagSize ? bagCount : 0);
+    const uint8_t* history = in.getBytes(sizeof(history_));
+    firstPiece_ = in.getU8() != 0;
+    if (!in.ok() || bagCount > bagSize) {
+        return false;
+    }
+    // Every piece must be a TetrominoType below EMPTY, or it would index past the shape tables
+    for (int i = 0; i < bagCount; ++i) {
+        if (bag[i] >= 7) {
+            return false;
+        }
+    }
+    for (size_t i = 0; i < sizeof(history_); ++i) {
+        if (history[i] >= 7) {
+            return false;
+        }
+    }
+    bagCount_ = bagCount;
+    if (bagCount_ > 0) {
+        memcpy(bag_, bag, bagCount_);
+    }
+    memcpy(history_, history, sizeof(history_));
+    return true;
+}
@@ -0,0 +1,24 @@
+#include "RenderBackend.h"
+#include <algorithm>
+
+bool BoardShadow::update(const Game::Board& board, int& firstRow, int& lastRow) {
+    // Find the span of rows that differ from what the texture already holds
+    firstRow = BOARD_HEIGHT;
+    lastRow = -1;
+    for (int y = 0; y < BOARD_HEIGHT; ++y) {
+        bool rowChanged = !valid_;
+        for (int x = 0; x < BOARD_WIDTH; ++x) {
+            auto cell = static_cast<uint8_t>(board[y][x]);
+            if (cells_[y][x] != cell) {
+                cells_[y][x] = cell;
+                rowChanged = true;
+            }
+        }
+        if (rowChanged) {
+            firstRow = std::min(firstRow, y);
+            lastRow = y;
+        }
+    }
+    valid_ = true;
+    return lastRow >= 0;
+}
@@ -0,0 +1,106 @@
+#ifndef PALIBRIX_RENDERBACKEND_H
+#define PALIBRIX_RENDERBACKEND_H
+
+#include <cstdint>
+#include <string>
+
+#include "Game.h"
+
+/*!
+ * One colored rectangle in world units, straight alpha. Quads are drawn as instances of the
+ * unit quad.
+ */
+struct QuadInstance {
+    float x, y;
+    float width, height;
+    float r, g, b, a;
+};
+
+/*!
+ * Everything one frame shows, laid out by Renderer on the CPU. Backends draw it in this order:
+ * the board, the static playfield quads (see RenderBackend::setStaticQuads), the dynamic quads,
+ * the particles (additive) and the text. All pointers stay valid until render() returns.
+ */
+struct RenderFrame {
+    const float* projection; // Column-major 4x4, GL clip conventions
+    const Game::Board* board;
+    float boardX, boardY;    // World position of cell (0, 0); cells are one unit
+
+    const QuadInstance* quads;
+    int quadCount;
+
+    const float* particles;  // kParticleFloats per instance: x, y, size, r, g, b, a in board cells
+    int particleCount;
+
+    const float* textVertices; // kTextVertexFloats per vertex: x, y, u, v, r, g, b; 6 per glyph
+    int textVertexCount;
+    uint32_t textGeneration;   // Changes whenever textVertices do
+};
+
+constexpr int kParticleFloats = 7;
+constexpr int kTextVertexFloats = 7;
+
+// Capacities backends size their buffers for
+constexpr int kMaxFrameQuads = 64;
+constexpr int kMaxStaticQuads = 16;
+constexpr int kMaxParticles = 1024;
+constexpr int kMaxTextVertices = 16 * 31 * 6; // TextRenderer slots * characters * vertices
+
+/*!
+ * CPU copy of what a backend's board texture holds; update() finds the rows that need uploading.
+ */
+class BoardShadow {
+public:
+    BoardShadow() : valid_(false), cells_{} {}
+
+    // Forgets the contents, so the next update() reports every row (e.g. a recreated texture)
+    void invalidate() { valid_ = false; }
+
+    // Copies board in; returns false if nothing changed, else the changed span of rows
+    bool update(const Game::Board& board, int& firstRow, int& lastRow);
+
+    const uint8_t* row(int y) const { return cells_[y]; }
+
+private:
+    bool valid_;
+    uint8_t cells_[BOARD_HEIGHT][BOARD_WIDTH]; // TetrominoType values
+};
+
+/*!
+ * What Renderer draws through. Renderer lays a frame out once; a backend owns every API object
+ * and turns a RenderFrame into commands. Backends are used from one thread, the render thread.
+ */
+class RenderBackend {
+public:
+    virtual ~RenderBackend() = default;
+
+    /*!
+     * Directory for compiled shader and pipeline caches; nothing is cached until it is set.
+     * Call before the first initialize().
+     */
+    virtual void setCacheDirectory(const std::string& directory) = 0;
+
+    // A surface was created; its context is current on this thread
+    virtual void initialize() = 0;
+
+    virtual void resize(int width, int height) = 0;
+
+    /*!
+     * Quads that never change (borders, panels), drawn right after the board. Backends may
+     * keep them in static buffers.
+     */
+    virtual void setStaticQuads(const QuadInstance* quads, int count) = 0;
+
+    /*!
+     * Starts a frame: clears and restores lost objects. False if nothing can be drawn yet, in
+     * which case render() is not called for this frame.
+     */
+    virtual bool beginFrame() = 0;
+
+    virtual void render(const RenderFrame& frame) = 0;
+
+    // True while objects are still being (re)created and frames are incomplete
+    virtual bool isRestoring() const = 0;
+};
+
+#endif //PALIBRIX_RENDERBACKEND_H
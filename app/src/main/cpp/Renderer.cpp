@@ -1,7 +1,10 @@
 #include "Renderer.h"
 #include "AndroidOut.h"
+#include "GlesBackend.h"
 #include "TetrominoData.h"
-#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <chrono>
 
 // Helper to create an orthographic projection matrix
 void createOrthoMatrix(float* mat, float left, float right, float bottom, float top, float near, float far) {
@@ -26,204 +29,136 @@ void createOrthoMatrix(float* mat, float left, float right, float bottom, float
     mat[15] = 1.0f;
 }
 
-// Simple vertex shader for drawing colored blocks
-const char* VERTEX_SHADER =
-    "#version 300 es\n"
-    "layout(location = 0) in vec2 aPosition;\n"
-    "uniform mat4 uProjection;\n"
-    "uniform vec2 uOffset;\n"
-    "uniform vec2 uScale;\n"
-    "void main() {\n"
-    "    gl_Position = uProjection * vec4((aPosition * uScale) + uOffset, 0.0, 1.0);\n"
-    "}\n";
-
-// Simple fragment shader for drawing colored blocks
-const char* FRAGMENT_SHADER =
-    "#version 300 es\n"
-    "precision mediump float;\n"
-    "out vec4 FragColor;\n"
-    "uniform vec3 uColor;\n"
-    "uniform float uAlpha;\n"
-    "void main() {\n"
-    "    FragColor = vec4(uColor, uAlpha);\n"
-    "}\n";
-
-
-Renderer::Renderer() : width_(0), height_(0), vao_(0), vbo_(0) {}
-
-Renderer::~Renderer() {
-    if (vbo_ != 0) {
-        glDeleteBuffers(1, &vbo_);
-    }
-    if (vao_ != 0) {
-        glDeleteVertexArrays(1, &vao_);
-    }
-}
-
-void Renderer::initRenderer() {
-    aout << "Initializing Renderer..." << std::endl;
+static_assert(ParticleSystem::kCapacity <= kMaxParticles, "backends size particle buffers for kMaxParticles");
+static_assert(ParticleSystem::kFloatsPerInstance == kParticleFloats, "instance layout");
+static_assert(TextRenderer::kMaxVertices <= kMaxTextVertices, "backends size text buffers for kMaxTextVertices");
+static_assert(TextRenderer::kFloatsPerVertex == kTextVertexFloats, "vertex layout");
 
-    // Clean up previous resources if they exist
-    if (vao_ != 0) {
-        glDeleteVertexArrays(1, &vao_);
-        vao_ = 0;
-    }
-    if (vbo_ != 0) {
-        glDeleteBuffers(1, &vbo_);
-        vbo_ = 0;
-    }
-    if (blockShader_) {
-        blockShader_.reset();
-    }
+// World position of board cell (0, 0)
+constexpr float kBoardOffsetX = 4.0f;
+constexpr float kBoardOffsetY = 3.0f; // Moved down from y=1.0f to y=3.0f
 
-    blockShader_ = std::make_unique<Shader>(VERTEX_SHADER, FRAGMENT_SHADER);
-    if (!blockShader_->isLoaded()) {
-        aout << "Failed to load block shader" << std::endl;
-        return;
-    }
+static const float kPanelColor[3] = {0.2f, 0.2f, 0.2f};  // Darker gray
+static const float kHeaderColor[3] = {0.3f, 0.3f, 0.3f};
+static const float kBorderColor[3] = {0.7f, 0.7f, 0.7f}; // Light gray
 
-    // A single 1x1 quad (0,0) to (1,1)
-    const std::vector<float> vertices = {
-        0.0f, 1.0f,  // Top-left
-        1.0f, 0.0f,  // Bottom-right
-        0.0f, 0.0f,  // Bottom-left
-        0.0f, 1.0f,  // Top-left
-        1.0f, 1.0f,  // Top-right
-        1.0f, 0.0f   // Bottom-right
+Renderer::Renderer()
+        : backend_(std::make_unique<GlesBackend>()), quadCount_(0), textRenderer_(std::make_unique<TextRenderer>()),
+          hudValues_{-1, -1, -1, -1, -1, -1}, particles_(std::make_unique<ParticleSystem>()), eventCursor_(0),
+          fixedTimeStep_(0.0f), lastRenderCost_(0.0f) {
+    // Adjusted coordinate system - make game area wider to show UI elements
+    float gameAreaWidth = 20.0f; // Increased width for UI
+    float gameAreaHeight = 26.0f; // Increased height to show top rows
+    createOrthoMatrix(projection_, 0.0f, gameAreaWidth, gameAreaHeight, 0.0f, -1.0f, 1.0f);
+
+    // Board border, the hold and next panels and their header bars never change
+    const QuadInstance staticQuads[] = {
+        {3.8f, 3.0f, 0.2f, 22.0f, kBorderColor[0], kBorderColor[1], kBorderColor[2], 1.0f},  // Left border
+        {14.0f, 3.0f, 0.2f, 22.0f, kBorderColor[0], kBorderColor[1], kBorderColor[2], 1.0f}, // Right border
+        {3.8f, 25.0f, 10.4f, 0.2f, kBorderColor[0], kBorderColor[1], kBorderColor[2], 1.0f}, // Bottom border
+        {15.0f, 3.0f, 3.0f, 18.0f, kPanelColor[0], kPanelColor[1], kPanelColor[2], 0.8f},    // Next queue
+        {15.0f, 3.0f, 3.0f, 1.0f, kHeaderColor[0], kHeaderColor[1], kHeaderColor[2], 1.0f},  // "NEXT" bar
+        {0.5f, 3.0f, 3.0f, 4.0f, kPanelColor[0], kPanelColor[1], kPanelColor[2], 0.8f},      // Hold
+        {0.5f, 3.0f, 3.0f, 1.0f, kHeaderColor[0], kHeaderColor[1], kHeaderColor[2], 1.0f},   // "HOLD" bar
     };
+    backend_->setStaticQuads(staticQuads, sizeof(staticQuads) / sizeof(staticQuads[0]));
 
-    glGenVertexArrays(1, &vao_);
-    glGenBuffers(1, &vbo_);
-
-    glBindVertexArray(vao_);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo_);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    // Static labels centered in the HOLD / NEXT header bars
+    textRenderer_->setText(kHudSlotHoldLabel, "HOLD", 1.1f, 3.2f, 0.6f, 1.0f, 1.0f, 1.0f);
+    textRenderer_->setText(kHudSlotNextLabel, "NEXT", 15.6f, 3.2f, 0.6f, 1.0f, 1.0f, 1.0f);
+}
 
-    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+Renderer::~Renderer() = default;
 
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
+void Renderer::initRenderer() {
+    aout << "Initializing Renderer..." << std::endl;
+    backend_->initialize();
+    lastFrameTime_ = std::chrono::steady_clock::now();
+    aout << "Renderer Initialized" << std::endl;
+}
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+void Renderer::setShaderCacheDirectory(const std::string& directory) {
+    backend_->setCacheDirectory(directory);
+}
 
-    glClearColor(0.05f, 0.1f, 0.15f, 1.0f); // Dark blue background
-    aout << "Renderer Initialized" << std::endl;
+void Renderer::setFixedTimeStep(float seconds) {
+    fixedTimeStep_ = seconds;
 }
 
 void Renderer::updateRenderArea(int width, int height) {
-    width_ = width;
-    height_ = height;
-    glViewport(0, 0, width_, height_);
+    backend_->resize(width, height);
 }
 
 void Renderer::render(const Game& game) {
-    glClear(GL_COLOR_BUFFER_BIT);
-
-    if (!blockShader_ || !blockShader_->isLoaded()) {
+    // Clears, and recreates what a context loss took a few objects per frame
+    if (!backend_->beginFrame()) {
         return;
     }
-    
-    // Adjusted coordinate system - make game area wider to show UI elements
-    float gameAreaWidth = 20.0f; // Increased width for UI
-    float gameAreaHeight = 26.0f; // Increased height to show top rows
-    float projection[16];
-    createOrthoMatrix(projection, 0.0f, gameAreaWidth, gameAreaHeight, 0.0f, -1.0f, 1.0f);
+    auto start = std::chrono::steady_clock::now();
+
+    // Ghost piece (semi-transparent) under the falling piece
+    quadCount_ = 0;
+    addPiece(game.getGhostPiece(), 0.3f);
+    addPiece(game.getCurrentPiece(), 1.0f);
+    addNextQueue(game);
+    addHoldPiece(game);
+
+    // Line clear / hard drop / T-spin effects
+    updateEffects(game);
+
+    // Score, lines, level and combo text
+    updateHud(game);
+
+    RenderFrame frame{};
+    frame.projection = projection_;
+    frame.board = &game.getBoard();
+    frame.boardX = kBoardOffsetX;
+    frame.boardY = kBoardOffsetY;
+    frame.quads = quads_;
+    frame.quadCount = quadCount_;
+    frame.particleCount = particles_->getLiveCount();
+    frame.particles = frame.particleCount > 0 ? particles_->packInstances() : nullptr;
+    frame.textVertices = textRenderer_->getVertices();
+    frame.textVertexCount = textRenderer_->getVertexCount();
+    frame.textGeneration = textRenderer_->getGeneration();
+    backend_->render(frame);
+
+    // Offscreen runs with a fixed step keep full quality, so that their pixels stay reproducible
+    if (fixedTimeStep_ <= 0.0f) {
+        lastRenderCost_ = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+    }
+}
 
-    blockShader_->use();
-    blockShader_->setMat4("uProjection", projection);
-    
-    // Draw game board background (dark gray rectangle)
-    drawBackground();
-    
-    // Draw locked pieces on the board
-    drawBoard(game);
-    
-    // Draw ghost piece (semi-transparent)
-    drawPiece(game.getGhostPiece(), true);
-    
-    // Draw current falling piece
-    drawPiece(game.getCurrentPiece(), false);
-    
-    // Draw board border
-    drawBorder();
-    
-    // Draw UI elements
-    drawUI(game);
+void Renderer::addQuad(float x, float y, float width, float height, const float* color, float alpha) {
+    if (quadCount_ < kMaxFrameQuads) {
+        quads_[quadCount_++] = {x, y, width, height, color[0], color[1], color[2], alpha};
+    }
 }
 
-void Renderer::drawBackground() {
-    blockShader_->setVec3("uColor", 0.1f, 0.1f, 0.1f); // Dark gray
-    blockShader_->setFloat("uAlpha", 1.0f);
-    blockShader_->setVec2("uOffset", 4.0f, 3.0f); // Moved down from y=1.0f to y=3.0f
-    blockShader_->setVec2("uScale", 10.0f, 22.0f); // Full 22 rows height
-    
-    glBindVertexArray(vao_);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
+void Renderer::addPiece(const Tetromino& piece, float alpha) {
+    if (piece.type == TetrominoType::EMPTY) return;
+
+    const float* color = tetrominoColors[static_cast<int>(piece.type)];
+    const auto& shape = tetrominoShapes[static_cast<int>(piece.type)][piece.rotation];
+    for (const auto& mino : shape) {
+        // Blocks are slightly smaller than a cell for a visible grid
+        addQuad(kBoardOffsetX + piece.x + mino.x, kBoardOffsetY + piece.y + mino.y, 0.9f, 0.9f, color, alpha);
+    }
 }
 
-void Renderer::drawNextQueue(const Game& game) {
+void Renderer::addNextQueue(const Game& game) {
     const auto& nextQueue = game.getNextQueue();
-    
-    // Draw background for next queue area
-    blockShader_->setVec3("uColor", 0.2f, 0.2f, 0.2f); // Darker gray
-    blockShader_->setFloat("uAlpha", 0.8f);
-    blockShader_->setVec2("uOffset", 15.0f, 3.0f);
-    blockShader_->setVec2("uScale", 3.0f, 18.0f);
-    
-    glBindVertexArray(vao_);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
-    
-    // Draw "NEXT" label background
-    blockShader_->setVec3("uColor", 0.3f, 0.3f, 0.3f);
-    blockShader_->setFloat("uAlpha", 1.0f);
-    blockShader_->setVec2("uOffset", 15.0f, 3.0f);
-    blockShader_->setVec2("uScale", 3.0f, 1.0f);
-    
-    glBindVertexArray(vao_);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
-    
-    // Draw each piece in the next queue
     for (size_t i = 0; i < nextQueue.size() && i < 6; ++i) {
         float yOffset = 4.5f + i * 2.8f;
-        drawPreviewPiece(nextQueue[i], 15.5f, yOffset, 0.4f);
+        addPreviewPiece(nextQueue[i], 15.5f, yOffset, 0.4f);
     }
 }
 
-void Renderer::drawHoldPiece(const Game& game) {
-    TetrominoType heldPiece = game.getHeldPiece();
-    
-    // Draw background for hold area
-    blockShader_->setVec3("uColor", 0.2f, 0.2f, 0.2f); // Darker gray
-    blockShader_->setFloat("uAlpha", 0.8f);
-    blockShader_->setVec2("uOffset", 0.5f, 3.0f);
-    blockShader_->setVec2("uScale", 3.0f, 4.0f);
-    
-    glBindVertexArray(vao_);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
-    
-    // Draw "HOLD" label background
-    blockShader_->setVec3("uColor", 0.3f, 0.3f, 0.3f);
-    blockShader_->setFloat("uAlpha", 1.0f);
-    blockShader_->setVec2("uOffset", 0.5f, 3.0f);
-    blockShader_->setVec2("uScale", 3.0f, 1.0f);
-    
-    glBindVertexArray(vao_);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
-    
-    // Draw held piece if it exists
-    if (heldPiece != TetrominoType::EMPTY) {
-        drawPreviewPiece(heldPiece, 1.0f, 4.5f, 0.4f);
-    }
+void Renderer::addHoldPiece(const Game& game) {
+    addPreviewPiece(game.getHeldPiece(), 1.0f, 4.5f, 0.4f);
 }
 
-void Renderer::drawPreviewPiece(TetrominoType type, float x, float y, float scale) {
+void Renderer::addPreviewPiece(TetrominoType type, float x, float y, float scale) {
     if (type == TetrominoType::EMPTY) return;
     
     const auto& shape = tetrominoShapes[static_cast<int>(type)][0]; // Always use rotation 0 for preview
@@ -241,112 +176,57 @@ void Renderer::drawPreviewPiece(TetrominoType type, float x, float y, float scal
     float centerOffsetX = -(maxX + minX) * scale * 0.5f;
     float centerOffsetY = -(maxY + minY) * scale * 0.5f;
     
-    // Set color based on piece type
-    float r=1, g=1, b=1;
-    switch (type) {
-        case TetrominoType::I: r=0.0f; g=1.0f; b=1.0f; break; // Cyan
-        case TetrominoType::O: r=1.0f; g=1.0f; b=0.0f; break; // Yellow
-        case TetrominoType::T: r=0.6f; g=0.2f; b=0.8f; break; // Purple
-        case TetrominoType::J: r=0.0f; g=0.3f; b=1.0f; break; // Blue
-        case TetrominoType::L: r=1.0f; g=0.5f; b=0.0f; break; // Orange
-        case TetrominoType::S: r=0.0f; g=0.8f; b=0.0f; break; // Green
-        case TetrominoType::Z: r=1.0f; g=0.0f; b=0.0f; break; // Red
-        default: return;
-    }
-    
-    blockShader_->setVec3("uColor", r, g, b);
-    blockShader_->setFloat("uAlpha", 1.0f);
-    
-    // Draw each mino of the piece
+    const float* color = tetrominoColors[static_cast<int>(type)];
     for (const auto& mino : shape) {
         float blockX = x + centerOffsetX + mino.x * scale;
         float blockY = y + centerOffsetY + mino.y * scale;
-        
-        blockShader_->setVec2("uOffset", blockX, blockY);
-        blockShader_->setVec2("uScale", scale * 0.9f, scale * 0.9f);
-        
-        glBindVertexArray(vao_);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        glBindVertexArray(0);
+        addQuad(blockX, blockY, scale * 0.9f, scale * 0.9f, color, 1.0f);
     }
 }
 
-void Renderer::drawBorder() {
-    blockShader_->setVec3("uColor", 0.7f, 0.7f, 0.7f); // Light gray
-    blockShader_->setFloat("uAlpha", 1.0f);
-    blockShader_->setVec2("uScale", 1.0f, 1.0f);
-    
-    // Left border - adjusted position
-    blockShader_->setVec2("uOffset", 3.8f, 3.0f);
-    blockShader_->setVec2("uScale", 0.2f, 22.0f);
-    glBindVertexArray(vao_);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    
-    // Right border - adjusted position  
-    blockShader_->setVec2("uOffset", 14.0f, 3.0f);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    
-    // Bottom border - adjusted position
-    blockShader_->setVec2("uOffset", 3.8f, 25.0f);
-    blockShader_->setVec2("uScale", 10.4f, 0.2f);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    
-    glBindVertexArray(0);
-}
-
-void Renderer::drawBoard(const Game& game) {
-    const auto& board = game.getBoard();
-    for (int y = 0; y < BOARD_HEIGHT; ++y) {
-        for (int x = 0; x < BOARD_WIDTH; ++x) {
-            if (board[y][x] != TetrominoType::EMPTY) {
-                drawBlock(x, y, board[y][x], false);
-            }
-        }
-    }
-}
+void Renderer::updateEffects(const Game& game) {
+    auto now = std::chrono::steady_clock::now();
+    float dt = fixedTimeStep_ > 0.0f ? fixedTimeStep_ : std::chrono::duration<float>(now - lastFrameTime_).count();
+    lastFrameTime_ = now;
+    dt = std::min(std::max(dt, 0.0f), 0.1f); // Don't let a stall fling particles off screen
 
-// This is defined in Game.cpp, need to include Game.h or move it
-// extern const std::vector<std::vector<std::vector<Mino>>> tetrominoShapes;
+    // Spawn for every event since the last frame
+    game.consumeEvents(eventCursor_, [this](const GameEvent& event) {
+        particles_->spawn(event);
+    });
 
-void Renderer::drawPiece(const Tetromino& piece, bool isGhost) {
-    if (piece.type == TetrominoType::EMPTY) return;
-    
-    const auto& shape = tetrominoShapes[static_cast<int>(piece.type)][piece.rotation];
-    for (const auto& mino : shape) {
-        drawBlock(piece.x + mino.x, piece.y + mino.y, piece.type, isGhost);
-    }
+    particles_->update(dt, lastRenderCost_, kFrameBudget);
 }
 
-void Renderer::drawUI(const Game& game) {
-    // Draw next queue (6 pieces)
-    drawNextQueue(game);
-    
-    // Draw hold piece
-    drawHoldPiece(game);
-}
-
-void Renderer::drawBlock(int x, int y, TetrominoType type, bool isGhost) {
-    float r=1, g=1, b=1; // Default to white
-    switch (type) {
-        case TetrominoType::I: r=0.0f; g=1.0f; b=1.0f; break; // Cyan
-        case TetrominoType::O: r=1.0f; g=1.0f; b=0.0f; break; // Yellow
-        case TetrominoType::T: r=0.6f; g=0.2f; b=0.8f; break; // Purple
-        case TetrominoType::J: r=0.0f; g=0.3f; b=1.0f; break; // Blue
-        case TetrominoType::L: r=1.0f; g=0.5f; b=0.0f; break; // Orange
-        case TetrominoType::S: r=0.0f; g=0.8f; b=0.0f; break; // Green
-        case TetrominoType::Z: r=1.0f; g=0.0f; b=0.0f; break; // Red
-        default: return;
+void Renderer::updateHud(const Game& game) {
+    static const char* const kLabels[kHudValueCount] = {"SCORE", "LINES", "LEVEL", "COMBO", "PPS", "APM"};
+    static const float kColors[kHudValueCount][3] = {
+        {0.0f, 1.0f, 1.0f},  // Score - Cyan
+        {1.0f, 0.84f, 0.0f}, // Lines - Gold
+        {1.0f, 0.41f, 0.7f}, // Level - Pink
+        {0.0f, 1.0f, 0.0f},  // Combo - Green
+        {0.75f, 0.75f, 1.0f}, // Pieces per second - Lavender
+        {1.0f, 0.55f, 0.2f}  // Attack per minute - Orange
+    };
+    // Rates are kept in hundredths so that the change check stays an integer compare
+    const SessionStats& stats = game.getStats();
+    const int values[kHudValueCount] = {game.getScore(), game.getLines(), game.getLevel(), game.getCombo(),
+                                        static_cast<int>(stats.pps * 100.0f + 0.5f),
+                                        static_cast<int>(stats.apm * 100.0f + 0.5f)};
+
+    // Stats are stacked under the hold box; only changed values are re-laid out
+    for (int i = 0; i < kHudValueCount; ++i) {
+        if (values[i] == hudValues_[i]) continue;
+        hudValues_[i] = values[i];
+        char text[TextRenderer::kMaxTextLength + 1];
+        if (i < kHudIntegerValues) {
+            snprintf(text, sizeof(text), "%s\n%d", kLabels[i], values[i]);
+        } else {
+            snprintf(text, sizeof(text), "%s\n%d.%02d", kLabels[i], values[i] / 100, values[i] % 100);
+        }
+        textRenderer_->setText(kHudSlotStats + i, text, 0.5f, 8.5f + i * 1.6f, 0.5f,
+                               kColors[i][0], kColors[i][1], kColors[i][2]);
     }
 
-    blockShader_->setVec3("uColor", r, g, b);
-    blockShader_->setFloat("uAlpha", isGhost ? 0.3f : 1.0f); // Ghost pieces are transparent
-    
-    float boardOffsetX = 4.0f;
-    float boardOffsetY = 3.0f; // Moved down from y=1.0f to y=3.0f
-    blockShader_->setVec2("uOffset", boardOffsetX + x, boardOffsetY + y);
-    blockShader_->setVec2("uScale", 0.9f, 0.9f); // Make blocks slightly smaller for visible grid
-    
-    glBindVertexArray(vao_);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
-} 
\ No newline at end of file
+    textRenderer_->update();
+}
@@ -1,13 +1,19 @@
 #ifndef PALIBRIX_RENDERER_H
 #define PALIBRIX_RENDERER_H
 
-#include <EGL/egl.h>
-#include <GLES3/gl3.h>
 #include <memory>
+#include <chrono>
+#include <string>
 
-#include "Shader.h"
+#include "RenderBackend.h"
+#include "TextRenderer.h"
+#include "ParticleSystem.h"
 #include "Game.h"
 
+/*!
+ * Lays out a frame of the game (pieces, panels, HUD text, particles) on the CPU and hands it to
+ * a RenderBackend (GlesBackend), which owns every GPU object.
+ */
 class Renderer {
 public:
     Renderer();
@@ -15,25 +21,63 @@ public:
 
     void initRenderer();
     void updateRenderArea(int width, int height);
+
+    /*!
+     * Directory for shader binaries; shaders are compiled every time until it is set.
+     */
+    void setShaderCacheDirectory(const std::string& directory);
     void render(const Game& game);
 
+    /*!
+     * Advances effects by a fixed step per frame instead of the wall clock (0 restores the
+     * clock), so that offscreen runs produce the same pixels every time.
+     */
+    void setFixedTimeStep(float seconds);
+    float getFixedTimeStep() const { return fixedTimeStep_; }
+
+    RenderBackend& getBackend() { return *backend_; }
+
+    // True while GPU objects are still being (re)created and frames are incomplete
+    bool isRestoring() const { return backend_->isRestoring(); }
+
+    // True while particles are on screen, which need every frame to move smoothly
+    bool hasActiveEffects() const { return particles_->getLiveCount() > 0; }
+
 private:
-    void drawBoard(const Game& game);
-    void drawPiece(const Tetromino& piece, bool isGhost);
-    void drawUI(const Game& game);
-    void drawBlock(int x, int y, TetrominoType type, bool isGhost = false);
-    void drawBackground();
-    void drawBorder();
-    void drawNextQueue(const Game& game);
-    void drawHoldPiece(const Game& game);
-    void drawPreviewPiece(TetrominoType type, float x, float y, float scale = 0.5f);
-
-    int width_;
-    int height_;
-
-    std::unique_ptr<Shader> blockShader_;
-    GLuint vao_;
-    GLuint vbo_;
+    void addQuad(float x, float y, float width, float height, const float* color, float alpha);
+    void addPiece(const Tetromino& piece, float alpha);
+    void addPreviewPiece(TetrominoType type, float x, float y, float scale = 0.5f);
+    void addNextQueue(const Game& game);
+    void addHoldPiece(const Game& game);
+    void updateHud(const Game& game);
+    void updateEffects(const Game& game);
+
+    std::unique_ptr<RenderBackend> backend_;
+    float projection_[16];
+
+    // Pieces and previews of the current frame
+    QuadInstance quads_[kMaxFrameQuads];
+    int quadCount_;
+
+    // Text slots used by the HUD
+    static constexpr int kHudSlotHoldLabel = 0;
+    static constexpr int kHudSlotNextLabel = 1;
+    static constexpr int kHudSlotStats = 2; // kHudValueCount consecutive slots
+    static constexpr int kHudValueCount = 6;
+    static constexpr int kHudIntegerValues = 4; // The rest are rates shown with two decimals
+
+    // HUD text, only re-laid out when one of the displayed values changes
+    std::unique_ptr<TextRenderer> textRenderer_;
+    int hudValues_[kHudValueCount]; // score, lines, level, combo, PPS and APM as last sent to textRenderer_
+
+    // Effect particles, simulated on the CPU so they survive context and device loss. Their spawn
+    // rate drops while a frame costs more CPU time than a 60 Hz frame lasts.
+    static constexpr float kFrameBudget = 1.0f / 60.0f;
+    std::unique_ptr<ParticleSystem> particles_;
+    uint32_t eventCursor_; // Next Game event index to turn into particles
+    std::chrono::steady_clock::time_point lastFrameTime_;
+    float fixedTimeStep_; // 0 = measure frame time
+    float lastRenderCost_; // CPU seconds the last complete frame took; stays 0 with a fixed time step
 };
 
-#endif //PALIBRIX_RENDERER_H
\ No newline at end of file
+#endif //PALIBRIX_RENDERER_H
@@ -0,0 +1,582 @@
+#include "Replay.h"
+#include "ByteStream.h"
+#include "AndroidOut.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+static constexpr uint32_t kHeaderMagic = 0x50524c50; // "PLRP"
+static constexpr uint32_t kFooterMagic = 0x58524c50; // "PLRX"
+static constexpr uint16_t kVersion = 4; // 2: keyframe state carries session statistics, 3: fixed-point gravity,
+                                        // 4: tick runs
+static constexpr size_t kHeaderSize = 16;
+static constexpr size_t kFooterSize = 20;
+static constexpr size_t kIndexEntrySize = 16;
+static constexpr uint8_t kKeyframeTag = 0x0f;
+static constexpr uint32_t kInlineDeltaLimit = 15; // Tag high nibble value meaning "varint follows"
+
+void applyReplayInput(Game& game, ReplayInput input) {
+    switch (input) {
+        case ReplayInput::Tick:
+            game.update();
+            break;
+        case ReplayInput::MoveLeft:
+            game.move(-1);
+            break;
+        case ReplayInput::MoveRight:
+            game.move(1);
+            break;
+        case ReplayInput::Rotate:
+            game.rotate();
+            break;
+        case ReplayInput::RotateLeft:
+            game.rotateLeft();
+            break;
+        case ReplayInput::SoftDrop:
+            game.softDrop();
+            break;
+        case ReplayInput::HardDrop:
+            game.hardDrop();
+            break;
+        case ReplayInput::Hold:
+            game.hold();
+            break;
+        default:
+            break;
+    }
+}
+
+int pruneReplays(const std::string& dir, size_t maxFiles, uint64_t maxBytes) {
+    DIR* listing = opendir(dir.c_str());
+    if (!listing) {
+        return 0;
+    }
+    std::vector<std::string> names;
+    while (dirent* entry = readdir(listing)) {
+        size_t length = strlen(entry->d_name);
+        if (length > 4 && strcmp(entry->d_name + length - 4, ".plr") == 0) {
+            names.emplace_back(entry->d_name);
+        }
+    }
+    closedir(listing);
+
+    // Newest first; the same number of digits in every start time until the year 2286
+    std::sort(names.begin(), names.end(), [](const std::string& a, const std::string& b) {
+        return a.size() != b.size() ? a.size() > b.size() : a > b;
+    });
+    int removed = 0;
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < names.size(); ++i) {
+        std::string path = dir + "/" + names[i];
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) {
+            continue;
+        }
+        bytes += static_cast<uint64_t>(info.st_size);
+        if (i > 0 && (i >= maxFiles || bytes > maxBytes) && remove(path.c_str()) == 0) {
+            removed++;
+        }
+    }
+    if (removed > 0) {
+        aout << "Replays: removed " << removed << " old recording(s) from " << dir << std::endl;
+    }
+    return removed;
+}
+
+// Clock time of the index-th of count ticks in a run that follows previousMs and ends at endMs
+static uint32_t tickTime(uint32_t previousMs, uint32_t endMs, uint32_t index, uint32_t count) {
+    return previousMs + static_cast<uint32_t>(uint64_t(endMs - previousMs) * index / count);
+}
+
+// --- ReplayWriter ---
+
+int64_t ReplayWriter::steadyMilliseconds() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+ReplayWriter::ReplayWriter(Clock clock)
+        : clock_(clock), file_(nullptr), startTime_(0), lastTimeMs_(0), runTicks_(0), runTimeMs_(0), inputCount_(0), pieces_(0), eventCursor_(0), bytesWritten_(0),
+          fillChunk_(0), drainChunk_(0), queuedChunks_(0), stopWriter_(false) {
+    keyframes_.reserve(kMaxKeyframes);
+    for (auto& chunk : chunks_) {
+        chunk.size = 0;
+    }
+}
+
+ReplayWriter::~ReplayWriter() {
+    finish();
+}
+
+bool ReplayWriter::begin(const std::string& path, const Game& game) {
+    finish();
+
+    file_ = fopen(path.c_str(), "wb");
+    if (!file_) {
+        aout << "Could not create replay " << path << std::endl;
+        return false;
+    }
+
+    startTime_ = clock_();
+    lastTimeMs_ = 0;
+    runTicks_ = 0;
+    runTimeMs_ = 0;
+    inputCount_ = 0;
+    pieces_ = 0;
+    eventCursor_ = game.getEventCount();
+    bytesWritten_ = 0;
+    keyframes_.clear();
+    for (auto& chunk : chunks_) {
+        chunk.size = 0;
+    }
+    fillChunk_ = 0;
+    drainChunk_ = 0;
+    queuedChunks_ = 0;
+    stopWriter_ = false;
+
+    uint8_t header[kHeaderSize];
+    ByteWriter out(header, sizeof(header));
+    out.putU32(kHeaderMagic);
+    out.putU16(kVersion);
+    out.putU8(static_cast<uint8_t>(game.getRandomizerKind()));
+    out.putU8(static_cast<uint8_t>(kKeyframeInterval));
+    out.putU64(game.getSeed());
+    append(header, out.size());
+    writeKeyframe(game);
+
+    writerThread_ = std::thread(&ReplayWriter::writerLoop, this);
+    return true;
+}
+
+void ReplayWriter::record(ReplayInput input, const Game& game) {
+    if (!file_) {
+        return;
+    }
+
+    uint32_t timeMs = static_cast<uint32_t>(clock_() - startTime_);
+    uint32_t events = game.getEventCount() - eventCursor_;
+    bool keyframeDue = false;
+    game.consumeEvents(eventCursor_, [this, &keyframeDue](const GameEvent& event) {
+        if (event.type == GameEventType::PieceLocked && ++pieces_ % kKeyframeInterval == 0) {
+            keyframeDue = true;
+        }
+    });
+    inputCount_++;
+
+    // A tick without events joins the run. The clock is not part of the game state, and the
+    // statistics it feeds only change at events, so its exact time does not matter.
+    if (input == ReplayInput::Tick) {
+        runTicks_++;
+        runTimeMs_ = timeMs;
+        if (events == 0) {
+            return;
+        }
+        endTickRun();
+    } else {
+        endTickRun();
+        appendRecord(input, timeMs, 0);
+    }
+
+    if (keyframeDue) {
+        writeKeyframe(game);
+        // Push it out now so that a crash loses at most one keyframe interval
+        submitChunk();
+    }
+}
+
+void ReplayWriter::flush() {
+    if (file_) {
+        endTickRun();
+        submitChunk();
+    }
+}
+
+void ReplayWriter::finish() {
+    if (!file_) {
+        return;
+    }
+
+    endTickRun();
+    submitChunk();
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        stopWriter_ = true;
+    }
+    chunkQueued_.notify_one();
+    writerThread_.join();
+
+    // Index and footer go straight to the file; nothing else is writing to it any more
+    uint32_t indexOffset = bytesWritten_;
+    for (const ReplayKeyframe& keyframe : keyframes_) {
+        uint8_t entry[kIndexEntrySize];
+        ByteWriter out(entry, sizeof(entry));
+        out.putU32(keyframe.inputIndex);
+        out.putU32(keyframe.timeMs);
+        out.putU32(keyframe.offset);
+        out.putU32(keyframe.pieces);
+        fwrite(entry, 1, out.size(), file_);
+    }
+
+    uint8_t footer[kFooterSize];
+    ByteWriter out(footer, sizeof(footer));
+    out.putU32(indexOffset);
+    out.putU32(static_cast<uint32_t>(keyframes_.size()));
+    out.putU32(inputCount_);
+    out.putU32(lastTimeMs_);
+    out.putU32(kFooterMagic);
+    fwrite(footer, 1, out.size(), file_);
+
+    fclose(file_);
+    file_ = nullptr;
+}
+
+void ReplayWriter::appendRecord(ReplayInput input, uint32_t timeMs, uint32_t ticks) {
+    uint32_t delta = timeMs - lastTimeMs_;
+    lastTimeMs_ = timeMs;
+
+    uint8_t record[16];
+    ByteWriter out(record, sizeof(record));
+    if (delta < kInlineDeltaLimit) {
+        out.putU8(static_cast<uint8_t>(static_cast<uint8_t>(input) | (delta << 4)));
+    } else {
+        out.putU8(static_cast<uint8_t>(static_cast<uint8_t>(input) | (kInlineDeltaLimit << 4)));
+        out.putVarint(delta);
+    }
+    if (input == ReplayInput::Tick) {
+        out.putVarint(ticks);
+    }
+    append(record, out.size());
+}
+
+void ReplayWriter::endTickRun() {
+    if (runTicks_ > 0) {
+        appendRecord(ReplayInput::Tick, runTimeMs_, runTicks_);
+        runTicks_ = 0;
+    }
+}
+
+void ReplayWriter::writeKeyframe(const Game& game) {
+    if (keyframes_.size() >= kMaxKeyframes) {
+        return; // Seeking past this point replays longer, but the file stays valid
+    }
+
+    uint8_t state[Game::kMaxStateSize];
+    ByteWriter stateOut(state, sizeof(state));
+    game.writeState(stateOut);
+    if (!stateOut.ok()) {
+        aout << "Replay keyframe exceeds " << Game::kMaxStateSize << " bytes" << std::endl;
+        return;
+    }
+
+    keyframes_.push_back({inputCount_, lastTimeMs_, bytesWritten_, pieces_});
+
+    uint8_t head[16];
+    ByteWriter out(head, sizeof(head));
+    out.putU8(kKeyframeTag);
+    out.putVarint(pieces_);
+    out.putVarint(stateOut.size());
+    append(head, out.size());
+    append(state, stateOut.size());
+}
+
+void ReplayWriter::append(const uint8_t* data, size_t size) {
+    bytesWritten_ += static_cast<uint32_t>(size);
+    while (size > 0) {
+        Chunk& chunk = chunks_[fillChunk_];
+        size_t count = std::min(size, kChunkSize - chunk.size);
+        memcpy(chunk.data + chunk.size, data, count);
+        chunk.size += count;
+        data += count;
+        size -= count;
+        if (chunk.size == kChunkSize) {
+            submitChunk();
+        }
+    }
+}
+
+void ReplayWriter::submitChunk() {
+    if (chunks_[fillChunk_].size == 0) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(lock_);
+    queuedChunks_++;
+    chunkQueued_.notify_one();
+    fillChunk_ = (fillChunk_ + 1) % kChunkCount;
+
+    // Only blocks if every chunk is still waiting for storage
+    chunkWritten_.wait(lock, [this] { return queuedChunks_ < kChunkCount; });
+    chunks_[fillChunk_].size = 0;
+}
+
+void ReplayWriter::writerLoop() {
+    std::unique_lock<std::mutex> lock(lock_);
+    for (;;) {
+        chunkQueued_.wait(lock, [this] { return queuedChunks_ > 0 || stopWriter_; });
+        if (queuedChunks_ == 0) {
+            break; // Stopped and drained
+        }
+
+        const Chunk& chunk = chunks_[drainChunk_];
+        lock.unlock();
+        fwrite(chunk.data, 1, chunk.size, file_);
+        fflush(file_);
+        lock.lock();
+
+        drainChunk_ = (drainChunk_ + 1) % kChunkCount;
+        queuedChunks_--;
+        chunkWritten_.notify_one();
+    }
+}
+
+// --- ReplayReader ---
+
+ReplayReader::ReplayReader()
+        : data_(nullptr), size_(0), streamEnd_(0), seed_(0), kind_(RandomizerKind::Bag7),
+          inputCount_(0), durationMs_(0) {}
+
+ReplayReader::~ReplayReader() {
+    close();
+}
+
+bool ReplayReader::open(const std::string& path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        aout << "Could not open replay " << path << std::endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(kHeaderSize)) {
+        ::close(fd);
+        return false;
+    }
+    void* mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // The mapping keeps the file alive
+    if (mapped == MAP_FAILED) {
+        aout << "Could not map replay " << path << std::endl;
+        return false;
+    }
+    data_ = static_cast<const uint8_t*>(mapped);
+    size_ = static_cast<size_t>(info.st_size);
+
+    ByteReader in(data_, kHeaderSize);
+    uint32_t magic = in.getU32();
+    uint16_t version = in.getU16();
+    uint8_t kind = in.getU8();
+    in.getU8(); // Keyframe interval, informational
+    seed_ = in.getU64();
+    if (magic != kHeaderMagic || version != kVersion
+        || kind > static_cast<uint8_t>(RandomizerKind::PureRandom)) {
+        aout << "Not a replay file: " << path << std::endl;
+        close();
+        return false;
+    }
+    kind_ = static_cast<RandomizerKind>(kind);
+
+    if (!readFooter()) {
+        aout << "Replay " << path << " has no index, scanning" << std::endl;
+        if (!scanIndex()) {
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void ReplayReader::close() {
+    if (data_) {
+        munmap(const_cast<uint8_t*>(data_), size_);
+        data_ = nullptr;
+    }
+    size_ = 0;
+    streamEnd_ = 0;
+    inputCount_ = 0;
+    durationMs_ = 0;
+    keyframes_.clear();
+}
+
+bool ReplayReader::readFooter() {
+    if (size_ < kHeaderSize + kFooterSize) {
+        return false;
+    }
+
+    ByteReader footer(data_ + size_ - kFooterSize, kFooterSize);
+    uint32_t indexOffset = footer.getU32();
+    uint32_t count = footer.getU32();
+    inputCount_ = footer.getU32();
+    durationMs_ = footer.getU32();
+    if (footer.getU32() != kFooterMagic || count == 0 || indexOffset < kHeaderSize
+        || static_cast<uint64_t>(indexOffset) + uint64_t(count) * kIndexEntrySize != size_ - kFooterSize) {
+        return false;
+    }
+
+    streamEnd_ = indexOffset;
+    ByteReader index(data_ + indexOffset, count * kIndexEntrySize);
+    keyframes_.resize(count);
+    for (ReplayKeyframe& keyframe : keyframes_) {
+        keyframe.inputIndex = index.getU32();
+        keyframe.timeMs = index.getU32();
+        keyframe.offset = index.getU32();
+        keyframe.pieces = index.getU32();
+        if (keyframe.offset < kHeaderSize || keyframe.offset >= streamEnd_) {
+            keyframes_.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ReplayReader::scanIndex() {
+    ByteReader in(data_ + kHeaderSize, size_ - kHeaderSize);
+    uint32_t timeMs = 0;
+    uint32_t inputs = 0;
+    size_t validEnd = 0;
+
+    while (in.remaining() > 0) {
+        size_t recordStart = in.position();
+        uint8_t tag = in.getU8();
+        uint8_t type = tag & 0x0f;
+        if (type == kKeyframeTag) {
+            uint32_t pieces = static_cast<uint32_t>(in.getVarint());
+            in.getBytes(static_cast<size_t>(in.getVarint()));
+            if (!in.ok()) {
+                break;
+            }
+            keyframes_.push_back({inputs, timeMs, static_cast<uint32_t>(kHeaderSize + recordStart), pieces});
+        } else if (type < static_cast<uint8_t>(ReplayInput::Count)) {
+            uint32_t delta = tag >> 4;
+            if (delta == kInlineDeltaLimit) {
+                delta = static_cast<uint32_t>(in.getVarint());
+            }
+            uint32_t count = type == static_cast<uint8_t>(ReplayInput::Tick)
+                             ? static_cast<uint32_t>(in.getVarint()) : 1;
+            if (!in.ok()) {
+                break;
+            }
+            timeMs += delta;
+            inputs += count;
+        } else {
+            break;
+        }
+        validEnd = in.position();
+    }
+
+    // A cut-off recording ends in a partial record; keep everything before it
+    streamEnd_ = kHeaderSize + validEnd;
+    inputCount_ = inputs;
+    durationMs_ = timeMs;
+    return !keyframes_.empty();
+}
+
+bool ReplayReader::loadKeyframe(Game& game, const ReplayKeyframe& keyframe, size_t& streamPos) const {
+    ByteReader in(data_ + keyframe.offset, streamEnd_ - keyframe.offset);
+    if (in.getU8() != kKeyframeTag) {
+        return false;
+    }
+    in.getVarint();
+    size_t length = static_cast<size_t>(in.getVarint());
+    const uint8_t* state = in.getBytes(length);
+    if (!in.ok()) {
+        return false;
+    }
+    ByteReader stateIn(state, length);
+    if (!game.readState(stateIn)) {
+        return false;
+    }
+    streamPos = keyframe.offset + in.position();
+    return true;
+}
+
+bool ReplayReader::replayFrom(Game& game, size_t keyframe, uint32_t stopInput, uint32_t stopTimeMs,
+                              bool checkKeyframes) const {
+    size_t pos;
+    if (!loadKeyframe(game, keyframes_[keyframe], pos)) {
+        return false;
+    }
+
+    uint32_t timeMs = keyframes_[keyframe].timeMs;
+    uint32_t inputs = keyframes_[keyframe].inputIndex;
+    game.setClock(timeMs);
+    ByteReader in(data_ + pos, streamEnd_ - pos);
+    uint8_t state[Game::kMaxStateSize];
+
+    while (in.remaining() > 0 && inputs < stopInput) {
+        size_t recordStart = in.position();
+        uint8_t tag = in.getU8();
+        uint8_t type = tag & 0x0f;
+        if (type == kKeyframeTag) {
+            in.getVarint();
+            size_t length = static_cast<size_t>(in.getVarint());
+            const uint8_t* recorded = in.getBytes(length);
+            if (checkKeyframes && recorded) {
+                ByteWriter out(state, sizeof(state));
+                game.writeState(out);
+                if (out.size() != length || memcmp(state, recorded, length) != 0) {
+                    aout << "Replay diverges at keyframe offset " << pos + recordStart << std::endl;
+                    return false;
+                }
+            }
+            continue;
+        }
+
+        uint32_t delta = tag >> 4;
+        if (delta == kInlineDeltaLimit) {
+            delta = static_cast<uint32_t>(in.getVarint());
+        }
+        uint32_t count = type == static_cast<uint8_t>(ReplayInput::Tick) ? static_cast<uint32_t>(in.getVarint()) : 1;
+        if (!in.ok() || type >= static_cast<uint8_t>(ReplayInput::Count) || count == 0) {
+            return false;
+        }
+
+        // A run may be cut short by either limit
+        uint32_t previousMs = timeMs;
+        timeMs += delta;
+        for (uint32_t i = 1; i <= count; ++i) {
+            uint32_t inputMs = tickTime(previousMs, timeMs, i, count);
+            if (inputs == stopInput || inputMs > stopTimeMs) {
+                return true;
+            }
+            game.setClock(inputMs);
+            applyReplayInput(game, static_cast<ReplayInput>(type));
+            inputs++;
+        }
+    }
+    return in.ok();
+}
+
+bool ReplayReader::seek(Game& game, uint32_t timeMs) const {
+    if (keyframes_.empty()) {
+        return false;
+    }
+    auto it = std::upper_bound(keyframes_.begin(), keyframes_.end(), timeMs,
+                               [](uint32_t t, const ReplayKeyframe& keyframe) { return t < keyframe.timeMs; });
+    size_t keyframe = it == keyframes_.begin() ? 0 : static_cast<size_t>(it - keyframes_.begin()) - 1;
+    return replayFrom(game, keyframe, UINT32_MAX, timeMs, false);
+}
+
+bool ReplayReader::seekToInput(Game& game, uint32_t inputIndex) const {
+    if (keyframes_.empty()) {
+        return false;
+    }
+    auto it = std::upper_bound(keyframes_.begin(), keyframes_.end(), inputIndex,
+                               [](uint32_t n, const ReplayKeyframe& keyframe) { return n < keyframe.inputIndex; });
+    size_t keyframe = it == keyframes_.begin() ? 0 : static_cast<size_t>(it - keyframes_.begin()) - 1;
+    return replayFrom(game, keyframe, inputIndex, UINT32_MAX, false);
+}
+
+bool ReplayReader::verify() const {
+    if (keyframes_.empty()) {
+        return false;
+    }
+    Game game(seed_, kind_);
+    return replayFrom(game, 0, UINT32_MAX, UINT32_MAX, true);
+}
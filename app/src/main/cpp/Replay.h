@@ -0,0 +1,198 @@
+#ifndef PALIBRIX_REPLAY_H
+#define PALIBRIX_REPLAY_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Game.h"
+
+/*!
+ * Replay file layout (all integers little-endian):
+ *
+ *   header   "PLRP", u16 version, u8 randomizer kind, u8 keyframe interval, u64 seed
+ *   stream   records until the index. Each starts with a tag byte: the low nibble is the
+ *            ReplayInput (or kKeyframeTag), the high nibble the milliseconds since the previous
+ *            input, with 15 meaning a varint delta follows. A Tick record stands for a run of
+ *            ticks and carries their varint count; its time is that of the last tick, and the
+ *            ones before it are spread evenly over the gap. Runs end at every other input and
+ *            at every tick that raised a game event, so keyframes still follow the input that
+ *            locked their piece and the statistics see every event at its own time. Keyframe
+ *            records carry varint pieces, varint length and a Game::writeState blob, taken
+ *            right after the input that locked every keyframe-interval-th piece. The first
+ *            keyframe holds the starting state.
+ *   index    one ReplayKeyframe per keyframe record (4 x u32)
+ *   footer   u32 index offset, u32 keyframe count, u32 input count, u32 duration ms, "PLRX"
+ *
+ * A file whose recording was cut short has no footer; the reader then rebuilds the index by
+ * scanning the stream.
+ */
+enum class ReplayInput : uint8_t {
+    Tick,       // Game::update, recorded in runs
+    MoveLeft,
+    MoveRight,
+    Rotate,
+    RotateLeft,
+    SoftDrop,
+    HardDrop,
+    Hold,
+    Count
+};
+
+struct ReplayKeyframe {
+    uint32_t inputIndex; // Inputs applied before this keyframe
+    uint32_t timeMs;
+    uint32_t offset;     // File offset of the keyframe record
+    uint32_t pieces;     // Pieces locked before this keyframe
+};
+
+/*!
+ * Applies a recorded input to the game.
+ */
+void applyReplayInput(Game& game, ReplayInput input);
+
+/*!
+ * Deletes the oldest .plr files in dir until at most maxFiles remain and they take at most
+ * maxBytes together. The newest file is always kept, so the recording that was just started
+ * survives. Files are aged by name, which starts with the start time. Returns the number deleted.
+ */
+int pruneReplays(const std::string& dir, size_t maxFiles, uint64_t maxBytes);
+
+/*!
+ * Records a game to disk while it is played. Records are appended to in-memory chunks and a
+ * background thread writes the filled ones, so the game thread never waits on storage unless
+ * the whole chunk ring is still in flight.
+ */
+class ReplayWriter {
+public:
+    using Clock = int64_t (*)(); // Monotonic milliseconds
+
+    static constexpr uint32_t kKeyframeInterval = 32; // Pieces between keyframes
+
+    static int64_t steadyMilliseconds();
+
+    explicit ReplayWriter(Clock clock = steadyMilliseconds);
+    ~ReplayWriter();
+
+    /*!
+     * Starts recording the game from its current state. Any previous recording is finished.
+     */
+    bool begin(const std::string& path, const Game& game);
+
+    /*!
+     * Records an input that was just applied to the game. Ticks are held back until their run
+     * ends.
+     */
+    void record(ReplayInput input, const Game& game);
+
+    /*!
+     * Hands everything recorded so far to the writer thread, e.g. when the app is paused.
+     */
+    void flush();
+
+    /*!
+     * Writes the index and footer and closes the file.
+     */
+    void finish();
+
+    bool isRecording() const { return file_ != nullptr; }
+
+private:
+    static constexpr size_t kChunkSize = 4096;
+    static constexpr size_t kChunkCount = 4;
+    static constexpr size_t kMaxKeyframes = 4096;
+
+    struct Chunk {
+        uint8_t data[kChunkSize];
+        size_t size;
+    };
+
+    void append(const uint8_t* data, size_t size);
+    void appendRecord(ReplayInput input, uint32_t timeMs, uint32_t ticks);
+    void endTickRun();
+    void submitChunk();
+    void writeKeyframe(const Game& game);
+    void writerLoop();
+
+    Clock clock_;
+    FILE* file_;
+    int64_t startTime_;
+    uint32_t lastTimeMs_; // Of the last record written
+    uint32_t runTicks_;   // Ticks recorded but not written yet
+    uint32_t runTimeMs_;  // Of the last of them
+    uint32_t inputCount_;
+    uint32_t pieces_;
+    uint32_t eventCursor_;
+    uint32_t bytesWritten_; // Logical file offset of the next appended byte
+    std::vector<ReplayKeyframe> keyframes_; // Reserved up front, never grows past kMaxKeyframes
+
+    // Chunk ring shared with the writer thread
+    Chunk chunks_[kChunkCount];
+    size_t fillChunk_;
+    size_t drainChunk_;
+    size_t queuedChunks_;
+    bool stopWriter_;
+    std::mutex lock_;
+    std::condition_variable chunkQueued_;
+    std::condition_variable chunkWritten_;
+    std::thread writerThread_;
+};
+
+/*!
+ * Memory-maps a replay file and restores the game at any point in it: the nearest keyframe at
+ * or before the target is loaded, then at most one keyframe interval of inputs is replayed.
+ */
+class ReplayReader {
+public:
+    ReplayReader();
+    ~ReplayReader();
+
+    bool open(const std::string& path);
+    void close();
+
+    uint64_t getSeed() const { return seed_; }
+    RandomizerKind getRandomizerKind() const { return kind_; }
+    uint32_t getInputCount() const { return inputCount_; }
+    uint32_t getDurationMs() const { return durationMs_; }
+    const std::vector<ReplayKeyframe>& getKeyframes() const { return keyframes_; }
+
+    /*!
+     * Puts the game in the state it had timeMs into the recording.
+     */
+    bool seek(Game& game, uint32_t timeMs) const;
+
+    /*!
+     * Puts the game in the state it had after the first inputIndex inputs.
+     */
+    bool seekToInput(Game& game, uint32_t inputIndex) const;
+
+    /*!
+     * Replays the whole file and checks that every keyframe matches the simulation, i.e. that
+     * the recording is consistent with the current game rules.
+     */
+    bool verify() const;
+
+private:
+    bool readFooter();
+    bool scanIndex();
+    bool loadKeyframe(Game& game, const ReplayKeyframe& keyframe, size_t& streamPos) const;
+    // Loads a keyframe and replays inputs until stopInput inputs were applied or the next one is
+    // later than stopTimeMs, optionally checking every keyframe passed on the way
+    bool replayFrom(Game& game, size_t keyframe, uint32_t stopInput, uint32_t stopTimeMs,
+                    bool checkKeyframes) const;
+
+    const uint8_t* data_;
+    size_t size_;
+    size_t streamEnd_;
+    uint64_t seed_;
+    RandomizerKind kind_;
+    uint32_t inputCount_;
+    uint32_t durationMs_;
+    std::vector<ReplayKeyframe> keyframes_;
+};
+
+#endif //PALIBRIX_REPLAY_H
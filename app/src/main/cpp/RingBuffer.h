@@ -0,0 +1,54 @@
+#ifndef PALIBRIX_RINGBUFFER_H
+#define PALIBRIX_RINGBUFFER_H
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+
+/*!
+ * Fixed-capacity FIFO that never allocates. Indexing is relative to the front, so it can stand
+ * in for a vector that is only ever popped at the front and pushed at the back.
+ *
+ * @tparam Capacity maximum element count, must be a power of two
+ */
+template <typename T, size_t Capacity>
+class RingBuffer {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    RingBuffer() : head_(0), size_(0) {}
+
+    void push_back(const T& value) {
+        assert(size_ < Capacity);
+        items_[(head_ + size_) & kMask] = value;
+        size_++;
+    }
+
+    void pop_front() {
+        assert(size_ > 0);
+        head_ = (head_ + 1) & kMask;
+        size_--;
+    }
+
+    const T& front() const { return items_[head_]; }
+    const T& operator[](size_t i) const { return items_[(head_ + i) & kMask]; }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    bool full() const { return size_ == Capacity; }
+    static constexpr size_t capacity() { return Capacity; }
+
+    void clear() {
+        head_ = 0;
+        size_ = 0;
+    }
+
+private:
+    static constexpr size_t kMask = Capacity - 1;
+
+    std::array<T, Capacity> items_;
+    size_t head_;
+    size_t size_;
+};
+
+#endif //PALIBRIX_RINGBUFFER_H
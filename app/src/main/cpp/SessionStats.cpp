@@ -0,0 +1,143 @@
+#include "SessionStats.h"
+#include "ByteStream.h"
+
+#include <algorithm>
+
+// Guideline garbage: lines sent for a combo of n clears is kComboAttack[n - 1]
+static constexpr int kComboAttack[] = {0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 4, 5};
+static constexpr int kComboAttackCount = sizeof(kComboAttack) / sizeof(kComboAttack[0]);
+static constexpr int kPerfectClearAttack = 10;
+
+StatsTracker::StatsTracker() {
+    reset();
+}
+
+void StatsTracker::reset() {
+    stats_ = SessionStats{};
+    backToBack_ = 0;
+    timeMs_ = 0;
+    second_ = 0;
+    std::fill(buckets_, buckets_ + kWindowSeconds, Bucket{0, 0});
+    window_ = {0, 0};
+}
+
+void StatsTracker::setTime(uint32_t timeMs) {
+    if (timeMs <= timeMs_) {
+        return;
+    }
+    timeMs_ = timeMs;
+
+    // Retire the buckets that fell out of the window; a long gap clears it at most once
+    uint32_t second = timeMs / 1000;
+    uint32_t steps = std::min<uint32_t>(second - second_, kWindowSeconds);
+    for (uint32_t i = 1; i <= steps; ++i) {
+        Bucket& bucket = buckets_[(second_ + i) % kWindowSeconds];
+        window_.pieces -= bucket.pieces;
+        window_.attack -= bucket.attack;
+        bucket = {0, 0};
+    }
+    second_ = second;
+    stats_.timeSeconds = timeMs / 1000.0;
+    updateRates();
+}
+
+void StatsTracker::onKey() {
+    stats_.keys++;
+    updateRates();
+}
+
+void StatsTracker::onPiece() {
+    stats_.pieces++;
+    buckets_[second_ % kWindowSeconds].pieces++;
+    window_.pieces++;
+    updateRates();
+}
+
+void StatsTracker::onClear(int lines, bool tSpin, int combo, bool perfectClear) {
+    int attack;
+    ClearType type;
+    if (tSpin) {
+        static constexpr int kTSpinAttack[] = {0, 2, 4, 6};
+        lines = std::min(lines, 3);
+        attack = kTSpinAttack[lines];
+        type = static_cast<ClearType>(static_cast<int>(ClearType::TSpinMini) + lines);
+    } else {
+        static constexpr int kLineAttack[] = {0, 0, 1, 2, 4};
+        lines = std::min(lines, 4);
+        attack = kLineAttack[lines];
+        type = static_cast<ClearType>(lines - 1);
+    }
+    stats_.clears[static_cast<int>(type)]++;
+
+    if (lines > 0) {
+        // Tetrises and T-spin clears keep the back-to-back chain, any other clear breaks it
+        bool difficult = tSpin || lines == 4;
+        if (difficult) {
+            attack += backToBack_ > 0 ? 1 : 0;
+            backToBack_++;
+            stats_.maxBackToBack = std::max(stats_.maxBackToBack, backToBack_);
+        } else {
+            backToBack_ = 0;
+        }
+        attack += kComboAttack[std::min(combo, kComboAttackCount) - 1];
+        stats_.maxCombo = std::max(stats_.maxCombo, combo);
+    }
+    if (perfectClear) {
+        stats_.clears[static_cast<int>(ClearType::PerfectClear)]++;
+        attack += kPerfectClearAttack;
+    }
+
+    stats_.attack += attack;
+    buckets_[second_ % kWindowSeconds].attack += attack;
+    window_.attack += attack;
+    updateRates();
+}
+
+void StatsTracker::onFinesseFaults(int faults) {
+    stats_.finesseFaults += faults;
+}
+
+void StatsTracker::updateRates() {
+    float seconds = static_cast<float>(stats_.timeSeconds);
+    // A window that has not filled yet covers only the time played so far
+    float windowSeconds = std::min(seconds, static_cast<float>(kWindowSeconds));
+    stats_.pps = seconds > 0.0f ? stats_.pieces / seconds : 0.0f;
+    stats_.apm = seconds > 0.0f ? stats_.attack * 60.0f / seconds : 0.0f;
+    stats_.kpp = stats_.pieces > 0 ? static_cast<float>(stats_.keys) / stats_.pieces : 0.0f;
+    stats_.recentPps = windowSeconds > 0.0f ? window_.pieces / windowSeconds : 0.0f;
+    stats_.recentApm = windowSeconds > 0.0f ? window_.attack * 60.0f / windowSeconds : 0.0f;
+}
+
+void StatsTracker::writeState(ByteWriter& out) const {
+    out.putVarint(stats_.pieces);
+    out.putVarint(stats_.keys);
+    out.putVarint(stats_.attack);
+    for (uint32_t count : stats_.clears) {
+        out.putVarint(count);
+    }
+    out.putVarint(static_cast<uint32_t>(stats_.maxCombo));
+    out.putVarint(static_cast<uint32_t>(stats_.maxBackToBack));
+    out.putVarint(static_cast<uint32_t>(backToBack_));
+}
+
+bool StatsTracker::readState(ByteReader& in) {
+    SessionStats stats{};
+    stats.pieces = static_cast<uint32_t>(in.getVarint());
+    stats.keys = static_cast<uint32_t>(in.getVarint());
+    stats.attack = static_cast<uint32_t>(in.getVarint());
+    for (uint32_t& count : stats.clears) {
+        count = static_cast<uint32_t>(in.getVarint());
+    }
+    stats.maxCombo = static_cast<int>(in.getVarint());
+    stats.maxBackToBack = static_cast<int>(in.getVarint());
+    int backToBack = static_cast<int>(in.getVarint());
+    if (!in.ok()) {
+        return false;
+    }
+
+    // The clock and window restart from the next setTime()
+    reset();
+    stats_ = stats;
+    backToBack_ = backToBack;
+    return true;
+}
@@ -0,0 +1,90 @@
+#ifndef PALIBRIX_SESSIONSTATS_H
+#define PALIBRIX_SESSIONSTATS_H
+
+#include <cstdint>
+
+class ByteWriter;
+class ByteReader;
+
+enum class ClearType : uint8_t {
+    Single, Double, Triple, Tetris,
+    TSpinMini,   // T-spin without lines
+    TSpinSingle, TSpinDouble, TSpinTriple,
+    PerfectClear, // Counted in addition to the clear that emptied the board
+    Count
+};
+
+/*!
+ * Competitive statistics of the current game, as shown on the HUD.
+ */
+struct SessionStats {
+    double timeSeconds;
+    uint32_t pieces;
+    uint32_t keys;   // Moves, rotations, drops and holds pressed by the player
+    uint32_t attack; // Garbage lines the clears would send (guideline table)
+    uint32_t finesseFaults;
+    uint32_t clears[static_cast<int>(ClearType::Count)];
+    int maxCombo;
+    int maxBackToBack;
+
+    float pps; // Pieces per second over the whole game
+    float apm; // Attack per minute over the whole game
+    float kpp; // Keys per piece
+    float recentPps; // Over the last StatsTracker::kWindowSeconds
+    float recentApm;
+};
+
+/*!
+ * Keeps SessionStats up to date as the game reports keys, pieces and clears. Every update is
+ * O(1): totals are counters, and the recent rates are running sums over a ring of one-second
+ * buckets, so nothing is ever rescanned however long the game runs.
+ */
+class StatsTracker {
+public:
+    static constexpr int kWindowSeconds = 10;
+
+    StatsTracker();
+
+    void reset();
+
+    /*!
+     * Advances the game clock; time only moves forward.
+     */
+    void setTime(uint32_t timeMs);
+
+    void onKey();
+    void onPiece();
+
+    /*!
+     * Records a line clear or T-spin. combo is the combo count including this clear.
+     */
+    void onClear(int lines, bool tSpin, int combo, bool perfectClear);
+
+    void onFinesseFaults(int faults);
+
+    const SessionStats& getStats() const { return stats_; }
+
+    /*!
+     * Totals only; the recent window and the finesse count are rebuilt as play continues.
+     */
+    void writeState(ByteWriter& out) const;
+    bool readState(ByteReader& in);
+
+private:
+    struct Bucket {
+        uint32_t pieces;
+        uint32_t attack;
+    };
+
+    void updateRates();
+
+    SessionStats stats_;
+    int backToBack_; // Consecutive Tetrises and T-spin clears
+
+    uint32_t timeMs_;
+    uint32_t second_; // Second the newest bucket covers
+    Bucket buckets_[kWindowSeconds];
+    Bucket window_;   // Sum of buckets_
+};
+
+#endif //PALIBRIX_SESSIONSTATS_H
@@ -1,37 +1,61 @@
 #include "Shader.h"
+#include "GlDispatch.h"
 #include "AndroidOut.h"
+#include <cstring>
 
-Shader::Shader(const char *vertexSource, const char *fragmentSource) {
+Shader::Shader(const char *vertexSource, const char *fragmentSource, ProgramCache* cache) {
     bool vertexOk, fragmentOk, programOk;
+    programId_ = 0;
     loaded_ = false;
+    deferred_ = false;
+    uniformCount_ = 0;
+
+    if (cache) {
+        programId_ = cache->load(vertexSource, fragmentSource);
+        if (programId_ != 0) {
+            loaded_ = true;
+            aout << "Shader loaded from cache. ID: " << programId_ << std::endl;
+            return;
+        }
+        if (!cache->reserveCompile()) {
+            deferred_ = true;
+            return;
+        }
+    }
 
     // 1. compile shaders
     GLuint vertex, fragment;
     // vertex shader
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vertexSource, NULL);
-    glCompileShader(vertex);
+    vertex = gl.CreateShader(GL_VERTEX_SHADER);
+    gl.ShaderSource(vertex, 1, &vertexSource, NULL);
+    gl.CompileShader(vertex);
     vertexOk = checkCompileErrors(vertex, "VERTEX");
 
     // fragment Shader
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fragmentSource, NULL);
-    glCompileShader(fragment);
+    fragment = gl.CreateShader(GL_FRAGMENT_SHADER);
+    gl.ShaderSource(fragment, 1, &fragmentSource, NULL);
+    gl.CompileShader(fragment);
     fragmentOk = checkCompileErrors(fragment, "FRAGMENT");
 
     if (vertexOk && fragmentOk) {
         // shader Program
-        programId_ = glCreateProgram();
-        glAttachShader(programId_, vertex);
-        glAttachShader(programId_, fragment);
-        glLinkProgram(programId_);
+        programId_ = gl.CreateProgram();
+        gl.AttachShader(programId_, vertex);
+        gl.AttachShader(programId_, fragment);
+        if (cache) {
+            gl.ProgramParameteri(programId_, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+        gl.LinkProgram(programId_);
         programOk = checkCompileErrors(programId_, "PROGRAM");
         loaded_ = programOk;
+        if (loaded_ && cache) {
+            cache->store(programId_, vertexSource, fragmentSource);
+        }
     }
 
     // delete the shaders as they're linked into our program now and no longer necessary
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
+    gl.DeleteShader(vertex);
+    gl.DeleteShader(fragment);
 
     if (loaded_) {
         aout << "Shader loaded successfully. ID: " << programId_ << std::endl;
@@ -42,58 +66,84 @@ Shader::Shader(const char *vertexSource, const char *fragmentSource) {
 
 Shader::~Shader() {
     if (loaded_) {
-        glDeleteProgram(programId_);
+        gl.DeleteProgram(programId_);
     }
 }
 
+void Shader::abandon() {
+    programId_ = 0;
+    loaded_ = false;
+    uniformCount_ = 0;
+}
+
+ProgramStatus Shader::getStatus() const {
+    if (loaded_) return ProgramStatus::Ready;
+    return deferred_ ? ProgramStatus::Deferred : ProgramStatus::Failed;
+}
+
 void Shader::use() const {
     if (loaded_) {
-        glUseProgram(programId_);
+        gl.UseProgram(programId_);
     }
 }
 
 void Shader::unuse() const {
-    glUseProgram(0);
+    gl.UseProgram(0);
+}
+
+void Shader::setBool(const char *name, bool value) {
+    if(loaded_) gl.Uniform1i(getUniformLocation(name), (int)value);
 }
 
-void Shader::setBool(const std::string &name, bool value) {
-    if(loaded_) glUniform1i(glGetUniformLocation(programId_, name.c_str()), (int)value);
+void Shader::setInt(const char *name, int value) {
+    if(loaded_) gl.Uniform1i(getUniformLocation(name), value);
 }
 
-void Shader::setInt(const std::string &name, int value) {
-    if(loaded_) glUniform1i(glGetUniformLocation(programId_, name.c_str()), value);
+void Shader::setFloat(const char *name, float value) {
+    if(loaded_) gl.Uniform1f(getUniformLocation(name), value);
 }
 
-void Shader::setFloat(const std::string &name, float value) {
-    if(loaded_) glUniform1f(glGetUniformLocation(programId_, name.c_str()), value);
+void Shader::setVec2(const char *name, float x, float y) {
+    if(loaded_) gl.Uniform2f(getUniformLocation(name), x, y);
 }
 
-void Shader::setVec2(const std::string &name, float x, float y) {
-    if(loaded_) glUniform2f(glGetUniformLocation(programId_, name.c_str()), x, y);
+void Shader::setVec3(const char *name, float x, float y, float z) {
+    if(loaded_) gl.Uniform3f(getUniformLocation(name), x, y, z);
 }
 
-void Shader::setVec3(const std::string &name, float x, float y, float z) {
-    if(loaded_) glUniform3f(glGetUniformLocation(programId_, name.c_str()), x, y, z);
+void Shader::setMat4(const char *name, const float* mat) {
+    if(loaded_) gl.UniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, mat);
 }
 
-void Shader::setMat4(const std::string &name, const float* mat) {
-    if(loaded_) glUniformMatrix4fv(glGetUniformLocation(programId_, name.c_str()), 1, GL_FALSE, mat);
+GLint Shader::getUniformLocation(const char *name) {
+    // Callers pass string literals, so the pointer check almost always hits
+    for (int i = 0; i < uniformCount_; ++i) {
+        if (uniforms_[i].name == name || strcmp(uniforms_[i].name, name) == 0) {
+            return uniforms_[i].location;
+        }
+    }
+
+    GLint location = gl.GetUniformLocation(programId_, name);
+    if (uniformCount_ < kMaxCachedUniforms) {
+        uniforms_[uniformCount_++] = {name, location};
+    }
+    return location;
 }
 
 bool Shader::checkCompileErrors(GLuint shader, std::string type) {
     GLint success;
     GLchar infoLog[1024];
     if (type != "PROGRAM") {
-        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        gl.GetShaderiv(shader, GL_COMPILE_STATUS, &success);
         if (!success) {
-            glGetShaderInfoLog(shader, 1024, NULL, infoLog);
+            gl.GetShaderInfoLog(shader, 1024, NULL, infoLog);
             aout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << std::endl;
             return false;
         }
     } else {
-        glGetProgramiv(shader, GL_LINK_STATUS, &success);
+        gl.GetProgramiv(shader, GL_LINK_STATUS, &success);
         if (!success) {
-            glGetProgramInfoLog(shader, 1024, NULL, infoLog);
+            gl.GetProgramInfoLog(shader, 1024, NULL, infoLog);
             aout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << std::endl;
             return false;
         }
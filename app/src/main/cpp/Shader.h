@@ -4,10 +4,13 @@
 #include <GLES3/gl3.h>
 #include <string>
 
+#include "ProgramCache.h"
+
 class Shader {
 public:
-    // constructor reads and builds the shader
-    Shader(const char* vertexSource, const char* fragmentSource);
+    // constructor reads and builds the shader. With a cache the program is loaded from a stored
+    // binary when possible, and a compile beyond the frame's budget leaves the shader deferred
+    Shader(const char* vertexSource, const char* fragmentSource, ProgramCache* cache = nullptr);
     ~Shader();
 
     // activate/deactivate the shader
@@ -15,20 +18,38 @@ public:
     void unuse() const;
 
     // utility uniform functions
-    void setBool(const std::string &name, bool value);
-    void setInt(const std::string &name, int value);
-    void setFloat(const std::string &name, float value);
-    void setVec2(const std::string &name, float x, float y);
-    void setVec3(const std::string &name, float x, float y, float z);
-    void setMat4(const std::string &name, const float* mat);
+    void setBool(const char *name, bool value);
+    void setInt(const char *name, int value);
+    void setFloat(const char *name, float value);
+    void setVec2(const char *name, float x, float y);
+    void setVec3(const char *name, float x, float y, float z);
+    void setMat4(const char *name, const float* mat);
+
+    // cached glGetUniformLocation, no allocation and no driver call after the first lookup.
+    // name must outlive the shader, which string literals do
+    GLint getUniformLocation(const char *name);
+
+    // forget the program without deleting it, for when its context is already gone
+    void abandon();
 
     bool isLoaded() const { return loaded_; }
+    bool isDeferred() const { return deferred_; }
+    ProgramStatus getStatus() const;
     GLuint getProgram() const { return programId_; }
 
 private:
     GLuint programId_;
     bool loaded_;
+    bool deferred_;
     bool checkCompileErrors(GLuint shader, std::string type);
+
+    struct UniformSlot {
+        const char *name;
+        GLint location;
+    };
+    static constexpr int kMaxCachedUniforms = 16;
+    UniformSlot uniforms_[kMaxCachedUniforms];
+    int uniformCount_;
 };
 
 #endif //PALIBRIX_SHADER_H 
\ No newline at end of file
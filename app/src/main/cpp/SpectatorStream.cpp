@@ -0,0 +1,434 @@
+#include "SpectatorStream.h"
+#include "ByteStream.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Frame flags. The ones a tick usually needs fit in the first varint byte.
+enum : uint32_t {
+    kFramePose = 1u << 0,       // Rotation and x/y delta of the falling piece
+    kFrameSpawn = 1u << 1,      // New piece, absolute
+    kFrameCells = 1u << 2,      // Locked cells: fill type, then (row delta, XOR mask) pairs
+    kFrameClear = 1u << 3,      // Cleared rows mask, applied after the cells
+    kFrameQueueShift = 1u << 4, // Queue moved up by one, new tail follows
+    kFrameScore = 1u << 5,      // Score, lines, level and combo deltas
+    kFrameHold = 1u << 6,       // Held type and canHold
+    kFrameKeyframe = 1u << 7,   // Everything, absolute
+    kFrameQueueFull = 1u << 8,  // Queue count and types
+    kFrameGameOver = 1u << 9,
+};
+
+constexpr int kPieceBias = 4; // Bounding boxes can start left of or above the board
+
+uint64_t zigzag(int value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(static_cast<int64_t>(value) >> 63);
+}
+
+int unzigzag(uint64_t value) {
+    return static_cast<int>(static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1));
+}
+
+uint16_t rowMask(const std::array<TetrominoType, BOARD_WIDTH>& row) {
+    uint16_t mask = 0;
+    for (int x = 0; x < BOARD_WIDTH; ++x) {
+        mask |= row[x] != TetrominoType::EMPTY ? 1u << x : 0u;
+    }
+    return mask;
+}
+
+// type | rotation << 3 | (x + bias) << 5 | (y + bias) << 9
+uint64_t packPiece(const Tetromino& piece) {
+    return static_cast<uint64_t>(piece.type) | static_cast<uint64_t>(piece.rotation) << 3
+           | static_cast<uint64_t>(piece.x + kPieceBias) << 5 | static_cast<uint64_t>(piece.y + kPieceBias) << 9;
+}
+
+bool unpackPiece(uint64_t value, Tetromino& piece) {
+    piece.type = static_cast<TetrominoType>(value & 7);
+    piece.rotation = static_cast<int>(value >> 3 & 3);
+    piece.x = static_cast<int>(value >> 5 & 15) - kPieceBias;
+    piece.y = static_cast<int>(value >> 9 & 31) - kPieceBias;
+    return piece.type != TetrominoType::EMPTY && piece.y < BOARD_HEIGHT;
+}
+
+bool validType(uint64_t value) {
+    return value <= static_cast<uint64_t>(TetrominoType::EMPTY);
+}
+
+// Removes the rows in mask and drops the ones above, as Game::clearLines does
+void removeRows(Game::Board& board, uint32_t mask) {
+    int to = BOARD_HEIGHT - 1;
+    for (int from = BOARD_HEIGHT - 1; from >= 0; --from) {
+        if (!(mask & 1u << from)) {
+            board[to--] = board[from];
+        }
+    }
+    for (; to >= 0; --to) {
+        board[to].fill(TetrominoType::EMPTY);
+    }
+}
+
+} // namespace
+
+SpectatorView SpectatorView::capture(const Game& game) {
+    SpectatorView view;
+    view.board = game.getBoard();
+    view.piece = game.getCurrentPiece();
+    view.held = game.getHeldPiece();
+    view.canHold = game.canHold();
+    const Game::NextQueue& queue = game.getNextQueue();
+    view.nextCount = static_cast<uint8_t>(queue.size());
+    for (size_t i = 0; i < Game::NextQueue::capacity(); ++i) {
+        view.next[i] = i < queue.size() ? queue[i] : TetrominoType::EMPTY;
+    }
+    view.score = game.getScore();
+    view.lines = game.getLines();
+    view.level = game.getLevel();
+    view.combo = game.getCombo();
+    view.gameOver = game.isGameOver();
+    return view;
+}
+
+bool SpectatorView::operator==(const SpectatorView& other) const {
+    return board == other.board && piece.type == other.piece.type && piece.rotation == other.piece.rotation
+           && piece.x == other.piece.x && piece.y == other.piece.y && held == other.held
+           && canHold == other.canHold && nextCount == other.nextCount
+           && std::equal(next, next + nextCount, other.next) && score == other.score
+           && lines == other.lines && level == other.level && combo == other.combo
+           && gameOver == other.gameOver;
+}
+
+SpectatorEncoder::SpectatorEncoder() : last_(), eventCursor_(0), keyframe_(true) {}
+
+size_t SpectatorEncoder::encode(const Game& game, uint8_t* out) {
+    SpectatorView view = SpectatorView::capture(game);
+
+    // Body first, one byte in; the length prefix is written in front of it afterwards
+    uint8_t body[kMaxFrameSize];
+    ByteWriter writer(body, sizeof(body));
+    if (keyframe_ || !encodeDelta(game, view, writer)) {
+        writer = ByteWriter(body, sizeof(body));
+        encodeKeyframe(view, writer);
+        keyframe_ = false;
+    }
+    eventCursor_ = game.getEventCount();
+    last_ = view;
+    if (writer.size() == 0) {
+        return 0;
+    }
+
+    ByteWriter frame(out, kMaxFrameSize);
+    frame.putVarint(writer.size());
+    frame.putBytes(writer.data(), writer.size());
+    return frame.ok() ? frame.size() : 0;
+}
+
+bool SpectatorEncoder::encodeDelta(const Game& game, const SpectatorView& view, ByteWriter& out) {
+    if (game.getEventCount() - eventCursor_ > Game::kEventHistory || (last_.gameOver && !view.gameOver)) {
+        return false;
+    }
+    int locks = 0;
+    int clears = 0;
+    TetrominoType fill = TetrominoType::EMPTY;
+    uint32_t cleared = 0;
+    uint32_t cursor = eventCursor_;
+    game.consumeEvents(cursor, [&](const GameEvent& event) {
+        if (event.type == GameEventType::PieceLocked) {
+            locks++;
+            fill = event.piece.type;
+        } else if (event.type == GameEventType::LineClear) {
+            clears++;
+            cleared = event.rowMask;
+        }
+    });
+    if (locks > 1 || clears > 1) {
+        return false;
+    }
+
+    // The board before the clear: surviving rows moved back up, cleared rows as they were
+    // before the lock. Cells the clear removed do not need to be sent.
+    Game::Board before;
+    int from = BOARD_HEIGHT - 1;
+    for (int y = BOARD_HEIGHT - 1; y >= 0; --y) {
+        before[y] = cleared & 1u << y ? last_.board[y] : view.board[from--];
+    }
+    for (; from >= 0; --from) {
+        if (rowMask(view.board[from]) != 0) {
+            return false;
+        }
+    }
+
+    uint16_t masks[BOARD_HEIGHT];
+    bool cellsChanged = false;
+    for (int y = 0; y < BOARD_HEIGHT; ++y) {
+        masks[y] = 0;
+        for (int x = 0; x < BOARD_WIDTH; ++x) {
+            TetrominoType was = last_.board[y][x];
+            TetrominoType is = before[y][x];
+            if (was == is) {
+                continue;
+            }
+            // Only locking adds cells, all of the locked piece's type
+            if (was != TetrominoType::EMPTY || is != fill) {
+                return false;
+            }
+            masks[y] |= 1u << x;
+        }
+        cellsChanged = cellsChanged || masks[y] != 0;
+    }
+
+    uint32_t flags = 0;
+    const Tetromino& a = last_.piece;
+    const Tetromino& b = view.piece;
+    if (locks > 0 || a.type != b.type) {
+        flags |= kFrameSpawn;
+    } else if (a.rotation != b.rotation || a.x != b.x || a.y != b.y) {
+        flags |= kFramePose;
+    }
+    if (cellsChanged) {
+        flags |= kFrameCells;
+    }
+    if (cleared) {
+        flags |= kFrameClear;
+    }
+    if (view.held != last_.held || view.canHold != last_.canHold) {
+        flags |= kFrameHold;
+    }
+    bool queueChanged = view.nextCount != last_.nextCount
+                        || !std::equal(view.next, view.next + view.nextCount, last_.next);
+    if (queueChanged) {
+        bool shifted = view.nextCount == last_.nextCount && view.nextCount > 0
+                       && std::equal(view.next, view.next + view.nextCount - 1, last_.next + 1);
+        flags |= shifted ? kFrameQueueShift : kFrameQueueFull;
+    }
+    if (view.score != last_.score || view.lines != last_.lines || view.level != last_.level
+        || view.combo != last_.combo) {
+        flags |= kFrameScore;
+    }
+    if (view.gameOver && !last_.gameOver) {
+        flags |= kFrameGameOver;
+    }
+    if (flags == 0) {
+        return true;
+    }
+
+    out.putVarint(flags);
+    if (flags & kFramePose) {
+        // Gravity (dy = 1) fits one byte; sideways moves and rotations take two
+        uint64_t rotation = static_cast<uint64_t>((b.rotation - a.rotation) & 3);
+        out.putVarint(rotation | zigzag(b.y - a.y) << 2 | zigzag(b.x - a.x) << 8);
+    }
+    if (flags & kFrameSpawn) {
+        out.putVarint(packPiece(b));
+    }
+    if (flags & kFrameCells) {
+        out.putU8(static_cast<uint8_t>(fill));
+        int previous = -1;
+        for (int y = 0; y < BOARD_HEIGHT; ++y) {
+            if (masks[y]) {
+                out.putVarint(static_cast<uint64_t>(y - previous));
+                out.putVarint(masks[y]);
+                previous = y;
+            }
+        }
+        out.putVarint(0);
+    }
+    if (flags & kFrameClear) {
+        out.putVarint(cleared);
+    }
+    if (flags & kFrameQueueShift) {
+        out.putU8(static_cast<uint8_t>(view.next[view.nextCount - 1]));
+    }
+    if (flags & kFrameQueueFull) {
+        out.putU8(view.nextCount);
+        for (int i = 0; i < view.nextCount; ++i) {
+            out.putU8(static_cast<uint8_t>(view.next[i]));
+        }
+    }
+    if (flags & kFrameScore) {
+        out.putVarint(zigzag(view.score - last_.score));
+        out.putVarint(zigzag(view.lines - last_.lines));
+        out.putVarint(zigzag(view.level - last_.level));
+        out.putVarint(zigzag(view.combo - last_.combo));
+    }
+    if (flags & kFrameHold) {
+        out.putU8(static_cast<uint8_t>(static_cast<int>(view.held) | (view.canHold ? 8 : 0)));
+    }
+    return out.ok();
+}
+
+void SpectatorEncoder::encodeKeyframe(const SpectatorView& view, ByteWriter& out) {
+    uint32_t flags = kFrameKeyframe;
+    if (view.gameOver) {
+        flags |= kFrameGameOver;
+    }
+    out.putVarint(flags);
+    // Two cells per byte
+    for (int y = 0; y < BOARD_HEIGHT; ++y) {
+        for (int x = 0; x < BOARD_WIDTH; x += 2) {
+            out.putU8(static_cast<uint8_t>(static_cast<int>(view.board[y][x])
+                                           | static_cast<int>(view.board[y][x + 1]) << 4));
+        }
+    }
+    out.putVarint(packPiece(view.piece));
+    out.putU8(static_cast<uint8_t>(static_cast<int>(view.held) | (view.canHold ? 8 : 0)));
+    out.putU8(view.nextCount);
+    for (int i = 0; i < view.nextCount; ++i) {
+        out.putU8(static_cast<uint8_t>(view.next[i]));
+    }
+    out.putVarint(zigzag(view.score));
+    out.putVarint(zigzag(view.lines));
+    out.putVarint(zigzag(view.level));
+    out.putVarint(zigzag(view.combo));
+}
+
+SpectatorDecoder::SpectatorDecoder() : view_(), hasView_(false), failed_(false), frames_(0) {}
+
+size_t SpectatorDecoder::decodeFrame(const uint8_t* data, size_t size) {
+    if (failed_) {
+        return 0;
+    }
+    ByteReader in(data, size);
+    uint64_t length = in.getVarint();
+    if (in.ok() && length >= SpectatorEncoder::kMaxFrameSize) {
+        failed_ = true; // Garbage rather than a frame still arriving
+    }
+    if (!in.ok() || length > in.remaining() || failed_) {
+        return 0;
+    }
+    ByteReader body(data + in.position(), static_cast<size_t>(length));
+    if (length == 0 || !decodeBody(body) || !body.ok() || body.remaining() != 0) {
+        failed_ = true;
+        return 0;
+    }
+    frames_++;
+    return in.position() + static_cast<size_t>(length);
+}
+
+size_t SpectatorDecoder::consume(const uint8_t* data, size_t size) {
+    size_t used = 0;
+    while (size_t frame = decodeFrame(data + used, size - used)) {
+        used += frame;
+    }
+    return used;
+}
+
+bool SpectatorDecoder::decodeBody(ByteReader& in) {
+    uint64_t flags = in.getVarint();
+    if (flags & kFrameKeyframe) {
+        for (int y = 0; y < BOARD_HEIGHT; ++y) {
+            for (int x = 0; x < BOARD_WIDTH; x += 2) {
+                uint8_t cells = in.getU8();
+                if (!validType(cells & 15) || !validType(cells >> 4)) {
+                    return false;
+                }
+                view_.board[y][x] = static_cast<TetrominoType>(cells & 15);
+                view_.board[y][x + 1] = static_cast<TetrominoType>(cells >> 4);
+            }
+        }
+        bool piece = unpackPiece(in.getVarint(), view_.piece);
+        uint8_t hold = in.getU8();
+        if (!piece || !validType(hold & 7)) {
+            return false;
+        }
+        view_.held = static_cast<TetrominoType>(hold & 7);
+        view_.canHold = (hold & 8) != 0;
+        view_.nextCount = in.getU8();
+        if (view_.nextCount > Game::NextQueue::capacity()) {
+            return false;
+        }
+        for (int i = 0; i < view_.nextCount; ++i) {
+            uint8_t type = in.getU8();
+            if (!validType(type)) {
+                return false;
+            }
+            view_.next[i] = static_cast<TetrominoType>(type);
+        }
+        view_.score = unzigzag(in.getVarint());
+        view_.lines = unzigzag(in.getVarint());
+        view_.level = unzigzag(in.getVarint());
+        view_.combo = unzigzag(in.getVarint());
+        view_.gameOver = (flags & kFrameGameOver) != 0;
+        hasView_ = true;
+        return true;
+    }
+    if (!hasView_) {
+        return false;
+    }
+
+    if (flags & kFramePose) {
+        uint64_t pose = in.getVarint();
+        view_.piece.rotation = (view_.piece.rotation + static_cast<int>(pose & 3)) & 3;
+        view_.piece.y += unzigzag(pose >> 2 & 63);
+        view_.piece.x += unzigzag(pose >> 8);
+    }
+    if ((flags & kFrameSpawn) && !unpackPiece(in.getVarint(), view_.piece)) {
+        return false;
+    }
+    if (flags & kFrameCells) {
+        uint8_t fill = in.getU8();
+        if (!validType(fill)) {
+            return false;
+        }
+        int y = -1;
+        while (uint64_t step = in.getVarint()) {
+            y += static_cast<int>(step);
+            uint64_t mask = in.getVarint();
+            if (step > BOARD_HEIGHT || y >= BOARD_HEIGHT || mask >> BOARD_WIDTH) {
+                return false;
+            }
+            for (int x = 0; x < BOARD_WIDTH; ++x) {
+                if (mask & 1u << x) {
+                    view_.board[y][x] = static_cast<TetrominoType>(fill);
+                }
+            }
+        }
+    }
+    if (flags & kFrameClear) {
+        uint64_t cleared = in.getVarint();
+        if (cleared >> BOARD_HEIGHT) {
+            return false;
+        }
+        removeRows(view_.board, static_cast<uint32_t>(cleared));
+    }
+    if (flags & kFrameQueueShift) {
+        uint8_t tail = in.getU8();
+        if (view_.nextCount == 0 || !validType(tail)) {
+            return false;
+        }
+        std::memmove(view_.next, view_.next + 1, (view_.nextCount - 1) * sizeof(view_.next[0]));
+        view_.next[view_.nextCount - 1] = static_cast<TetrominoType>(tail);
+    }
+    if (flags & kFrameQueueFull) {
+        view_.nextCount = in.getU8();
+        if (view_.nextCount > Game::NextQueue::capacity()) {
+            return false;
+        }
+        for (int i = 0; i < view_.nextCount; ++i) {
+            uint8_t type = in.getU8();
+            if (!validType(type)) {
+                return false;
+            }
+            view_.next[i] = static_cast<TetrominoType>(type);
+        }
+    }
+    if (flags & kFrameScore) {
+        view_.score += unzigzag(in.getVarint());
+        view_.lines += unzigzag(in.getVarint());
+        view_.level += unzigzag(in.getVarint());
+        view_.combo += unzigzag(in.getVarint());
+    }
+    if (flags & kFrameHold) {
+        uint8_t hold = in.getU8();
+        if (!validType(hold & 7)) {
+            return false;
+        }
+        view_.held = static_cast<TetrominoType>(hold & 7);
+        view_.canHold = (hold & 8) != 0;
+    }
+    if (flags & kFrameGameOver) {
+        view_.gameOver = true;
+    }
+    return true;
+}
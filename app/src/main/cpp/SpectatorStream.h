@@ -0,0 +1,97 @@
+#ifndef PALIBRIX_SPECTATORSTREAM_H
+#define PALIBRIX_SPECTATORSTREAM_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Game.h"
+
+/*!
+ * What a spectator sees of a game: the board, the falling piece, hold, the next queue and the
+ * score line. The ghost piece follows from the board and the piece.
+ */
+struct SpectatorView {
+    Game::Board board;
+    Tetromino piece;
+    TetrominoType held;
+    bool canHold;
+    uint8_t nextCount;
+    TetrominoType next[Game::NextQueue::capacity()];
+    int score;
+    int lines;
+    int level;
+    int combo;
+    bool gameOver;
+
+    static SpectatorView capture(const Game& game);
+    bool operator==(const SpectatorView& other) const;
+    bool operator!=(const SpectatorView& other) const { return !(*this == other); }
+};
+
+/*!
+ * Encodes a running game into a stream of per-tick frames for spectators and recorders. Each
+ * frame holds only what changed since the previous one, as varints:
+ *  - piece moves as rotation and x/y deltas, a spawned piece with its type,
+ *  - locked cells as per-row XOR masks plus the locking piece's type, cleared rows as a mask,
+ *  - the next queue as a one-piece shift with the new tail, hold as one byte,
+ *  - score, lines, level and combo as deltas.
+ * A tick that changed nothing produces no frame, a gravity step three bytes. Anything the delta
+ * forms cannot express (the first frame, resets, missed events) is sent as a keyframe.
+ *
+ * Frames are length prefixed, so they can be cut out of a byte stream without parsing them.
+ */
+class SpectatorEncoder {
+public:
+    static constexpr size_t kMaxFrameSize = 192; // Keyframe, the largest frame, with its prefix
+
+    SpectatorEncoder();
+
+    /*!
+     * Call once per tick or input, after it was applied. Writes a frame to out (at least
+     * kMaxFrameSize bytes) and returns its size, 0 if nothing visible changed.
+     */
+    size_t encode(const Game& game, uint8_t* out);
+
+    void requestKeyframe() { keyframe_ = true; } // E.g. when a spectator joins mid-game
+
+private:
+    bool encodeDelta(const Game& game, const SpectatorView& view, ByteWriter& out);
+    void encodeKeyframe(const SpectatorView& view, ByteWriter& out);
+
+    SpectatorView last_;
+    uint32_t eventCursor_;
+    bool keyframe_;
+};
+
+/*!
+ * Rebuilds the view from SpectatorEncoder frames.
+ */
+class SpectatorDecoder {
+public:
+    SpectatorDecoder();
+
+    /*!
+     * Decodes the frame at the start of data and returns its size, or 0 if data does not hold
+     * a whole frame yet. A malformed frame or a delta before the first keyframe sets failed(),
+     * after which nothing more is decoded.
+     */
+    size_t decodeFrame(const uint8_t* data, size_t size);
+
+    // Decodes all complete frames and returns the bytes they took; a partial frame is left over
+    size_t consume(const uint8_t* data, size_t size);
+
+    bool hasView() const { return hasView_; }
+    bool failed() const { return failed_; }
+    const SpectatorView& getView() const { return view_; }
+    uint32_t getFrameCount() const { return frames_; }
+
+private:
+    bool decodeBody(ByteReader& in);
+
+    SpectatorView view_;
+    bool hasView_;
+    bool failed_;
+    uint32_t frames_;
+};
+
+#endif //PALIBRIX_SPECTATORSTREAM_H
@@ -0,0 +1,220 @@
+#include "TaskScheduler.h"
+#include "AndroidOut.h"
+
+#include <algorithm>
+#include <chrono>
+#include <new>
+
+namespace {
+
+// Each frame is preceded by the pool it came from (nullptr for the heap)
+constexpr size_t kFrameHeader = alignof(std::max_align_t);
+
+constexpr auto sleepsLonger = [](const auto& a, const auto& b) {
+    return a.wakeTick != b.wakeTick ? a.wakeTick > b.wakeTick : a.order > b.order;
+};
+
+} // namespace
+
+FramePool::FramePool(size_t blocks)
+        : storage_(new std::max_align_t[blocks * kBlockSize / sizeof(std::max_align_t)]),
+          blockCount_(blocks), free_(nullptr), inUse_(0), heapFrames_(0) {
+    auto* bytes = reinterpret_cast<unsigned char*>(storage_.get());
+    for (size_t i = blocks; i-- > 0;) {
+        auto* block = reinterpret_cast<FreeBlock*>(bytes + i * kBlockSize);
+        block->next = free_;
+        free_ = block;
+    }
+}
+
+void* FramePool::allocate(size_t size) {
+    unsigned char* block;
+    FramePool* owner = this;
+    if (size + kFrameHeader <= kBlockSize && free_) {
+        block = reinterpret_cast<unsigned char*>(free_);
+        free_ = free_->next;
+        inUse_++;
+    } else {
+        block = static_cast<unsigned char*>(::operator new(size + kFrameHeader));
+        owner = nullptr;
+        heapFrames_++;
+    }
+    *reinterpret_cast<FramePool**>(block) = owner;
+    return block + kFrameHeader;
+}
+
+void FramePool::release(void* frame) {
+    unsigned char* block = static_cast<unsigned char*>(frame) - kFrameHeader;
+    FramePool* owner = *reinterpret_cast<FramePool**>(block);
+    if (!owner) {
+        ::operator delete(block);
+        return;
+    }
+    auto* freed = reinterpret_cast<FreeBlock*>(block);
+    freed->next = owner->free_;
+    owner->free_ = freed;
+    owner->inUse_--;
+}
+
+Task::promise_type::~promise_type() {
+    if (scheduler) {
+        scheduler->unlink(*this);
+    }
+}
+
+Task::~Task() {
+    // Never spawned
+    if (handle_) {
+        handle_.destroy();
+    }
+}
+
+TaskScheduler::TaskScheduler(size_t frameBlocks)
+        : pool_(frameBlocks), tick_(0), sleepOrder_(0), waiters_(), tasks_(nullptr), taskCount_(0) {
+    // A task sleeps at most once at a time, so this only grows with heap-allocated frames
+    sleepers_.reserve(frameBlocks);
+}
+
+TaskScheduler::~TaskScheduler() {
+    cancelAll();
+}
+
+void TaskScheduler::spawn(Task task) {
+    std::coroutine_handle<Task::promise_type> handle = task.handle_;
+    task.handle_ = nullptr;
+    link(handle.promise());
+    handle.resume();
+}
+
+void TaskScheduler::cancelAll() {
+    // Forget the wake-ups first; destroying a frame destroys the awaiter inside it
+    sleepers_.clear();
+    for (WaitList& list : waiters_) {
+        list = {};
+    }
+    while (tasks_) {
+        std::coroutine_handle<Task::promise_type>::from_promise(*tasks_).destroy();
+    }
+}
+
+void TaskScheduler::advance() {
+    tick_++;
+    while (!sleepers_.empty() && sleepers_.front().wakeTick <= tick_) {
+        std::pop_heap(sleepers_.begin(), sleepers_.end(), sleepsLonger);
+        std::coroutine_handle<> handle = sleepers_.back().handle;
+        sleepers_.pop_back();
+        handle.resume();
+    }
+}
+
+void TaskScheduler::signal(const GameEvent& event) {
+    resumeAll(waiters_[listFor(event.type)], event);
+    resumeAll(waiters_[kAnyEvent], event);
+}
+
+void TaskScheduler::sleep(std::coroutine_handle<> handle, uint64_t ticks) {
+    sleepers_.push_back({tick_ + ticks, sleepOrder_++, handle});
+    std::push_heap(sleepers_.begin(), sleepers_.end(), sleepsLonger);
+}
+
+void TaskScheduler::wait(EventAwaiter& awaiter) {
+    WaitList& list = waiters_[awaiter.list];
+    awaiter.next = nullptr;
+    if (list.tail) {
+        list.tail->next = &awaiter;
+    } else {
+        list.head = &awaiter;
+    }
+    list.tail = &awaiter;
+}
+
+void TaskScheduler::resumeAll(WaitList& list, const GameEvent& event) {
+    // Detach first: resumed tasks that wait again belong to the next signal
+    EventAwaiter* awaiter = list.head;
+    list = {};
+    while (awaiter) {
+        EventAwaiter* next = awaiter->next;
+        awaiter->event = event;
+        awaiter->handle.resume(); // May end the task and free the awaiter
+        awaiter = next;
+    }
+}
+
+void TaskScheduler::link(Task::promise_type& promise) {
+    promise.scheduler = this;
+    promise.previous = nullptr;
+    promise.next = tasks_;
+    if (tasks_) {
+        tasks_->previous = &promise;
+    }
+    tasks_ = &promise;
+    taskCount_++;
+}
+
+void TaskScheduler::unlink(Task::promise_type& promise) {
+    if (promise.previous) {
+        promise.previous->next = promise.next;
+    } else {
+        tasks_ = promise.next;
+    }
+    if (promise.next) {
+        promise.next->previous = promise.previous;
+    }
+    promise.scheduler = nullptr;
+    taskCount_--;
+}
+
+namespace {
+
+Task sleeper(TaskScheduler& scheduler, uint64_t period, uint64_t& resumes) {
+    for (;;) {
+        co_await scheduler.ticks(period);
+        resumes++;
+    }
+}
+
+Task waiter(TaskScheduler& scheduler, GameEventType type, uint64_t& resumes) {
+    for (;;) {
+        co_await scheduler.event(type);
+        resumes++;
+    }
+}
+
+} // namespace
+
+void TaskScheduler::benchmark() {
+    constexpr uint64_t kTicks = 1000000;
+    constexpr int kSleepers = 192;
+    constexpr int kWaiters = 64;
+
+    auto run = [](TaskScheduler& scheduler) {
+        GameEvent lock{};
+        lock.type = GameEventType::PieceLocked;
+        auto start = std::chrono::steady_clock::now();
+        for (uint64_t tick = 0; tick < kTicks; ++tick) {
+            scheduler.advance();
+            if (tick % 40 == 0) {
+                scheduler.signal(lock); // About a piece every 40 ticks
+            }
+        }
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / kTicks;
+    };
+
+    TaskScheduler empty(1);
+    double emptyNs = run(empty);
+
+    // Mostly long sleeps (countdowns, delays of seconds), a few short ones and event waiters
+    uint64_t resumes = 0;
+    TaskScheduler scheduler(kSleepers + kWaiters);
+    for (int i = 0; i < kSleepers; ++i) {
+        scheduler.spawn(sleeper(scheduler, i % 8 == 0 ? 1 + i % 5 : 600 + i * 7, resumes));
+    }
+    for (int i = 0; i < kWaiters; ++i) {
+        scheduler.spawn(waiter(scheduler, i % 2 ? GameEventType::PieceLocked : GameEventType::LineClear, resumes));
+    }
+    double loadedNs = run(scheduler); // The tasks count their resumes
+
+    aout << "Scheduler: " << scheduler.getTaskCount() << " tasks, " << loadedNs << " ns/tick ("
+         << emptyNs << " empty), " << static_cast<double>(resumes) / kTicks << " resumes/tick, "
+         << scheduler.getPool().getHeapFrames() << " heap frames" << std::endl;
+}
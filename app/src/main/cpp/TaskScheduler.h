@@ -0,0 +1,208 @@
+#ifndef PALIBRIX_TASKSCHEDULER_H
+#define PALIBRIX_TASKSCHEDULER_H
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <vector>
+
+#include "Game.h"
+
+class TaskScheduler;
+
+/*!
+ * Fixed-size blocks for coroutine frames, carved from one allocation made up front. Frames that
+ * do not fit a block, or arrive when all blocks are taken, fall back to the heap and are counted.
+ */
+class FramePool {
+public:
+    static constexpr size_t kBlockSize = 512;
+
+    explicit FramePool(size_t blocks);
+
+    FramePool(const FramePool&) = delete;
+    FramePool& operator=(const FramePool&) = delete;
+
+    void* allocate(size_t size);
+    static void release(void* frame);
+
+    size_t getBlockCount() const { return blockCount_; }
+    size_t getBlocksInUse() const { return inUse_; }
+    uint64_t getHeapFrames() const { return heapFrames_; }
+
+private:
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    std::unique_ptr<std::max_align_t[]> storage_;
+    size_t blockCount_;
+    FreeBlock* free_;
+    size_t inUse_;
+    uint64_t heapFrames_;
+};
+
+/*!
+ * A sequence on the simulation thread, written as a coroutine:
+ *
+ *     Task lineClearDelay(TaskScheduler& scheduler) {
+ *         GameEvent clear = co_await scheduler.event(GameEventType::LineClear);
+ *         co_await scheduler.ticks(20);
+ *         ...
+ *     }
+ *     scheduler.spawn(lineClearDelay(scheduler));
+ *
+ * The scheduler must be the coroutine's first parameter (right after the object for member
+ * functions): its frame comes from that scheduler's pool, so starting a task during play does not
+ * touch the heap. Tasks run until their first co_await inside spawn() and free their frame when
+ * they return; the scheduler destroys the ones still suspended when it goes away.
+ */
+class Task {
+public:
+    struct promise_type {
+        template <typename... Args>
+        static void* operator new(size_t size, TaskScheduler& scheduler, Args&&...);
+        template <typename Self, typename... Args>
+        static void* operator new(size_t size, Self&, TaskScheduler& scheduler, Args&&...);
+        static void operator delete(void* frame, size_t) { FramePool::release(frame); }
+
+        promise_type() : scheduler(nullptr), previous(nullptr), next(nullptr) {}
+        ~promise_type();
+
+        Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+
+        // Live task list, so the scheduler can destroy suspended tasks
+        TaskScheduler* scheduler;
+        promise_type* previous;
+        promise_type* next;
+    };
+
+    Task(Task&& other) noexcept : handle_(other.handle_) { other.handle_ = nullptr; }
+    Task& operator=(Task&&) = delete;
+    ~Task();
+
+private:
+    friend class TaskScheduler;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+    std::coroutine_handle<promise_type> handle_; // Until spawned
+};
+
+/*!
+ * Runs Tasks on the simulation thread. Time is counted in simulation ticks (advance()) and tasks
+ * can also wait for game events (signal()). A suspended task costs nothing per tick: sleepers sit
+ * in a heap ordered by wake tick and event waiters in per-type lists, so advance() only looks at
+ * the earliest sleeper and signal() only at the tasks waiting for that event.
+ *
+ * Not thread safe; the owner serializes calls (GameSession does so under its lock).
+ */
+class TaskScheduler {
+public:
+    explicit TaskScheduler(size_t frameBlocks = 32);
+    ~TaskScheduler();
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    // Takes ownership of the task and runs it up to its first suspension
+    void spawn(Task task);
+
+    // Destroys every suspended task
+    void cancelAll();
+
+    // One simulation tick: resumes the tasks whose sleep ends now
+    void advance();
+
+    // Resumes the tasks waiting for this event type (or any event), in the order they started waiting
+    void signal(const GameEvent& event);
+
+    uint64_t getTick() const { return tick_; }
+    size_t getTaskCount() const { return taskCount_; }
+    const FramePool& getPool() const { return pool_; }
+
+    struct TickAwaiter {
+        TaskScheduler& scheduler;
+        uint64_t ticks;
+
+        bool await_ready() const { return ticks == 0; }
+        void await_suspend(std::coroutine_handle<> handle) { scheduler.sleep(handle, ticks); }
+        void await_resume() const {}
+    };
+
+    struct EventAwaiter {
+        TaskScheduler& scheduler;
+        int list; // Index into waiters_
+        GameEvent event;
+        std::coroutine_handle<> handle;
+        EventAwaiter* next;
+
+        bool await_ready() const { return false; }
+        void await_suspend(std::coroutine_handle<> waiting) { handle = waiting; scheduler.wait(*this); }
+        GameEvent await_resume() const { return event; }
+    };
+
+    // co_await ticks(n): resume n ticks from now; n = 0 continues at once
+    TickAwaiter ticks(uint64_t n) { return {*this, n}; }
+
+    // co_await event(type): resume at the next event of that type and return it
+    EventAwaiter event(GameEventType type) { return {*this, listFor(type), {}, nullptr, nullptr}; }
+    EventAwaiter event() { return {*this, kAnyEvent, {}, nullptr, nullptr}; } // Any type
+
+    /*!
+     * Cost of advance() with many suspended tasks, against an empty scheduler, and whether any
+     * frame missed the pool.
+     */
+    static void benchmark();
+
+private:
+    friend struct Task::promise_type;
+
+    static constexpr int kAnyEvent = 0;
+    static constexpr int kEventLists = static_cast<int>(GameEventType::LineClear) + 2; // Any, then each type
+
+    static int listFor(GameEventType type) { return static_cast<int>(type) + 1; }
+
+    struct Sleeper {
+        uint64_t wakeTick;
+        uint64_t order; // Same-tick sleepers wake in the order they went to sleep
+        std::coroutine_handle<> handle;
+    };
+
+    struct WaitList {
+        EventAwaiter* head;
+        EventAwaiter* tail;
+    };
+
+    void sleep(std::coroutine_handle<> handle, uint64_t ticks);
+    void wait(EventAwaiter& awaiter);
+    void resumeAll(WaitList& list, const GameEvent& event);
+    void link(Task::promise_type& promise);
+    void unlink(Task::promise_type& promise);
+
+    FramePool pool_;
+    uint64_t tick_;
+    uint64_t sleepOrder_;
+    std::vector<Sleeper> sleepers_; // Min-heap on (wakeTick, order); capacity reserved up front
+    WaitList waiters_[kEventLists];
+    Task::promise_type* tasks_;
+    size_t taskCount_;
+};
+
+template <typename... Args>
+void* Task::promise_type::operator new(size_t size, TaskScheduler& scheduler, Args&&...) {
+    return scheduler.pool_.allocate(size);
+}
+
+template <typename Self, typename... Args>
+void* Task::promise_type::operator new(size_t size, Self&, TaskScheduler& scheduler, Args&&...) {
+    return scheduler.pool_.allocate(size);
+}
+
+#endif //PALIBRIX_TASKSCHEDULER_H
@@ -1,13 +1,13 @@
 #ifndef PALIBRIX_TETROMINODATA_H
 #define PALIBRIX_TETROMINODATA_H
 
-#include <vector>
 #include "Game.h" // Include for the Mino struct definition
 
 // Rotation states for each tetromino type
 // Standard Tetris rotation data (SRS)
 // Coordinates are relative to a pivot point in a 3x3 or 4x4 grid.
-const std::vector<Mino> tetrominoShapes[7][4] = {
+// constexpr so that tables derived from the shapes can be built at compile time.
+constexpr Mino tetrominoShapes[7][4][4] = {
     // I (long bar)
     {
         {{0, 1}, {1, 1}, {2, 1}, {3, 1}}, // 0 deg (horizontal)
@@ -59,4 +59,15 @@ const std::vector<Mino> tetrominoShapes[7][4] = {
     }
 };
 
+// Block colors (RGB) for each tetromino type, indexed like tetrominoShapes
+const float tetrominoColors[7][3] = {
+    {0.0f, 1.0f, 1.0f}, // I - Cyan
+    {1.0f, 1.0f, 0.0f}, // O - Yellow
+    {0.6f, 0.2f, 0.8f}, // T - Purple
+    {0.0f, 0.3f, 1.0f}, // J - Blue
+    {1.0f, 0.5f, 0.0f}, // L - Orange
+    {0.0f, 0.8f, 0.0f}, // S - Green
+    {1.0f, 0.0f, 0.0f}  // Z - Red
+};
+
 #endif //PALIBRIX_TETROMINODATA_H 
\ No newline at end of file
@@ -0,0 +1,182 @@
+#include "TextRenderer.h"
+#include <cstring>
+
+// Characters present in the atlas, in atlas order
+static const char kGlyphChars[] = " 0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ:-.";
+constexpr int kGlyphCount = TextRenderer::kGlyphCount;
+static_assert(sizeof(kGlyphChars) - 1 == kGlyphCount, "one atlas cell per glyph");
+
+// 5x7 glyph bitmaps, one byte per row with bit 4 as the leftmost pixel
+static const uint8_t kGlyphBitmaps[kGlyphCount][7] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}, // ' '
+    {0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E}, // 0
+    {0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E}, // 1
+    {0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F}, // 2
+    {0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E}, // 3
+    {0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02}, // 4
+    {0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E}, // 5
+    {0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E}, // 6
+    {0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08}, // 7
+    {0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E}, // 8
+    {0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C}, // 9
+    {0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11}, // A
+    {0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E}, // B
+    {0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E}, // C
+    {0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C}, // D
+    {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F}, // E
+    {0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10}, // F
+    {0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F}, // G
+    {0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11}, // H
+    {0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E}, // I
+    {0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C}, // J
+    {0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11}, // K
+    {0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F}, // L
+    {0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11}, // M
+    {0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11}, // N
+    {0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, // O
+    {0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10}, // P
+    {0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D}, // Q
+    {0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11}, // R
+    {0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E}, // S
+    {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04}, // T
+    {0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E}, // U
+    {0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04}, // V
+    {0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A}, // W
+    {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11}, // X
+    {0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04}, // Y
+    {0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F}, // Z
+    {0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00}, // :
+    {0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00}, // -
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C}  // .
+};
+
+constexpr int kCellWidth = TextRenderer::kCellWidth;
+constexpr int kCellHeight = TextRenderer::kCellHeight;
+constexpr int kAtlasWidth = TextRenderer::kAtlasWidth;
+
+static uint32_t hashText(const char* text) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (; *text; ++text) {
+        hash = (hash ^ (uint8_t)*text) * 16777619u;
+    }
+    return hash;
+}
+
+static int glyphIndex(char c) {
+    for (int i = 0; i < kGlyphCount; ++i) {
+        if (kGlyphChars[i] == c) return i;
+    }
+    return 0; // Unknown characters render as a space
+}
+
+TextRenderer::TextRenderer() : vertexCount_(0), generation_(0), dirty_(false) {
+    for (auto& entry : layoutCache_) {
+        entry.used = false;
+    }
+}
+
+TextRenderer::~TextRenderer() = default;
+
+void TextRenderer::bakeAtlas(uint8_t* pixels) {
+    // Bake the bitmap font into a single channel coverage atlas
+    memset(pixels, 0, kAtlasWidth * kAtlasHeight);
+    for (int g = 0; g < kGlyphCount; ++g) {
+        for (int row = 0; row < 7; ++row) {
+            for (int col = 0; col < 5; ++col) {
+                if (kGlyphBitmaps[g][row] & (0x10 >> col)) {
+                    pixels[row * kAtlasWidth + g * kCellWidth + col] = 255;
+                }
+            }
+        }
+    }
+}
+
+void TextRenderer::setText(int slot, const char* text, float x, float y, float size,
+                           float r, float g, float b) {
+    if (slot < 0 || slot >= kMaxSlots) return;
+
+    Slot& s = slots_[slot];
+    if (strncmp(s.text, text, kMaxTextLength) == 0 && s.x == x && s.y == y && s.size == size
+        && s.color[0] == r && s.color[1] == g && s.color[2] == b) {
+        return;
+    }
+
+    strncpy(s.text, text, kMaxTextLength);
+    s.text[kMaxTextLength] = '\0';
+    s.x = x;
+    s.y = y;
+    s.size = size;
+    s.color[0] = r;
+    s.color[1] = g;
+    s.color[2] = b;
+    dirty_ = true;
+}
+
+const TextRenderer::LayoutEntry& TextRenderer::layoutFor(const char* text) {
+    LayoutEntry& entry = layoutCache_[hashText(text) % kLayoutCacheSize];
+    if (entry.used && strcmp(entry.key, text) == 0) {
+        return entry;
+    }
+
+    // Miss: lay the text out into this entry, replacing whatever hashed here before
+    strcpy(entry.key, text);
+    entry.glyphCount = 0;
+    entry.used = true;
+    float penX = 0.0f;
+    float penY = 0.0f;
+    for (const char* c = text; *c; ++c) {
+        if (*c == '\n') {
+            penX = 0.0f;
+            penY += 1.25f;
+            continue;
+        }
+        int glyph = glyphIndex(*c);
+        if (glyph != 0) { // Spaces only advance the pen
+            entry.glyphs[entry.glyphCount++] = {penX, penY, glyph};
+        }
+        penX += 1.0f;
+    }
+    return entry;
+}
+
+void TextRenderer::update() {
+    if (!dirty_) return;
+
+    float* out = vertices_;
+
+    for (const Slot& s : slots_) {
+        if (s.text[0] == '\0') continue;
+
+        const float cellH = s.size;
+        const float cellW = s.size * kCellWidth / kCellHeight;
+        const LayoutEntry& layout = layoutFor(s.text);
+        for (int i = 0; i < layout.glyphCount; ++i) {
+            const LayoutGlyph& lg = layout.glyphs[i];
+            float x0 = s.x + lg.x * cellW;
+            float y0 = s.y + lg.y * cellH;
+            float x1 = x0 + cellW;
+            float y1 = y0 + cellH;
+            float u0 = (float)(lg.glyph * kCellWidth) / kAtlasWidth;
+            float u1 = (float)((lg.glyph + 1) * kCellWidth) / kAtlasWidth;
+
+            const float quad[6][4] = {
+                {x0, y0, u0, 0.0f}, {x1, y1, u1, 1.0f}, {x0, y1, u0, 1.0f},
+                {x0, y0, u0, 0.0f}, {x1, y0, u1, 0.0f}, {x1, y1, u1, 1.0f}
+            };
+            for (const auto& v : quad) {
+                *out++ = v[0];
+                *out++ = v[1];
+                *out++ = v[2];
+                *out++ = v[3];
+                *out++ = s.color[0];
+                *out++ = s.color[1];
+                *out++ = s.color[2];
+            }
+        }
+    }
+
+    vertexCount_ = (int)((out - vertices_) / kFloatsPerVertex);
+    generation_++;
+    dirty_ = false;
+}
@@ -0,0 +1,89 @@
+#ifndef PALIBRIX_TEXTRENDERER_H
+#define PALIBRIX_TEXTRENDERER_H
+
+#include <cstdint>
+
+/*!
+ * Lays out HUD text as quads over a baked 5x7 bitmap glyph atlas; a render backend draws the
+ * vertices with the atlas from bakeAtlas().
+ *
+ * Text is assigned to numbered slots. A slot's quads are only re-emitted when its text or
+ * placement changes, and all slots share one vertex array meant for a single draw call. All
+ * storage is fixed-size, so changing text never allocates.
+ */
+class TextRenderer {
+public:
+    static constexpr int kMaxSlots = 16;
+    static constexpr int kMaxTextLength = 31; // Longer text is truncated
+    static constexpr int kFloatsPerVertex = 7; // x, y, u, v, r, g, b
+    static constexpr int kMaxVertices = kMaxSlots * kMaxTextLength * 6;
+
+    // Each glyph occupies a 6x8 texel cell in a single-row atlas, leaving a 1 texel gutter
+    static constexpr int kCellWidth = 6;
+    static constexpr int kCellHeight = 8;
+    static constexpr int kGlyphCount = 40;
+    static constexpr int kAtlasWidth = kGlyphCount * kCellWidth;
+    static constexpr int kAtlasHeight = kCellHeight;
+
+    TextRenderer();
+    ~TextRenderer();
+
+    /*!
+     * Writes the glyph coverage atlas, one byte per texel (0 or 255), kAtlasWidth * kAtlasHeight.
+     */
+    static void bakeAtlas(uint8_t* pixels);
+
+    /*!
+     * Sets the text shown in a slot. Supports upper case letters, digits, space, ':', '-', '.'
+     * and '\n'; anything else is drawn as a space.
+     * @param x left edge in world units
+     * @param y top edge in world units
+     * @param size glyph cell height in world units
+     */
+    void setText(int slot, const char* text, float x, float y, float size,
+                 float r, float g, float b);
+
+    /*!
+     * Re-emits the vertices if any slot changed since the last call.
+     */
+    void update();
+
+    // Six vertices per glyph, kFloatsPerVertex floats each
+    const float* getVertices() const { return vertices_; }
+    int getVertexCount() const { return vertexCount_; }
+    // Changes whenever the vertices do
+    uint32_t getGeneration() const { return generation_; }
+
+private:
+    struct LayoutGlyph {
+        float x, y; // In glyph cells, relative to the text origin
+        int glyph;
+    };
+
+    struct Slot {
+        char text[kMaxTextLength + 1] = {};
+        float x = 0, y = 0, size = 0;
+        float color[3] = {1, 1, 1};
+    };
+
+    // Direct-mapped layout cache entry, keyed by the full text
+    struct LayoutEntry {
+        char key[kMaxTextLength + 1];
+        LayoutGlyph glyphs[kMaxTextLength];
+        int glyphCount;
+        bool used;
+    };
+    static constexpr int kLayoutCacheSize = 64;
+
+    const LayoutEntry& layoutFor(const char* text);
+
+    Slot slots_[kMaxSlots];
+    LayoutEntry layoutCache_[kLayoutCacheSize];
+
+    float vertices_[kMaxVertices * kFloatsPerVertex];
+    int vertexCount_;
+    uint32_t generation_;
+    bool dirty_;
+};
+
+#endif //PALIBRIX_TEXTRENDERER_H
@@ -0,0 +1,170 @@
+#include "TrainingWorkload.h"
+#include "AllocAudit.h"
+#include "BoardFeatures.h"
+#include "Finesse.h"
+#include "Game.h"
+#include "Renderer.h"
+#include "Replay.h"
+#include "TetrominoData.h"
+
+#include <algorithm>
+#include <chrono>
+
+#if defined(PALIBRIX_PGO_GENERATE) && defined(__clang__)
+extern "C" int __llvm_profile_write_file(void);
+#endif
+
+constexpr int kMaxPiecesPerGame = 400;
+constexpr uint32_t kInputSpacingMs = 50; // Game clock advance per input, keeps the statistics deterministic
+
+namespace {
+
+struct Placement {
+    int rotation;
+    int x;
+};
+
+// Scores every reachable resting place of the current piece in one feature batch
+bool choosePlacement(const Game& game, BoardBatch& batch, BoardFeatureBatch& features, Placement& best) {
+    const Game::Board& board = game.getBoard();
+    const TetrominoType type = game.getCurrentPiece().type;
+    uint16_t rows[BOARD_HEIGHT];
+    packBoardRows(board, rows);
+
+    Placement candidates[kBoardBatchSize];
+    int lines[kBoardBatchSize];
+    batch.clear();
+    for (int rotation = 0; rotation < 4; ++rotation) {
+        for (int x = -3; x < BOARD_WIDTH; ++x) {
+            Tetromino piece{type, rotation, x, 0};
+            if (!game.canPlace(piece)) {
+                continue;
+            }
+            piece.y = game.getLandingRow(piece);
+            uint16_t after[BOARD_HEIGHT];
+            std::copy(rows, rows + BOARD_HEIGHT, after);
+            for (const Mino& mino : tetrominoShapes[static_cast<int>(type)][rotation]) {
+                after[piece.y + mino.y] |= 1u << (piece.x + mino.x);
+            }
+            int full = static_cast<int>(std::count(after, after + BOARD_HEIGHT, kBoardRowMask));
+            candidates[batch.count] = {rotation, x};
+            lines[batch.count] = full;
+            batch.add(after);
+        }
+    }
+    if (batch.count == 0) {
+        return false;
+    }
+
+    computeBoardFeatures(batch, features);
+    int bestScore = 0;
+    for (int i = 0; i < batch.count; ++i) {
+        int score = lines[i] * 80 - features.holes[i] * 50 - features.aggregateHeight[i] * 5
+                    - features.bumpiness[i] * 3 - features.maxWell[i] * 2;
+        if (i == 0 || score > bestScore) {
+            bestScore = score;
+            best = candidates[i];
+        }
+    }
+    return true;
+}
+
+uint64_t mix(uint64_t hash, uint64_t value) {
+    return (hash ^ value) * 0x100000001b3ull;
+}
+
+} // namespace
+
+TrainingResult runTrainingWorkload(int games, Renderer* renderer) {
+    TrainingResult result{};
+    auto start = std::chrono::steady_clock::now();
+
+    float previousTimeStep = 0.0f;
+    if (renderer) {
+        previousTimeStep = renderer->getFixedTimeStep();
+        renderer->setFixedTimeStep(1.0f / 60.0f);
+    }
+
+    BoardBatch batch;
+    BoardFeatureBatch features;
+    FinesseAnalyzer finesse;
+    uint64_t checksum = 0xcbf29ce484222325ull;
+
+    for (int gameIndex = 0; gameIndex < games; ++gameIndex) {
+        Game game(0x5eed0000ull + gameIndex);
+        finesse.begin(game);
+        uint32_t clockMs = 0;
+
+        // Same bookkeeping as GameSession::apply, minus recording and sound
+        auto apply = [&](ReplayInput input) {
+            ALLOC_AUDIT_SCOPE("training input");
+            clockMs += kInputSpacingMs;
+            game.setClock(clockMs);
+            applyReplayInput(game, input);
+            uint32_t graded = finesse.getPieces();
+            finesse.onInput(input, game);
+            if (finesse.getPieces() != graded) {
+                const FinesseResult& last = finesse.getLastResult();
+                game.addFinesseFaults(std::max(0, last.inputs - last.minimal));
+            }
+            result.inputs++;
+            if (renderer) {
+                renderer->render(game);
+                result.frames++;
+            }
+        };
+
+        for (int piece = 0; piece < kMaxPiecesPerGame && !game.isGameOver(); ++piece) {
+            if (piece % 7 == 3 && game.canHold()) {
+                apply(ReplayInput::Hold);
+            }
+            Placement target{0, SPAWN_X};
+            choosePlacement(game, batch, features, target);
+
+            if (target.rotation == 3) {
+                apply(ReplayInput::RotateLeft);
+            } else {
+                for (int i = 0; i < target.rotation; ++i) {
+                    apply(ReplayInput::Rotate);
+                }
+            }
+            // Taps with a gravity tick every third one, as when the player is slower than gravity
+            for (int guard = 0; guard < BOARD_WIDTH && game.getCurrentPiece().x != target.x; ++guard) {
+                apply(target.x < game.getCurrentPiece().x ? ReplayInput::MoveLeft : ReplayInput::MoveRight);
+                if (guard % 3 == 2) {
+                    apply(ReplayInput::Tick);
+                }
+            }
+            if (piece % 4 == 1) {
+                apply(ReplayInput::SoftDrop);
+                apply(ReplayInput::SoftDrop);
+            }
+            apply(ReplayInput::HardDrop);
+            result.pieces++;
+        }
+
+        checksum = mix(checksum, static_cast<uint64_t>(game.getScore()));
+        checksum = mix(checksum, static_cast<uint64_t>(game.getLines()));
+        uint16_t rows[BOARD_HEIGHT];
+        packBoardRows(game.getBoard(), rows);
+        for (uint16_t row : rows) {
+            checksum = mix(checksum, row);
+        }
+        result.games++;
+    }
+
+    if (renderer) {
+        renderer->setFixedTimeStep(previousTimeStep);
+    }
+    result.checksum = checksum;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+bool writeTrainingProfile() {
+#if defined(PALIBRIX_PGO_GENERATE) && defined(__clang__)
+    return __llvm_profile_write_file() == 0;
+#else
+    return false;
+#endif
+}
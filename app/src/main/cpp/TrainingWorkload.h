@@ -0,0 +1,35 @@
+#ifndef PALIBRIX_TRAININGWORKLOAD_H
+#define PALIBRIX_TRAININGWORKLOAD_H
+
+#include <cstdint>
+
+class Renderer;
+
+struct TrainingResult {
+    int games;
+    int pieces;
+    int inputs;
+    int frames;
+    uint64_t checksum; // Over final scores and boards; equal on every run with the same arguments
+    double seconds;
+};
+
+/*!
+ * Deterministic scripted gameplay for profile-guided builds and tick timing: plays fixed-seed
+ * games with a feature-scoring bot that moves pieces the way a player does (rotations, taps,
+ * soft drops, holds, gravity ticks in between), through the same input path as a session, with
+ * finesse grading. With a renderer (GL context current) a frame is drawn after every input.
+ *
+ * Runs anywhere the game sources build, so the same workload trains the device library and
+ * benchmarks host builds.
+ */
+TrainingResult runTrainingWorkload(int games, Renderer* renderer);
+
+/*!
+ * Instrumented builds (-DPALIBRIX_PGO=GENERATE) only: writes the profile counters gathered so
+ * far. Apps are rarely allowed to exit normally, which is when the runtime would write them
+ * itself. Returns false in other builds or when the write fails.
+ */
+bool writeTrainingProfile();
+
+#endif //PALIBRIX_TRAININGWORKLOAD_H
@@ -5,43 +5,38 @@ import android.opengl.GLSurfaceView
 import android.os.Bundle
 import android.os.Handler
 import android.os.Looper
+import android.os.SystemClock
 import android.view.MotionEvent
+import android.view.SurfaceHolder
 import android.widget.Button
 import android.widget.FrameLayout
-import android.widget.TextView
 import androidx.appcompat.app.AppCompatActivity
 import javax.microedition.khronos.egl.EGLConfig
 import javax.microedition.khronos.opengles.GL10
 
 import android.os.Vibrator
-import android.media.SoundPool
-import android.media.AudioAttributes
 import android.media.MediaPlayer
+import java.io.File
 
 class MainActivity : AppCompatActivity() {
 
     private lateinit var glSurfaceView: GLSurfaceView
-    private lateinit var scoreText: TextView
-    private lateinit var linesText: TextView
-    private lateinit var levelText: TextView
-    private lateinit var scoreTextBottom: TextView
-    private lateinit var linesTextBottom: TextView
-    private lateinit var levelTextBottom: TextView
-    private lateinit var comboTextBottom: TextView
     private lateinit var gameOverLayout: android.widget.RelativeLayout
     private lateinit var pauseLayout: android.widget.RelativeLayout
     private var isPaused = false
     private lateinit var vibrator: Vibrator
     private var currentLevel = 1
-    private var baseDropSpeed = 150L // 기본 속도 (ms)
     private var backgroundMusic: MediaPlayer? = null
-    private lateinit var soundPool: SoundPool
-    private var soundMap: HashMap<String, Int> = HashMap()
     private var gameOverSoundPlayed = false
+
+    // 네이티브 객체 핸들 (NativeBridge)
+    private var game = 0L
+    private var renderer = 0L
+    private var audio = 0L
     
     private val updateHandler = Handler(Looper.getMainLooper())
     
-    // UI update timer (100ms)
+    // Game state poll (100ms) - HUD text itself is drawn by the native renderer
     private val uiUpdateRunnable = object : Runnable {
         override fun run() {
             updateUI()
@@ -49,13 +44,22 @@ class MainActivity : AppCompatActivity() {
         }
     }
     
-    // Game drop timer (dynamic speed based on level)
-    private val gameDropRunnable = object : Runnable {
+    // 시뮬레이션 틱 (60Hz 고정). 낙하 속도는 네이티브의 레벨별 중력 곡선이 틱마다 정한다
+    private var tickOrigin = 0L
+    private var ticksRun = 0L
+    private val gameTickRunnable = object : Runnable {
         override fun run() {
             if (!isPaused) {
-                nativeUpdate() // Call native game update for automatic dropping
-                val dropSpeed = calculateDropSpeed()
-                updateHandler.postDelayed(this, dropSpeed) // Drop speed based on level
+                // 메인 스레드가 밀렸으면 놓친 틱을 따라잡되, 한 번에 MAX_CATCH_UP_TICKS 까지만
+                val due = (SystemClock.uptimeMillis() - tickOrigin) * TICK_RATE / 1000
+                if (due - ticksRun > MAX_CATCH_UP_TICKS) {
+                    ticksRun = due - MAX_CATCH_UP_TICKS
+                }
+                while (ticksRun < due) {
+                    NativeBridge.update(game)
+                    ticksRun++
+                }
+                updateHandler.postAtTime(this, tickOrigin + (ticksRun + 1) * 1000 / TICK_RATE)
             }
         }
     }
@@ -65,38 +69,22 @@ class MainActivity : AppCompatActivity() {
         setContentView(R.layout.activity_main)
 
         // Initialize UI elements
-        scoreText = findViewById(R.id.tv_score)
-        linesText = findViewById(R.id.tv_lines)
-        levelText = findViewById(R.id.tv_level)
-        scoreTextBottom = findViewById(R.id.tv_score_bottom)
-        linesTextBottom = findViewById(R.id.tv_lines_bottom)
-        levelTextBottom = findViewById(R.id.tv_level_bottom)
-        comboTextBottom = findViewById(R.id.tv_combo_bottom)
         gameOverLayout = findViewById(R.id.game_over_layout)
         pauseLayout = findViewById(R.id.pause_layout)
         vibrator = getSystemService(Context.VIBRATOR_SERVICE) as Vibrator
 
-        // 효과음 초기화
-        val audioAttributes = AudioAttributes.Builder()
-            .setUsage(AudioAttributes.USAGE_GAME)
-            .setContentType(AudioAttributes.CONTENT_TYPE_SONIFICATION)
-            .build()
-
-        soundPool = SoundPool.Builder()
-            .setMaxStreams(5)
-            .setAudioAttributes(audioAttributes)
-            .build()
-
-        soundMap["rotate"] = soundPool.load(this, R.raw.re, 1)
-        soundMap["gameover"] = soundPool.load(this, R.raw.fail, 1)
-        soundMap["click"] = soundPool.load(this, R.raw.click, 1)
-        soundMap["hold"] = soundPool.load(this, R.raw.hole, 1)
-        soundMap["lock"] = soundPool.load(this, R.raw.down, 1)
-        soundMap["clear"] = soundPool.load(this, R.raw.del, 1)
-        
         // 배경음악 초기화
         initBackgroundMusic()
         
+        // 크래시나 JNI 호출 멈춤 시 flight-*.plfr 덤프 (이전 실행의 덤프가 있으면 로그에 남김)
+        val crashDir = File(filesDir, "crash").apply { mkdirs() }
+        NativeBridge.installFlightRecorder(crashDir.absolutePath)
+
+        // Native objects come first; the surface view hands the renderer handle to the GL thread
+        game = NativeBridge.createGame(0)
+        renderer = NativeBridge.createRenderer()
+        audio = NativeBridge.createAudio()
+
         // Create and add GLSurfaceView to the container
         glSurfaceView = GameSurfaceView(this)
         val container = findViewById<FrameLayout>(R.id.gl_surface_container)
@@ -105,20 +93,32 @@ class MainActivity : AppCompatActivity() {
         // Setup button listeners
         setupControlButtons()
 
-        // Call the native C++ setup function
-        nativeOnCreate()
+        // Open the output first so effects are decoded straight to the device rate
+        NativeBridge.startAudio(audio)
+        NativeBridge.attachAudio(game, audio)
+
+        // 효과음은 모두 네이티브 오디오 엔진에서 재생: 에셋 번들(palibrix.pak)을 한 번 열어 메모리 매핑
+        NativeBridge.loadSoundBank(audio, assets, "palibrix.pak")
+
+        // 모든 게임을 리플레이 파일로 기록
+        val replayDir = File(filesDir, "replays").apply { mkdirs() }
+        NativeBridge.setReplayDirectory(game, replayDir.absolutePath)
+
+        // 링크된 셰이더 바이너리 캐시 (앱 업데이트 시 codeCacheDir 는 비워짐)
+        val shaderCacheDir = File(codeCacheDir, "shaders").apply { mkdirs() }
+        NativeBridge.setShaderCacheDirectory(renderer, shaderCacheDir.absolutePath)
         
         // Start both update loops
         updateHandler.post(uiUpdateRunnable)
-        updateHandler.post(gameDropRunnable)
+        startTicking()
 
         findViewById<Button>(R.id.pause_button).setOnClickListener {
-            playSoundEffect("click")
+            playSoundEffect(SOUND_CLICK)
             togglePause()
         }
 
         findViewById<Button>(R.id.resume_button).setOnClickListener {
-            playSoundEffect("click")
+            playSoundEffect(SOUND_CLICK)
             togglePause()
         }
     }
@@ -138,7 +138,7 @@ class MainActivity : AppCompatActivity() {
                         MotionEvent.ACTION_DOWN -> {
                             moveRunnable = object : Runnable {
                                 override fun run() {
-                                    nativeMove(direction)
+                                    NativeBridge.move(game, direction)
                                     moveHandler.postDelayed(this, 100) // 100ms 간격으로 반복
                                 }
                             }
@@ -162,7 +162,7 @@ class MainActivity : AppCompatActivity() {
                     MotionEvent.ACTION_DOWN -> {
                         moveRunnable = object : Runnable {
                             override fun run() {
-                                nativeSoftDrop()
+                                NativeBridge.softDrop(game)
                                 moveHandler.postDelayed(this, 100)
                             }
                         }
@@ -177,44 +177,47 @@ class MainActivity : AppCompatActivity() {
         })
 
         findViewById<android.view.View>(R.id.btn_up).setOnClickListener {
-            nativeHardDrop() // Hard drop on up
+            NativeBridge.hardDrop(game) // Hard drop on up
+            vibrate(50)
         }
 
         // Action buttons in diamond pattern
         findViewById<android.view.View>(R.id.btn_y).setOnClickListener {
-            nativeHold() // Y: 홀드
-            playSoundEffect("hold")
+            NativeBridge.hold(game) // Y: 홀드
+            playSoundEffect(SOUND_HOLD)
         }
 
         findViewById<android.view.View>(R.id.btn_x_left).setOnClickListener {
-            nativeHold() // X (왼쪽): 홀드
-            playSoundEffect("hold")
+            NativeBridge.hold(game) // X (왼쪽): 홀드
+            playSoundEffect(SOUND_HOLD)
         }
 
         findViewById<android.view.View>(R.id.btn_a).setOnClickListener {
-            nativeRotate() // A: 우회전 (시계방향)
-            playSoundEffect("rotate") // 회전 효과음 재생
+            NativeBridge.rotate(game) // A: 우회전 (시계방향)
+            playSoundEffect(SOUND_ROTATE) // 회전 효과음 재생
         }
 
         findViewById<android.view.View>(R.id.btn_b).setOnClickListener {
-            nativeRotateLeft() // B: 좌회전 (반시계방향)
-            playSoundEffect("rotate") // 회전 효과음 재생
+            NativeBridge.rotateLeft(game) // B: 좌회전 (반시계방향)
+            playSoundEffect(SOUND_ROTATE) // 회전 효과음 재생
         }
 
         findViewById<Button>(R.id.restart_button).setOnClickListener {
-            playSoundEffect("click")
-            nativeReset()
+            playSoundEffect(SOUND_CLICK)
+            NativeBridge.reset(game)
             currentLevel = 1 // 레벨 초기화
             gameOverSoundPlayed = false // 게임 오버 효과음 플래그 초기화
             gameOverLayout.visibility = android.view.View.GONE
+            startTicking() // 게임 오버 때 멈춘 틱 재개
             startBackgroundMusic() // 게임 재시작 시 배경음악 재생
         }
     }
 
-    private fun calculateDropSpeed(): Long {
-        // 레벨마다 10ms씩 빨라짐 (최소 50ms)
-        val speed = baseDropSpeed - (currentLevel - 1) * 10
-        return if (speed < 50) 50 else speed
+    private fun startTicking() {
+        tickOrigin = SystemClock.uptimeMillis()
+        ticksRun = 0
+        updateHandler.removeCallbacks(gameTickRunnable)
+        updateHandler.post(gameTickRunnable)
     }
 
     private fun initBackgroundMusic() {
@@ -266,22 +269,14 @@ class MainActivity : AppCompatActivity() {
         }
     }
 
-    private fun playSoundEffect(soundName: String) {
-        try {
-            soundMap[soundName]?.let { soundId ->
-                soundPool.play(soundId, 1.0f, 1.0f, 1, 0, 1.0f)
-            }
-        } catch (e: Exception) {
-            e.printStackTrace()
-        }
+    private fun playSoundEffect(id: Int) {
+        NativeBridge.playSound(audio, id)
     }
 
     private fun updateUI() {
-        // Get score and lines from native code
-        val score = nativeGetScore()
-        val lines = nativeGetLines()
-        val combo = nativeGetCombo()
-        val isGameOver = nativeIsGameOver()
+        // Score, lines, level and combo are drawn natively; only state transitions are handled here
+        val lines = NativeBridge.getLines(game)
+        val isGameOver = NativeBridge.isGameOver(game)
 
         // 레벨 계산 (10줄마다 레벨 업)
         val newLevel = (lines / 10) + 1
@@ -291,23 +286,12 @@ class MainActivity : AppCompatActivity() {
             vibrator.vibrate(100)
         }
 
-        // Update top UI
-        scoreText.text = "Score: $score"
-        linesText.text = "Lines: $lines"
-        levelText.text = "Level: $currentLevel"
-        
-        // Update bottom UI (more prominent display)
-        scoreTextBottom.text = "SCORE\n   $score"
-        linesTextBottom.text = "LINES\n   $lines"
-        levelTextBottom.text = "LEVEL\n   $currentLevel"
-        comboTextBottom.text = "COMBO\n   $combo"
-
         if (isGameOver) {
             gameOverLayout.visibility = android.view.View.VISIBLE
-            updateHandler.removeCallbacks(gameDropRunnable)
+            updateHandler.removeCallbacks(gameTickRunnable)
             stopBackgroundMusic() // 게임 오버 시 음악 정지
             if (!gameOverSoundPlayed) {
-                playSoundEffect("gameover") // 게임 오버 효과음 재생
+                playSoundEffect(SOUND_GAME_OVER) // 게임 오버 효과음 재생
                 gameOverSoundPlayed = true
             }
         } else {
@@ -318,12 +302,13 @@ class MainActivity : AppCompatActivity() {
 
     private fun togglePause() {
         isPaused = !isPaused
+        NativeBridge.setPaused(game, isPaused) // 일시정지 중에는 네이티브 쪽에서 화면 갱신 빈도를 낮춤
         if (isPaused) {
-            updateHandler.removeCallbacks(gameDropRunnable)
+            updateHandler.removeCallbacks(gameTickRunnable)
             pauseLayout.visibility = android.view.View.VISIBLE
             pauseBackgroundMusic() // 일시정지 시 음악 일시정지
         } else {
-            updateHandler.post(gameDropRunnable)
+            startTicking()
             pauseLayout.visibility = android.view.View.GONE
             startBackgroundMusic() // 재개 시 음악 재생
         }
@@ -332,24 +317,29 @@ class MainActivity : AppCompatActivity() {
     override fun onResume() {
         super.onResume()
         glSurfaceView.onResume()
+        NativeBridge.startAudio(audio)
+        NativeBridge.setPaused(game, false)
         isPaused = false
         pauseLayout.visibility = android.view.View.GONE
-        updateHandler.post(gameDropRunnable)
+        startTicking()
         startBackgroundMusic() // 게임 재개 시 음악 재생
     }
 
     override fun onPause() {
         super.onPause()
+        // 뷰보다 먼저: 일시정지가 프레임 조절기에서 최대 500 ms 대기 중인 렌더 스레드를 깨워야 뷰의 onPause 가 멈추지 않음
+        NativeBridge.setPaused(game, true) // 리플레이도 저장소에 기록됨
         glSurfaceView.onPause()
+        NativeBridge.stopAudio(audio)
         isPaused = true
-        updateHandler.removeCallbacks(gameDropRunnable)
+        updateHandler.removeCallbacks(gameTickRunnable)
         pauseBackgroundMusic() // 게임 일시정지 시 음악 일시정지
     }
 
     override fun onDestroy() {
         super.onDestroy()
         updateHandler.removeCallbacks(uiUpdateRunnable)
-        updateHandler.removeCallbacks(gameDropRunnable)
+        updateHandler.removeCallbacks(gameTickRunnable)
         
         // 배경음악 정리
         backgroundMusic?.let { player ->
@@ -360,73 +350,66 @@ class MainActivity : AppCompatActivity() {
         }
         backgroundMusic = null
 
-        // 효과음 정리
-        soundPool.release()
-        
-        // It's important to call the native cleanup function
-        nativeOnDestroy()
+        // It's important to release the native objects; the audio engine last, after the game let go of it
+        NativeBridge.destroyRenderer(renderer)
+        NativeBridge.destroyGame(game)
+        NativeBridge.destroyAudio(audio)
+        renderer = 0L
+        game = 0L
+        audio = 0L
     }
 
     fun vibrate(milliseconds: Long) {
         vibrator.vibrate(milliseconds)
     }
 
-    fun playLockSound() {
-        playSoundEffect("lock")
-    }
-
-    fun playLineClearSound() {
-        playSoundEffect("clear")
-    }
-
-    // --- Native Methods ---
-    private external fun nativeOnCreate()
-    private external fun nativeOnSurfaceCreated()
-    private external fun nativeOnSurfaceChanged(width: Int, height: Int)
-    private external fun nativeOnDrawFrame()
-    private external fun nativeOnDestroy()
-    private external fun nativeUpdate()
-    private external fun nativeMove(direction: Int)
-    private external fun nativeRotate()
-    private external fun nativeRotateLeft()
-    private external fun nativeSoftDrop()
-    private external fun nativeHardDrop()
-    private external fun nativeHold()
-    private external fun nativeReset()
-    private external fun nativeGetScore(): Int
-    private external fun nativeGetLines(): Int
-    private external fun nativeGetCombo(): Int
-    private external fun nativeIsGameOver(): Boolean
-
     companion object {
-        init {
-            System.loadLibrary("palibrix")
-        }
+        // Must match SoundEffect in AudioEngine.h (lock = 0, line clear = 1 are triggered natively)
+        private const val SOUND_ROTATE = 2
+        private const val SOUND_HOLD = 3
+        private const val SOUND_CLICK = 4
+        private const val SOUND_GAME_OVER = 5
+
+        private const val TICK_RATE = 60L // Game::update 한 번이 한 틱
+        private const val MAX_CATCH_UP_TICKS = 6L
     }
 
     // Inner class to access MainActivity's native methods
     internal inner class GameSurfaceView(context: Context) : GLSurfaceView(context) {
-        private val renderer: GameRenderer
+        private val glRenderer: GameRenderer
 
         init {
             setEGLContextClientVersion(3)
-            renderer = GameRenderer()
-            setRenderer(renderer)
+            // 일시정지 중에도 EGL 컨텍스트를 유지 (유지되면 네이티브 쪽에서 GL 리소스 재생성을 건너뜀)
+            preserveEGLContextOnPause = true
+            glRenderer = GameRenderer()
+            setRenderer(glRenderer)
             renderMode = RENDERMODE_CONTINUOUSLY
         }
+
+        // 네이티브 프레임 레이트 조절기가 ANativeWindow_setFrameRate를 호출할 수 있도록 Surface 전달
+        override fun surfaceCreated(holder: SurfaceHolder) {
+            super.surfaceCreated(holder)
+            NativeBridge.setSurface(renderer, holder.surface)
+        }
+
+        override fun surfaceDestroyed(holder: SurfaceHolder) {
+            NativeBridge.setSurface(renderer, null)
+            super.surfaceDestroyed(holder)
+        }
     }
 
     internal inner class GameRenderer : GLSurfaceView.Renderer {
         override fun onSurfaceCreated(gl: GL10, config: EGLConfig) {
-            nativeOnSurfaceCreated()
+            NativeBridge.onSurfaceCreated(renderer)
         }
 
         override fun onSurfaceChanged(gl: GL10, width: Int, height: Int) {
-            nativeOnSurfaceChanged(width, height)
+            NativeBridge.onSurfaceChanged(renderer, width, height)
         }
 
         override fun onDrawFrame(gl: GL10) {
-            nativeOnDrawFrame()
+            NativeBridge.drawFrame(renderer, game)
         }
     }
 }
@@ -0,0 +1,56 @@
+package com.example.palibrix
+
+import android.content.res.AssetManager
+import android.view.Surface
+
+/**
+ * 네이티브 API. 게임/렌더러/오디오는 create* 가 돌려주는 핸들(Long)로 다루고 destroy* 로 해제한다.
+ * 전역 상태가 없으므로 여러 게임을 동시에 돌릴 수 있다 (분할 화면, AI 대전, 백그라운드 시뮬레이션).
+ * 핸들 하나는 한 스레드에서 사용하되, 게임 입력(UI 스레드)과 drawFrame(GL 스레드)은 함께 써도 된다.
+ * 함수들은 JNI_OnLoad 에서 RegisterNatives 로 등록된다.
+ */
+object NativeBridge {
+    init {
+        System.loadLibrary("palibrix")
+    }
+
+    // 게임 (seed 0 = 무작위)
+    @JvmStatic external fun createGame(seed: Long): Long
+    @JvmStatic external fun destroyGame(game: Long)
+    @JvmStatic external fun setReplayDirectory(game: Long, path: String)
+    @JvmStatic external fun attachAudio(game: Long, audio: Long) // audio 0 = 분리
+    @JvmStatic external fun update(game: Long)
+    @JvmStatic external fun move(game: Long, direction: Int)
+    @JvmStatic external fun rotate(game: Long)
+    @JvmStatic external fun rotateLeft(game: Long)
+    @JvmStatic external fun softDrop(game: Long)
+    @JvmStatic external fun hardDrop(game: Long)
+    @JvmStatic external fun hold(game: Long)
+    @JvmStatic external fun reset(game: Long)
+    @JvmStatic external fun setPaused(game: Long, paused: Boolean)
+    @JvmStatic external fun getScore(game: Long): Int
+    @JvmStatic external fun getLines(game: Long): Int
+    @JvmStatic external fun getCombo(game: Long): Int
+    @JvmStatic external fun isGameOver(game: Long): Boolean
+
+    // 크래시/멈춤 시 최근 입력·프레임 기록을 dir 에 덤프 (프로세스당 한 번, tools/flight_replay 로 재현)
+    @JvmStatic external fun installFlightRecorder(dir: String): Boolean
+
+    // 오디오 (해제 전에 연결된 게임에서 먼저 분리할 것)
+    @JvmStatic external fun createAudio(): Long
+    @JvmStatic external fun destroyAudio(audio: Long)
+    // 압축하지 않은 에셋 번들을 메모리 매핑해 효과음을 로드하고 로드된 개수를 반환 (오디오 핸들당 한 번)
+    @JvmStatic external fun loadSoundBank(audio: Long, assets: AssetManager, name: String): Int
+    @JvmStatic external fun playSound(audio: Long, id: Int) // id: AudioEngine.h 의 SoundEffect
+    @JvmStatic external fun startAudio(audio: Long): Boolean
+    @JvmStatic external fun stopAudio(audio: Long)
+
+    // 렌더러 (setSurface 외에는 GL 스레드에서 호출)
+    @JvmStatic external fun createRenderer(): Long
+    @JvmStatic external fun destroyRenderer(renderer: Long)
+    @JvmStatic external fun setShaderCacheDirectory(renderer: Long, path: String)
+    @JvmStatic external fun setSurface(renderer: Long, surface: Surface?)
+    @JvmStatic external fun onSurfaceCreated(renderer: Long)
+    @JvmStatic external fun onSurfaceChanged(renderer: Long, width: Int, height: Int)
+    @JvmStatic external fun drawFrame(renderer: Long, game: Long)
+}
@@ -0,0 +1,252 @@
+// Build-time asset packer: writes the bundle AssetBundle maps at runtime. Reads a manifest with
+// one asset per line,
+//
+//   <name> <format> <source path>
+//
+// where format is
+//   pcm         WAV (16-bit or float) converted to mono float at --rate, played zero-copy
+//   compressed  stored as is (MP3, Opus, ...), decoded once on device
+//   raw         stored as is
+// Blank lines and lines starting with # are skipped; paths are relative to the working directory.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "AssetBundle.h"
+#include "ByteStream.h"
+
+namespace {
+
+struct Input {
+    std::string name;
+    AssetFormat format;
+    uint32_t param;
+    std::vector<uint8_t> payload;
+};
+
+bool readFile(const std::string& path, std::vector<uint8_t>& bytes) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    bytes.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+// Decodes a RIFF WAV file to mono float at the given rate
+bool decodeWav(const std::vector<uint8_t>& wav, int rate, std::vector<float>& out, std::string& error) {
+    ByteReader in(wav.data(), wav.size());
+    uint32_t riff = in.getU32();
+    in.getU32(); // RIFF size
+    uint32_t wave = in.getU32();
+    if (riff != 0x46464952 || wave != 0x45564157) { // "RIFF", "WAVE"
+        error = "not a WAV file";
+        return false;
+    }
+    uint16_t encoding = 0;
+    uint16_t channels = 0;
+    uint32_t sampleRate = 0;
+    uint16_t bits = 0;
+    const uint8_t* data = nullptr;
+    uint32_t dataSize = 0;
+    while (in.remaining() >= 8 && !data) {
+        uint32_t id = in.getU32();
+        uint32_t size = in.getU32();
+        const uint8_t* chunk = in.getBytes(std::min<size_t>(size + (size & 1), in.remaining()));
+        if (!chunk || size > wav.size()) {
+            break;
+        }
+        if (id == 0x20746d66) { // "fmt "
+            ByteReader fmt(chunk, size);
+            encoding = fmt.getU16();
+            channels = fmt.getU16();
+            sampleRate = fmt.getU32();
+            fmt.getU32(); // Byte rate
+            fmt.getU16(); // Block align
+            bits = fmt.getU16();
+        } else if (id == 0x61746164) { // "data"
+            data = chunk;
+            dataSize = size;
+        }
+    }
+    bool pcm16 = encoding == 1 && bits == 16;
+    bool float32 = encoding == 3 && bits == 32;
+    if (!data || channels == 0 || sampleRate == 0 || (!pcm16 && !float32)) {
+        error = "only 16-bit PCM and 32-bit float WAV are supported";
+        return false;
+    }
+
+    size_t frames = dataSize / (channels * bits / 8);
+    std::vector<float> mono(frames);
+    for (size_t i = 0; i < frames; ++i) {
+        float sum = 0.0f;
+        for (int c = 0; c < channels; ++c) {
+            const uint8_t* sample = data + (i * channels + c) * (bits / 8);
+            if (pcm16) {
+                int16_t value;
+                memcpy(&value, sample, sizeof(value));
+                sum += value / 32768.0f;
+            } else {
+                float value;
+                memcpy(&value, sample, sizeof(value));
+                sum += value;
+            }
+        }
+        mono[i] = sum / channels;
+    }
+
+    // Linear resampling, same as AudioEngine does at load time, but done once here
+    double step = static_cast<double>(sampleRate) / rate;
+    size_t outFrames = static_cast<size_t>(frames / step);
+    out.resize(outFrames);
+    for (size_t i = 0; i < outFrames; ++i) {
+        double src = i * step;
+        size_t i0 = static_cast<size_t>(src);
+        size_t i1 = std::min(i0 + 1, frames - 1);
+        float t = static_cast<float>(src - i0);
+        out[i] = mono[i0] + (mono[i1] - mono[i0]) * t;
+    }
+    return true;
+}
+
+bool readManifest(const std::string& path, int rate, std::vector<Input>& inputs) {
+    std::ifstream manifest(path);
+    if (!manifest) {
+        fprintf(stderr, "Cannot read manifest %s\n", path.c_str());
+        return false;
+    }
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(manifest, line)) {
+        lineNumber++;
+        std::istringstream fields(line);
+        std::string name;
+        std::string format;
+        std::string source;
+        if (!(fields >> name) || name[0] == '#') {
+            continue;
+        }
+        if (!(fields >> format >> source) || name.size() >= kAssetNameSize) {
+            fprintf(stderr, "%s:%d: expected '<name> <format> <path>', names below %zu characters\n",
+                    path.c_str(), lineNumber, kAssetNameSize);
+            return false;
+        }
+
+        Input input{name, AssetFormat::Raw, 0, {}};
+        std::vector<uint8_t> bytes;
+        if (!readFile(source, bytes)) {
+            fprintf(stderr, "%s:%d: cannot read %s\n", path.c_str(), lineNumber, source.c_str());
+            return false;
+        }
+        if (format == "pcm") {
+            std::vector<float> samples;
+            std::string error;
+            if (!decodeWav(bytes, rate, samples, error)) {
+                fprintf(stderr, "%s:%d: %s: %s\n", path.c_str(), lineNumber, source.c_str(), error.c_str());
+                return false;
+            }
+            input.format = AssetFormat::PcmF32Mono;
+            input.param = static_cast<uint32_t>(rate);
+            input.payload.resize(samples.size() * sizeof(float));
+            memcpy(input.payload.data(), samples.data(), input.payload.size());
+        } else if (format == "compressed" || format == "raw") {
+            input.format = format == "raw" ? AssetFormat::Raw : AssetFormat::Compressed;
+            input.payload = std::move(bytes);
+        } else {
+            fprintf(stderr, "%s:%d: unknown format %s\n", path.c_str(), lineNumber, format.c_str());
+            return false;
+        }
+        inputs.push_back(std::move(input));
+    }
+    return true;
+}
+
+size_t align(size_t offset) {
+    return (offset + kAssetAlignment - 1) / kAssetAlignment * kAssetAlignment;
+}
+
+bool writeBundle(const std::string& path, std::vector<Input>& inputs) {
+    std::sort(inputs.begin(), inputs.end(), [](const Input& a, const Input& b) { return a.name < b.name; });
+    for (size_t i = 1; i < inputs.size(); ++i) {
+        if (inputs[i].name == inputs[i - 1].name) {
+            fprintf(stderr, "Duplicate asset %s\n", inputs[i].name.c_str());
+            return false;
+        }
+    }
+
+    std::vector<uint64_t> offsets;
+    size_t size = align(kAssetHeaderSize + inputs.size() * kAssetIndexEntrySize);
+    for (const Input& input : inputs) {
+        offsets.push_back(size);
+        size = align(size + input.payload.size());
+    }
+
+    std::vector<uint8_t> bundle(size, 0);
+    ByteWriter out(bundle.data(), bundle.size());
+    out.putU32(kAssetBundleMagic);
+    out.putU16(kAssetBundleVersion);
+    out.putU16(static_cast<uint16_t>(inputs.size()));
+    out.putU64(size);
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        char name[kAssetNameSize] = {};
+        memcpy(name, inputs[i].name.data(), inputs[i].name.size());
+        out.putBytes(name, sizeof(name));
+        out.putU16(static_cast<uint16_t>(inputs[i].format));
+        out.putU16(0);
+        out.putU32(inputs[i].param);
+        out.putU64(offsets[i]);
+        out.putU64(inputs[i].payload.size());
+    }
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        memcpy(bundle.data() + offsets[i], inputs[i].payload.data(), inputs[i].payload.size());
+    }
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file || fwrite(bundle.data(), 1, bundle.size(), file) != bundle.size()) {
+        fprintf(stderr, "Cannot write %s\n", path.c_str());
+        if (file) fclose(file);
+        return false;
+    }
+    fclose(file);
+    printf("%s: %zu assets, %zu bytes\n", path.c_str(), inputs.size(), bundle.size());
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string manifest;
+    std::string output;
+    int rate = 48000; // The usual AAudio device rate; other rates resample at load
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--manifest" && hasValue) {
+            manifest = argv[++i];
+        } else if (arg == "--out" && hasValue) {
+            output = argv[++i];
+        } else if (arg == "--rate" && hasValue) {
+            rate = std::max(8000, atoi(argv[++i]));
+        } else {
+            manifest.clear();
+            break;
+        }
+    }
+    if (manifest.empty() || output.empty()) {
+        printf("usage: palibrix_asset_packer --manifest FILE --out BUNDLE [--rate HZ]\n");
+        return 2;
+    }
+
+    std::vector<Input> inputs;
+    if (!readManifest(manifest, rate, inputs) || !writeBundle(output, inputs)) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,204 @@
+// Loads generated effects into an AudioEngine, triggers voices and renders the mix through
+// WavFileSink, then reads the WAV file back and checks it: the header, a 16-bit stereo effect at
+// half the engine rate downmixed and resampled, gain, voices summing and clipping, voices ending,
+// effects played before they were loaded, and game events.
+//
+//   palibrix_audio_mixer_test [DIR]
+//
+// Writes its WAV files to DIR (default: the working directory). Prints every failed check and
+// exits with 1 if there were any.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "AudioEngine.h"
+#include "AudioSink.h"
+
+namespace {
+
+constexpr int kRate = 48000;
+
+int gFailures = 0;
+std::string gDir = ".";
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++gFailures; \
+        } \
+    } while (0)
+
+// What WavFileSink writes for a mixed sample
+int16_t quantize(float sample) {
+    return static_cast<int16_t>(sample * 32767.0f);
+}
+
+bool near(int16_t actual, int16_t expected) {
+    return std::abs(actual - expected) <= 1;
+}
+
+// Reads back a file WavFileSink wrote: checks the header and returns the interleaved samples
+std::vector<int16_t> readWav(const std::string& path) {
+    std::vector<int16_t> samples;
+    FILE* file = fopen(path.c_str(), "rb");
+    CHECK(file != nullptr);
+    if (!file) return samples;
+
+    uint8_t header[44];
+    bool complete = fread(header, 1, sizeof(header), file) == sizeof(header);
+    CHECK(complete);
+    if (complete) {
+        uint16_t format, channels, bits;
+        uint32_t rate, riffSize, dataSize;
+        memcpy(&riffSize, header + 4, 4);
+        memcpy(&format, header + 20, 2);
+        memcpy(&channels, header + 22, 2);
+        memcpy(&rate, header + 24, 4);
+        memcpy(&bits, header + 34, 2);
+        memcpy(&dataSize, header + 40, 4);
+        CHECK(memcmp(header, "RIFF", 4) == 0 && memcmp(header + 8, "WAVEfmt ", 8) == 0);
+        CHECK(memcmp(header + 36, "data", 4) == 0);
+        CHECK(format == 1 && channels == AudioEngine::kChannels && bits == 16 && rate == kRate);
+        CHECK(riffSize == 36 + dataSize);
+        samples.resize(dataSize / sizeof(int16_t));
+        CHECK(fread(samples.data(), 1, dataSize, file) == dataSize);
+    }
+    fclose(file);
+    return samples;
+}
+
+// Renders blocks of frames into a fresh WAV file and returns its samples
+template<typename Script>
+std::vector<int16_t> renderWav(AudioEngine& engine, const char* name, Script script) {
+    std::string path = gDir + "/" + name;
+    WavFileSink sink(path, kRate);
+    CHECK(sink.start(engine));
+    script(sink);
+    sink.stop();
+    return readWav(path);
+}
+
+void testPcmEffect() {
+    // A stereo ramp at 24 kHz whose channels mix to (i - 1000) * 4, so the engine doubles it
+    // to 48 kHz with each odd sample halfway between its neighbours
+    constexpr int kFrames = 2000;
+    std::vector<int16_t> pcm(kFrames * 2);
+    for (int i = 0; i < kFrames; ++i) {
+        pcm[i * 2] = static_cast<int16_t>((i - 1000) * 6);
+        pcm[i * 2 + 1] = static_cast<int16_t>((i - 1000) * 2);
+    }
+    AudioEngine engine;
+    std::vector<int16_t> out = renderWav(engine, "pcm_effect.wav", [&](WavFileSink& sink) {
+        CHECK(engine.loadPcm(SoundEffect::LineClear, pcm.data(), kFrames, 2, kRate / 2));
+        CHECK(!engine.loadPcm(SoundEffect::LineClear, pcm.data(), kFrames, 2, kRate / 2)); // Only once
+        engine.play(SoundEffect::LineClear, 0.5f);
+        sink.renderFrames(1000);
+        sink.renderFrames(4000);
+    });
+    CHECK(out.size() == 5000 * 2);
+    if (out.size() != 5000 * 2) return;
+
+    int mismatches = 0;
+    for (int i = 0; i < 5000; ++i) {
+        float expected = 0.0f;
+        if (i < kFrames * 2) {
+            float mono = (i / 2 - 1000) * 4.0f / 32768.0f;
+            float next = (std::min(i / 2 + 1, kFrames - 1) - 1000) * 4.0f / 32768.0f;
+            expected = (i % 2 ? (mono + next) / 2 : mono) * 0.5f;
+        }
+        mismatches += near(out[i * 2], quantize(expected)) && out[i * 2 + 1] == out[i * 2] ? 0 : 1;
+    }
+    CHECK(mismatches == 0);
+}
+
+void testMixing() {
+    constexpr int kFrames = 480;
+    std::vector<float> loud(kFrames, 0.75f);
+    std::vector<float> quiet(kFrames * 2, -0.25f);
+    AudioEngine engine;
+    std::vector<int16_t> out = renderWav(engine, "mixing.wav", [&](WavFileSink& sink) {
+        // Played before it is loaded: dropped
+        engine.play(SoundEffect::Lock);
+        CHECK(engine.loadMapped(SoundEffect::Lock, loud.data(), loud.size(), kRate));
+        CHECK(engine.loadMapped(SoundEffect::Rotate, quiet.data(), quiet.size(), kRate));
+        sink.renderFrames(100); // Silence
+
+        // Two loud voices clip, the quiet one then pulls the sum back under full scale
+        engine.play(SoundEffect::Lock);
+        engine.play(SoundEffect::Lock);
+        sink.renderFrames(100);
+        engine.play(SoundEffect::Rotate);
+        sink.renderFrames(2000);
+
+        // A lock event starts the lock effect, a hard drop has no sound
+        GameEvent drop{};
+        drop.type = GameEventType::HardDrop;
+        engine.onGameEvent(drop);
+        GameEvent lock{};
+        lock.type = GameEventType::PieceLocked;
+        engine.onGameEvent(lock);
+        sink.renderFrames(1000);
+    });
+    CHECK(out.size() == 3200 * 2);
+    if (out.size() != 3200 * 2) return;
+
+    // Frame ranges: the two loud voices play 100-580, the quiet one 200-1160, the event 2200-2680
+    auto expectedAt = [&](int frame) {
+        float sum = 0.0f;
+        if (frame >= 100 && frame < 100 + kFrames) sum += 1.5f;
+        if (frame >= 200 && frame < 200 + kFrames * 2) sum -= 0.25f;
+        if (frame >= 2200 && frame < 2200 + kFrames) sum += 0.75f;
+        return quantize(std::min(1.0f, std::max(-1.0f, sum)));
+    };
+    int mismatches = 0;
+    for (int i = 0; i < 3200; ++i) {
+        mismatches += near(out[i * 2], expectedAt(i)) && out[i * 2 + 1] == out[i * 2] ? 0 : 1;
+    }
+    CHECK(mismatches == 0);
+    CHECK(out[150 * 2] == 32767);
+    CHECK(near(out[300 * 2], quantize(1.0f)));
+    CHECK(near(out[700 * 2], quantize(-0.25f)));
+}
+
+void testVoiceSteal() {
+    // With every voice busy, a new one replaces the voice closest to finishing
+    std::vector<float> effect(1000, 0.01f);
+    AudioEngine engine;
+    std::vector<int16_t> out = renderWav(engine, "voice_steal.wav", [&](WavFileSink& sink) {
+        CHECK(engine.loadMapped(SoundEffect::Click, effect.data(), effect.size(), kRate));
+        for (int i = 0; i < AudioEngine::kMaxVoices; ++i) {
+            engine.play(SoundEffect::Click);
+            sink.renderFrames(10);
+        }
+        engine.play(SoundEffect::Click, 2.0f);
+        sink.renderFrames(1000);
+    });
+    CHECK(out.size() == (AudioEngine::kMaxVoices * 10 + 1000) * 2);
+    if (out.size() != (AudioEngine::kMaxVoices * 10 + 1000) * 2) return;
+
+    // The first voice, 160 frames in, is dropped for one at twice the gain
+    size_t start = AudioEngine::kMaxVoices * 10 * 2;
+    CHECK(near(out[start], quantize(0.01f * (AudioEngine::kMaxVoices - 1) + 0.02f)));
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc > 1) {
+        gDir = argv[1];
+    }
+    testPcmEffect();
+    testMixing();
+    testVoiceSteal();
+    if (gFailures > 0) {
+        printf("%d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,237 @@
+// Checks the board feature kernel this build compiled (see BoardFeatures.h) against the
+// cell-by-cell reference: many random batches of ragged stacks with holes, plus edge boards
+// (empty, full, single columns, holes under overhangs, wells against the walls), some of them
+// with their features worked out by hand so the reference itself is checked too.
+//
+//   palibrix_board_features_test
+//
+// Prints every failed check and exits with 1 if there were any.
+
+#include <cstdio>
+#include <cstring>
+
+#include "BoardFeatures.h"
+
+namespace {
+
+int gFailures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++gFailures; \
+        } \
+    } while (0)
+
+constexpr uint16_t kFullRow = kBoardRowMask;
+
+uint32_t gRandom = 0x2545f491u;
+
+uint32_t random() {
+    gRandom ^= gRandom << 13;
+    gRandom ^= gRandom >> 17;
+    gRandom ^= gRandom << 5;
+    return gRandom;
+}
+
+// Lane of the first difference between the kernel and the reference, or -1
+int firstDifference(const BoardFeatureBatch& a, const BoardFeatureBatch& b, int count) {
+    for (int i = 0; i < count; ++i) {
+        bool same = a.aggregateHeight[i] == b.aggregateHeight[i] && a.maxHeight[i] == b.maxHeight[i] &&
+                    a.holes[i] == b.holes[i] && a.wellSum[i] == b.wellSum[i] && a.maxWell[i] == b.maxWell[i] &&
+                    a.rowTransitions[i] == b.rowTransitions[i] && a.bumpiness[i] == b.bumpiness[i];
+        for (int x = 0; x < BOARD_WIDTH; ++x) {
+            same &= a.heights[x][i] == b.heights[x][i];
+        }
+        if (!same) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Runs both implementations over the batch and compares the filled lanes
+bool matchesReference(const BoardBatch& batch, BoardFeatureBatch& features) {
+    BoardFeatureBatch reference;
+    computeBoardFeaturesScalar(batch, reference);
+    computeBoardFeatures(batch, features);
+    int lane = firstDifference(features, reference, batch.count);
+    if (lane >= 0) {
+        printf("lane %d: holes %d/%d, transitions %d/%d, wells %d/%d, bumpiness %d/%d (kernel/reference)\n", lane,
+               features.holes[lane], reference.holes[lane], features.rowTransitions[lane],
+               reference.rowTransitions[lane], features.wellSum[lane], reference.wellSum[lane],
+               features.bumpiness[lane], reference.bumpiness[lane]);
+    }
+    return lane < 0;
+}
+
+// Columns up to maxHeight tall, each cell below the top empty with chance 1/holeOdds
+void randomBoard(uint16_t rows[BOARD_HEIGHT], int maxHeight, int holeOdds) {
+    memset(rows, 0, BOARD_HEIGHT * sizeof(uint16_t));
+    for (int x = 0; x < BOARD_WIDTH; ++x) {
+        int height = static_cast<int>(random() % (maxHeight + 1));
+        for (int y = BOARD_HEIGHT - height; y < BOARD_HEIGHT; ++y) {
+            if (y == BOARD_HEIGHT - height || random() % holeOdds != 0) {
+                rows[y] |= static_cast<uint16_t>(1u << x);
+            }
+        }
+    }
+}
+
+void testRandomBatches() {
+    int mismatches = 0;
+    for (int round = 0; round < 4000; ++round) {
+        BoardBatch batch;
+        int maxHeight = 1 + round % BOARD_HEIGHT;
+        int holeOdds = 2 + round % 7;
+        while (!batch.full()) {
+            uint16_t rows[BOARD_HEIGHT];
+            if (round % 5 == 0) {
+                // Noise: any bit pattern, including cells floating over empty rows
+                for (uint16_t& row : rows) {
+                    row = static_cast<uint16_t>(random() & kFullRow);
+                }
+            } else {
+                randomBoard(rows, maxHeight, holeOdds);
+            }
+            batch.add(rows);
+        }
+        BoardFeatureBatch features;
+        mismatches += !matchesReference(batch, features);
+    }
+    CHECK(mismatches == 0);
+
+    // A partly filled batch still gets the filled lanes right
+    BoardBatch partial;
+    uint16_t rows[BOARD_HEIGHT];
+    for (int i = 0; i < 13; ++i) {
+        randomBoard(rows, 12, 4);
+        partial.add(rows);
+    }
+    BoardFeatureBatch features;
+    CHECK(matchesReference(partial, features));
+}
+
+// Fills the whole batch with copies of one board and checks lane 0 against expected values
+struct Expected {
+    int aggregateHeight, maxHeight, holes, wellSum, maxWell, rowTransitions, bumpiness;
+};
+
+void checkBoard(const char* name, const uint16_t rows[BOARD_HEIGHT], const Expected& expected) {
+    BoardBatch batch;
+    while (!batch.full()) {
+        batch.add(rows);
+    }
+    BoardFeatureBatch features;
+    bool matches = matchesReference(batch, features);
+    bool asExpected = features.aggregateHeight[0] == expected.aggregateHeight &&
+                      features.maxHeight[0] == expected.maxHeight && features.holes[0] == expected.holes &&
+                      features.wellSum[0] == expected.wellSum && features.maxWell[0] == expected.maxWell &&
+                      features.rowTransitions[0] == expected.rowTransitions &&
+                      features.bumpiness[0] == expected.bumpiness;
+    if (!matches || !asExpected) {
+        printf("%s: aggregate %d, max %d, holes %d, wells %d/%d, transitions %d, bumpiness %d\n", name,
+               features.aggregateHeight[0], features.maxHeight[0], features.holes[0], features.wellSum[0],
+               features.maxWell[0], features.rowTransitions[0], features.bumpiness[0]);
+    }
+    CHECK(matches);
+    CHECK(asExpected);
+}
+
+void testEdgeBoards() {
+    uint16_t rows[BOARD_HEIGHT] = {};
+    // Every row is empty between two walls: two transitions each
+    checkBoard("empty", rows, {0, 0, 0, 0, 0, 2 * BOARD_HEIGHT, 0});
+
+    for (uint16_t& row : rows) {
+        row = kFullRow;
+    }
+    checkBoard("full", rows, {BOARD_WIDTH * BOARD_HEIGHT, BOARD_HEIGHT, 0, 0, 0, 0, 0});
+
+    // One full column: a wall next to the left wall, or a spike in the middle
+    for (uint16_t& row : rows) {
+        row = 1u << 0;
+    }
+    checkBoard("left column", rows, {BOARD_HEIGHT, BOARD_HEIGHT, 0, 0, 0, 2 * BOARD_HEIGHT, BOARD_HEIGHT});
+    for (uint16_t& row : rows) {
+        row = 1u << 5;
+    }
+    checkBoard("middle column", rows, {BOARD_HEIGHT, BOARD_HEIGHT, 0, 0, 0, 4 * BOARD_HEIGHT, 2 * BOARD_HEIGHT});
+
+    // Full rows with one column missing: a well as deep as the board
+    for (uint16_t& row : rows) {
+        row = kFullRow & ~(1u << 9);
+    }
+    checkBoard("right well", rows,
+               {(BOARD_WIDTH - 1) * BOARD_HEIGHT, BOARD_HEIGHT, 0, BOARD_HEIGHT, BOARD_HEIGHT, 2 * BOARD_HEIGHT,
+                BOARD_HEIGHT});
+
+    // A single cell halfway up column 4 covers every empty cell under it
+    memset(rows, 0, sizeof(rows));
+    rows[10] = 1u << 4;
+    int height = BOARD_HEIGHT - 10;
+    checkBoard("overhang", rows,
+               {height, height, BOARD_HEIGHT - 11, 0, 0, 2 * BOARD_HEIGHT + 2, 2 * height});
+
+    // Only the top row filled: every column is as tall as the board and hollow
+    memset(rows, 0, sizeof(rows));
+    rows[0] = kFullRow;
+    checkBoard("lid", rows,
+               {BOARD_WIDTH * BOARD_HEIGHT, BOARD_HEIGHT, BOARD_WIDTH * (BOARD_HEIGHT - 1), 0, 0,
+                2 * (BOARD_HEIGHT - 1), 0});
+
+    // Checkerboard: all cells alternate, so every row has a transition at one wall and between
+    // every pair of cells
+    for (int y = 0; y < BOARD_HEIGHT; ++y) {
+        rows[y] = static_cast<uint16_t>((y % 2 ? 0x2aa : 0x155) & kFullRow);
+    }
+    BoardBatch batch;
+    batch.add(rows);
+    BoardFeatureBatch features;
+    CHECK(matchesReference(batch, features));
+    CHECK(features.rowTransitions[0] == BOARD_WIDTH * BOARD_HEIGHT);
+}
+
+// Each single column, and the same column with a hole under an overhang in every lane position
+void testEveryColumnAndLane() {
+    BoardBatch batch;
+    for (int i = 0; i < kBoardBatchSize; ++i) {
+        uint16_t rows[BOARD_HEIGHT] = {};
+        int x = i % BOARD_WIDTH;
+        int top = 4 + i % 11;
+        for (int y = top; y < BOARD_HEIGHT; ++y) {
+            rows[y] = static_cast<uint16_t>(1u << x);
+        }
+        if (i % 2) {
+            rows[top + 1] = 0; // Hole right under the top cell
+            rows[BOARD_HEIGHT - 1] |= static_cast<uint16_t>(1u << ((x + 1) % BOARD_WIDTH));
+        }
+        batch.add(rows);
+    }
+    BoardFeatureBatch features;
+    CHECK(matchesReference(batch, features));
+    CHECK(features.holes[0] == 0);
+    CHECK(features.holes[1] == 1);
+}
+
+} // namespace
+
+int main() {
+#if defined(__AVX2__) && defined(__GNUC__)
+    if (!__builtin_cpu_supports("avx2")) {
+        printf("this CPU has no AVX2, skipped\n");
+        return 77;
+    }
+#endif
+    printf("kernel: %s\n", boardFeatureKernelName());
+    testEdgeBoards();
+    testEveryColumnAndLane();
+    testRandomBatches();
+    if (gFailures > 0) {
+        printf("%d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,285 @@
+// Reads a flight recorder dump (see FlightRecorder.h): prints why it was written, what the
+// threads were doing and the last records, then restores the chosen session from the oldest
+// keyframe of its last game still in the ring and replays the inputs after it. Every replayed
+// input is checked against the state hash recorded on the device; the first difference is
+// reported. With --out the inputs are written as a replay file, starting from that keyframe.
+//
+//   palibrix_flight_replay DUMP [--session N] [--last N] [--out REPLAY]
+//
+// The replay keeps the order of the inputs, not their timing.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ByteStream.h"
+#include "FlightRecorder.h"
+
+using namespace FlightRecorder;
+
+namespace {
+
+struct Dump {
+    FlightDumpHeader header;
+    std::vector<FlightKeyframe> keyframes;
+    std::vector<FlightRecord> records; // Whole records only, oldest first
+};
+
+const char* kindName(uint8_t kind) {
+    static const char* const kNames[] = {"?", "input", "frame", "jni-enter", "jni-exit", "session",
+                                         "keyframe", "stall"};
+    return kind < sizeof(kNames) / sizeof(kNames[0]) ? kNames[kind] : "?";
+}
+
+const char* inputName(uint16_t input) {
+    static const char* const kNames[] = {"tick", "move-left", "move-right", "rotate", "rotate-left",
+                                         "soft-drop", "hard-drop", "hold"};
+    return input < sizeof(kNames) / sizeof(kNames[0]) ? kNames[input] : "?";
+}
+
+const char* methodName(uint16_t method) {
+    static const char* const kNames[] = {"update", "input", "reset", "drawFrame", "onSurfaceCreated",
+                                         "onSurfaceChanged"};
+    return method < sizeof(kNames) / sizeof(kNames[0]) ? kNames[method] : "?";
+}
+
+bool readDump(const std::string& path, Dump& dump) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        fprintf(stderr, "cannot open %s\n", path.c_str());
+        return false;
+    }
+    std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (bytes.size() < sizeof(FlightDumpHeader)) {
+        fprintf(stderr, "%s: too short for a flight dump\n", path.c_str());
+        return false;
+    }
+    FlightDumpHeader& header = dump.header;
+    memcpy(&header, bytes.data(), sizeof(header));
+    size_t keyframeCount = static_cast<size_t>(header.sessions) * header.keyframeSlots;
+    if (header.magic != kDumpMagic || header.version != kDumpVersion
+        || header.recordSize != sizeof(FlightRecord) || header.keyframeSize != sizeof(FlightKeyframe)
+        || header.ringSize == 0 || (header.ringSize & (header.ringSize - 1)) != 0
+        || bytes.size() != sizeof(header) + keyframeCount * sizeof(FlightKeyframe)
+                           + static_cast<size_t>(header.ringSize) * sizeof(FlightRecord)) {
+        fprintf(stderr, "%s: not a flight dump of this version\n", path.c_str());
+        return false;
+    }
+
+    const char* data = bytes.data() + sizeof(header);
+    dump.keyframes.resize(keyframeCount);
+    memcpy(dump.keyframes.data(), data, keyframeCount * sizeof(FlightKeyframe));
+    data += keyframeCount * sizeof(FlightKeyframe);
+
+    std::vector<FlightRecord> ring(header.ringSize);
+    memcpy(ring.data(), data, ring.size() * sizeof(FlightRecord));
+    for (uint32_t pos = 0; pos < header.ringSize; ++pos) {
+        const FlightRecord& record = ring[pos];
+        uint32_t index = record.sequence - 1;
+        // Skips records being written, never written, or older than the ring
+        if (record.sequence == 0 || (index & (header.ringSize - 1)) != pos
+            || header.head - index - 1 >= header.ringSize) {
+            continue;
+        }
+        dump.records.push_back(record);
+    }
+    std::sort(dump.records.begin(), dump.records.end(), [&](const FlightRecord& a, const FlightRecord& b) {
+        return header.head - a.sequence > header.head - b.sequence;
+    });
+    return true;
+}
+
+const FlightKeyframe* findKeyframe(const Dump& dump, uint8_t session, uint32_t serial) {
+    for (const FlightKeyframe& keyframe : dump.keyframes) {
+        if (keyframe.serial == serial && keyframe.check == serial && keyframe.session == session
+            && keyframe.size <= sizeof(keyframe.state)) {
+            return &keyframe;
+        }
+    }
+    return nullptr;
+}
+
+void printSummary(const Dump& dump, size_t last) {
+    const FlightDumpHeader& header = dump.header;
+    if (header.reason == 0) {
+        printf("Dump: JNI call stalled\n");
+    } else {
+        printf("Dump: signal %d (%s)\n", header.reason, strsignal(header.reason));
+    }
+    if (dump.records.empty()) {
+        printf("No records\n");
+        return;
+    }
+    printf("%zu records over the last %u ms (%u written in total)\n", dump.records.size(),
+           header.timeMs - dump.records.front().timeMs, header.head);
+
+    std::map<uint8_t, size_t> counts;
+    std::vector<uint32_t> frameMicros;
+    std::map<uint32_t, const FlightRecord*> inFlight; // Thread id -> its open JNI call
+    for (const FlightRecord& record : dump.records) {
+        counts[record.kind]++;
+        auto kind = static_cast<RecordKind>(record.kind);
+        if (kind == RecordKind::Frame) {
+            frameMicros.push_back(record.value);
+        } else if (kind == RecordKind::JniEnter) {
+            inFlight[record.value] = &record;
+        } else if (kind == RecordKind::JniExit) {
+            inFlight.erase(record.value);
+        }
+    }
+    for (const auto& [kind, count] : counts) {
+        printf("  %-10s %zu\n", kindName(kind), count);
+    }
+    if (!frameMicros.empty()) {
+        std::sort(frameMicros.begin(), frameMicros.end());
+        printf("Render time: median %u us, p99 %u us, max %u us\n", frameMicros[frameMicros.size() / 2],
+               frameMicros[frameMicros.size() * 99 / 100], frameMicros.back());
+    }
+    for (const auto& [thread, record] : inFlight) {
+        printf("Thread %u inside %s for %u ms\n", thread, methodName(record->arg), header.timeMs - record->timeMs);
+    }
+
+    printf("Last records (ms before the dump):\n");
+    for (size_t i = dump.records.size() - std::min(last, dump.records.size()); i < dump.records.size(); ++i) {
+        const FlightRecord& record = dump.records[i];
+        printf("  %8u  %-10s session %u  ", header.timeMs - record.timeMs, kindName(record.kind), record.session);
+        switch (static_cast<RecordKind>(record.kind)) {
+            case RecordKind::Input:
+                printf("%s, hash %08x\n", inputName(record.arg), record.value);
+                break;
+            case RecordKind::Frame:
+                printf("%u us\n", record.value);
+                break;
+            case RecordKind::JniEnter:
+            case RecordKind::JniExit:
+                printf("%s, thread %u\n", methodName(record.arg), record.value);
+                break;
+            case RecordKind::Stall:
+                printf("%s, %u ms\n", methodName(record.arg), record.value);
+                break;
+            case RecordKind::Keyframe:
+                printf("serial %u%s\n", record.value, record.arg ? ", new game" : "");
+                break;
+            default:
+                printf("%08x\n", record.value);
+                break;
+        }
+    }
+}
+
+// Replays the last game of the session that a keyframe is left for; false if nothing to replay
+// or a hash differs
+bool replaySession(const Dump& dump, int session, const std::string& output) {
+    const std::vector<FlightRecord>& records = dump.records;
+    if (session < 0) {
+        for (auto it = records.rbegin(); it != records.rend() && session < 0; ++it) {
+            if (static_cast<RecordKind>(it->kind) == RecordKind::Input) {
+                session = it->session;
+            }
+        }
+        if (session < 0) {
+            printf("No inputs to replay\n");
+            return false;
+        }
+    }
+
+    // The oldest keyframe still held after the last new game
+    size_t start = records.size();
+    const FlightKeyframe* keyframe = nullptr;
+    for (size_t i = 0; i < records.size(); ++i) {
+        const FlightRecord& record = records[i];
+        if (record.session != session || static_cast<RecordKind>(record.kind) != RecordKind::Keyframe) {
+            continue;
+        }
+        if (record.arg || !keyframe) {
+            keyframe = findKeyframe(dump, record.session, record.value);
+            start = keyframe ? i : records.size();
+        }
+    }
+    if (!keyframe) {
+        printf("Session %d: no keyframe of its last game is left in the dump\n", session);
+        return false;
+    }
+
+    Game game(keyframe->seed, static_cast<RandomizerKind>(keyframe->randomizer));
+    ByteReader state(keyframe->state, keyframe->size);
+    if (!game.readState(state)) {
+        printf("Session %d: keyframe %u is malformed\n", session, keyframe->serial);
+        return false;
+    }
+    ReplayWriter writer;
+    if (!output.empty() && !writer.begin(output, game)) {
+        return false;
+    }
+
+    uint32_t inputs = 0;
+    uint32_t divergence = 0; // Input number of the first differing hash, 0 = none
+    for (size_t i = start + 1; i < records.size(); ++i) {
+        const FlightRecord& record = records[i];
+        if (record.session != session || static_cast<RecordKind>(record.kind) != RecordKind::Input
+            || record.arg >= static_cast<uint16_t>(ReplayInput::Count)) {
+            continue;
+        }
+        auto input = static_cast<ReplayInput>(record.arg);
+        applyReplayInput(game, input);
+        writer.record(input, game);
+        inputs++;
+        if (!divergence && stateHash(game) != record.value) {
+            divergence = inputs;
+            printf("Session %d: input %u (%s, %u ms before the dump) does not reproduce: hash %08x, recorded %08x\n",
+                   session, inputs, inputName(record.arg), dump.header.timeMs - record.timeMs,
+                   stateHash(game), record.value);
+        }
+    }
+    writer.finish();
+
+    printf("Session %d: replayed %u inputs over %u ms from keyframe %u (score %d, lines %d, level %d%s), %s\n",
+           session, inputs, dump.header.timeMs - records[start].timeMs, keyframe->serial, game.getScore(),
+           game.getLines(), game.getLevel(), game.isGameOver() ? ", game over" : "",
+           divergence ? "DIVERGED" : "all hashes match");
+    if (!output.empty()) {
+        printf("Replay written to %s\n", output.c_str());
+    }
+    return divergence == 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string input;
+    std::string output;
+    int session = -1; // The one with the last input
+    size_t last = 24;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--out" && hasValue) {
+            output = argv[++i];
+        } else if (arg == "--session" && hasValue) {
+            session = atoi(argv[++i]);
+        } else if (arg == "--last" && hasValue) {
+            last = static_cast<size_t>(std::max(0, atoi(argv[++i])));
+        } else if (input.empty() && arg[0] != '-') {
+            input = arg;
+        } else {
+            input.clear();
+            break;
+        }
+    }
+    if (input.empty()) {
+        printf("usage: palibrix_flight_replay DUMP [--session N] [--last N] [--out REPLAY]\n");
+        return 2;
+    }
+
+    Dump dump;
+    if (!readDump(input, dump)) {
+        return 1;
+    }
+    printSummary(dump, last);
+    return replaySession(dump, session, output) ? 0 : 1;
+}
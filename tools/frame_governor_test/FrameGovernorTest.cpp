@@ -0,0 +1,176 @@
+// Drives FrameGovernor (see FrameGovernor.h) with a fake clock: the rate it picks for input,
+// slow and fast gravity, effects, pause and game over, and how long beginFrame() holds the render
+// thread. The wake tests wait on real time, since the governor's condition variable does; each
+// idle wait they cut short would otherwise last half a second.
+//
+//   palibrix_frame_governor_test
+//
+// Prints every failed check and exits with 1 if there were any.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+#include "FrameGovernor.h"
+
+namespace {
+
+constexpr int64_t kMs = 1000000;
+
+std::atomic<int64_t> gNow{1000 * kMs};
+int gFailures = 0;
+
+int64_t fakeClock() {
+    return gNow.load();
+}
+
+void advance(int64_t ns) {
+    gNow += ns;
+}
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++gFailures; \
+        } \
+    } while (0)
+
+// Real milliseconds fn takes
+template<typename Fn>
+int64_t elapsedMs(Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Starts beginFrame() on another thread, gives it time to start waiting, runs wakeUp, and returns
+// the real milliseconds beginFrame() took and the rate it returned
+int64_t wakeWaitingFrame(FrameGovernor& governor, bool gameOver, void (*wakeUp)(FrameGovernor&), float& rate) {
+    int64_t ms = 0;
+    std::thread render([&]() { ms = elapsedMs([&]() { rate = governor.beginFrame(gameOver, false); }); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    wakeUp(governor);
+    render.join();
+    return ms;
+}
+
+void testInputHold() {
+    FrameGovernor governor(fakeClock);
+    // Creation counts as input, and gravity is unknown until two steps have been seen
+    CHECK(governor.chooseRate(false, false) == FrameGovernor::kFullRate);
+    advance(FrameGovernor::kInputHoldNs + kMs);
+    CHECK(governor.chooseRate(false, false) == FrameGovernor::kFullRate);
+}
+
+void testSlowGravity() {
+    FrameGovernor governor(fakeClock);
+    governor.onGravityStep();
+    advance(500 * kMs);
+    governor.onGravityStep();
+    advance(FrameGovernor::kInputHoldNs);
+    CHECK(governor.chooseRate(false, false) == FrameGovernor::kReducedRate);
+
+    // Input brings full rate back for the hold time
+    governor.onInput();
+    CHECK(governor.chooseRate(false, false) == FrameGovernor::kFullRate);
+    advance(FrameGovernor::kInputHoldNs - kMs);
+    CHECK(governor.chooseRate(false, false) == FrameGovernor::kFullRate);
+    advance(2 * kMs);
+    CHECK(governor.chooseRate(false, false) == FrameGovernor::kReducedRate);
+
+    // Effects always get full rate while playing
+    CHECK(governor.chooseRate(false, true) == FrameGovernor::kFullRate);
+
+    // Gravity speeding up past the threshold is fast again
+    governor.onGravityStep();
+    advance(FrameGovernor::kSlowGravityNs / 2);
+    governor.onGravityStep();
+    CHECK(governor.chooseRate(false, false) == FrameGovernor::kFullRate);
+}
+
+void testGravityGap() {
+    FrameGovernor governor(fakeClock);
+    governor.onGravityStep();
+    advance(50 * kMs);
+    governor.onGravityStep();
+    // A long gap is a pause, not slow gravity; the last known interval stays
+    advance(5000 * kMs);
+    governor.onGravityStep();
+    CHECK(governor.chooseRate(false, false) == FrameGovernor::kFullRate);
+}
+
+void testIdle() {
+    FrameGovernor governor(fakeClock);
+    CHECK(governor.chooseRate(true, false) == FrameGovernor::kIdleRate);
+    CHECK(governor.chooseRate(true, true) == FrameGovernor::kReducedRate);
+
+    governor.setPaused(true);
+    CHECK(governor.chooseRate(false, false) == FrameGovernor::kIdleRate);
+    CHECK(governor.chooseRate(false, true) == FrameGovernor::kReducedRate);
+    governor.onInput(); // Input does not end a pause
+    CHECK(governor.chooseRate(false, false) == FrameGovernor::kIdleRate);
+
+    // Resuming counts as input
+    advance(FrameGovernor::kInputHoldNs * 2);
+    governor.setPaused(false);
+    CHECK(governor.chooseRate(false, false) == FrameGovernor::kFullRate);
+}
+
+void testFrameDelay() {
+    FrameGovernor governor(fakeClock);
+    CHECK(governor.beginFrame(false, false) == FrameGovernor::kFullRate);
+    CHECK(governor.getFrameDelay(FrameGovernor::kFullRate) == 0);
+    CHECK(governor.getFrameDelay(FrameGovernor::kIdleRate) == 500 * kMs);
+    advance(100 * kMs);
+    CHECK(governor.getFrameDelay(FrameGovernor::kIdleRate) == 400 * kMs);
+    advance(1000 * kMs);
+    CHECK(governor.getFrameDelay(FrameGovernor::kIdleRate) == 0);
+}
+
+void testWake() {
+    FrameGovernor governor(fakeClock);
+    governor.beginFrame(true, false); // Sets the last frame; the clock then stands still
+    float rate = 0.0f;
+
+    // Game over waits 500 ms for the next frame; input cuts that short
+    int64_t ms = wakeWaitingFrame(governor, true, [](FrameGovernor& g) { g.onInput(); }, rate);
+    CHECK(ms < 400);
+    CHECK(rate == FrameGovernor::kIdleRate);
+
+    // Resuming from a pause wakes the thread into full rate
+    governor.setPaused(true);
+    governor.beginFrame(false, false);
+    ms = wakeWaitingFrame(governor, false, [](FrameGovernor& g) { g.setPaused(false); }, rate);
+    CHECK(ms < 400);
+    CHECK(rate == FrameGovernor::kFullRate);
+
+    // A wake that arrives before the thread waits is not lost, but answers only one frame
+    governor.setPaused(true);
+    governor.beginFrame(false, false);
+    governor.onInput();
+    ms = elapsedMs([&]() { rate = governor.beginFrame(false, false); });
+    CHECK(ms < 100);
+    CHECK(rate == FrameGovernor::kIdleRate);
+    ms = wakeWaitingFrame(governor, false, [](FrameGovernor& g) { g.onInput(); }, rate);
+    CHECK(ms >= 40);
+    CHECK(ms < 400);
+}
+
+} // namespace
+
+int main() {
+    testInputHold();
+    testSlowGravity();
+    testGravityGap();
+    testIdle();
+    testFrameDelay();
+    testWake();
+    if (gFailures > 0) {
+        printf("%d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
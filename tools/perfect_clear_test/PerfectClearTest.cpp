@@ -0,0 +1,341 @@
+// Checks PerfectClearFinder (see PerfectClear.h) against the real game. Every solution it returns
+// is played out on a Game with moves, rotations, soft drops and hold, the way a player would
+// reach each placement, and the board must end up empty. Hand-made setups check that solvable
+// boards are found (a 1-wide well for an I, with and without hold) and that hopeless ones are not.
+//
+//   palibrix_perfect_clear_test
+//
+// Prints every failed check and exits with 1 if there were any.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "ByteStream.h"
+#include "PerfectClear.h"
+#include "TetrominoData.h"
+
+namespace {
+
+int gFailures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++gFailures; \
+        } \
+    } while (0)
+
+// Generous, so that a slow machine does not turn a solvable setup into a miss
+constexpr double kTimeLimitMs = 5000.0;
+
+// Offsets into Game::writeState: the board two cells per byte, then the current piece, the held
+// piece, flags and the next queue
+constexpr size_t kStateBoardBytes = BOARD_HEIGHT * BOARD_WIDTH / 2;
+constexpr size_t kStatePiece = kStateBoardBytes;
+constexpr size_t kStateHeld = kStateBoardBytes + 4;
+constexpr size_t kStateFlags = kStateBoardBytes + 5;
+constexpr size_t kStateQueueSize = kStateBoardBytes + 6;
+
+/*
+ * Puts a setup into a game through its keyframe state: rows are drawn top to bottom and sit on
+ * the floor ('X' filled), pieces lists the current piece and then the start of the next queue.
+ * Everything else keeps the values of a new game with this seed.
+ */
+bool setUp(Game& game, const std::vector<const char*>& rows, const std::vector<TetrominoType>& pieces,
+           TetrominoType held = TetrominoType::EMPTY, bool canHold = true) {
+    uint8_t state[Game::kMaxStateSize];
+    ByteWriter out(state, sizeof(state));
+    game.writeState(out);
+
+    for (int y = 0; y < BOARD_HEIGHT; ++y) {
+        for (int x = 0; x < BOARD_WIDTH; x += 2) {
+            int row = y - (BOARD_HEIGHT - static_cast<int>(rows.size()));
+            auto cell = [&](int cx) {
+                bool filled = row >= 0 && rows[row][cx] == 'X';
+                return static_cast<int>(filled ? TetrominoType::T : TetrominoType::EMPTY);
+            };
+            state[(y * BOARD_WIDTH + x) / 2] = static_cast<uint8_t>(cell(x) | cell(x + 1) << 4);
+        }
+    }
+    state[kStatePiece] = static_cast<uint8_t>(pieces[0]);
+    state[kStatePiece + 1] = 0;
+    state[kStatePiece + 2] = SPAWN_X + 8;
+    state[kStatePiece + 3] = 8;
+    state[kStateHeld] = static_cast<uint8_t>(held);
+    state[kStateFlags] = canHold ? 1 : 0;
+    for (size_t i = 1; i < pieces.size() && i <= state[kStateQueueSize]; ++i) {
+        state[kStateQueueSize + i] = static_cast<uint8_t>(pieces[i]);
+    }
+
+    ByteReader in(state, out.size());
+    return out.ok() && game.readState(in);
+}
+
+bool boardEmpty(const Game& game) {
+    for (const auto& row : game.getBoard()) {
+        for (TetrominoType cell : row) {
+            if (cell != TetrominoType::EMPTY) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Board cells of a piece, sorted, for comparing placements that differ only in rotation state
+std::vector<int> cellsOf(const Tetromino& piece) {
+    std::vector<int> cells;
+    for (const Mino& mino : tetrominoShapes[static_cast<int>(piece.type)][piece.rotation]) {
+        cells.push_back((piece.y + mino.y) * BOARD_WIDTH + piece.x + mino.x);
+    }
+    std::sort(cells.begin(), cells.end());
+    return cells;
+}
+
+enum class Key { Left, Right, RotateRight, RotateLeft, SoftDrop };
+
+Tetromino afterKey(Tetromino piece, Key key) {
+    switch (key) {
+        case Key::Left: piece.x--; break;
+        case Key::Right: piece.x++; break;
+        case Key::RotateRight: piece.rotation = (piece.rotation + 1) % 4; break;
+        case Key::RotateLeft: piece.rotation = (piece.rotation + 3) % 4; break;
+        case Key::SoftDrop: piece.y++; break;
+    }
+    return piece;
+}
+
+/*
+ * Shortest key sequence that takes the current piece to a resting position covering the same
+ * cells as target, searched with the game's own collision rule. Soft drops never lock here:
+ * only positions the piece can still move down from are expanded downward.
+ */
+bool findKeys(const Game& game, const Tetromino& target, std::vector<Key>& keys) {
+    const Game::Board& board = game.getBoard();
+    const std::vector<int> targetCells = cellsOf(target);
+    constexpr int kXs = BOARD_WIDTH + 6;
+    constexpr int kYs = BOARD_HEIGHT + 4;
+    auto index = [](const Tetromino& p) { return (p.rotation * kXs + p.x + 3) * kYs + p.y + 2; };
+
+    struct Visit {
+        Tetromino piece;
+        int parent;
+        Key key;
+    };
+    std::vector<Visit> visits;
+    std::vector<bool> seen(4 * kXs * kYs, false);
+    visits.push_back({game.getCurrentPiece(), -1, Key::Left});
+    seen[index(game.getCurrentPiece())] = true;
+    for (size_t i = 0; i < visits.size(); ++i) {
+        Tetromino piece = visits[i].piece;
+        if (!Game::fits(board, afterKey(piece, Key::SoftDrop)) && cellsOf(piece) == targetCells) {
+            keys.clear();
+            for (int v = static_cast<int>(i); visits[v].parent >= 0; v = visits[v].parent) {
+                keys.push_back(visits[v].key);
+            }
+            std::reverse(keys.begin(), keys.end());
+            return true;
+        }
+        for (Key key : {Key::Left, Key::Right, Key::RotateRight, Key::RotateLeft, Key::SoftDrop}) {
+            Tetromino next = afterKey(piece, key);
+            if (Game::fits(board, next) && !seen[index(next)]) {
+                seen[index(next)] = true;
+                visits.push_back({next, static_cast<int>(i), key});
+            }
+        }
+    }
+    return false;
+}
+
+/*
+ * Plays the solution on the game: hold where it says, walk each piece to its placement and hard
+ * drop it there. True if every placement was reachable and the board ends up empty with the
+ * promised number of lines cleared.
+ */
+bool playSolution(Game& game, const PerfectClearResult& result) {
+    int lines = game.getLines();
+    for (int i = 0; i < result.stepCount; ++i) {
+        const PerfectClearStep& step = result.steps[i];
+        if (step.hold) {
+            game.hold();
+        }
+        std::vector<Key> keys;
+        if (game.getCurrentPiece().type != step.placement.type || !findKeys(game, step.placement, keys)) {
+            printf("step %d: placement not reachable\n", i);
+            return false;
+        }
+        for (Key key : keys) {
+            switch (key) {
+                case Key::Left: game.move(-1); break;
+                case Key::Right: game.move(1); break;
+                case Key::RotateRight: game.rotate(); break;
+                case Key::RotateLeft: game.rotateLeft(); break;
+                case Key::SoftDrop: game.softDrop(); break;
+            }
+        }
+        if (cellsOf(game.getCurrentPiece()) != cellsOf(step.placement)) {
+            printf("step %d: the game did not follow the keys\n", i);
+            return false;
+        }
+        game.hardDrop();
+    }
+    return boardEmpty(game) && game.getLines() - lines == result.lines && !game.isGameOver();
+}
+
+void testSingleWell() {
+    PerfectClearFinder finder;
+    const std::vector<const char*> well = {
+            "XXXXXXXXX.",
+            "XXXXXXXXX.",
+            "XXXXXXXXX.",
+            "XXXXXXXXX.",
+    };
+
+    // The current piece is the I
+    Game game(7);
+    CHECK(setUp(game, well, {TetrominoType::I, TetrominoType::O, TetrominoType::O}));
+    PerfectClearResult result;
+    CHECK(finder.find(game, 1, result, kTimeLimitMs));
+    CHECK(result.stepCount == 1 && result.lines == 4);
+    CHECK(!result.steps[0].hold);
+    CHECK(playSolution(game, result));
+
+    // The I is next; only holding the O first gets to it
+    CHECK(setUp(game, well, {TetrominoType::O, TetrominoType::I, TetrominoType::O}));
+    CHECK(finder.find(game, 1, result, kTimeLimitMs));
+    CHECK(result.stepCount == 1 && result.steps[0].hold);
+    CHECK(playSolution(game, result));
+
+    // The I is already held
+    CHECK(setUp(game, well, {TetrominoType::S, TetrominoType::Z, TetrominoType::O}, TetrominoType::I));
+    CHECK(finder.find(game, 1, result, kTimeLimitMs));
+    CHECK(result.stepCount == 1 && result.steps[0].hold);
+    CHECK(playSolution(game, result));
+}
+
+void testNarrowWells() {
+    // Two rows with a 2x2 hole: the O, after holding the T
+    PerfectClearFinder finder;
+    Game game(11);
+    CHECK(setUp(game, {"XXXX..XXXX", "XXXX..XXXX"}, {TetrominoType::T, TetrominoType::O, TetrominoType::L}));
+    PerfectClearResult result;
+    CHECK(finder.find(game, 2, result, kTimeLimitMs));
+    CHECK(result.lines == 2);
+    CHECK(playSolution(game, result));
+
+    // An L and a J stacked into a 2-wide, 4-deep well
+    const std::vector<const char*> deepWell = {
+            "XXXX..XXXX",
+            "XXXX..XXXX",
+            "XXXX..XXXX",
+            "XXXX..XXXX",
+    };
+    CHECK(setUp(game, deepWell, {TetrominoType::L, TetrominoType::J, TetrominoType::S}));
+    CHECK(finder.find(game, 2, result, kTimeLimitMs));
+    CHECK(result.lines == 4 && result.stepCount == 2);
+    CHECK(playSolution(game, result));
+
+    // A T point down into its slot
+    CHECK(setUp(game, {"XXX...XXXX", "XXXX.XXXXX"}, {TetrominoType::T, TetrominoType::S, TetrominoType::Z}));
+    CHECK(finder.find(game, 1, result, kTimeLimitMs));
+    CHECK(result.lines == 2 && result.stepCount == 1);
+    CHECK(playSolution(game, result));
+
+    // Three pieces: a flat I on the left and a 2-wide well on the right for the Os
+    const std::vector<const char*> shelf = {
+            "....XXXX..",
+            "XXXXXXXX..",
+            "XXXXXXXX..",
+            "XXXXXXXX..",
+    };
+    CHECK(setUp(game, shelf, {TetrominoType::O, TetrominoType::I, TetrominoType::O, TetrominoType::S}));
+    CHECK(finder.find(game, 3, result, kTimeLimitMs));
+    CHECK(result.lines == 4 && result.stepCount == 3);
+    CHECK(playSolution(game, result));
+}
+
+void testUnsolvable() {
+    PerfectClearFinder finder;
+    Game game(13);
+    PerfectClearResult result;
+
+    // A 1-wide well, but only Os and the hold already used
+    const std::vector<const char*> well = {
+            "XXXXXXXXX.",
+            "XXXXXXXXX.",
+            "XXXXXXXXX.",
+            "XXXXXXXXX.",
+    };
+    std::vector<TetrominoType> os(NEXT_QUEUE_SIZE + 1, TetrominoType::O);
+    CHECK(setUp(game, well, os, TetrominoType::EMPTY, false));
+    CHECK(!finder.find(game, PerfectClearResult::kMaxSteps, result, kTimeLimitMs));
+    CHECK(result.elapsedMs < kTimeLimitMs); // Exhausted, not timed out
+
+    // An odd number of filled cells never leaves a multiple of four to fill
+    CHECK(setUp(game, {"X.........", "XXXXXXXXXX"}, {TetrominoType::I, TetrominoType::T, TetrominoType::L}));
+    CHECK(!finder.find(game, PerfectClearResult::kMaxSteps, result, kTimeLimitMs));
+
+    // Enough pieces for the cells, but not enough of them: 36 cells take 9
+    CHECK(setUp(game, {"X.........", "X.........", "X.........", "X........."},
+                {TetrominoType::I, TetrominoType::I, TetrominoType::I}));
+    CHECK(!finder.find(game, 2, result, kTimeLimitMs));
+}
+
+// Searches the game and, if a solution comes back, plays it; returns whether one was found
+bool solveAndPlay(PerfectClearFinder& finder, Game& game, const char* setup, uint64_t seed) {
+    PerfectClearResult result;
+    if (!finder.find(game, PerfectClearResult::kMaxSteps, result, kTimeLimitMs)) {
+        return false;
+    }
+    bool cleared = playSolution(game, result);
+    if (!cleared) {
+        printf("%s, seed %llu: solution does not clear the board\n", setup, static_cast<unsigned long long>(seed));
+    }
+    CHECK(cleared);
+    return true;
+}
+
+void testOpenings() {
+    PerfectClearFinder finder;
+
+    // Setups like the benchmark's, four times as many: three pieces spread over the floor, the
+    // rest of the queue to finish
+    int setups = 0;
+    int found = 0;
+    for (uint64_t seed = 1; setups < 128; ++seed) {
+        Game game(seed);
+        for (int i = 0; i < 3; ++i) {
+            game.move(i * 3 - 3);
+            game.hardDrop();
+        }
+        bool flat = true;
+        for (TetrominoType cell : game.getBoard()[BOARD_HEIGHT - 5]) {
+            flat &= cell == TetrominoType::EMPTY;
+        }
+        if (!flat || game.getLines() > 0) {
+            continue;
+        }
+        setups++;
+        found += solveAndPlay(finder, game, "opening", seed);
+    }
+    printf("%d/%d openings solvable\n", found, setups);
+    CHECK(found > 0);
+}
+
+} // namespace
+
+int main() {
+    testSingleWell();
+    testNarrowWells();
+    testUnsolvable();
+    testOpenings();
+    if (gFailures > 0) {
+        printf("%d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
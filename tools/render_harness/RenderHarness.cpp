@@ -0,0 +1,632 @@
+// Offscreen renderer harness: renders scripted Game states through the real Renderer into an
+// FBO on a surfaceless EGL/GLES3 context (Mesa llvmpipe is enough), compares the result against
+// golden PNGs and reports CPU frame time, draw calls and GPU time per scene.
+//
+// With --record it needs no GPU at all: GlRecorder stands in for the driver and every scene's
+// per-frame draws, binds, uniform uploads, buffer uploads and redundant state changes are
+// checked against the budgets below.
+//
+// --train N times the PGO training workload (N scripted games), once as pure simulation and once
+// drawing a frame per input, to compare optimized builds of the shared sources.
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES3/gl3.h>
+#include <GLES2/gl2ext.h>
+#include <png.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "AllocAudit.h"
+#include "Game.h"
+#include "GlRecorder.h"
+#include "Renderer.h"
+#include "TetrominoData.h"
+#include "TrainingWorkload.h"
+
+namespace {
+
+constexpr int kWidth = 400;  // Same 20:26 aspect as the renderer's game area
+constexpr int kHeight = 520;
+constexpr float kFrameStep = 1.0f / 60.0f;
+
+struct Options {
+    std::string goldenDir = "golden";
+    std::string outDir = "render_out";
+    std::string scene; // Empty = all
+    bool update = false;
+    int frames = 120;
+    bool record = false; // Check GL call budgets without a GPU instead of rendering
+    bool dump = false;   // Print the recorded call stream of scenes over budget
+    int trainGames = 0;  // Time the training workload instead of running the scenes
+    std::string cacheDir; // Shader binary cache; empty = compile every run
+    int tolerance = 8;              // Per channel, absorbs rasterizer differences between drivers
+    double maxDiffFraction = 0.005; // Share of pixels allowed beyond the tolerance
+};
+
+// ---- Scripted game states ----
+
+int landingRow(const Game::Board& board, Tetromino piece) {
+    while (Game::fits(board, {piece.type, piece.rotation, piece.x, piece.y + 1})) {
+        piece.y++;
+    }
+    return piece.y;
+}
+
+// Simple greedy placer: prefers clears, then few holes, then a low stack. Weak on purpose so that
+// boards look like real play rather than a perfect stack.
+bool bestPlacement(const Game& game, bool preferClears, int& bestRotation, int& bestX) {
+    const Game::Board& board = game.getBoard();
+    const TetrominoType type = game.getCurrentPiece().type;
+    double bestScore = -1e9;
+    bool found = false;
+    for (int rotation = 0; rotation < 4; ++rotation) {
+        for (int x = -3; x < BOARD_WIDTH; ++x) {
+            Tetromino piece{type, rotation, x, 0};
+            if (!Game::fits(board, piece)) continue;
+            piece.y = landingRow(board, piece);
+
+            Game::Board after = board;
+            for (const Mino& mino : tetrominoShapes[static_cast<int>(type)][rotation]) {
+                after[piece.y + mino.y][piece.x + mino.x] = type;
+            }
+            int lines = 0;
+            for (const auto& row : after) {
+                lines += std::none_of(row.begin(), row.end(),
+                                      [](TetrominoType cell) { return cell == TetrominoType::EMPTY; });
+            }
+            int holes = 0;
+            int height = 0;
+            for (int column = 0; column < BOARD_WIDTH; ++column) {
+                bool covered = false;
+                for (int row = 0; row < BOARD_HEIGHT; ++row) {
+                    bool filled = after[row][column] != TetrominoType::EMPTY;
+                    if (filled && !covered) height = std::max(height, BOARD_HEIGHT - row);
+                    holes += covered && !filled;
+                    covered |= filled;
+                }
+            }
+            double score = (preferClears ? lines * 10.0 : 0.0) - holes * 4.0 - height;
+            if (score > bestScore) {
+                bestScore = score;
+                bestRotation = rotation;
+                bestX = x;
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+
+void place(Game& game, int rotation, int x) {
+    for (int i = 0; i < rotation; ++i) {
+        game.rotate();
+    }
+    for (int guard = 0; guard < BOARD_WIDTH && game.getCurrentPiece().x != x; ++guard) {
+        game.move(x < game.getCurrentPiece().x ? -1 : 1);
+    }
+    game.hardDrop();
+}
+
+void playGreedy(Game& game, int pieces, bool preferClears) {
+    for (int i = 0; i < pieces && !game.isGameOver(); ++i) {
+        int rotation = 0;
+        int x = SPAWN_X;
+        bestPlacement(game, preferClears, rotation, x);
+        place(game, rotation, x);
+    }
+}
+
+// Per-frame limits, checked against the worst of the recorded frames. Keep them tight: a
+// change that needs more has to raise them here, visibly.
+struct Budget {
+    int draws;
+    int binds;
+    int uniformUploads;
+    int bufferUploads;
+    int redundant;
+};
+
+struct Scene {
+    const char* name;
+    uint64_t seed;
+    void (*script)(Game& game);
+    int settleFrames; // Frames rendered before the capture, e.g. to let particles fly
+    Budget budget;
+};
+
+// Budgets are the counts as of the render backend split: the board, the static quads, the
+// dynamic quads, the particles and the text are one draw each, view uniforms are only set when
+// they change, and the one upload every frame is the dynamic quad instances.
+// Settle counts include the four frames GLES used to spend restoring with the scene already
+// showing, so the goldens are the same images as before warm-up rendered a blank game instead.
+const Scene kScenes[] = {
+    {"empty", 1, [](Game&) {}, 5, {4, 16, 0, 1, 0}},
+    {"midgame", 2, [](Game& game) { playGreedy(game, 24, false); }, 5, {5, 21, 0, 2, 0}},
+    {"tall", 3,
+     [](Game& game) {
+         // Stack without clearing until the top third of the board is reached
+         for (int i = 0; i < 200 && !game.isGameOver() && game.getGhostPiece().y > 8; ++i) {
+             int rotation = 0;
+             int x = SPAWN_X;
+             bestPlacement(game, false, rotation, x);
+             place(game, rotation, (x + game.getLines() * 3) % (BOARD_WIDTH - 2));
+         }
+     },
+     5, {5, 21, 0, 2, 0}},
+    {"clear", 4,
+     [](Game& game) {
+         playGreedy(game, 12, false);
+         for (int i = 0; i < 40 && game.getLines() == 0 && !game.isGameOver(); ++i) {
+             playGreedy(game, 1, true);
+         }
+         game.hold();
+     },
+     16, {5, 21, 0, 2, 0}},
+};
+
+// ---- EGL / FBO ----
+
+struct Context {
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+    GLuint framebuffer = 0;
+    GLuint colorBuffer = 0;
+    bool timerQueries = false;
+};
+
+bool createContext(Context& ctx) {
+    auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+            eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (!getPlatformDisplay) {
+        fprintf(stderr, "eglGetPlatformDisplayEXT is not available\n");
+        return false;
+    }
+    ctx.display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (ctx.display == EGL_NO_DISPLAY || !eglInitialize(ctx.display, nullptr, nullptr)) {
+        fprintf(stderr, "Could not open a surfaceless EGL display\n");
+        return false;
+    }
+    eglBindAPI(EGL_OPENGL_ES_API);
+    const EGLint contextAttributes[] = {EGL_CONTEXT_MAJOR_VERSION, 3, EGL_NONE};
+    ctx.context = eglCreateContext(ctx.display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttributes);
+    if (ctx.context == EGL_NO_CONTEXT ||
+        !eglMakeCurrent(ctx.display, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx.context)) {
+        fprintf(stderr, "Could not create a GLES3 context (0x%x)\n", eglGetError());
+        return false;
+    }
+
+    glGenRenderbuffers(1, &ctx.colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, ctx.colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, kWidth, kHeight);
+    glGenFramebuffers(1, &ctx.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, ctx.framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, ctx.colorBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "Offscreen framebuffer is incomplete\n");
+        return false;
+    }
+
+    const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+    ctx.timerQueries = extensions && strstr(extensions, "GL_EXT_disjoint_timer_query");
+    printf("GL: %s / %s\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+    return true;
+}
+
+void destroyContext(Context& ctx) {
+    if (ctx.context != EGL_NO_CONTEXT) {
+        glDeleteFramebuffers(1, &ctx.framebuffer);
+        glDeleteRenderbuffers(1, &ctx.colorBuffer);
+        eglMakeCurrent(ctx.display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(ctx.display, ctx.context);
+    }
+    if (ctx.display != EGL_NO_DISPLAY) {
+        eglTerminate(ctx.display);
+    }
+}
+
+// Top row first, as PNG expects
+std::vector<uint8_t> readPixels() {
+    std::vector<uint8_t> pixels(kWidth * kHeight * 4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, kWidth, kHeight, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    const size_t stride = kWidth * 4;
+    for (int row = 0; row < kHeight / 2; ++row) {
+        std::swap_ranges(pixels.begin() + row * stride, pixels.begin() + (row + 1) * stride,
+                         pixels.begin() + (kHeight - 1 - row) * stride);
+    }
+    return pixels;
+}
+
+// ---- PNG ----
+
+bool writePng(const std::string& path, const std::vector<uint8_t>& pixels) {
+    png_image image{};
+    image.version = PNG_IMAGE_VERSION;
+    image.width = kWidth;
+    image.height = kHeight;
+    image.format = PNG_FORMAT_RGBA;
+    if (!png_image_write_to_file(&image, path.c_str(), 0, pixels.data(), 0, nullptr)) {
+        fprintf(stderr, "Could not write %s: %s\n", path.c_str(), image.message);
+        return false;
+    }
+    return true;
+}
+
+bool readPng(const std::string& path, std::vector<uint8_t>& pixels) {
+    png_image image{};
+    image.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_file(&image, path.c_str())) {
+        return false;
+    }
+    image.format = PNG_FORMAT_RGBA;
+    if (image.width != kWidth || image.height != kHeight) {
+        fprintf(stderr, "%s is %ux%u, expected %dx%d\n", path.c_str(), image.width, image.height, kWidth, kHeight);
+        png_image_free(&image);
+        return false;
+    }
+    pixels.resize(PNG_IMAGE_SIZE(image));
+    return png_image_finish_read(&image, nullptr, pixels.data(), 0, nullptr) != 0;
+}
+
+// Returns the share of pixels differing by more than tolerance in any channel and fills a
+// visualization (red where different, dimmed actual elsewhere)
+double compareImages(const std::vector<uint8_t>& actual, const std::vector<uint8_t>& expected,
+                     int tolerance, std::vector<uint8_t>& diff) {
+    diff.resize(actual.size());
+    int different = 0;
+    for (size_t i = 0; i < actual.size(); i += 4) {
+        int worst = 0;
+        for (int channel = 0; channel < 3; ++channel) {
+            worst = std::max(worst, std::abs(actual[i + channel] - expected[i + channel]));
+        }
+        bool bad = worst > tolerance;
+        different += bad;
+        diff[i] = bad ? 255 : actual[i] / 4;
+        diff[i + 1] = bad ? 0 : actual[i + 1] / 4;
+        diff[i + 2] = bad ? 0 : actual[i + 2] / 4;
+        diff[i + 3] = 255;
+    }
+    return different / double(kWidth * kHeight);
+}
+
+// ---- Scene runs ----
+
+struct SceneResult {
+    double cpuMedianMs = 0.0;
+    double cpuP95Ms = 0.0;
+    double gpuMeanMs = -1.0; // < 0 when timer queries are unavailable
+    int draws = 0;
+    const char* golden = "";
+    bool passed = true;
+};
+
+double percentile(std::vector<double> values, double p) {
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, size_t(p * values.size()))];
+}
+
+// Heap allocations made by this thread so far; always 0 unless built with PALIBRIX_ALLOC_AUDIT
+uint64_t allocationCount() {
+#ifdef PALIBRIX_ALLOC_AUDIT
+    return AllocAudit::threadAllocationCount();
+#else
+    return 0;
+#endif
+}
+
+// Warmed-up frames must not allocate, like the app's audited frames
+bool checkAllocations(const char* scene, uint64_t allocations) {
+    if (allocations != 0) {
+        fprintf(stderr, "%s: %llu heap allocation(s) in timed frames\n", scene,
+                static_cast<unsigned long long>(allocations));
+    }
+    return allocations == 0;
+}
+
+// Initializes the renderer and renders a fresh game, which has no events yet, until every GL
+// object exists
+void restore(Renderer& renderer, uint64_t seed, const Options& options) {
+    renderer.setFixedTimeStep(kFrameStep);
+    renderer.updateRenderArea(kWidth, kHeight);
+    if (!options.cacheDir.empty()) {
+        renderer.setShaderCacheDirectory(options.cacheDir);
+    }
+    renderer.initRenderer();
+    Game blank(seed);
+    for (int guard = 0; guard < 64 && renderer.isRestoring(); ++guard) {
+        renderer.render(blank);
+    }
+}
+
+// Restores, then renders the scene's settle frames. The scene's effects start at its first
+// settle frame however many frames restoring takes (fewer with a warm shader cache).
+void warmUp(Renderer& renderer, const Game& game, const Scene& scene, const Options& options) {
+    restore(renderer, scene.seed, options);
+    for (int i = 0; i < scene.settleFrames; ++i) {
+        renderer.render(game);
+    }
+}
+
+SceneResult runScene(const Scene& scene, const Context& ctx, const Options& options) {
+    SceneResult result;
+    Game game(scene.seed);
+    scene.script(game);
+
+    Renderer renderer;
+    warmUp(renderer, game, scene, options);
+    glFinish();
+
+    std::vector<uint8_t> actual = readPixels();
+    std::string goldenPath = options.goldenDir + "/" + scene.name + ".png";
+    std::vector<uint8_t> expected;
+    if (options.update) {
+        result.golden = writePng(goldenPath, actual) ? "updated" : "write failed";
+        result.passed = strcmp(result.golden, "updated") == 0;
+    } else if (!readPng(goldenPath, expected)) {
+        result.golden = "missing";
+        result.passed = false;
+    } else {
+        std::vector<uint8_t> diff;
+        double fraction = compareImages(actual, expected, options.tolerance, diff);
+        result.passed = fraction <= options.maxDiffFraction;
+        result.golden = result.passed ? "match" : "MISMATCH";
+        if (!result.passed) {
+            mkdir(options.outDir.c_str(), 0755);
+            std::string base = options.outDir + "/" + scene.name;
+            writePng(base + ".actual.png", actual);
+            writePng(base + ".diff.png", diff);
+            fprintf(stderr, "%s: %.3f%% of pixels differ, see %s.diff.png\n", scene.name, fraction * 100.0,
+                    base.c_str());
+        }
+    }
+
+    // Timed frames; the CPU time stops before glFinish so it only covers command submission
+    std::vector<double> cpuMs;
+    cpuMs.reserve(options.frames);
+    std::vector<GLuint> queries(ctx.timerQueries ? options.frames : 0);
+    if (!queries.empty()) {
+        glGenQueries(options.frames, queries.data());
+    }
+    uint64_t allocations = 0;
+    for (int frame = 0; frame < options.frames; ++frame) {
+        if (!queries.empty()) glBeginQuery(GL_TIME_ELAPSED_EXT, queries[frame]);
+        auto start = std::chrono::steady_clock::now();
+        uint64_t before = allocationCount();
+        renderer.render(game);
+        allocations += allocationCount() - before;
+        cpuMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        if (!queries.empty()) glEndQuery(GL_TIME_ELAPSED_EXT);
+    }
+    glFinish();
+    result.passed &= checkAllocations(scene.name, allocations);
+    result.cpuMedianMs = percentile(cpuMs, 0.5);
+    result.cpuP95Ms = percentile(cpuMs, 0.95);
+
+    if (!queries.empty()) {
+        GLint disjoint = 0;
+        glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+        if (!disjoint) {
+            double totalNs = 0.0;
+            for (GLuint query : queries) {
+                GLuint ns = 0;
+                glGetQueryObjectuiv(query, GL_QUERY_RESULT, &ns);
+                totalNs += ns;
+            }
+            result.gpuMeanMs = totalNs / options.frames / 1e6;
+        }
+        glDeleteQueries(options.frames, queries.data());
+    }
+
+    // One more frame through a forwarding recorder for the call counts
+    GlRecorder recorder(true);
+    recorder.install();
+    recorder.beginFrame();
+    renderer.render(game);
+    result.draws = recorder.endFrame().draws;
+    recorder.uninstall();
+
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR) {
+        fprintf(stderr, "%s: GL error 0x%x\n", scene.name, error);
+        result.passed = false;
+    }
+    return result;
+}
+
+// Runs a scene on the emulating recorder and checks the worst frame against its budget
+bool checkBudget(const Scene& scene, const Options& options) {
+    GlRecorder recorder(false);
+    recorder.install();
+
+    Game game(scene.seed);
+    scene.script(game);
+    Renderer renderer;
+    warmUp(renderer, game, scene, options);
+
+    GlFrameCounts worst{};
+    uint64_t allocations = 0;
+    for (int frame = 0; frame < options.frames; ++frame) {
+        recorder.beginFrame();
+        uint64_t before = allocationCount();
+        renderer.render(game);
+        allocations += allocationCount() - before;
+        GlFrameCounts counts = recorder.endFrame();
+        worst.draws = std::max(worst.draws, counts.draws);
+        worst.binds = std::max(worst.binds, counts.binds);
+        worst.uniformUploads = std::max(worst.uniformUploads, counts.uniformUploads);
+        worst.bufferUploads = std::max(worst.bufferUploads, counts.bufferUploads);
+        worst.redundant = std::max(worst.redundant, counts.redundant);
+    }
+
+    const Budget& budget = scene.budget;
+    bool passed = worst.draws <= budget.draws && worst.binds <= budget.binds &&
+                  worst.uniformUploads <= budget.uniformUploads && worst.bufferUploads <= budget.bufferUploads &&
+                  worst.redundant <= budget.redundant;
+    bool allocationFree = checkAllocations(scene.name, allocations);
+    printf("%-10s %5d/%-5d %5d/%-5d %5d/%-5d %5d/%-5d %5d/%-5d  %s\n", scene.name, worst.draws, budget.draws,
+           worst.binds, budget.binds, worst.uniformUploads, budget.uniformUploads, worst.bufferUploads,
+           budget.bufferUploads, worst.redundant, budget.redundant,
+           !passed ? "OVER BUDGET" : allocationFree ? "ok" : "ALLOCATES");
+    if (!passed && options.dump) {
+        printf("Last frame of %s:\n", scene.name);
+        recorder.dumpFrame(stdout);
+    }
+    return passed && allocationFree;
+}
+
+void printTraining(const char* mode, const TrainingResult& result) {
+    printf("%-10s %6d games %7d pieces %8d inputs %8d frames %9.3fs %8.2fus/input  checksum %016llx\n", mode,
+           result.games, result.pieces, result.inputs, result.frames, result.seconds,
+           result.seconds * 1e6 / std::max(1, result.inputs), static_cast<unsigned long long>(result.checksum));
+}
+
+// The rendered pass needs a current context: the real one, or the emulating recorder. It runs
+// first so that in audited builds the renderer gets the warm-up a new one gets in the app.
+bool runTraining(const Options& options) {
+    Context ctx;
+    GlRecorder recorder(false);
+    if (options.record) {
+        recorder.install();
+    } else if (!createContext(ctx)) {
+        destroyContext(ctx);
+        return false;
+    }
+    TrainingResult rendered;
+    {
+        Renderer renderer;
+        restore(renderer, 1, options);
+        rendered = runTrainingWorkload(options.trainGames, &renderer);
+        if (!options.record) {
+            glFinish();
+        }
+    }
+    if (options.record) {
+        recorder.uninstall();
+    } else {
+        destroyContext(ctx);
+    }
+
+    TrainingResult simulated = runTrainingWorkload(options.trainGames, nullptr);
+    printTraining("simulate", simulated);
+    printTraining(options.record ? "recorded" : "render", rendered);
+    return rendered.checksum == simulated.checksum;
+}
+
+void printUsage() {
+    printf("usage: palibrix_render_harness [options]\n"
+           "  --golden DIR        golden PNG directory (default: golden)\n"
+           "  --out DIR           where mismatching frames and diffs are written (default: render_out)\n"
+           "  --update            write the current frames as the new goldens\n"
+           "  --scene NAME        run one scene only\n"
+           "  --frames N          timed frames per scene (default: 120)\n"
+           "  --tolerance N       per-channel difference still counted as equal (default: 8)\n"
+           "  --max-diff F        share of pixels allowed beyond the tolerance (default: 0.005)\n"
+           "  --record            check per-frame GL call budgets on a recording backend, no GPU needed\n"
+           "  --dump              with --record, print the call stream of scenes over budget\n"
+           "  --train N           time N training games, simulated and rendered (with --record: on the recorder)\n"
+           "  --cache DIR         keep shader binaries in DIR between runs\n");
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--update") {
+            options.update = true;
+        } else if (arg == "--record") {
+            options.record = true;
+        } else if (arg == "--dump") {
+            options.dump = true;
+        } else if (arg == "--golden" && hasValue) {
+            options.goldenDir = argv[++i];
+        } else if (arg == "--out" && hasValue) {
+            options.outDir = argv[++i];
+        } else if (arg == "--scene" && hasValue) {
+            options.scene = argv[++i];
+        } else if (arg == "--train" && hasValue) {
+            options.trainGames = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--frames" && hasValue) {
+            options.frames = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--tolerance" && hasValue) {
+            options.tolerance = atoi(argv[++i]);
+        } else if (arg == "--max-diff" && hasValue) {
+            options.maxDiffFraction = atof(argv[++i]);
+        } else if (arg == "--cache" && hasValue) {
+            options.cacheDir = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage();
+        return 2;
+    }
+
+    if (options.trainGames > 0) {
+        return runTraining(options) ? 0 : 1;
+    }
+
+    if (options.record) {
+        printf("%-10s %11s %11s %11s %11s %11s\n", "scene", "draws", "binds", "uniforms", "uploads", "redundant");
+        bool passed = true;
+        int ran = 0;
+        for (const Scene& scene : kScenes) {
+            if (!options.scene.empty() && options.scene != scene.name) continue;
+            passed &= checkBudget(scene, options);
+            ran++;
+        }
+        if (ran == 0) {
+            fprintf(stderr, "No scene named %s\n", options.scene.c_str());
+            return 2;
+        }
+        return passed ? 0 : 1;
+    }
+
+    Context ctx;
+    if (!createContext(ctx)) {
+        destroyContext(ctx);
+        return 2;
+    }
+    if (!ctx.timerQueries) {
+        printf("GL_EXT_disjoint_timer_query is not available, GPU time is not reported\n");
+    }
+
+    printf("%-10s %10s %10s %10s %8s  %s\n", "scene", "cpu med", "cpu p95", "gpu mean", "draws", "golden");
+    bool passed = true;
+    int ran = 0;
+    for (const Scene& scene : kScenes) {
+        if (!options.scene.empty() && options.scene != scene.name) continue;
+        SceneResult result = runScene(scene, ctx, options);
+        char gpu[32] = "n/a";
+        if (result.gpuMeanMs >= 0.0) {
+            snprintf(gpu, sizeof(gpu), "%.3fms", result.gpuMeanMs);
+        }
+        printf("%-10s %8.3fms %8.3fms %10s %8d  %s\n", scene.name, result.cpuMedianMs, result.cpuP95Ms, gpu,
+               result.draws, result.golden);
+        passed &= result.passed;
+        ran++;
+    }
+    destroyContext(ctx);
+
+    if (ran == 0) {
+        fprintf(stderr, "No scene named %s\n", options.scene.c_str());
+        return 2;
+    }
+    return passed ? 0 : 1;
+}
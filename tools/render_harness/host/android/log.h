@@ -0,0 +1,24 @@
+#ifndef PALIBRIX_HOST_ANDROID_LOG_H
+#define PALIBRIX_HOST_ANDROID_LOG_H
+
+// Host stand-in for the NDK logging header so that AndroidOut.h builds off-device; logcat
+// output goes to stderr instead.
+
+#include <cstdarg>
+#include <cstdio>
+
+enum {
+    ANDROID_LOG_UNKNOWN = 0, ANDROID_LOG_DEFAULT, ANDROID_LOG_VERBOSE, ANDROID_LOG_DEBUG,
+    ANDROID_LOG_INFO, ANDROID_LOG_WARN, ANDROID_LOG_ERROR, ANDROID_LOG_FATAL, ANDROID_LOG_SILENT
+};
+
+inline int __android_log_print(int, const char* tag, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    fprintf(stderr, "%s: ", tag);
+    int written = vfprintf(stderr, format, args);
+    va_end(args);
+    return written;
+}
+
+#endif //PALIBRIX_HOST_ANDROID_LOG_H
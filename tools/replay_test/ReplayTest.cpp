@@ -0,0 +1,356 @@
+// Records scripted games the way GameSession does, with ticks every 16-17 ms of a fake clock (some
+// frames late) and the rotations, taps and hard drop of a simple placement bot, until 20 minutes
+// of play were recorded. Each file is then read back and checked: the footer counts, verify(),
+// seeking to inputs and times against the game as it was played, and a copy cut short, which has
+// to be rescanned. Prints the bytes per minute of play. Also checks which files pruneReplays()
+// keeps.
+//
+//   palibrix_replay_test [DIR]
+//
+// Writes its replay files to DIR (default: the working directory). Prints every failed check
+// and exits with 1 if there were any.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "ByteStream.h"
+#include "Replay.h"
+#include "TetrominoData.h"
+
+namespace {
+
+constexpr int64_t kSessionMs = 20 * 60 * 1000;
+
+int64_t gNowMs = 0;
+int gFailures = 0;
+std::string gDir = ".";
+
+int64_t fakeClock() {
+    return gNowMs;
+}
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++gFailures; \
+        } \
+    } while (0)
+
+struct Recorded {
+    uint64_t seed;
+    std::vector<ReplayInput> inputs;
+    std::vector<uint32_t> timesMs;
+    uint32_t durationMs;
+};
+
+std::vector<uint8_t> stateOf(const Game& game) {
+    uint8_t state[Game::kMaxStateSize];
+    ByteWriter out(state, sizeof(state));
+    game.writeState(out);
+    return std::vector<uint8_t>(state, state + out.size());
+}
+
+// The recorded game up to the first count inputs
+Game playTo(const Recorded& recorded, uint32_t count) {
+    Game game(recorded.seed);
+    for (uint32_t i = 0; i < count; ++i) {
+        game.setClock(recorded.timesMs[i]);
+        applyReplayInput(game, recorded.inputs[i]);
+    }
+    return game;
+}
+
+struct Placement {
+    int rotation;
+    int x;
+};
+
+// Where a tidy player would drop the current piece: fewest holes, then a low, even stack
+Placement choosePlacement(const Game& game) {
+    TetrominoType type = game.getCurrentPiece().type;
+    Placement best{game.getCurrentPiece().rotation, game.getCurrentPiece().x};
+    int bestScore = 0;
+    bool found = false;
+    for (int rotation = 0; rotation < 4; ++rotation) {
+        for (int x = -3; x < BOARD_WIDTH; ++x) {
+            Tetromino piece{type, rotation, x, 0};
+            if (!game.canPlace(piece)) {
+                continue;
+            }
+            piece.y = game.getLandingRow(piece);
+            Game::Board board = game.getBoard();
+            for (const Mino& mino : tetrominoShapes[static_cast<int>(type)][rotation]) {
+                board[piece.y + mino.y][piece.x + mino.x] = type;
+            }
+            int lines = 0;
+            int holes = 0;
+            int heights[BOARD_WIDTH] = {};
+            for (int row = 0; row < BOARD_HEIGHT; ++row) {
+                bool full = true;
+                for (int column = 0; column < BOARD_WIDTH; ++column) {
+                    bool filled = board[row][column] != TetrominoType::EMPTY;
+                    full &= filled;
+                    if (filled && heights[column] == 0) {
+                        heights[column] = BOARD_HEIGHT - row;
+                    } else if (!filled && heights[column] > 0) {
+                        holes++;
+                    }
+                }
+                lines += full ? 1 : 0;
+            }
+            int height = 0;
+            int bumpiness = 0;
+            for (int column = 0; column < BOARD_WIDTH; ++column) {
+                height += heights[column];
+                bumpiness += column > 0 ? std::abs(heights[column] - heights[column - 1]) : 0;
+            }
+            int score = lines * 80 - holes * 50 - height * 5 - bumpiness * 3;
+            if (!found || score > bestScore) {
+                found = true;
+                bestScore = score;
+                best = {rotation, x};
+            }
+        }
+    }
+    return best;
+}
+
+// Plays one game until it is over or the time runs out
+Recorded recordGame(const std::string& path, uint64_t seed, int64_t endMs, uint64_t& state) {
+    Recorded recorded{seed, {}, {}, 0};
+    Game game(seed);
+    ReplayWriter writer(fakeClock);
+    int64_t startMs = gNowMs;
+    CHECK(writer.begin(path, game));
+
+    auto input = [&](ReplayInput replayInput) {
+        game.setClock(static_cast<uint32_t>(gNowMs - startMs));
+        applyReplayInput(game, replayInput);
+        writer.record(replayInput, game);
+        recorded.inputs.push_back(replayInput);
+        recorded.timesMs.push_back(static_cast<uint32_t>(gNowMs - startMs));
+    };
+    auto random = [&](uint32_t range) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return static_cast<uint32_t>(state >> 33) % range;
+    };
+
+    // A piece about every second: the rotation, then taps toward the chosen column, then a hard
+    // drop, or soft drops until a gravity tick locks it; each input a few ticks after the last,
+    // sometimes a hold first
+    int frame = 0;
+    int nextInput = 20;
+    bool planned = false;
+    Placement target{0, 0};
+    while (!game.isGameOver() && gNowMs < endMs) {
+        // 60 Hz with a dropped frame or a stall now and then
+        gNowMs += random(16) == 0 ? 33 + random(100) : frame++ % 3 == 2 ? 16 : 17;
+        uint32_t locked = game.getEventCount();
+        input(ReplayInput::Tick);
+        planned &= game.getEventCount() == locked;
+        if (--nextInput > 0) {
+            continue;
+        }
+        nextInput = 4 + static_cast<int>(random(8));
+        if (!planned) {
+            if (random(10) == 0 && game.canHold()) {
+                input(ReplayInput::Hold);
+                continue;
+            }
+            target = choosePlacement(game);
+            planned = true;
+        }
+        uint32_t events = game.getEventCount();
+        const Tetromino& piece = game.getCurrentPiece();
+        if (piece.rotation != target.rotation) {
+            input(target.rotation == 3 ? ReplayInput::RotateLeft : ReplayInput::Rotate);
+        } else if (piece.x != target.x) {
+            int x = piece.x;
+            input(target.x < x ? ReplayInput::MoveLeft : ReplayInput::MoveRight);
+            if (game.getCurrentPiece().x == x) {
+                target.x = x; // Blocked; drop it here
+            }
+        } else if (piece.y != game.getLandingRow(piece) && random(3) == 0) {
+            input(ReplayInput::SoftDrop);
+        } else if (piece.y == game.getLandingRow(piece)) {
+            continue; // Soft dropped all the way; a gravity tick locks it
+        } else {
+            input(ReplayInput::HardDrop);
+        }
+        planned &= game.getEventCount() == events;
+        if (random(50) == 0) {
+            writer.flush(); // As a pause would
+        }
+    }
+    writer.finish();
+    recorded.durationMs = static_cast<uint32_t>(gNowMs - startMs);
+    return recorded;
+}
+
+void checkReplay(const std::string& path, const Recorded& recorded) {
+    ReplayReader reader;
+    CHECK(reader.open(path));
+    CHECK(reader.getSeed() == recorded.seed);
+    CHECK(reader.getInputCount() == recorded.inputs.size());
+    CHECK(reader.getDurationMs() == recorded.timesMs.back());
+    CHECK(reader.verify());
+
+    // Seeks to inputs, including ones inside a run of ticks
+    uint32_t count = static_cast<uint32_t>(recorded.inputs.size());
+    int mismatches = 0;
+    for (uint32_t target = 1; target <= count; target += 1 + target / 3) {
+        Game seeked(recorded.seed);
+        CHECK(reader.seekToInput(seeked, target));
+        mismatches += stateOf(seeked) == stateOf(playTo(recorded, target)) ? 0 : 1;
+    }
+    CHECK(mismatches == 0);
+
+    // Seeking to the time of an input lands right after it, with the clock it was played at
+    int others = 0;
+    for (uint32_t target = 0; target + 1 < count; ++target) {
+        if (recorded.inputs[target] == ReplayInput::Tick || recorded.timesMs[target] == recorded.timesMs[target + 1]
+            || others++ % 97 != 0) {
+            continue;
+        }
+        Game seeked(recorded.seed);
+        Game expected = playTo(recorded, target + 1);
+        CHECK(reader.seek(seeked, recorded.timesMs[target]));
+        CHECK(stateOf(seeked) == stateOf(expected));
+        CHECK(seeked.getTime() == expected.getTime());
+    }
+}
+
+void checkCutShort(const std::string& path, const Recorded& recorded) {
+    // Drop the footer, the index and a few bytes of the stream, as a crash would
+    FILE* file = fopen(path.c_str(), "rb");
+    std::vector<uint8_t> data;
+    uint8_t chunk[4096];
+    size_t read;
+    while (file && (read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.insert(data.end(), chunk, chunk + read);
+    }
+    if (file) {
+        fclose(file);
+    }
+    ReplayReader complete;
+    CHECK(complete.open(path));
+    size_t indexSize = complete.getKeyframes().size() * 16 + 20;
+    CHECK(data.size() > indexSize + 3);
+    std::string cutPath = path + ".cut";
+    file = fopen(cutPath.c_str(), "wb");
+    CHECK(file != nullptr);
+    if (!file) return;
+    fwrite(data.data(), 1, data.size() - indexSize - 3, file);
+    fclose(file);
+
+    ReplayReader reader;
+    CHECK(reader.open(cutPath));
+    CHECK(reader.getKeyframes().size() == complete.getKeyframes().size());
+    CHECK(reader.getInputCount() <= recorded.inputs.size());
+    CHECK(reader.getInputCount() + 64 > recorded.inputs.size());
+    CHECK(reader.verify());
+    Game seeked(recorded.seed);
+    CHECK(reader.seekToInput(seeked, reader.getInputCount()));
+    CHECK(stateOf(seeked) == stateOf(playTo(recorded, reader.getInputCount())));
+    remove(cutPath.c_str());
+}
+
+bool exists(const std::string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0;
+}
+
+void writeFile(const std::string& path, size_t size) {
+    FILE* file = fopen(path.c_str(), "wb");
+    CHECK(file != nullptr);
+    if (file) {
+        std::vector<uint8_t> data(size, 0);
+        fwrite(data.data(), 1, data.size(), file);
+        fclose(file);
+    }
+}
+
+void testPrune() {
+    std::string dir = gDir + "/prune";
+    mkdir(dir.c_str(), 0755);
+    // Named like GameSession's recordings; a longer start time is a later one
+    const char* const names[] = {"999999999_01.plr", "1700000000_02.plr", "1700000100_03.plr",
+                                 "1700000200_04.plr", "1700000300_05.plr"};
+    for (const char* name : names) {
+        writeFile(dir + "/" + name, 1000);
+    }
+    writeFile(dir + "/notes.txt", 1000);
+
+    // By count: the oldest two go, other files stay
+    CHECK(pruneReplays(dir, 3, 1000000) == 2);
+    CHECK(!exists(dir + "/" + names[0]) && !exists(dir + "/" + names[1]));
+    CHECK(exists(dir + "/" + names[2]) && exists(dir + "/" + names[4]));
+    CHECK(exists(dir + "/notes.txt"));
+    CHECK(pruneReplays(dir, 3, 1000000) == 0);
+
+    // By size: 2500 bytes hold the newest two
+    CHECK(pruneReplays(dir, 100, 2500) == 1);
+    CHECK(!exists(dir + "/" + names[2]) && exists(dir + "/" + names[3]));
+
+    // The newest recording stays even if it alone is over the limit
+    writeFile(dir + "/1700000400_06.plr", 5000);
+    CHECK(pruneReplays(dir, 100, 2500) == 2);
+    CHECK(exists(dir + "/1700000400_06.plr") && !exists(dir + "/" + names[4]));
+
+    CHECK(pruneReplays(dir + "/missing", 1, 0) == 0);
+    remove((dir + "/1700000400_06.plr").c_str());
+    remove((dir + "/notes.txt").c_str());
+    rmdir(dir.c_str());
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc > 1) {
+        gDir = argv[1];
+    }
+
+    testPrune();
+
+    uint64_t state = 0x9e91a7ull;
+    uint64_t ticks = 0;
+    uint64_t inputs = 0;
+    uint64_t bytes = 0;
+    int games = 0;
+    while (gNowMs < kSessionMs) {
+        std::string path = gDir + "/session" + std::to_string(games) + ".plr";
+        Recorded recorded = recordGame(path, 0x51e55000ull + games, kSessionMs, state);
+        for (ReplayInput input : recorded.inputs) {
+            ticks += input == ReplayInput::Tick ? 1 : 0;
+        }
+        inputs += recorded.inputs.size();
+        struct stat info;
+        CHECK(stat(path.c_str(), &info) == 0);
+        bytes += static_cast<uint64_t>(info.st_size);
+        checkReplay(path, recorded);
+        if (games == 0) {
+            checkCutShort(path, recorded);
+        }
+        remove(path.c_str());
+        games++;
+    }
+
+    double minutes = gNowMs / 60000.0;
+    printf("%d games, %.1f minutes, %llu ticks and %llu other inputs: %llu bytes, %.0f bytes/minute\n", games,
+           minutes, static_cast<unsigned long long>(ticks), static_cast<unsigned long long>(inputs - ticks),
+           static_cast<unsigned long long>(bytes), bytes / minutes);
+    // Ticks alone took two bytes each when every one had its own record
+    CHECK(bytes < ticks);
+    if (gFailures > 0) {
+        printf("%d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
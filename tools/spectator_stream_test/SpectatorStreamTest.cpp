@@ -0,0 +1,181 @@
+// Streams scripted games through SpectatorEncoder, a local socket pair and SpectatorDecoder, and
+// checks that the decoder never fails and that each decoded view equals the game it came from.
+// The stream is decoded once frame by frame and once in uneven chunks, so frames split across
+// reads are covered too. Also checks that a decoder refuses a stream joined after its keyframe.
+//
+//   palibrix_spectator_stream_test
+//
+// Prints every failed check and exits with 1 if there were any.
+
+#include <algorithm>
+#include <cstdio>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "Replay.h"
+#include "SpectatorStream.h"
+
+namespace {
+
+int gFailures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++gFailures; \
+        } \
+    } while (0)
+
+struct Stream {
+    std::vector<uint8_t> bytes;
+    std::vector<size_t> frameSizes;
+    std::vector<SpectatorView> views; // What the game looked like after each frame
+    uint64_t ticks = 0;
+};
+
+// Plays scripted games on a writer thread and streams their frames through a socket pair
+bool recordStream(int games, int inputsPerGame, Stream& stream) {
+    int sockets[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sockets) != 0) {
+        printf("no socket pair\n");
+        return false;
+    }
+
+    std::thread writer([&]() {
+        SpectatorEncoder encoder;
+        uint8_t frame[SpectatorEncoder::kMaxFrameSize];
+        uint64_t state = 0x5bec7a70ull;
+        for (int gameIndex = 0; gameIndex < games; ++gameIndex) {
+            Game game(0x5bec0000ull + gameIndex);
+            for (int i = 0; i < inputsPerGame; ++i) {
+                // Mostly ticks, with a move or rotation now and then and a drop every few dozen
+                state = state * 6364136223846793005ull + 1442695040888963407ull;
+                uint32_t roll = static_cast<uint32_t>(state >> 33) % 100;
+                ReplayInput input = ReplayInput::Hold;
+                if (roll < 80) {
+                    input = ReplayInput::Tick;
+                } else if (roll < 88) {
+                    input = roll & 1 ? ReplayInput::MoveLeft : ReplayInput::MoveRight;
+                } else if (roll < 93) {
+                    input = ReplayInput::Rotate;
+                } else if (roll < 96) {
+                    input = ReplayInput::SoftDrop;
+                } else if (roll < 98) {
+                    input = ReplayInput::HardDrop;
+                }
+                stream.ticks += input == ReplayInput::Tick ? 1 : 0;
+                applyReplayInput(game, input);
+                if (game.isGameOver()) {
+                    game.reset(0x5bec1000ull + i);
+                }
+                size_t size = encoder.encode(game, frame);
+                if (size == 0) {
+                    continue;
+                }
+                stream.frameSizes.push_back(size);
+                stream.views.push_back(SpectatorView::capture(game));
+                for (size_t written = 0; written < size;) {
+                    ssize_t result = write(sockets[0], frame + written, size - written);
+                    if (result <= 0) {
+                        shutdown(sockets[0], SHUT_WR);
+                        return;
+                    }
+                    written += static_cast<size_t>(result);
+                }
+            }
+        }
+        shutdown(sockets[0], SHUT_WR);
+    });
+
+    uint8_t chunk[4096];
+    ssize_t received;
+    while ((received = read(sockets[1], chunk, sizeof(chunk))) > 0) {
+        stream.bytes.insert(stream.bytes.end(), chunk, chunk + received);
+    }
+    writer.join();
+    close(sockets[0]);
+    close(sockets[1]);
+    return true;
+}
+
+void testFrameByFrame(const Stream& stream) {
+    SpectatorDecoder decoder;
+    size_t offset = 0;
+    size_t decoded = 0;
+    size_t mismatches = 0;
+    for (const SpectatorView& expected : stream.views) {
+        size_t size = decoder.decodeFrame(stream.bytes.data() + offset, stream.bytes.size() - offset);
+        if (size == 0) {
+            break;
+        }
+        CHECK(size == stream.frameSizes[decoded]);
+        offset += size;
+        ++decoded;
+        mismatches += decoder.getView() != expected ? 1 : 0;
+    }
+    CHECK(!decoder.failed());
+    CHECK(decoded == stream.views.size());
+    CHECK(decoder.getFrameCount() == stream.views.size());
+    CHECK(offset == stream.bytes.size());
+    CHECK(mismatches == 0);
+}
+
+void testChunked(const Stream& stream) {
+    // Feeds the stream in pieces that split frames, the way reads from a socket do
+    SpectatorDecoder decoder;
+    std::vector<uint8_t> pending;
+    size_t offset = 0;
+    size_t chunk = 1;
+    size_t mismatches = 0;
+    uint32_t checked = 0;
+    while (offset < stream.bytes.size()) {
+        size_t size = std::min(chunk, stream.bytes.size() - offset);
+        pending.insert(pending.end(), stream.bytes.begin() + offset, stream.bytes.begin() + offset + size);
+        offset += size;
+        chunk = chunk % 251 + 37;
+        pending.erase(pending.begin(), pending.begin() + decoder.consume(pending.data(), pending.size()));
+        if (decoder.getFrameCount() > checked) {
+            checked = decoder.getFrameCount();
+            mismatches += decoder.getView() != stream.views[checked - 1] ? 1 : 0;
+        }
+    }
+    CHECK(!decoder.failed());
+    CHECK(decoder.getFrameCount() == stream.views.size());
+    CHECK(pending.empty());
+    CHECK(mismatches == 0);
+}
+
+void testJoinWithoutKeyframe(const Stream& stream) {
+    // Only the first frame is a keyframe, so a decoder starting at the second sees a delta first
+    SpectatorDecoder decoder;
+    size_t first = stream.frameSizes[0];
+    decoder.consume(stream.bytes.data() + first, stream.bytes.size() - first);
+    CHECK(decoder.failed());
+    CHECK(!decoder.hasView());
+}
+
+} // namespace
+
+int main() {
+    Stream stream;
+    if (!recordStream(8, 20000, stream)) {
+        return 1;
+    }
+    CHECK(!stream.views.empty());
+    if (!stream.views.empty()) {
+        testFrameByFrame(stream);
+        testChunked(stream);
+        testJoinWithoutKeyframe(stream);
+    }
+    printf("%zu frames, %.2f bytes/tick\n", stream.views.size(),
+           static_cast<double>(stream.bytes.size()) / stream.ticks);
+    if (gFailures > 0) {
+        printf("%d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
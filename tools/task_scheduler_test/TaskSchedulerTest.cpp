@@ -0,0 +1,273 @@
+// Drives TaskScheduler (see TaskScheduler.h) tick by tick: when sleepers wake and in which order
+// when they share a tick, which waiters an event reaches, cancelling tasks suspended either way,
+// and frames that miss the pool.
+//
+//   palibrix_task_scheduler_test
+//
+// Prints every failed check and exits with 1 if there were any.
+
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+#include "TaskScheduler.h"
+
+namespace {
+
+int gFailures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++gFailures; \
+        } \
+    } while (0)
+
+// (task id, scheduler tick) for every resume the tasks report
+using Log = std::vector<std::pair<int, uint64_t>>;
+
+GameEvent makeEvent(GameEventType type, int lines = 0) {
+    GameEvent event{};
+    event.type = type;
+    event.lines = lines;
+    return event;
+}
+
+// Counts frame destructions, so cancelling can be told apart from leaking
+struct Alive {
+    int& count;
+    explicit Alive(int& count) : count(count) { count++; }
+    ~Alive() { count--; }
+};
+
+Task sleepThenLog(TaskScheduler& scheduler, int id, uint64_t ticks, Log& log) {
+    co_await scheduler.ticks(ticks);
+    log.push_back({id, scheduler.getTick()});
+}
+
+Task sleepTwice(TaskScheduler& scheduler, int id, uint64_t first, uint64_t second, Log& log) {
+    co_await scheduler.ticks(first);
+    log.push_back({id, scheduler.getTick()});
+    co_await scheduler.ticks(second);
+    log.push_back({id, scheduler.getTick()});
+}
+
+Task waitOnce(TaskScheduler& scheduler, int id, GameEventType type, Log& log, GameEvent& seen) {
+    seen = co_await scheduler.event(type);
+    log.push_back({id, scheduler.getTick()});
+}
+
+Task waitAny(TaskScheduler& scheduler, int id, Log& log, GameEvent& seen) {
+    seen = co_await scheduler.event();
+    log.push_back({id, scheduler.getTick()});
+}
+
+// Waits again right away; each signal must reach it once
+Task waitForever(TaskScheduler& scheduler, int id, GameEventType type, Log& log) {
+    for (;;) {
+        co_await scheduler.event(type);
+        log.push_back({id, scheduler.getTick()});
+    }
+}
+
+Task sleepGuarded(TaskScheduler& scheduler, uint64_t ticks, int& alive, int& finished) {
+    Alive guard(alive);
+    co_await scheduler.ticks(ticks);
+    finished++;
+}
+
+Task waitGuarded(TaskScheduler& scheduler, GameEventType type, int& alive, int& finished) {
+    Alive guard(alive);
+    co_await scheduler.event(type);
+    finished++;
+}
+
+// A frame bigger than a pool block: the buffer lives across the suspension
+Task bigFrame(TaskScheduler& scheduler, int& finished) {
+    volatile unsigned char buffer[FramePool::kBlockSize * 2];
+    buffer[0] = 1;
+    co_await scheduler.ticks(1);
+    finished += buffer[0];
+}
+
+void testSleepOrder() {
+    TaskScheduler scheduler;
+    Log log;
+    log.reserve(16);
+
+    // 0 ticks never suspends: logged inside spawn, at tick 0
+    scheduler.spawn(sleepThenLog(scheduler, 0, 0, log));
+    CHECK(log.size() == 1 && log[0] == std::make_pair(0, uint64_t(0)));
+    CHECK(scheduler.getTaskCount() == 0);
+
+    scheduler.spawn(sleepThenLog(scheduler, 1, 5, log));
+    scheduler.spawn(sleepThenLog(scheduler, 2, 3, log));
+    scheduler.spawn(sleepThenLog(scheduler, 3, 5, log));
+    CHECK(scheduler.getTaskCount() == 3);
+    scheduler.advance();
+    scheduler.advance();
+    // Goes to sleep at tick 2, so it wakes at 5 with 1 and 3, but after them
+    scheduler.spawn(sleepThenLog(scheduler, 4, 3, log));
+
+    scheduler.advance(); // Tick 3: only task 2
+    CHECK(log.size() == 2 && log[1] == std::make_pair(2, uint64_t(3)));
+    scheduler.advance();
+    CHECK(log.size() == 2);
+    scheduler.advance(); // Tick 5: same-tick sleepers in the order they went to sleep
+    CHECK(log.size() == 5);
+    CHECK(log[2] == std::make_pair(1, uint64_t(5)));
+    CHECK(log[3] == std::make_pair(3, uint64_t(5)));
+    CHECK(log[4] == std::make_pair(4, uint64_t(5)));
+    CHECK(scheduler.getTaskCount() == 0);
+    CHECK(scheduler.getPool().getBlocksInUse() == 0);
+
+    // A task that sleeps again queues behind the ones already sleeping for the same tick
+    log.clear();
+    scheduler.spawn(sleepTwice(scheduler, 5, 1, 2, log));  // Wakes at 6, then 8
+    scheduler.spawn(sleepThenLog(scheduler, 6, 3, log));   // 8
+    for (int i = 0; i < 3; ++i) {
+        scheduler.advance();
+    }
+    CHECK(log.size() == 3);
+    CHECK(log[0] == std::make_pair(5, uint64_t(6)));
+    CHECK(log[1] == std::make_pair(6, uint64_t(8)));
+    CHECK(log[2] == std::make_pair(5, uint64_t(8)));
+}
+
+void testEventFanOut() {
+    TaskScheduler scheduler;
+    Log log;
+    log.reserve(16);
+    GameEvent seen[4] = {};
+
+    scheduler.spawn(waitOnce(scheduler, 0, GameEventType::PieceLocked, log, seen[0]));
+    scheduler.spawn(waitAny(scheduler, 1, log, seen[1]));
+    scheduler.spawn(waitOnce(scheduler, 2, GameEventType::LineClear, log, seen[2]));
+    scheduler.spawn(waitOnce(scheduler, 3, GameEventType::PieceLocked, log, seen[3]));
+    scheduler.spawn(waitForever(scheduler, 4, GameEventType::PieceLocked, log));
+    CHECK(log.empty());
+
+    // Typed waiters in the order they started waiting, then the ones waiting for any event
+    scheduler.signal(makeEvent(GameEventType::PieceLocked));
+    CHECK(log.size() == 4);
+    CHECK(log.size() == 4 && log[0].first == 0 && log[1].first == 3 && log[2].first == 4 && log[3].first == 1);
+    CHECK(seen[0].type == GameEventType::PieceLocked && seen[1].type == GameEventType::PieceLocked);
+    CHECK(scheduler.getTaskCount() == 2); // The line-clear waiter and the one that waits again
+
+    // Nobody waits for hard drops; the repeating waiter gets each lock once
+    log.clear();
+    scheduler.signal(makeEvent(GameEventType::HardDrop));
+    CHECK(log.empty());
+    scheduler.signal(makeEvent(GameEventType::PieceLocked));
+    CHECK(log.size() == 1 && log[0].first == 4);
+
+    log.clear();
+    scheduler.signal(makeEvent(GameEventType::LineClear, 3));
+    CHECK(log.size() == 1 && log[0].first == 2);
+    CHECK(seen[2].type == GameEventType::LineClear && seen[2].lines == 3);
+    CHECK(scheduler.getTaskCount() == 1);
+}
+
+void testCancel() {
+    int alive = 0;
+    int finished = 0;
+    {
+        TaskScheduler scheduler;
+        for (int i = 0; i < 4; ++i) {
+            scheduler.spawn(sleepGuarded(scheduler, 10 + i, alive, finished));
+            scheduler.spawn(waitGuarded(scheduler, GameEventType::PieceLocked, alive, finished));
+        }
+        scheduler.spawn(waitGuarded(scheduler, GameEventType::LineClear, alive, finished));
+        CHECK(alive == 9);
+        CHECK(scheduler.getPool().getBlocksInUse() == 9);
+
+        scheduler.cancelAll();
+        CHECK(alive == 0);
+        CHECK(finished == 0);
+        CHECK(scheduler.getTaskCount() == 0);
+        CHECK(scheduler.getPool().getBlocksInUse() == 0);
+
+        // Nothing is left to wake
+        for (int i = 0; i < 20; ++i) {
+            scheduler.advance();
+        }
+        scheduler.signal(makeEvent(GameEventType::PieceLocked));
+        scheduler.signal(makeEvent(GameEventType::LineClear));
+        CHECK(finished == 0);
+
+        // The scheduler works as before afterwards
+        scheduler.spawn(sleepGuarded(scheduler, 1, alive, finished));
+        scheduler.spawn(waitGuarded(scheduler, GameEventType::PieceLocked, alive, finished));
+        scheduler.advance();
+        scheduler.signal(makeEvent(GameEventType::PieceLocked));
+        CHECK(finished == 2);
+        CHECK(alive == 0);
+
+        // The destructor cancels what is still suspended
+        scheduler.spawn(sleepGuarded(scheduler, 5, alive, finished));
+        scheduler.spawn(waitGuarded(scheduler, GameEventType::HardDrop, alive, finished));
+        CHECK(alive == 2);
+    }
+    CHECK(alive == 0);
+    CHECK(finished == 2);
+
+    // A task that is never spawned gives its frame back without running
+    TaskScheduler scheduler;
+    {
+        Task task = sleepGuarded(scheduler, 1, alive, finished);
+        CHECK(scheduler.getPool().getBlocksInUse() == 1);
+        CHECK(alive == 0);
+    }
+    CHECK(scheduler.getPool().getBlocksInUse() == 0);
+}
+
+void testPoolFallback() {
+    int alive = 0;
+    int finished = 0;
+    TaskScheduler scheduler(2);
+    for (int i = 0; i < 3; ++i) {
+        scheduler.spawn(sleepGuarded(scheduler, 1 + i, alive, finished));
+    }
+    // The third frame found the pool empty
+    CHECK(scheduler.getPool().getBlocksInUse() == 2);
+    CHECK(scheduler.getPool().getHeapFrames() == 1);
+
+    // A frame too big for a block goes to the heap even with blocks free
+    scheduler.advance(); // Frees the first block
+    CHECK(scheduler.getPool().getBlocksInUse() == 1);
+    scheduler.spawn(bigFrame(scheduler, finished));
+    CHECK(scheduler.getPool().getHeapFrames() == 2);
+    CHECK(scheduler.getPool().getBlocksInUse() == 1);
+
+    // Heap frames run and are freed like pooled ones; pooled blocks return to the pool
+    scheduler.advance();
+    scheduler.advance();
+    CHECK(finished == 4);
+    CHECK(alive == 0);
+    CHECK(scheduler.getTaskCount() == 0);
+    CHECK(scheduler.getPool().getBlocksInUse() == 0);
+
+    // With blocks free again, new frames come from the pool
+    scheduler.spawn(sleepGuarded(scheduler, 1, alive, finished));
+    scheduler.spawn(sleepGuarded(scheduler, 1, alive, finished));
+    CHECK(scheduler.getPool().getHeapFrames() == 2);
+    CHECK(scheduler.getPool().getBlocksInUse() == 2);
+    scheduler.advance();
+    CHECK(finished == 6);
+}
+
+} // namespace
+
+int main() {
+    testSleepOrder();
+    testEventFanOut();
+    testCancel();
+    testPoolFallback();
+    if (gFailures > 0) {
+        printf("%d checks failed\n", gFailures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}